@@ -3,7 +3,7 @@
 
 %module(directors="1") CombinedTileDataSource
 
-!proxy_imports(carto::CombinedTileDataSource, core.MapTile, core.MapBounds, core.StringMap, datasources.TileDataSource, datasources.components.TileData)
+!proxy_imports(carto::CombinedTileDataSource, core.MapTile, core.MapBounds, core.StringMap, core.IntVector, datasources.TileDataSource, datasources.components.TileData)
 
 %{
 #include "datasources/CombinedTileDataSource.h"
@@ -15,11 +15,13 @@
 %include <std_string.i>
 %include <cartoswig.i>
 
+%import "core/IntVector.i"
 %import "datasources/TileDataSource.i"
 
 !polymorphic_shared_ptr(carto::CombinedTileDataSource, datasources.CombinedTileDataSource)
 
 %std_exceptions(carto::CombinedTileDataSource::CombinedTileDataSource)
+%std_exceptions(carto::CombinedTileDataSource::getLatencyHistogram)
 
 %feature("director") carto::CombinedTileDataSource;
 
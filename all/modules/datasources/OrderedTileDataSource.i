@@ -3,7 +3,7 @@
 
 %module(directors="1") OrderedTileDataSource
 
-!proxy_imports(carto::OrderedTileDataSource, core.MapTile, core.MapBounds, core.StringMap, datasources.TileDataSource, datasources.components.TileData)
+!proxy_imports(carto::OrderedTileDataSource, core.MapTile, core.MapBounds, core.StringMap, core.IntVector, datasources.TileDataSource, datasources.components.TileData)
 
 %{
 #include "datasources/OrderedTileDataSource.h"
@@ -15,11 +15,14 @@
 %include <std_string.i>
 %include <cartoswig.i>
 
+%import "core/IntVector.i"
 %import "datasources/TileDataSource.i"
 
 !polymorphic_shared_ptr(carto::OrderedTileDataSource, datasources.OrderedTileDataSource)
 
+%attribute(carto::OrderedTileDataSource, int, HedgingDelay, getHedgingDelay, setHedgingDelay)
 %std_exceptions(carto::OrderedTileDataSource::OrderedTileDataSource)
+%std_exceptions(carto::OrderedTileDataSource::getLatencyHistogram)
 
 %feature("director") carto::OrderedTileDataSource;
 
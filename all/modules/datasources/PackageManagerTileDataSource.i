@@ -5,7 +5,7 @@
 
 #ifdef _CARTO_PACKAGEMANAGER_SUPPORT
 
-!proxy_imports(carto::PackageManagerTileDataSource, core.MapTile, core.MapBounds, core.StringMap, datasources.TileDataSource, datasources.components.TileData, packagemanager.PackageManager)
+!proxy_imports(carto::PackageManagerTileDataSource, core.MapTile, core.MapBounds, core.StringMap, datasources.TileDataSource, datasources.components.TileData, packagemanager.PackageManager, packagemanager.PackageTileLoadStatistics)
 
 %{
 #include "datasources/PackageManagerTileDataSource.h"
@@ -19,10 +19,12 @@
 
 %import "datasources/TileDataSource.i"
 %import "packagemanager/PackageManager.i"
+%import "packagemanager/PackageTileLoadStatistics.i"
 
 !polymorphic_shared_ptr(carto::PackageManagerTileDataSource, datasources.PackageManagerTileDataSource)
 
 !attributestring_polymorphic(carto::PackageManagerTileDataSource, packagemanager.PackageManager, PackageManager, getPackageManager)
+%attributestring(carto::PackageManagerTileDataSource, std::shared_ptr<carto::PackageTileLoadStatistics>, TileLoadStatistics, getTileLoadStatistics)
 %std_exceptions(carto::PackageManagerTileDataSource::PackageManagerTileDataSource)
 
 %feature("director") carto::PackageManagerTileDataSource;
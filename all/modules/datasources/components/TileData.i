@@ -11,6 +11,7 @@
 %}
 
 %include <std_shared_ptr.i>
+%include <std_string.i>
 %include <cartoswig.i>
 
 %import "core/BinaryData.i"
@@ -19,6 +20,8 @@
 
 %attribute(carto::TileData, long long, MaxAge, getMaxAge, setMaxAge)
 %attribute(carto::TileData, bool, ReplaceWithParent, isReplaceWithParent, setReplaceWithParent)
+%attributestring(carto::TileData, std::string, ETag, getETag, setETag)
+%attributestring(carto::TileData, std::string, LastModified, getLastModified, setLastModified)
 %attributestring(carto::TileData, std::shared_ptr<carto::BinaryData>, Data, getData)
 !standard_equals(carto::TileData);
 
@@ -17,6 +17,7 @@
 
 %include <std_string.i>
 %include <std_shared_ptr.i>
+%include <std_vector.i>
 %include <cartoswig.i>
 
 %import "core/MapPos.i"
@@ -37,6 +38,8 @@
 
 %include "geocoding/GeocodingRequest.h"
 
+!value_template(std::vector<std::shared_ptr<carto::GeocodingRequest> >, geocoding.GeocodingRequestVector);
+
 #endif
 
 #endif
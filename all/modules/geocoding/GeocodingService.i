@@ -8,7 +8,7 @@
 
 #ifdef _CARTO_GEOCODING_SUPPORT
 
-!proxy_imports(carto::GeocodingService, geocoding.GeocodingRequest, geocoding.GeocodingResult)
+!proxy_imports(carto::GeocodingService, geocoding.GeocodingRequest, geocoding.GeocodingRequestVector, geocoding.GeocodingResult, geocoding.GeocodingResultVector, geocoding.GeocodingResultVectorVector)
 
 %{
 #include "geocoding/GeocodingService.h"
@@ -32,6 +32,7 @@
 %std_exceptions(carto::GeocodingService::setLanguage)
 %std_exceptions(carto::GeocodingService::setNumResults)
 %std_io_exceptions(carto::GeocodingService::calculateAddresses)
+%std_io_exceptions(carto::GeocodingService::calculateAddressesBatch)
 
 %feature("director") carto::GeocodingService;
 
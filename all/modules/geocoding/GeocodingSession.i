@@ -0,0 +1,36 @@
+#ifndef _GEOCODINGSESSION_I
+#define _GEOCODINGSESSION_I
+
+#pragma SWIG nowarn=325
+
+%module GeocodingSession
+
+#ifdef _CARTO_GEOCODING_SUPPORT
+
+!proxy_imports(carto::GeocodingSession, geocoding.GeocodingService, geocoding.GeocodingRequest, geocoding.GeocodingResult, geocoding.GeocodingResultVector)
+
+%{
+#include "geocoding/GeocodingSession.h"
+#include "components/Exceptions.h"
+#include <memory>
+%}
+
+%include <std_shared_ptr.i>
+%include <cartoswig.i>
+
+%import "geocoding/GeocodingService.i"
+%import "geocoding/GeocodingRequest.i"
+%import "geocoding/GeocodingResult.i"
+
+!shared_ptr(carto::GeocodingSession, geocoding.GeocodingSession)
+
+%attributestring(carto::GeocodingSession, std::shared_ptr<carto::GeocodingService>, Service, getService)
+%std_exceptions(carto::GeocodingSession::GeocodingSession)
+%std_io_exceptions(carto::GeocodingSession::calculateAddresses)
+!standard_equals(carto::GeocodingSession);
+
+%include "geocoding/GeocodingSession.h"
+
+#endif
+
+#endif
@@ -8,7 +8,7 @@
 
 #if defined(_CARTO_GEOCODING_SUPPORT) && defined(_CARTO_OFFLINE_SUPPORT)
 
-!proxy_imports(carto::OSMOfflineGeocodingService, geocoding.GeocodingService, geocoding.GeocodingRequest, geocoding.GeocodingResult, projections.Projection)
+!proxy_imports(carto::OSMOfflineGeocodingService, geocoding.GeocodingService, geocoding.GeocodingRequest, geocoding.GeocodingRequestVector, geocoding.GeocodingResult, geocoding.GeocodingResultVector, geocoding.GeocodingResultVectorVector, projections.Projection)
 
 %{
 #include "geocoding/OSMOfflineGeocodingService.h"
@@ -27,6 +27,7 @@
 
 %std_io_exceptions(carto::OSMOfflineGeocodingService::OSMOfflineGeocodingService)
 %std_io_exceptions(carto::OSMOfflineGeocodingService::calculateAddresses)
+%std_io_exceptions(carto::OSMOfflineGeocodingService::calculateAddressesBatch)
 
 %feature("director") carto::OSMOfflineGeocodingService;
 
@@ -8,7 +8,7 @@
 
 #if defined(_CARTO_GEOCODING_SUPPORT) && defined(_CARTO_OFFLINE_SUPPORT)
 
-!proxy_imports(carto::OSMOfflineReverseGeocodingService, geocoding.ReverseGeocodingService, geocoding.ReverseGeocodingRequest, geocoding.GeocodingResult, projections.Projection)
+!proxy_imports(carto::OSMOfflineReverseGeocodingService, geocoding.ReverseGeocodingService, geocoding.ReverseGeocodingRequest, geocoding.ReverseGeocodingRequestVector, geocoding.GeocodingResult, geocoding.GeocodingResultVector, geocoding.GeocodingResultVectorVector, projections.Projection)
 
 %{
 #include "geocoding/OSMOfflineReverseGeocodingService.h"
@@ -27,6 +27,7 @@
 
 %std_io_exceptions(carto::OSMOfflineReverseGeocodingService::OSMOfflineReverseGeocodingService)
 %std_io_exceptions(carto::OSMOfflineReverseGeocodingService::calculateAddresses)
+%std_io_exceptions(carto::OSMOfflineReverseGeocodingService::calculateAddressesBatch)
 
 %feature("director") carto::OSMOfflineReverseGeocodingService;
 
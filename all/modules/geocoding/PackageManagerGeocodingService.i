@@ -8,7 +8,7 @@
 
 #if defined(_CARTO_GEOCODING_SUPPORT) && defined(_CARTO_PACKAGEMANAGER_SUPPORT)
 
-!proxy_imports(carto::PackageManagerGeocodingService, geocoding.GeocodingService, geocoding.GeocodingRequest, geocoding.GeocodingResult, packagemanager.PackageManager, projections.Projection)
+!proxy_imports(carto::PackageManagerGeocodingService, geocoding.GeocodingService, geocoding.GeocodingRequest, geocoding.GeocodingRequestVector, geocoding.GeocodingResult, geocoding.GeocodingResultVector, geocoding.GeocodingResultVectorVector, packagemanager.PackageManager, projections.Projection)
 
 %{
 #include "geocoding/PackageManagerGeocodingService.h"
@@ -26,6 +26,7 @@
 
 %std_exceptions(carto::PackageManagerGeocodingService::PackageManagerGeocodingService)
 %std_io_exceptions(carto::PackageManagerGeocodingService::calculateAddresses)
+%std_io_exceptions(carto::PackageManagerGeocodingService::calculateAddressesBatch)
 
 %feature("director") carto::PackageManagerGeocodingService;
 
@@ -8,7 +8,7 @@
 
 #if defined(_CARTO_GEOCODING_SUPPORT) && defined(_CARTO_PACKAGEMANAGER_SUPPORT)
 
-!proxy_imports(carto::PackageManagerReverseGeocodingService, geocoding.ReverseGeocodingService, geocoding.ReverseGeocodingRequest, geocoding.GeocodingResult, packagemanager.PackageManager, projections.Projection)
+!proxy_imports(carto::PackageManagerReverseGeocodingService, geocoding.ReverseGeocodingService, geocoding.ReverseGeocodingRequest, geocoding.ReverseGeocodingRequestVector, geocoding.GeocodingResult, geocoding.GeocodingResultVector, geocoding.GeocodingResultVectorVector, packagemanager.PackageManager, projections.Projection)
 
 %{
 #include "geocoding/PackageManagerReverseGeocodingService.h"
@@ -26,6 +26,7 @@
 
 %std_exceptions(carto::PackageManagerReverseGeocodingService::PackageManagerReverseGeocodingService)
 %std_io_exceptions(carto::PackageManagerReverseGeocodingService::calculateAddresses)
+%std_io_exceptions(carto::PackageManagerReverseGeocodingService::calculateAddressesBatch)
 
 %feature("director") carto::PackageManagerReverseGeocodingService;
 
@@ -8,7 +8,7 @@
 
 #ifdef _CARTO_GEOCODING_SUPPORT
 
-!proxy_imports(carto::ReverseGeocodingService, geocoding.ReverseGeocodingRequest, geocoding.GeocodingResult)
+!proxy_imports(carto::ReverseGeocodingService, geocoding.ReverseGeocodingRequest, geocoding.ReverseGeocodingRequestVector, geocoding.GeocodingResult, geocoding.GeocodingResultVector, geocoding.GeocodingResultVectorVector)
 
 %{
 #include "geocoding/ReverseGeocodingService.h"
@@ -28,6 +28,7 @@
 %attributestring(carto::ReverseGeocodingService, std::string, Language, getLanguage, setLanguage)
 %std_exceptions(carto::ReverseGeocodingService::setLanguage)
 %std_io_exceptions(carto::ReverseGeocodingService::calculateAddresses)
+%std_io_exceptions(carto::ReverseGeocodingService::calculateAddressesBatch)
 
 %feature("director") carto::ReverseGeocodingService;
 
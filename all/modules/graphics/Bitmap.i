@@ -30,6 +30,9 @@
 %ignore carto::Bitmap::getPixelData;
 %rename(getPixelData) carto::Bitmap::getPixelDataPtr;
 %ignore carto::Bitmap::CreateFromCompressed(const unsigned char*, std::size_t);
+%ignore carto::Bitmap::DecodePixels;
+%ignore carto::Bitmap::AcquireDecodeBuffer;
+%ignore carto::Bitmap::RecycleDecodeBuffer;
 !standard_equals(carto::Bitmap);
 
 %include "graphics/Bitmap.h"
@@ -22,6 +22,8 @@
 
 %attribute(carto::RasterTileLayer, std::size_t, TextureCacheCapacity, getTextureCacheCapacity, setTextureCacheCapacity)
 %attribute(carto::RasterTileLayer, carto::RasterTileFilterMode::RasterTileFilterMode, TileFilterMode, getTileFilterMode, setTileFilterMode)
+%attribute(carto::RasterTileLayer, bool, OverzoomTileSharing, isOverzoomTileSharing, setOverzoomTileSharing)
+%attribute(carto::RasterTileLayer, bool, TileCompression, isTileCompression, setTileCompression)
 !attributestring_polymorphic(carto::RasterTileLayer, layers.RasterTileEventListener, RasterTileEventListener, getRasterTileEventListener, setRasterTileEventListener)
 %std_exceptions(carto::RasterTileLayer::RasterTileLayer)
 %ignore carto::RasterTileLayer::FetchTask;
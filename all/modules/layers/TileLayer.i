@@ -27,6 +27,8 @@
 %attribute(carto::TileLayer, bool, Preloading, isPreloading, setPreloading)
 %attribute(carto::TileLayer, bool, SynchronizedRefresh, isSynchronizedRefresh, setSynchronizedRefresh)
 %attribute(carto::TileLayer, carto::TileSubstitutionPolicy::TileSubstitutionPolicy, TileSubstitutionPolicy, getTileSubstitutionPolicy, setTileSubstitutionPolicy)
+%attribute(carto::TileLayer, carto::TileSelectionMode::TileSelectionMode, TileSelectionMode, getTileSelectionMode, setTileSelectionMode)
+%attribute(carto::TileLayer, int, MaxTileCount, getMaxTileCount, setMaxTileCount)
 %attribute(carto::TileLayer, float, ZoomLevelBias, getZoomLevelBias, setZoomLevelBias)
 %attribute(carto::TileLayer, int, MaxOverzoomLevel, getMaxOverzoomLevel, setMaxOverzoomLevel)
 %attribute(carto::TileLayer, int, MaxUnderzoomLevel, getMaxUnderzoomLevel, setMaxUnderzoomLevel)
@@ -35,6 +35,8 @@ using std::uint64_t;
 %attributeval(carto::PackageManager, std::vector<std::shared_ptr<carto::PackageInfo> >, ServerPackages, getServerPackages)
 %attributeval(carto::PackageManager, std::vector<std::shared_ptr<carto::PackageInfo> >, LocalPackages, getLocalPackages)
 %attribute(carto::PackageManager, int, ServerPackageListAge, getServerPackageListAge)
+%attribute(carto::PackageManager, int, MaxParallelDownloads, getMaxParallelDownloads, setMaxParallelDownloads)
+%attribute(carto::PackageManager, int, MaxDownloadConnections, getMaxDownloadConnections, setMaxDownloadConnections)
 %attributestring(carto::PackageManager, std::shared_ptr<carto::PackageMetaInfo>, ServerPackageListMetaInfo, getServerPackageListMetaInfo)
 !attributestring_polymorphic(carto::PackageManager, packagemanager.PackageManagerListener, PackageManagerListener, getPackageManagerListener, setPackageManagerListener)
 %std_io_exceptions(carto::PackageManager::PackageManager)
@@ -44,6 +46,7 @@ using std::uint64_t;
 %ignore carto::PackageManager::unregisterOnChangeListener;
 %ignore carto::PackageManager::getSchema;
 %ignore carto::PackageManager::accessLocalPackages;
+%ignore carto::PackageManager::pinLocalPackages;
 !standard_equals(carto::PackageManager);
 
 %include "packagemanager/PackageManager.h"
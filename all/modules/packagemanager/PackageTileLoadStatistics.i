@@ -0,0 +1,28 @@
+#ifndef _PACKAGETILELOADSTATISTICS_I
+#define _PACKAGETILELOADSTATISTICS_I
+
+%module PackageTileLoadStatistics
+
+#ifdef _CARTO_PACKAGEMANAGER_SUPPORT
+
+%{
+#include "packagemanager/PackageTileLoadStatistics.h"
+#include <memory>
+%}
+
+%include <std_shared_ptr.i>
+%include <cartoswig.i>
+
+!shared_ptr(carto::PackageTileLoadStatistics, packagemanager.PackageTileLoadStatistics)
+
+%attribute(carto::PackageTileLoadStatistics, long long, LoadedTileCount, getLoadedTileCount)
+%attribute(carto::PackageTileLoadStatistics, long long, CacheHitCount, getCacheHitCount)
+%attribute(carto::PackageTileLoadStatistics, long long, DecryptTime, getDecryptTime)
+%attribute(carto::PackageTileLoadStatistics, long long, InflateTime, getInflateTime)
+!standard_equals(carto::PackageTileLoadStatistics);
+
+%include "packagemanager/PackageTileLoadStatistics.h"
+
+#endif
+
+#endif
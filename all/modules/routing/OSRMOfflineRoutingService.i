@@ -5,7 +5,7 @@
 
 #if defined(_CARTO_ROUTING_SUPPORT) && defined(_CARTO_OFFLINE_SUPPORT)
 
-!proxy_imports(carto::OSRMOfflineRoutingService, routing.RoutingService, routing.RoutingRequest, routing.RoutingResult, routing.RouteMatchingRequest, routing.RouteMatchingResult)
+!proxy_imports(carto::OSRMOfflineRoutingService, routing.RoutingService, routing.RoutingRequest, routing.RoutingResult, routing.RouteMatchingRequest, routing.RouteMatchingResult, routing.RoutingMatrixRequest, routing.RoutingMatrixResult)
 
 %{
 #include "routing/OSRMOfflineRoutingService.h"
@@ -23,6 +23,7 @@
 %std_io_exceptions(carto::OSRMOfflineRoutingService::OSRMOfflineRoutingService)
 %std_io_exceptions(carto::OSRMOfflineRoutingService::matchRoute)
 %std_io_exceptions(carto::OSRMOfflineRoutingService::calculateRoute)
+%std_io_exceptions(carto::OSRMOfflineRoutingService::calculateMatrix)
 
 %feature("director") carto::OSRMOfflineRoutingService;
 
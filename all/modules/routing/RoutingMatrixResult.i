@@ -0,0 +1,39 @@
+#ifndef _ROUTINGMATRIXRESULT_I
+#define _ROUTINGMATRIXRESULT_I
+
+#pragma SWIG nowarn=325
+
+%module RoutingMatrixResult
+
+#ifdef _CARTO_ROUTING_SUPPORT
+
+!proxy_imports(carto::RoutingMatrixResult, core.DoubleVector)
+
+%{
+#include "routing/RoutingMatrixResult.h"
+#include "components/Exceptions.h"
+#include <memory>
+%}
+
+%include <std_shared_ptr.i>
+%include <std_vector.i>
+%include <cartoswig.i>
+
+%import "core/DoubleVector.i"
+
+!shared_ptr(carto::RoutingMatrixResult, routing.RoutingMatrixResult)
+
+%attribute(carto::RoutingMatrixResult, int, SourceCount, getSourceCount)
+%attribute(carto::RoutingMatrixResult, int, TargetCount, getTargetCount)
+%std_exceptions(carto::RoutingMatrixResult::RoutingMatrixResult)
+%std_exceptions(carto::RoutingMatrixResult::isReachable)
+%std_exceptions(carto::RoutingMatrixResult::getDistance)
+%std_exceptions(carto::RoutingMatrixResult::getTime)
+!standard_equals(carto::RoutingMatrixResult);
+!custom_tostring(carto::RoutingMatrixResult);
+
+%include "routing/RoutingMatrixResult.h"
+
+#endif
+
+#endif
@@ -8,7 +8,7 @@
 
 #ifdef _CARTO_ROUTING_SUPPORT
 
-!proxy_imports(carto::RoutingService, routing.RoutingRequest, routing.RoutingResult, routing.RouteMatchingRequest, routing.RouteMatchingResult)
+!proxy_imports(carto::RoutingService, routing.RoutingRequest, routing.RoutingResult, routing.RouteMatchingRequest, routing.RouteMatchingResult, routing.RoutingMatrixRequest, routing.RoutingMatrixResult)
 
 %{
 #include "routing/RoutingService.h"
@@ -24,6 +24,8 @@
 %import "routing/RoutingResult.i"
 %import "routing/RouteMatchingRequest.i"
 %import "routing/RouteMatchingResult.i"
+%import "routing/RoutingMatrixRequest.i"
+%import "routing/RoutingMatrixResult.i"
 
 !polymorphic_shared_ptr(carto::RoutingService, routing.RoutingService)
 
@@ -31,6 +33,7 @@
 %std_exceptions(carto::RoutingService::setProfile)
 %std_io_exceptions(carto::RoutingService::matchRoute)
 %std_io_exceptions(carto::RoutingService::calculateRoute)
+%std_io_exceptions(carto::RoutingService::calculateMatrix)
 
 %feature("director") carto::RoutingService;
 
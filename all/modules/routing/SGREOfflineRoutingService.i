@@ -5,7 +5,7 @@
 
 #if defined(_CARTO_ROUTING_SUPPORT) && defined(_CARTO_OFFLINE_SUPPORT)
 
-!proxy_imports(carto::SGREOfflineRoutingService, core.Variant, geometry.FeatureCollection, projections.Projection, routing.RoutingService, routing.RoutingRequest, routing.RoutingResult, routing.RouteMatchingRequest, routing.RouteMatchingResult)
+!proxy_imports(carto::SGREOfflineRoutingService, core.Variant, core.StringVector, geometry.Feature, geometry.FeatureCollection, projections.Projection, routing.RoutingService, routing.RoutingRequest, routing.RoutingResult, routing.RouteMatchingRequest, routing.RouteMatchingResult, routing.RoutingMatrixRequest, routing.RoutingMatrixResult)
 
 %{
 #include "routing/SGREOfflineRoutingService.h"
@@ -19,14 +19,18 @@
 
 %import "routing/RoutingService.i"
 %import "core/Variant.i"
+%import "core/StringVector.i"
+%import "geometry/Feature.i"
 %import "geometry/FeatureCollection.i"
 %import "projections/Projection.i"
 
 !polymorphic_shared_ptr(carto::SGREOfflineRoutingService, routing.SGREOfflineRoutingService)
 
 %std_io_exceptions(carto::SGREOfflineRoutingService::SGREOfflineRoutingService)
+%std_exceptions(carto::SGREOfflineRoutingService::setFeature)
 %std_io_exceptions(carto::SGREOfflineRoutingService::matchRoute)
 %std_io_exceptions(carto::SGREOfflineRoutingService::calculateRoute)
+%std_io_exceptions(carto::SGREOfflineRoutingService::calculateMatrix)
 
 %feature("director") carto::SGREOfflineRoutingService;
 
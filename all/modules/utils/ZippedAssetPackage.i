@@ -12,6 +12,7 @@
 %}
 
 %include <std_shared_ptr.i>
+%include <std_string.i>
 %include <std_vector.i>
 %include <cartoswig.i>
 
@@ -22,7 +23,8 @@
 !polymorphic_shared_ptr(carto::ZippedAssetPackage, utils.ZippedAssetPackage)
 
 %attributeval(carto::ZippedAssetPackage, %arg(std::vector<std::string>), LocalAssetNames, getLocalAssetNames)
-%std_exceptions(carto::ZippedAssetPackage::ZippedAssetPackage)
+%attribute(carto::ZippedAssetPackage, std::size_t, CacheCapacity, getCacheCapacity, setCacheCapacity)
+%std_io_exceptions(carto::ZippedAssetPackage::ZippedAssetPackage)
 
 %include "utils/ZippedAssetPackage.h"
 
@@ -112,6 +112,7 @@ static const char valhalla_default_config[] = R"({
     "lru_mem_cache_hard_control": false,
     "max_cache_size": 10000000,
     "max_concurrent_reader_users": 1,
+    "max_idle_readers": 2,
     "shortcuts": true,
     "tile_dir": "",
     "tile_extract": "",
@@ -0,0 +1,284 @@
+#include "MemoryBudgetManager.h"
+#include "components/CancelableThreadPool.h"
+#include "utils/Log.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace carto {
+
+    MemoryBudgetManager::Client::Client(const std::string& name, std::size_t capacity, const UsageFunction& usageFunc, const QuotaFunction& quotaFunc) :
+        _name(name),
+        _usageFunc(usageFunc),
+        _quotaFunc(quotaFunc),
+        _capacity(capacity),
+        _quota(std::numeric_limits<std::size_t>::max()),
+        _hits(0),
+        _misses(0),
+        _hitRate(0),
+        _missRate(0)
+    {
+        MemoryBudgetManager::GetInstance().registerClient(this);
+    }
+
+    MemoryBudgetManager::Client::~Client() {
+        MemoryBudgetManager::GetInstance().unregisterClient(this);
+    }
+
+    std::size_t MemoryBudgetManager::Client::getCapacity() const {
+        return _capacity.load();
+    }
+
+    void MemoryBudgetManager::Client::setCapacity(std::size_t capacity) {
+        // Do not lock the manager here, the caller may hold its own lock. The quota is updated during next rebalancing
+        _capacity.store(capacity);
+        MemoryBudgetManager::GetInstance()._rebalanceRequested.store(true);
+    }
+
+    std::size_t MemoryBudgetManager::Client::getQuota() const {
+        return _quota.load();
+    }
+
+    std::size_t MemoryBudgetManager::Client::getCacheCapacity(std::size_t pinnedSize) const {
+        // The quota covers all caches of the client, the releasable caches get what is left after the pinned elements
+        std::size_t quota = _quota.load();
+        if (quota == std::numeric_limits<std::size_t>::max()) {
+            return _capacity.load();
+        }
+        return std::min(_capacity.load(), quota > pinnedSize ? quota - pinnedSize : 0);
+    }
+
+    void MemoryBudgetManager::Client::recordAccess(bool hit) {
+        if (hit) {
+            _hits++;
+        } else {
+            _misses++;
+        }
+    }
+
+    MemoryBudgetManager& MemoryBudgetManager::GetInstance() {
+        static MemoryBudgetManager instance;
+        return instance;
+    }
+
+    std::size_t MemoryBudgetManager::getMemoryBudget() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _budget;
+    }
+
+    void MemoryBudgetManager::setMemoryBudget(std::size_t budgetInBytes) {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _budget = budgetInBytes;
+        }
+        scheduleRebalance();
+    }
+
+    std::size_t MemoryBudgetManager::getMemoryUsage() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _memoryUsage;
+    }
+
+    void MemoryBudgetManager::onLowMemory() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _lowMemorySignaled = true;
+        }
+        scheduleRebalance();
+    }
+
+    void MemoryBudgetManager::update() {
+        // Called from the render thread, so only schedule the rebalancing here
+        std::chrono::steady_clock::time_point currentTime = std::chrono::steady_clock::now();
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (!_rebalanceRequested.load() && currentTime - _lastUpdateTime < UPDATE_INTERVAL) {
+                return;
+            }
+            _rebalanceRequested.store(false);
+            _lastUpdateTime = currentTime;
+        }
+        scheduleRebalance();
+    }
+
+    MemoryBudgetManager::RebalanceTask::RebalanceTask() {
+    }
+
+    void MemoryBudgetManager::RebalanceTask::run() {
+        if (!isCanceled()) {
+            MemoryBudgetManager::GetInstance().rebalance();
+        }
+    }
+
+    MemoryBudgetManager::MemoryBudgetManager() :
+        _budget(0),
+        _lowMemoryLimit(std::numeric_limits<std::size_t>::max()),
+        _lowMemorySignaled(false),
+        _memoryUsage(0),
+        _lastUpdateTime(),
+        _rebalanceRequested(false),
+        _rebalancePending(false),
+        _clients(),
+        _threadPool(std::make_shared<CancelableThreadPool>()),
+        _updateMutex(),
+        _mutex()
+    {
+        _threadPool->setPoolSize(1);
+    }
+
+    void MemoryBudgetManager::registerClient(Client* client) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _clients.push_back(client);
+        _rebalanceRequested.store(true);
+    }
+
+    void MemoryBudgetManager::unregisterClient(Client* client) {
+        // Wait until the rebalancing that may use the client is finished
+        std::lock_guard<std::mutex> updateLock(_updateMutex);
+        std::lock_guard<std::mutex> lock(_mutex);
+        _clients.erase(std::remove(_clients.begin(), _clients.end(), client), _clients.end());
+        _rebalanceRequested.store(true);
+    }
+
+    void MemoryBudgetManager::scheduleRebalance() {
+        if (!_rebalancePending.exchange(true)) {
+            _threadPool->execute(std::make_shared<RebalanceTask>());
+        }
+    }
+
+    void MemoryBudgetManager::rebalance() {
+        std::lock_guard<std::mutex> updateLock(_updateMutex);
+        _rebalancePending.store(false);
+
+        std::vector<Client*> clients;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            clients = _clients;
+        }
+
+        // Measure the usage without the manager lock, the callbacks take the locks of the caches
+        std::vector<Client::Usage> usages;
+        std::size_t totalUsage = 0;
+        std::size_t totalCapacity = 0;
+        for (Client* client : clients) {
+            Client::Usage usage = client->_usageFunc();
+            usages.push_back(usage);
+            totalUsage += usage.size;
+            totalCapacity += usage.pinnedSize + client->_capacity.load();
+
+            client->_hitRate = client->_hitRate * STATISTICS_DECAY + client->_hits.exchange(0);
+            client->_missRate = client->_missRate * STATISTICS_DECAY + client->_misses.exchange(0);
+        }
+
+        std::size_t budget = 0;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _memoryUsage = totalUsage;
+
+            if (_lowMemorySignaled) {
+                // Shrink the effective budget well below current usage. The limit is relaxed gradually in later updates.
+                Log::Infof("MemoryBudgetManager::rebalance: Reducing memory usage of caches, current usage %u bytes", static_cast<unsigned int>(totalUsage));
+                _lowMemoryLimit = std::min(_lowMemoryLimit, static_cast<std::size_t>(totalUsage * LOW_MEMORY_FACTOR));
+                _lowMemorySignaled = false;
+            } else if (_lowMemoryLimit != std::numeric_limits<std::size_t>::max()) {
+                std::size_t limit = _lowMemoryLimit + static_cast<std::size_t>(totalCapacity * LOW_MEMORY_RECOVERY_RATE);
+                if (limit >= (_budget > 0 ? std::min(_budget, totalCapacity) : totalCapacity)) {
+                    limit = std::numeric_limits<std::size_t>::max();
+                }
+                _lowMemoryLimit = limit;
+            }
+
+            budget = std::min(_budget > 0 ? _budget : std::numeric_limits<std::size_t>::max(), _lowMemoryLimit);
+        }
+
+        std::vector<std::size_t> quotas(clients.size(), std::numeric_limits<std::size_t>::max());
+        if (budget != std::numeric_limits<std::size_t>::max()) {
+            // Pinned elements can not be released, but they still consume the budget
+            double releasableBudget = static_cast<double>(budget);
+            for (const Client::Usage& usage : usages) {
+                releasableBudget -= static_cast<double>(usage.pinnedSize);
+            }
+            releasableBudget = std::max(0.0, releasableBudget);
+
+            // Shares are proportional to the measured size of the caches, weighted by their miss ratios.
+            // Hits and misses are normalized per cache, as caches count their accesses at very different rates.
+            std::vector<double> keys, usedSizes, unusedSizes;
+            for (std::size_t i = 0; i < clients.size(); i++) {
+                const Client* client = clients[i];
+                double accesses = client->_hitRate + client->_missRate;
+                double missRatio = accesses > 0 ? client->_missRate / accesses : 0.0;
+                double capacity = static_cast<double>(client->_capacity.load());
+                double size = static_cast<double>(usages[i].size - std::min(usages[i].size, usages[i].pinnedSize));
+                keys.push_back((1.0 + missRatio * MISS_WEIGHT) * std::max(size, MIN_CLIENT_SIZE));
+                usedSizes.push_back(std::min(size, capacity));
+                unusedSizes.push_back(capacity - std::min(size, capacity));
+            }
+
+            // First distribute the budget between the memory in use, then let the caches grow into the rest
+            std::vector<double> usedShares, unusedShares;
+            Distribute(releasableBudget, usedSizes, keys, usedShares);
+            double remainingBudget = releasableBudget;
+            for (std::size_t i = 0; i < clients.size(); i++) {
+                remainingBudget -= usedShares[i];
+                unusedSizes[i] += usedSizes[i] - usedShares[i];
+            }
+            Distribute(std::max(0.0, remainingBudget), unusedSizes, keys, unusedShares);
+
+            for (std::size_t i = 0; i < clients.size(); i++) {
+                quotas[i] = usages[i].pinnedSize + static_cast<std::size_t>(usedShares[i] + unusedShares[i]);
+            }
+        }
+
+        for (std::size_t i = 0; i < clients.size(); i++) {
+            Client* client = clients[i];
+            if (client->_quota.exchange(quotas[i]) != quotas[i]) {
+                Log::Debugf("MemoryBudgetManager::rebalance: Setting quota of %s to %u bytes", client->_name.c_str(), static_cast<unsigned int>(std::min(quotas[i], static_cast<std::size_t>(std::numeric_limits<unsigned int>::max()))));
+                client->_quotaFunc();
+            }
+        }
+    }
+
+    void MemoryBudgetManager::Distribute(double budget, const std::vector<double>& demands, const std::vector<double>& keys, std::vector<double>& shares) {
+        // Split the budget proportionally to the keys. Demands that are smaller than their proportional share are
+        // satisfied fully and the rest of the budget is split again between the remaining demands.
+        shares.assign(demands.size(), 0.0);
+        std::vector<std::size_t> indices;
+        for (std::size_t i = 0; i < demands.size(); i++) {
+            indices.push_back(i);
+        }
+        bool capped = true;
+        while (capped && !indices.empty()) {
+            double totalKey = 0;
+            for (std::size_t i : indices) {
+                totalKey += keys[i];
+            }
+
+            capped = false;
+            double cappedBudget = 0;
+            for (auto it = indices.begin(); it != indices.end(); ) {
+                if (demands[*it] <= budget * keys[*it] / totalKey) {
+                    shares[*it] = demands[*it];
+                    cappedBudget += demands[*it];
+                    it = indices.erase(it);
+                    capped = true;
+                } else {
+                    it++;
+                }
+            }
+            budget -= cappedBudget;
+            if (!capped) {
+                for (std::size_t i : indices) {
+                    shares[i] = budget * keys[i] / totalKey;
+                }
+            }
+        }
+    }
+
+    const std::chrono::milliseconds MemoryBudgetManager::UPDATE_INTERVAL = std::chrono::milliseconds(1000);
+    const double MemoryBudgetManager::STATISTICS_DECAY = 0.75;
+    const double MemoryBudgetManager::MISS_WEIGHT = 2.0;
+    const double MemoryBudgetManager::MIN_CLIENT_SIZE = 256.0 * 1024.0;
+    const double MemoryBudgetManager::LOW_MEMORY_FACTOR = 0.5;
+    const double MemoryBudgetManager::LOW_MEMORY_RECOVERY_RATE = 0.02;
+
+}
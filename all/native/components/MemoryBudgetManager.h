@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2016 CartoDB. All rights reserved.
+ * Copying and using this code is allowed only according
+ * to license terms, as given in https://cartodb.com/terms/
+ */
+
+#ifndef _CARTO_MEMORYBUDGETMANAGER_H_
+#define _CARTO_MEMORYBUDGETMANAGER_H_
+
+#include "components/CancelableTask.h"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace carto {
+    class CancelableThreadPool;
+
+    /**
+     * An internal class that distributes a global memory budget between the registered memory caches.
+     * Each cache gets one quota that covers all of its memory. Quotas are based on the measured usage of the caches
+     * and on their recent miss ratios, the capacity of each cache remains as its upper limit. Quotas are also reduced
+     * when the OS signals low memory. Usage is measured and quotas are applied in a background thread.
+     */
+    class MemoryBudgetManager {
+    public:
+        /**
+         * Registration of a single memory cache. The registration is valid during the lifetime of the object.
+         * The callbacks are called from the background thread of the manager without the manager lock held.
+         * The client must not be destroyed while holding a lock that the callbacks of any client need.
+         */
+        class Client {
+        public:
+            struct Usage {
+                std::size_t size; // total size of all caches of the client
+                std::size_t pinnedSize; // size of the elements that can not be released, like visible tiles
+
+                Usage(std::size_t size, std::size_t pinnedSize) : size(size), pinnedSize(pinnedSize) { }
+            };
+
+            typedef std::function<Usage()> UsageFunction;
+            typedef std::function<void()> QuotaFunction;
+
+            Client(const std::string& name, std::size_t capacity, const UsageFunction& usageFunc, const QuotaFunction& quotaFunc);
+            ~Client();
+
+            std::size_t getCapacity() const;
+            void setCapacity(std::size_t capacity);
+
+            std::size_t getQuota() const;
+            std::size_t getCacheCapacity(std::size_t pinnedSize) const;
+
+            void recordAccess(bool hit);
+
+        private:
+            friend class MemoryBudgetManager;
+
+            const std::string _name;
+            const UsageFunction _usageFunc;
+            const QuotaFunction _quotaFunc;
+
+            std::atomic<std::size_t> _capacity;
+            std::atomic<std::size_t> _quota;
+            std::atomic<unsigned int> _hits;
+            std::atomic<unsigned int> _misses;
+
+            double _hitRate; // guarded by MemoryBudgetManager::_updateMutex
+            double _missRate; // guarded by MemoryBudgetManager::_updateMutex
+        };
+
+        /**
+         * Returns the singleton instance of the class.
+         * @return The singleton instance of the class.
+         */
+        static MemoryBudgetManager& GetInstance();
+
+        std::size_t getMemoryBudget() const;
+        void setMemoryBudget(std::size_t budgetInBytes);
+
+        std::size_t getMemoryUsage() const;
+
+        void onLowMemory();
+
+        void update();
+
+    private:
+        class RebalanceTask : public CancelableTask {
+        public:
+            RebalanceTask();
+
+            virtual void run();
+        };
+
+        MemoryBudgetManager();
+
+        void registerClient(Client* client);
+        void unregisterClient(Client* client);
+
+        void scheduleRebalance();
+        void rebalance();
+
+        static void Distribute(double budget, const std::vector<double>& demands, const std::vector<double>& keys, std::vector<double>& shares);
+
+        static const std::chrono::milliseconds UPDATE_INTERVAL;
+        static const double STATISTICS_DECAY;
+        static const double MISS_WEIGHT;
+        static const double MIN_CLIENT_SIZE;
+        static const double LOW_MEMORY_FACTOR;
+        static const double LOW_MEMORY_RECOVERY_RATE; // fraction of total capacity restored per update
+
+        std::size_t _budget;
+        std::size_t _lowMemoryLimit;
+        bool _lowMemorySignaled;
+        std::size_t _memoryUsage;
+        std::chrono::steady_clock::time_point _lastUpdateTime;
+        std::atomic<bool> _rebalanceRequested;
+        std::atomic<bool> _rebalancePending;
+
+        std::vector<Client*> _clients;
+
+        std::shared_ptr<CancelableThreadPool> _threadPool;
+
+        mutable std::mutex _updateMutex;
+        mutable std::mutex _mutex;
+    };
+
+}
+
+#endif
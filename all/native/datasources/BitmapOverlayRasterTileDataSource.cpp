@@ -4,8 +4,10 @@
 #include "projections/EPSG3857.h"
 #include "graphics/Bitmap.h"
 #include "graphics/utils/BitmapFilterTable.h"
+#include "graphics/utils/BitmapPyramid.h"
 #include "utils/Log.h"
 
+#include <algorithm>
 #include <array>
 
 #include <cglib/mat.h>
@@ -23,6 +25,30 @@ namespace {
         cglib::mat3x3<double> _matrix;
     };
 
+    template <typename PixelAccessor>
+    void SampleTile(const carto::BitmapFilterTable& filterTable, int tileSize, const PixelAccessor& getPixel, std::vector<unsigned char>& data) {
+        std::size_t sampleIndex = 0;
+        const std::vector<carto::BitmapFilterTable::Sample>& samples = filterTable.getSamples();
+        for (int i = 0; i < tileSize * tileSize; i++) {
+            int count = filterTable.getSampleCounts()[i];
+            if (count == 0) {
+                continue;
+            }
+
+            float color[4] = { 0.5f, 0.5f, 0.5f, 0.5f };
+            for (int j = 0; j < count; j++) {
+                const carto::BitmapFilterTable::Sample& sample = samples[sampleIndex++];
+                const unsigned char* sampleData = getPixel(sample.u, sample.v);
+                for (int c = 0; c < 4; c++) {
+                    color[c] += sampleData[c] * sample.weight;
+                }
+            }
+            for (int c = 0; c < 4; c++) {
+                data[i * 4 + c] = static_cast<unsigned char>(color[c]);
+            }
+        }
+    }
+
 }
 
 namespace carto {
@@ -30,12 +56,143 @@ namespace carto {
     BitmapOverlayRasterTileDataSource::BitmapOverlayRasterTileDataSource(int minZoom, int maxZoom, const std::shared_ptr<Bitmap>& bitmap, const std::shared_ptr<Projection>& projection, const std::vector<MapPos>& mapPoses, const std::vector<ScreenPos>& bitmapPoses) :
         TileDataSource(minZoom, maxZoom),
         _tileSize(256),
+        _bitmapWidth(0),
+        _bitmapHeight(0),
         _origin(cglib::vec2<double>::zero()),
         _transform(cglib::mat3x3<double>::identity()),
         _invTransform(cglib::mat3x3<double>::identity()),
         _bitmap(),
-        _projection(std::make_shared<EPSG3857>())
+        _pyramid(),
+        _projection(std::make_shared<EPSG3857>()),
+        _pyramidThread(),
+        _pyramidCanceled(false),
+        _mutex()
     {
+        initialize(bitmap, projection, mapPoses, bitmapPoses);
+
+        // Full resolution tiles are sampled from the bitmap, only the downsampled levels are stored.
+        // Until the pyramid is ready, all tiles are sampled from the bitmap.
+        _pyramidThread = std::thread(&BitmapOverlayRasterTileDataSource::buildPyramid, this, _bitmap, false, std::string());
+    }
+
+    BitmapOverlayRasterTileDataSource::BitmapOverlayRasterTileDataSource(int minZoom, int maxZoom, const std::shared_ptr<Bitmap>& bitmap, const std::shared_ptr<Projection>& projection, const std::vector<MapPos>& mapPoses, const std::vector<ScreenPos>& bitmapPoses, const std::string& pyramidFileName, bool backgroundBuild) :
+        TileDataSource(minZoom, maxZoom),
+        _tileSize(256),
+        _bitmapWidth(0),
+        _bitmapHeight(0),
+        _origin(cglib::vec2<double>::zero()),
+        _transform(cglib::mat3x3<double>::identity()),
+        _invTransform(cglib::mat3x3<double>::identity()),
+        _bitmap(),
+        _pyramid(),
+        _projection(std::make_shared<EPSG3857>()),
+        _pyramidThread(),
+        _pyramidCanceled(false),
+        _mutex()
+    {
+        initialize(bitmap, projection, mapPoses, bitmapPoses);
+
+        if (backgroundBuild) {
+            _pyramidThread = std::thread(&BitmapOverlayRasterTileDataSource::buildPyramid, this, _bitmap, true, pyramidFileName);
+        } else {
+            buildPyramid(_bitmap, true, pyramidFileName);
+        }
+    }
+
+    BitmapOverlayRasterTileDataSource::~BitmapOverlayRasterTileDataSource() {
+        _pyramidCanceled = true;
+        if (_pyramidThread.joinable()) {
+            _pyramidThread.join();
+        }
+    }
+
+    MapBounds BitmapOverlayRasterTileDataSource::getDataExtent() const {
+        if (_bitmapWidth == 0 || _bitmapHeight == 0) {
+            return MapBounds(MapPos(0, 0), MapPos(0, 0));
+        }
+
+        // Calculate map positions of 4 bitmap corners
+        MapBounds bounds;
+        for (int y = 0; y <= 1; y++) {
+            for (int x = 0; x <= 1; x++) {
+                cglib::vec2<double> p = _origin + cglib::transform_point_affine(cglib::vec2<double>(x * _bitmapWidth, y * _bitmapHeight), _transform);
+                bounds.expandToContain(MapPos(p(0), p(1)));
+            }
+        }
+        return bounds;
+    }
+
+    std::shared_ptr<TileData> BitmapOverlayRasterTileDataSource::loadTile(const MapTile& mapTile) {
+        std::shared_ptr<Bitmap> bitmap;
+        std::shared_ptr<BitmapPyramid> pyramid;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            bitmap = _bitmap;
+            pyramid = _pyramid;
+        }
+        if (!bitmap && !pyramid) {
+            return std::shared_ptr<TileData>();
+        }
+
+        // Calculate tile bounds
+        MapBounds projBounds = _projection->getBounds();
+        double scaleX =  projBounds.getDelta().getX() / (1 << mapTile.getZoom());
+        double scaleY = -projBounds.getDelta().getY() / (1 << mapTile.getZoom());
+        cglib::vec2<double> projP0(projBounds.getMin().getX(), projBounds.getMax().getY());
+        cglib::vec2<double> tileP0(projP0(0) - _origin(0) + scaleX * mapTile.getX(), projP0(1) - _origin(1) + scaleY * mapTile.getY());
+
+        // Calculate transform for tile pixel -> source pixel
+        cglib::mat3x3<double> invTransform = _invTransform * cglib::translate3_matrix(cglib::vec3<double>(tileP0(0), tileP0(1), 1)) * cglib::scale3_matrix(cglib::vec3<double>(scaleX / _tileSize, scaleY / _tileSize, 1));
+
+        // Find tile area in raster space
+        int minU, minV, maxU, maxV;
+        if (!BitmapFilterTable::calculateFilterBounds(ProjectiveTransform(invTransform), _tileSize, _tileSize, _bitmapWidth, _bitmapHeight, minU, minV, maxU, maxV, MAX_FILTER_WIDTH)) {
+            Log::Infof("BitmapOverlayRasterTileDataSource: Tile %s outside of bitmap", mapTile.toString().c_str());
+            return std::shared_ptr<TileData>();
+        }
+
+        // Select the pyramid level where a tile pixel covers 1-2 source pixels
+        int level = 0;
+        if (pyramid) {
+            cglib::vec2<double> uv0 = ProjectiveTransform(invTransform)(_tileSize / 2 + 0, _tileSize / 2 + 0);
+            cglib::vec2<double> uvx = ProjectiveTransform(invTransform)(_tileSize / 2 + 1, _tileSize / 2 + 0) - uv0;
+            cglib::vec2<double> uvy = ProjectiveTransform(invTransform)(_tileSize / 2 + 0, _tileSize / 2 + 1) - uv0;
+            double scale = std::max(cglib::length(uvx), cglib::length(uvy));
+            while (level + 1 < pyramid->getLevelCount() && scale >= 2.0) {
+                scale *= 0.5;
+                level++;
+            }
+        }
+        bool pyramidLevel = pyramid && pyramid->hasLevel(level);
+        if (!pyramidLevel && !bitmap) {
+            return std::shared_ptr<TileData>();
+        }
+
+        // Calculate transform for tile pixel -> level pixel. Level pixel centers are at the centers of the corresponding source pixel blocks
+        double levelScale = static_cast<double>(1 << level);
+        cglib::mat3x3<double> levelTransform = cglib::scale3_matrix(cglib::vec3<double>(1.0 / levelScale, 1.0 / levelScale, 1)) * cglib::translate3_matrix(cglib::vec3<double>(-(levelScale - 1) * 0.5, -(levelScale - 1) * 0.5, 1)) * invTransform;
+        int levelWidth = pyramidLevel ? pyramid->getLevelWidth(level) : bitmap->getWidth();
+        int levelHeight = pyramidLevel ? pyramid->getLevelHeight(level) : bitmap->getHeight();
+
+        // Calculate filter table
+        Log::Infof("BitmapOverlayRasterTileDataSource: Tile %s inside the raster dataset", mapTile.toString().c_str());
+        BitmapFilterTable filterTable(0, 0, levelWidth, levelHeight);
+        filterTable.calculateFilterTable(ProjectiveTransform(levelTransform), _tileSize, _tileSize, FILTER_SCALE, MAX_FILTER_WIDTH);
+        
+        std::vector<unsigned char> data(_tileSize * _tileSize * 4);
+        if (pyramidLevel) {
+            SampleTile(filterTable, _tileSize, [&](int u, int v) { return pyramid->getPixel(level, u, v); }, data);
+        } else {
+            const unsigned char* pixelData = bitmap->getPixelData().data();
+            SampleTile(filterTable, _tileSize, [&](int u, int v) { return &pixelData[(static_cast<std::size_t>(v) * levelWidth + u) * 4]; }, data);
+        }
+
+        // Build bitmap, "compress" (serialize) to internal format
+        Bitmap tileBitmap(data.data(), _tileSize, _tileSize, ColorFormat::COLOR_FORMAT_RGBA, 4 * _tileSize);
+        return std::make_shared<TileData>(tileBitmap.compressToInternal());
+    }
+
+    void BitmapOverlayRasterTileDataSource::initialize(const std::shared_ptr<Bitmap>& bitmap, const std::shared_ptr<Projection>& projection, const std::vector<MapPos>& mapPoses, const std::vector<ScreenPos>& bitmapPoses) {
         if (!bitmap) {
             throw NullArgumentException("Null bitmap");
         }
@@ -122,79 +279,29 @@ namespace carto {
         if (bitmap->getColorFormat() != ColorFormat::COLOR_FORMAT_RGBA) {
             _bitmap = bitmap->getRGBABitmap();
         }
+        _bitmapWidth = _bitmap->getWidth();
+        _bitmapHeight = _bitmap->getHeight();
     }
 
-    BitmapOverlayRasterTileDataSource::~BitmapOverlayRasterTileDataSource() {
-    }
-
-    MapBounds BitmapOverlayRasterTileDataSource::getDataExtent() const {
-        if (!_bitmap) {
-            return MapBounds(MapPos(0, 0), MapPos(0, 0));
+    void BitmapOverlayRasterTileDataSource::buildPyramid(const std::shared_ptr<Bitmap>& bitmap, bool includeBaseLevel, const std::string& fileName) {
+        std::shared_ptr<BitmapPyramid> pyramid = BitmapPyramid::Create(bitmap, includeBaseLevel, fileName, _pyramidCanceled);
+        if (!pyramid && !fileName.empty() && !_pyramidCanceled) {
+            Log::Warn("BitmapOverlayRasterTileDataSource: Failed to build file based pyramid, keeping pyramid in memory");
+            pyramid = BitmapPyramid::Create(bitmap, false, std::string(), _pyramidCanceled);
         }
 
-        // Calculate map positions of 4 bitmap corners
-        MapBounds bounds;
-        for (int y = 0; y <= 1; y++) {
-            for (int x = 0; x <= 1; x++) {
-                cglib::vec2<double> p = _origin + cglib::transform_point_affine(cglib::vec2<double>(x * _bitmap->getWidth(), y * _bitmap->getHeight()), _transform);
-                bounds.expandToContain(MapPos(p(0), p(1)));
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _pyramid = pyramid;
+            if (_pyramid && _pyramid->hasLevel(0)) {
+                _bitmap.reset();
             }
         }
-        return bounds;
-    }
-
-    std::shared_ptr<TileData> BitmapOverlayRasterTileDataSource::loadTile(const MapTile& mapTile) {
-        if (!_bitmap) {
-            return std::shared_ptr<TileData>();
-        }
-
-        // Calculate tile bounds
-        MapBounds projBounds = _projection->getBounds();
-        double scaleX =  projBounds.getDelta().getX() / (1 << mapTile.getZoom());
-        double scaleY = -projBounds.getDelta().getY() / (1 << mapTile.getZoom());
-        cglib::vec2<double> projP0(projBounds.getMin().getX(), projBounds.getMax().getY());
-        cglib::vec2<double> tileP0(projP0(0) - _origin(0) + scaleX * mapTile.getX(), projP0(1) - _origin(1) + scaleY * mapTile.getY());
-
-        // Calculate transform for tile pixel -> source pixel
-        cglib::mat3x3<double> invTransform = _invTransform * cglib::translate3_matrix(cglib::vec3<double>(tileP0(0), tileP0(1), 1)) * cglib::scale3_matrix(cglib::vec3<double>(scaleX / _tileSize, scaleY / _tileSize, 1));
-
-        // Find tile area in raster space
-        int minU, minV, maxU, maxV;
-        if (!BitmapFilterTable::calculateFilterBounds(ProjectiveTransform(invTransform), _tileSize, _tileSize, _bitmap->getWidth(), _bitmap->getHeight(), minU, minV, maxU, maxV, MAX_FILTER_WIDTH)) {
-            Log::Infof("BitmapOverlayRasterTileDataSource: Tile %s outside of bitmap", mapTile.toString().c_str());
-            return std::shared_ptr<TileData>();
-        }
 
-        // Calculate filter table
-        Log::Infof("BitmapOverlayRasterTileDataSource: Tile %s inside the raster dataset", mapTile.toString().c_str());
-        BitmapFilterTable filterTable(0, 0, _bitmap->getWidth(), _bitmap->getHeight());
-        filterTable.calculateFilterTable(ProjectiveTransform(invTransform), _tileSize, _tileSize, FILTER_SCALE, MAX_FILTER_WIDTH);
-        
-        std::size_t sampleIndex = 0;
-        std::vector<unsigned char> data(_tileSize * _tileSize * 4);
-        const std::vector<BitmapFilterTable::Sample>& samples = filterTable.getSamples();
-        for (int i = 0; i < _tileSize * _tileSize; i++) {
-            int count = filterTable.getSampleCounts()[i];
-            if (count == 0) {
-                continue;
-            }
-
-            float color[4] = { 0.5f, 0.5f, 0.5f, 0.5f };
-            for (int j = 0; j < count; j++) {
-                const BitmapFilterTable::Sample& sample = samples[sampleIndex++];
-                const unsigned char* sampleData = &_bitmap->getPixelData()[(sample.v * _bitmap->getWidth() + sample.u) * 4];
-                for (int c = 0; c < 4; c++) {
-                    color[c] += sampleData[c] * sample.weight;
-                }
-            }
-            for (int c = 0; c < 4; c++) {
-                data[i * 4 + c] = static_cast<unsigned char>(color[c]);
-            }
+        // Reload the tiles that were sampled from the bitmap before the pyramid was ready
+        if (pyramid && !_pyramidCanceled) {
+            notifyTilesChanged(false);
         }
-
-        // Build bitmap, "compress" (serialize) to internal format
-        Bitmap bitmap(data.data(), _tileSize, _tileSize, ColorFormat::COLOR_FORMAT_RGBA, 4 * _tileSize);
-        return std::make_shared<TileData>(bitmap.compressToInternal());
     }
 
     const float BitmapOverlayRasterTileDataSource::FILTER_SCALE = 1.5f;
@@ -11,20 +11,28 @@
 #include "core/ScreenPos.h"
 #include "datasources/TileDataSource.h"
 
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+
 #include <cglib/mat.h>
 
 namespace carto {
     class Bitmap;
+    class BitmapPyramid;
     class Projection;
 
     /**
      * Tile data source that uses given bitmap with two, three or four control points define a raster overlay.
      * Note: if two points are given, conformal transformation is calculated. If three points are given, affine transformation is calculated. In case of four points, perspective transformation is used.
+     * Tiles are sampled from a mip-map pyramid of the bitmap, so that tiles at low zoom levels read only a downsampled copy of the bitmap.
      */
     class BitmapOverlayRasterTileDataSource : public TileDataSource {
     public:
         /**
          * Constructs a new bitmap overlay data source.
+         * The downsampled levels of the pyramid are built in a background thread, tiles are sampled directly from the bitmap until the pyramid is ready.
          * @param minZoom The minimum zoom for generated tiles.
          * @param maxZoom The maximum zoom for generated tiles.
          * @param bitmap The bitmap to use as an overlay.
@@ -34,6 +42,22 @@ namespace carto {
          * @throws std::invalid_argument If the transformation can not be calculated.
          */
         BitmapOverlayRasterTileDataSource(int minZoom, int maxZoom, const std::shared_ptr<Bitmap>& bitmap, const std::shared_ptr<Projection>& projection, const std::vector<MapPos>& mapPoses, const std::vector<ScreenPos>& bitmapPoses);
+        /**
+         * Constructs a new bitmap overlay data source that keeps the bitmap and its mip-map pyramid in a memory mapped file.
+         * Once the pyramid is built, the data source no longer references the bitmap and only the parts of the pyramid that are needed
+         * for the requested tiles are loaded into memory. This is recommended for very large bitmaps, like scanned floor plans.
+         * If the file can not be created, the pyramid is kept in memory instead.
+         * @param minZoom The minimum zoom for generated tiles.
+         * @param maxZoom The maximum zoom for generated tiles.
+         * @param bitmap The bitmap to use as an overlay.
+         * @param projection The projection definining coordinate system of the control points.
+         * @param mapPoses The geographical control points. The list must contain either 2, 3 or 4 points.
+         * @param bitmapPoses The pixel coordinates in the bitmap corresponding to geographical control points. The number of coordinates must be equal to the number of control points in mapPoses list.
+         * @param pyramidFileName The name of the file for the pyramid. The file is kept and reused by later data sources created from the same bitmap, the caller is responsible for deleting it.
+         * @param backgroundBuild If true, the pyramid is built in a background thread and tiles are sampled directly from the bitmap until the pyramid is ready.
+         * @throws std::invalid_argument If the transformation can not be calculated.
+         */
+        BitmapOverlayRasterTileDataSource(int minZoom, int maxZoom, const std::shared_ptr<Bitmap>& bitmap, const std::shared_ptr<Projection>& projection, const std::vector<MapPos>& mapPoses, const std::vector<ScreenPos>& bitmapPoses, const std::string& pyramidFileName, bool backgroundBuild);
         virtual ~BitmapOverlayRasterTileDataSource();
 
         virtual MapBounds getDataExtent() const;
@@ -41,16 +65,26 @@ namespace carto {
         virtual std::shared_ptr<TileData> loadTile(const MapTile& mapTile);
         
     private:
+        void initialize(const std::shared_ptr<Bitmap>& bitmap, const std::shared_ptr<Projection>& projection, const std::vector<MapPos>& mapPoses, const std::vector<ScreenPos>& bitmapPoses);
+        void buildPyramid(const std::shared_ptr<Bitmap>& bitmap, bool includeBaseLevel, const std::string& fileName);
+
         static const float FILTER_SCALE;
         static const int MAX_FILTER_WIDTH;
 
         int _tileSize;
+        int _bitmapWidth;
+        int _bitmapHeight;
 
         cglib::vec2<double> _origin;
         cglib::mat3x3<double> _transform;
         cglib::mat3x3<double> _invTransform;
         std::shared_ptr<Bitmap> _bitmap;
+        std::shared_ptr<BitmapPyramid> _pyramid;
         std::shared_ptr<Projection> _projection;
+
+        std::thread _pyramidThread;
+        std::atomic<bool> _pyramidCanceled;
+        mutable std::mutex _mutex;
     };
 }
 
@@ -1,6 +1,7 @@
 #include "CombinedTileDataSource.h"
 #include "core/MapTile.h"
 #include "components/Exceptions.h"
+#include "datasources/components/TileLatencyHistogram.h"
 #include "utils/Log.h"
 
 #include <memory>
@@ -11,7 +12,10 @@ namespace carto {
         TileDataSource(),
         _dataSource1(dataSource1),
         _dataSource2(dataSource2),
-        _zoomLevel(zoomLevel)
+        _zoomLevel(zoomLevel),
+        _latencyHistogram1(std::make_shared<TileLatencyHistogram>()),
+        _latencyHistogram2(std::make_shared<TileLatencyHistogram>()),
+        _dataSourceListener()
     {
         if (!dataSource1) {
             throw NullArgumentException("Null dataSource1");
@@ -45,11 +49,22 @@ namespace carto {
         return bounds;
     }
     
+    std::vector<int> CombinedTileDataSource::getLatencyHistogram(int index) const {
+        switch (index) {
+        case 0:
+            return _latencyHistogram1->getCounts();
+        case 1:
+            return _latencyHistogram2->getCounts();
+        default:
+            throw OutOfRangeException("Data source index out of range");
+        }
+    }
+    
     std::shared_ptr<TileData> CombinedTileDataSource::loadTile(const MapTile& mapTile) {
         if (mapTile.getZoom() < _zoomLevel) {
-            return _dataSource1->loadTile(mapTile);
+            return _latencyHistogram1->loadTile(_dataSource1, mapTile);
         }
-        return _dataSource2->loadTile(mapTile);
+        return _latencyHistogram2->loadTile(_dataSource2, mapTile);
     }
 
     CombinedTileDataSource::DataSourceListener::DataSourceListener(CombinedTileDataSource& combinedDataSource) :
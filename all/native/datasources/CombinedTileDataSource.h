@@ -11,6 +11,7 @@
 #include "components/DirectorPtr.h"
 
 namespace carto {
+    class TileLatencyHistogram;
     
     /**
      * A tile data source that combines two data sources (usually offline and online) and selects tiles
@@ -32,6 +33,16 @@ namespace carto {
         virtual int getMaxZoom() const;
 
         virtual MapBounds getDataExtent() const;
+
+        /**
+         * Returns the tile load latency histogram of the specified data source.
+         * The bucket upper limits are 10, 25, 50, 100, 250, 500, 1000, 2500 and 5000 milliseconds,
+         * the last bucket counts the loads that took at least 5000 milliseconds.
+         * @param index The index of the data source (0 or 1).
+         * @return The number of tile loads per bucket.
+         * @throws std::out_of_range If the index is out of range.
+         */
+        std::vector<int> getLatencyHistogram(int index) const;
         
         virtual std::shared_ptr<TileData> loadTile(const MapTile& tile);
         
@@ -51,6 +62,9 @@ namespace carto {
         int _zoomLevel;
         
     private:
+        const std::shared_ptr<TileLatencyHistogram> _latencyHistogram1;
+        const std::shared_ptr<TileLatencyHistogram> _latencyHistogram2;
+
         std::shared_ptr<DataSourceListener> _dataSourceListener;
     };
     
@@ -1,9 +1,12 @@
 #include "HTTPTileDataSource.h"
+#include "core/BinaryData.h"
 #include "core/MapTile.h"
 #include "utils/Log.h"
 #include "utils/NetworkUtils.h"
 #include "utils/GeneralUtils.h"
 
+#include <algorithm>
+
 namespace carto {
 
     HTTPTileDataSource::HTTPTileDataSource(int minZoom, int maxZoom, const std::string& baseURL) :
@@ -12,14 +15,22 @@ namespace carto {
         _subdomains({ "a", "b", "c", "d" }),
         _tmsScheme(false),
         _maxAgeHeaderCheck(false),
+        _staleWhileRevalidate(false),
         _headers(),
         _httpClient(true),
+        _validatedTileCache(DEFAULT_VALIDATED_TILE_CACHE_CAPACITY),
+        _revalidatedTileIds(),
+        _revalidatedTilesChanged(false),
+        _staleTileMaxAges(),
+        _revalidateThreadPool(std::make_shared<CancelableThreadPool>()),
         _randomGenerator(),
         _mutex()
     {
+        _revalidateThreadPool->setPoolSize(1);
     }
     
     HTTPTileDataSource::~HTTPTileDataSource() {
+        _revalidateThreadPool->deinit();
     }
     
     std::string HTTPTileDataSource::getBaseURL() const {
@@ -31,6 +42,8 @@ namespace carto {
         {
             std::lock_guard<std::mutex> lock(_mutex);
             _baseURL = baseURL;
+            _validatedTileCache.clear();
+            _staleTileMaxAges.clear();
         }
         notifyTilesChanged(false);
     }
@@ -57,6 +70,8 @@ namespace carto {
         {
             std::lock_guard<std::mutex> lock(_mutex);
             _tmsScheme = tmsScheme;
+            _validatedTileCache.clear();
+            _staleTileMaxAges.clear();
         }
         notifyTilesChanged(false);
     }
@@ -70,9 +85,21 @@ namespace carto {
         {
             std::lock_guard<std::mutex> lock(_mutex);
             _maxAgeHeaderCheck = maxAgeCheck;
+            _validatedTileCache.clear();
+            _staleTileMaxAges.clear();
         }
         notifyTilesChanged(false);
     }
+
+    bool HTTPTileDataSource::isStaleWhileRevalidate() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _staleWhileRevalidate;
+    }
+
+    void HTTPTileDataSource::setStaleWhileRevalidate(bool staleWhileRevalidate) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _staleWhileRevalidate = staleWhileRevalidate;
+    }
     
     std::map<std::string, std::string> HTTPTileDataSource::getHTTPHeaders() const {
         std::lock_guard<std::mutex> lock(_mutex);
@@ -83,11 +110,62 @@ namespace carto {
         {
             std::lock_guard<std::mutex> lock(_mutex);
             _headers = headers;
+            _validatedTileCache.clear();
+            _staleTileMaxAges.clear();
         }
         notifyTilesChanged(false);
     }
     
     std::shared_ptr<TileData> HTTPTileDataSource::loadTile(const MapTile& mapTile) {
+        std::shared_ptr<TileData> staleTileData;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_validatedTileCache.read(mapTile.getTileId(), staleTileData)) {
+                if (staleTileData->getMaxAge() != 0) {
+                    return staleTileData;
+                }
+
+                // Serve the expired tile with short expiration time, revalidate the tile in background.
+                // The expiration time grows after each failed revalidation, so that tiles are not requested constantly while offline.
+                if (_staleWhileRevalidate) {
+                    if (_revalidatedTileIds.insert(mapTile.getTileId()).second) {
+                        auto task = std::make_shared<RevalidateTask>(std::static_pointer_cast<HTTPTileDataSource>(shared_from_this()), mapTile);
+                        _revalidateThreadPool->execute(task);
+                    }
+                    auto it = _staleTileMaxAges.find(mapTile.getTileId());
+                    auto tileData = std::make_shared<TileData>(staleTileData->getData());
+                    tileData->setMaxAge(it != _staleTileMaxAges.end() ? it->second : MIN_STALE_TILE_MAX_AGE);
+                    return tileData;
+                }
+            } else {
+                _staleTileMaxAges.erase(mapTile.getTileId());
+            }
+        }
+
+        return loadOnlineTile(mapTile, staleTileData);
+    }
+    
+    std::string HTTPTileDataSource::buildTileURL(const std::string& baseURL, const MapTile& tile) const {
+        bool tmsScheme = false;
+        std::string subdomain;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            tmsScheme = _tmsScheme;
+            if (!_subdomains.empty()) {
+                std::size_t randomIndex = std::uniform_int_distribution<std::size_t>(0, _subdomains.size() - 1)(_randomGenerator);
+                subdomain = _subdomains[randomIndex];
+            }
+        }
+
+        std::map<std::string, std::string> tagValues = buildTagValues(tmsScheme ? tile.getFlipped() : tile);
+        if (!subdomain.empty()) {
+            tagValues["s"] = subdomain;
+        }
+   
+        return GeneralUtils::ReplaceTags(baseURL, tagValues, "{", "}", true);
+    }
+
+    std::shared_ptr<TileData> HTTPTileDataSource::loadOnlineTile(const MapTile& mapTile, const std::shared_ptr<TileData>& staleTileData) {
         std::string baseURL;
         std::map<std::string, std::string> headers;
         bool maxAgeHeaderCheck;
@@ -103,47 +181,124 @@ namespace carto {
             return std::shared_ptr<TileData>();
         }
 
-        Log::Infof("HTTPTileDataSource::loadTile: Loading %s", url.c_str());
+        // Use conditional request if validators of the expired tile are known
+        if (staleTileData) {
+            std::string etag = staleTileData->getETag();
+            if (!etag.empty()) {
+                headers["If-None-Match"] = etag;
+            }
+            std::string lastModified = staleTileData->getLastModified();
+            if (!lastModified.empty()) {
+                headers["If-Modified-Since"] = lastModified;
+            }
+        }
+
+        Log::Infof("HTTPTileDataSource::loadOnlineTile: Loading %s", url.c_str());
         std::map<std::string, std::string> responseHeaders;
         std::shared_ptr<BinaryData> responseData;
+        std::shared_ptr<TileData> tileData;
         try {
-            if (_httpClient.get(url, headers, responseHeaders, responseData) != 0) {
-                Log::Errorf("HTTPTileDataSource::loadTile: Failed to load %s", url.c_str());
-                return std::shared_ptr<TileData>();
+            int statusCode = -1;
+            if (_httpClient.get(url, headers, responseHeaders, responseData, &statusCode) != 0) {
+                if (statusCode != 304 || !staleTileData) {
+                    Log::Errorf("HTTPTileDataSource::loadOnlineTile: Failed to load %s", url.c_str());
+                    return std::shared_ptr<TileData>();
+                }
+                Log::Infof("HTTPTileDataSource::loadOnlineTile: Revalidated %s", url.c_str());
+                tileData = std::make_shared<TileData>(staleTileData->getData());
+                tileData->setETag(staleTileData->getETag());
+                tileData->setLastModified(staleTileData->getLastModified());
+            } else {
+                tileData = std::make_shared<TileData>(responseData);
             }
         }
         catch (const std::exception& ex) {
-            Log::Errorf("HTTPTileDataSource::loadTile: Exception while loading tile %d/%d/%d: %s", mapTile.getZoom(), mapTile.getX(), mapTile.getY(), ex.what());
+            Log::Errorf("HTTPTileDataSource::loadOnlineTile: Exception while loading tile %d/%d/%d: %s", mapTile.getZoom(), mapTile.getX(), mapTile.getY(), ex.what());
             return std::shared_ptr<TileData>();
         }
-        auto tileData = std::make_shared<TileData>(responseData);
+
+        // Server may update validators even for 304 responses
+        std::string etag = NetworkUtils::GetHTTPHeader(responseHeaders, "ETag");
+        if (!etag.empty()) {
+            tileData->setETag(etag);
+        }
+        std::string lastModified = NetworkUtils::GetHTTPHeader(responseHeaders, "Last-Modified");
+        if (!lastModified.empty()) {
+            tileData->setLastModified(lastModified);
+        }
+
         if (maxAgeHeaderCheck) {
             int maxAge = NetworkUtils::GetMaxAgeHTTPHeader(responseHeaders);
             if (maxAge >= 0) {
                 tileData->setMaxAge(maxAge * 1000);
             }
+
+            // Keep expiring tiles with validators, so that they can be revalidated later
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (maxAge >= 0 && (!tileData->getETag().empty() || !tileData->getLastModified().empty()) && tileData->getData()) {
+                _validatedTileCache.put(mapTile.getTileId(), tileData, tileData->getData()->size() + EXTRA_TILE_FOOTPRINT);
+            } else {
+                _validatedTileCache.remove(mapTile.getTileId());
+            }
         }
         return tileData;
     }
-    
-    std::string HTTPTileDataSource::buildTileURL(const std::string& baseURL, const MapTile& tile) const {
-        bool tmsScheme = false;
-        std::string subdomain;
-        {
-            std::lock_guard<std::mutex> lock(_mutex);
-            tmsScheme = _tmsScheme;
-            if (!_subdomains.empty()) {
-                std::size_t randomIndex = std::uniform_int_distribution<std::size_t>(0, _subdomains.size() - 1)(_randomGenerator);
-                subdomain = _subdomains[randomIndex];
+
+    HTTPTileDataSource::RevalidateTask::RevalidateTask(const std::shared_ptr<HTTPTileDataSource>& dataSource, const MapTile& mapTile) :
+        _dataSource(dataSource),
+        _mapTile(mapTile)
+    {
+    }
+
+    void HTTPTileDataSource::RevalidateTask::run() {
+        if (auto dataSource = _dataSource.lock()) {
+            std::shared_ptr<TileData> staleTileData;
+            {
+                std::lock_guard<std::mutex> lock(dataSource->_mutex);
+                dataSource->_validatedTileCache.peek(_mapTile.getTileId(), staleTileData);
             }
-        }
 
-        std::map<std::string, std::string> tagValues = buildTagValues(tmsScheme ? tile.getFlipped() : tile);
-        if (!subdomain.empty()) {
-            tagValues["s"] = subdomain;
+            std::shared_ptr<TileData> tileData;
+            if (!isCanceled()) {
+                tileData = dataSource->loadOnlineTile(_mapTile, staleTileData);
+            }
+
+            bool notify = false;
+            {
+                std::lock_guard<std::mutex> lock(dataSource->_mutex);
+                dataSource->_revalidatedTileIds.erase(_mapTile.getTileId());
+                if (tileData) {
+                    dataSource->_staleTileMaxAges.erase(_mapTile.getTileId());
+
+                    // 304 responses reuse the stale data, only new content needs to be pushed to the layers
+                    if (!staleTileData || tileData->getData() != staleTileData->getData()) {
+                        dataSource->_revalidatedTilesChanged = true;
+                    }
+                } else if (!isCanceled()) {
+                    auto it = dataSource->_staleTileMaxAges.find(_mapTile.getTileId());
+                    long long maxAge = (it != dataSource->_staleTileMaxAges.end() ? it->second : MIN_STALE_TILE_MAX_AGE);
+                    dataSource->_staleTileMaxAges[_mapTile.getTileId()] = std::min(maxAge * 2, MAX_STALE_TILE_MAX_AGE);
+                }
+
+                // Coalesce notifications, layers are refreshed once all pending revalidations are finished
+                if (dataSource->_revalidatedTileIds.empty() && dataSource->_revalidatedTilesChanged) {
+                    dataSource->_revalidatedTilesChanged = false;
+                    notify = true;
+                }
+            }
+
+            if (notify) {
+                dataSource->notifyTilesChanged(false);
+            }
         }
-   
-        return GeneralUtils::ReplaceTags(baseURL, tagValues, "{", "}", true);
     }
+
+    const unsigned int HTTPTileDataSource::DEFAULT_VALIDATED_TILE_CACHE_CAPACITY = 4 * 1024 * 1024;
+
+    const unsigned int HTTPTileDataSource::EXTRA_TILE_FOOTPRINT = 1024;
+
+    const long long HTTPTileDataSource::MIN_STALE_TILE_MAX_AGE = 1000;
+
+    const long long HTTPTileDataSource::MAX_STALE_TILE_MAX_AGE = 5 * 60 * 1000;
     
 }
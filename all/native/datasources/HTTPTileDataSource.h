@@ -7,6 +7,8 @@
 #ifndef _CARTO_HTTPTILEDATASOURCE_H_
 #define _CARTO_HTTPTILEDATASOURCE_H_
 
+#include "components/CancelableTask.h"
+#include "components/CancelableThreadPool.h"
 #include "datasources/TileDataSource.h"
 #include "network/HTTPClient.h"
 
@@ -15,6 +17,10 @@
 #include <map>
 #include <vector>
 #include <mutex>
+#include <unordered_set>
+#include <unordered_map>
+
+#include <stdext/timed_lru_cache.h>
 
 namespace carto {
 
@@ -82,6 +88,22 @@ namespace carto {
          * @param maxAgeCheck True if the check should be enabled, false otherwise.
          */
         void setMaxAgeHeaderCheck(bool maxAgeCheck);
+
+        /**
+         * Returns true/false based on whether expired tiles are served while being revalidated.
+         * @return True if stale-while-revalidate mode is used. False otherwise.
+         */
+        bool isStaleWhileRevalidate() const;
+        /**
+         * Enables/disables stale-while-revalidate mode.
+         * When max-age header check is enabled, expired tiles that contain ETag or Last-Modified validators
+         * are revalidated using conditional requests. If this mode is enabled, the expired tile is returned immediately
+         * and revalidated in background, otherwise the loading waits until the tile is revalidated. The default is disabled.
+         * If revalidation fails (for example, when offline), the expired tile is retried with exponentially growing intervals, up to 5 minutes.
+         * When revalidation returns new content, the data source notifies its layers once the pending revalidations are finished.
+         * @param staleWhileRevalidate True if stale-while-revalidate mode should be enabled, false otherwise.
+         */
+        void setStaleWhileRevalidate(bool staleWhileRevalidate);
         
         /**
          * Returns the current set of HTTP headers used. Initially this set is empty and can be changed with setHTTPHeaders.
@@ -98,14 +120,38 @@ namespace carto {
         virtual std::shared_ptr<TileData> loadTile(const MapTile& mapTile);
     
     protected:
+        class RevalidateTask : public CancelableTask {
+        public:
+            RevalidateTask(const std::shared_ptr<HTTPTileDataSource>& dataSource, const MapTile& mapTile);
+
+            virtual void run();
+
+        private:
+            std::weak_ptr<HTTPTileDataSource> _dataSource;
+            MapTile _mapTile;
+        };
+
         virtual std::string buildTileURL(const std::string& baseURL, const MapTile& tile) const;
+
+        std::shared_ptr<TileData> loadOnlineTile(const MapTile& mapTile, const std::shared_ptr<TileData>& staleTileData);
+
+        static const unsigned int DEFAULT_VALIDATED_TILE_CACHE_CAPACITY;
+        static const unsigned int EXTRA_TILE_FOOTPRINT;
+        static const long long MIN_STALE_TILE_MAX_AGE;
+        static const long long MAX_STALE_TILE_MAX_AGE;
     
         std::string _baseURL;
         std::vector<std::string> _subdomains;
         bool _tmsScheme;
         bool _maxAgeHeaderCheck;
+        bool _staleWhileRevalidate;
         std::map<std::string, std::string> _headers;
         HTTPClient _httpClient;
+        cache::timed_lru_cache<long long, std::shared_ptr<TileData> > _validatedTileCache;
+        std::unordered_set<long long> _revalidatedTileIds;
+        bool _revalidatedTilesChanged;
+        std::unordered_map<long long, long long> _staleTileMaxAges;
+        std::shared_ptr<CancelableThreadPool> _revalidateThreadPool;
         mutable std::default_random_engine _randomGenerator;
         mutable std::mutex _mutex;
     };
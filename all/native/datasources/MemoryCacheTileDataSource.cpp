@@ -10,7 +10,8 @@ namespace carto {
     MemoryCacheTileDataSource::MemoryCacheTileDataSource(const std::shared_ptr<TileDataSource>& dataSource) :
         CacheTileDataSource(dataSource),
         _cache(DEFAULT_CAPACITY),
-        _mutex()
+        _mutex(),
+        _memoryBudgetClient("MemoryCacheTileDataSource", DEFAULT_CAPACITY, [this]() { return getCacheMemoryUsage(); }, [this]() { applyCacheMemoryQuota(); })
     {
     }
     
@@ -25,10 +26,12 @@ namespace carto {
         std::shared_ptr<TileData> tileData;
         if (_cache.read(mapTile.getTileId(), tileData)) {
             if (tileData->getMaxAge() != 0) {
+                _memoryBudgetClient.recordAccess(true);
                 return tileData;
             }
             _cache.remove(mapTile.getTileId());
         }
+        _memoryBudgetClient.recordAccess(false);
         
         lock.unlock();
         tileData = _dataSource->loadTile(mapTile);
@@ -51,13 +54,23 @@ namespace carto {
     }
     
     std::size_t MemoryCacheTileDataSource::getCapacity() const {
-        std::lock_guard<std::recursive_mutex> lock(_mutex);
-        return _cache.capacity();
+        return _memoryBudgetClient.getCapacity();
     }
     
     void MemoryCacheTileDataSource::setCapacity(std::size_t capacityInBytes) {
         std::lock_guard<std::recursive_mutex> lock(_mutex);
-        _cache.resize(capacityInBytes);
+        _memoryBudgetClient.setCapacity(capacityInBytes);
+        _cache.resize(_memoryBudgetClient.getCacheCapacity(0));
+    }
+
+    MemoryBudgetManager::Client::Usage MemoryCacheTileDataSource::getCacheMemoryUsage() const {
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+        return MemoryBudgetManager::Client::Usage(_cache.size(), 0);
+    }
+
+    void MemoryCacheTileDataSource::applyCacheMemoryQuota() {
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+        _cache.resize(_memoryBudgetClient.getCacheCapacity(0));
     }
 
     const unsigned int MemoryCacheTileDataSource::DEFAULT_CAPACITY = 6 * 1024 * 1024;
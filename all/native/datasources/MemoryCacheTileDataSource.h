@@ -7,6 +7,7 @@
 #ifndef _CARTO_MEMORYCACHETILEDATASOURCE_H_
 #define _CARTO_MEMORYCACHETILEDATASOURCE_H_
 
+#include "components/MemoryBudgetManager.h"
 #include "datasources/CacheTileDataSource.h"
 
 #include <stdext/timed_lru_cache.h>
@@ -40,6 +41,12 @@ namespace carto {
 
         cache::timed_lru_cache<long long, std::shared_ptr<TileData> > _cache;
         mutable std::recursive_mutex _mutex;
+
+    private:
+        MemoryBudgetManager::Client::Usage getCacheMemoryUsage() const;
+        void applyCacheMemoryQuota();
+
+        MemoryBudgetManager::Client _memoryBudgetClient;
     };
     
 }
@@ -1,17 +1,27 @@
 #include "OrderedTileDataSource.h"
 #include "core/MapTile.h"
+#include "components/CancelableThreadPool.h"
 #include "components/Exceptions.h"
+#include "datasources/components/TileLatencyHistogram.h"
 #include "utils/Log.h"
 
 #include <memory>
 #include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
 
 namespace carto {
     
     OrderedTileDataSource::OrderedTileDataSource(const std::shared_ptr<TileDataSource>& dataSource1, const std::shared_ptr<TileDataSource>& dataSource2) :
         TileDataSource(),
         _dataSource1(dataSource1),
-        _dataSource2(dataSource2)
+        _dataSource2(dataSource2),
+        _hedgingDelay(-1),
+        _latencyHistogram1(std::make_shared<TileLatencyHistogram>()),
+        _latencyHistogram2(std::make_shared<TileLatencyHistogram>()),
+        _hedgingThreadPool(std::make_shared<CancelableThreadPool>()),
+        _dataSourceListener()
     {
         if (!dataSource1) {
             throw NullArgumentException("Null dataSource1");
@@ -20,12 +30,16 @@ namespace carto {
             throw NullArgumentException("Null dataSource2");
         }
 
+        _hedgingThreadPool->setPoolSize(HEDGING_THREAD_POOL_SIZE);
+
         _dataSourceListener = std::make_shared<DataSourceListener>(*this);
         _dataSource1->registerOnChangeListener(_dataSourceListener);
         _dataSource2->registerOnChangeListener(_dataSourceListener);
     }
     
     OrderedTileDataSource::~OrderedTileDataSource() {
+        _hedgingThreadPool->deinit();
+
         _dataSource2->unregisterOnChangeListener(_dataSourceListener);
         _dataSource1->unregisterOnChangeListener(_dataSourceListener);
         _dataSourceListener.reset();
@@ -45,13 +59,47 @@ namespace carto {
         return bounds;
     }
     
+    int OrderedTileDataSource::getHedgingDelay() const {
+        return _hedgingDelay.load();
+    }
+
+    void OrderedTileDataSource::setHedgingDelay(int delay) {
+        _hedgingDelay.store(delay);
+    }
+
+    std::vector<int> OrderedTileDataSource::getLatencyHistogram(int index) const {
+        switch (index) {
+        case 0:
+            return _latencyHistogram1->getCounts();
+        case 1:
+            return _latencyHistogram2->getCounts();
+        default:
+            throw OutOfRangeException("Data source index out of range");
+        }
+    }
+    
     std::shared_ptr<TileData> OrderedTileDataSource::loadTile(const MapTile& mapTile) {
-        std::shared_ptr<TileData> result1, result2;
         int zoom = mapTile.getZoom();
+        int hedgingDelay = _hedgingDelay.load();
+        if (hedgingDelay >= 0) {
+            // Hedging is only meaningful if both data sources can provide the tile
+            bool inRange1 = zoom >= _dataSource1->getMinZoom() && zoom <= _dataSource1->getMaxZoom();
+            bool inRange2 = zoom >= _dataSource2->getMinZoom() && zoom <= _dataSource2->getMaxZoom();
+            if (inRange1 && inRange2) {
+                return loadTileHedged(mapTile, hedgingDelay);
+            }
+        }
+
+        return loadTileSequential(mapTile);
+    }
+
+    std::shared_ptr<TileData> OrderedTileDataSource::loadTileSequential(const MapTile& mapTile) {
+        int zoom = mapTile.getZoom();
+        std::shared_ptr<TileData> result1, result2;
         if (zoom >= _dataSource1->getMinZoom()) {
             if (zoom <= _dataSource1->getMaxZoom()) {
-                result1 = _dataSource1->loadTile(mapTile);
-                if (result1 && !result1->isReplaceWithParent()) {
+                result1 = _latencyHistogram1->loadTile(_dataSource1, mapTile);
+                if (IsAcceptable(result1)) {
                     return result1;
                 }
             } else {
@@ -61,8 +109,8 @@ namespace carto {
         }
         if (zoom >= _dataSource2->getMinZoom()) {
             if (zoom <= _dataSource2->getMaxZoom()) {
-                result2 = _dataSource2->loadTile(mapTile);
-                if (result2 && !result2->isReplaceWithParent()) {
+                result2 = _latencyHistogram2->loadTile(_dataSource2, mapTile);
+                if (IsAcceptable(result2)) {
                     return result2;
                 }
             } else {
@@ -73,6 +121,147 @@ namespace carto {
         return result1 ? result1 : result2;
     }
 
+    struct OrderedTileDataSource::HedgedLoadState {
+        std::shared_ptr<TileData> results[2];
+        std::exception_ptr exceptions[2];
+        bool claimed[2];
+        bool finished[2];
+        std::mutex mutex;
+        std::condition_variable condition;
+
+        HedgedLoadState() : results(), exceptions(), claimed(), finished(), mutex(), condition() { }
+    };
+
+    std::shared_ptr<TileData> OrderedTileDataSource::loadTileHedged(const MapTile& mapTile, int hedgingDelay) {
+        // Loads run on a bounded pool. A load that has not been claimed by a pool thread when it is needed
+        // is claimed and run by this thread instead, so a pool blocked by slow loads never stalls tile loading.
+        // The pool gets at least HEDGING_CLAIM_TIMEOUT to start the first load, so that zero delay still hedges.
+        auto state = std::make_shared<HedgedLoadState>();
+        std::shared_ptr<HedgedLoadTask> tasks[2];
+        tasks[0] = std::make_shared<HedgedLoadTask>(state, 0, _dataSource1, _latencyHistogram1, mapTile);
+        _hedgingThreadPool->execute(tasks[0]);
+
+        auto startTime = std::chrono::steady_clock::now();
+        auto hedgingTime = startTime + std::chrono::milliseconds(hedgingDelay);
+        auto claimTime = startTime + std::chrono::milliseconds(std::max(hedgingDelay, HEDGING_CLAIM_TIMEOUT));
+        std::unique_lock<std::mutex> lock(state->mutex);
+        while (true) {
+            for (int i = 0; i < 2; i++) {
+                if (state->finished[i] && IsAcceptable(state->results[i])) {
+                    if (tasks[1 - i]) {
+                        state->claimed[1 - i] = true; // the load is skipped if it has not started yet
+                        tasks[1 - i]->cancel();
+                        if (!state->finished[1 - i]) {
+                            Log::Debugf("OrderedTileDataSource::loadTileHedged: Using data source %d for tile %s, discarding pending result of data source %d", i + 1, mapTile.toString().c_str(), 2 - i);
+                        }
+                    }
+                    return state->results[i];
+                }
+            }
+            if (state->finished[0] && state->exceptions[0]) {
+                // Same as without hedging: an exception from the first data source is propagated
+                if (tasks[1]) {
+                    state->claimed[1] = true;
+                    tasks[1]->cancel();
+                }
+                std::rethrow_exception(state->exceptions[0]);
+            }
+            if (state->finished[0] && state->finished[1]) {
+                break;
+            }
+
+            if (!tasks[1]) {
+                if (!state->finished[0] && std::chrono::steady_clock::now() < hedgingTime) {
+                    state->condition.wait_until(lock, hedgingTime);
+                    continue;
+                }
+
+                // Start the second data source once the first one has failed or the hedging delay has passed
+                tasks[1] = std::make_shared<HedgedLoadTask>(state, 1, _dataSource2, _latencyHistogram2, mapTile);
+                lock.unlock();
+                _hedgingThreadPool->execute(tasks[1]);
+                lock.lock();
+                continue;
+            }
+
+            // A pending load that no pool thread has claimed yet is run here once the other load is done.
+            // The first load is also run here if the pool has not started it in time.
+            int pendingIndex = -1;
+            for (int i = 0; i < 2; i++) {
+                if (!state->claimed[i] && state->finished[1 - i]) {
+                    pendingIndex = i;
+                }
+            }
+            if (pendingIndex < 0 && !state->claimed[0] && std::chrono::steady_clock::now() >= claimTime) {
+                pendingIndex = 0;
+            }
+            if (pendingIndex >= 0) {
+                state->claimed[pendingIndex] = true;
+                lock.unlock();
+                tasks[pendingIndex]->load();
+                lock.lock();
+                continue;
+            }
+            if (!state->claimed[0]) {
+                state->condition.wait_until(lock, claimTime);
+            } else {
+                state->condition.wait(lock);
+            }
+        }
+
+        if (state->exceptions[1]) {
+            std::rethrow_exception(state->exceptions[1]);
+        }
+        return state->results[0] ? state->results[0] : state->results[1];
+    }
+
+    bool OrderedTileDataSource::IsAcceptable(const std::shared_ptr<TileData>& tileData) {
+        return tileData && !tileData->isReplaceWithParent();
+    }
+
+    OrderedTileDataSource::HedgedLoadTask::HedgedLoadTask(const std::shared_ptr<HedgedLoadState>& state, int index, const DirectorPtr<TileDataSource>& dataSource, const std::shared_ptr<TileLatencyHistogram>& latencyHistogram, const MapTile& mapTile) :
+        CancelableTask(),
+        _state(state),
+        _index(index),
+        _dataSource(dataSource),
+        _latencyHistogram(latencyHistogram),
+        _mapTile(mapTile)
+    {
+    }
+
+    bool OrderedTileDataSource::HedgedLoadTask::claim() {
+        std::lock_guard<std::mutex> lock(_state->mutex);
+        if (_state->claimed[_index]) {
+            return false;
+        }
+        _state->claimed[_index] = true;
+        return true;
+    }
+
+    void OrderedTileDataSource::HedgedLoadTask::load() {
+        std::shared_ptr<TileData> result;
+        std::exception_ptr exception;
+        try {
+            result = _latencyHistogram->loadTile(_dataSource, _mapTile);
+        }
+        catch (...) {
+            exception = std::current_exception();
+        }
+
+        std::lock_guard<std::mutex> lock(_state->mutex);
+        _state->results[_index] = result;
+        _state->exceptions[_index] = exception;
+        _state->finished[_index] = true;
+        _state->condition.notify_all();
+    }
+
+    void OrderedTileDataSource::HedgedLoadTask::run() {
+        if (isCanceled() || !claim()) {
+            return;
+        }
+        load();
+    }
+
     OrderedTileDataSource::DataSourceListener::DataSourceListener(OrderedTileDataSource& combinedDataSource) :
         _combinedDataSource(combinedDataSource)
     {
@@ -81,5 +270,9 @@ namespace carto {
     void OrderedTileDataSource::DataSourceListener::onTilesChanged(bool removeTiles) {
         _combinedDataSource.notifyTilesChanged(removeTiles);
     }
+
+    const int OrderedTileDataSource::HEDGING_THREAD_POOL_SIZE = 4;
+
+    const int OrderedTileDataSource::HEDGING_CLAIM_TIMEOUT = 20;
     
 }
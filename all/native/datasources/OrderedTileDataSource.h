@@ -8,13 +8,20 @@
 #define _CARTO_ORDEREDTILEDATASOURCE_H_
 
 #include "datasources/TileDataSource.h"
+#include "components/CancelableTask.h"
 #include "components/DirectorPtr.h"
 
+#include <atomic>
+
 namespace carto {
+    class CancelableThreadPool;
+    class TileLatencyHistogram;
     
     /**
      * A tile data source that combines two data sources (usually offline and online).
      * All requests are made first to first data source. If not found the request will be made to the second data source.
+     * Optionally the data source can be used in hedged mode, where the second data source is queried
+     * if the first data source does not respond within the specified delay.
      */
     class OrderedTileDataSource : public TileDataSource {
     public:
@@ -30,6 +37,33 @@ namespace carto {
         virtual int getMaxZoom() const;
 
         virtual MapBounds getDataExtent() const;
+
+        /**
+         * Returns the hedging delay used when loading tiles.
+         * @return The hedging delay in milliseconds. Negative value means that hedging is disabled.
+         */
+        int getHedgingDelay() const;
+        /**
+         * Sets the hedging delay used when loading tiles.
+         * When hedging is enabled, the second data source is queried if the first data source has not returned within the given delay.
+         * The first acceptable result is used and the result of the other data source is discarded. Zero delay means that
+         * both data sources are queried at the same time. The default is -1, which means that the second data source is
+         * queried only after the first data source has failed to provide the tile.
+         * As without hedging, an exception from the first data source is propagated unless the second data source
+         * has already provided the tile.
+         * @param delay The hedging delay in milliseconds. Negative value disables hedging.
+         */
+        void setHedgingDelay(int delay);
+
+        /**
+         * Returns the tile load latency histogram of the specified data source.
+         * The bucket upper limits are 10, 25, 50, 100, 250, 500, 1000, 2500 and 5000 milliseconds,
+         * the last bucket counts the loads that took at least 5000 milliseconds.
+         * @param index The index of the data source (0 or 1).
+         * @return The number of tile loads per bucket.
+         * @throws std::out_of_range If the index is out of range.
+         */
+        std::vector<int> getLatencyHistogram(int index) const;
         
         virtual std::shared_ptr<TileData> loadTile(const MapTile& tile);
         
@@ -48,6 +82,38 @@ namespace carto {
         const DirectorPtr<TileDataSource> _dataSource2;
         
     private:
+        struct HedgedLoadState;
+
+        class HedgedLoadTask : public CancelableTask {
+        public:
+            HedgedLoadTask(const std::shared_ptr<HedgedLoadState>& state, int index, const DirectorPtr<TileDataSource>& dataSource, const std::shared_ptr<TileLatencyHistogram>& latencyHistogram, const MapTile& mapTile);
+
+            bool claim();
+            void load();
+
+            virtual void run();
+
+        private:
+            std::shared_ptr<HedgedLoadState> _state;
+            int _index;
+            DirectorPtr<TileDataSource> _dataSource;
+            std::shared_ptr<TileLatencyHistogram> _latencyHistogram;
+            MapTile _mapTile;
+        };
+
+        std::shared_ptr<TileData> loadTileSequential(const MapTile& mapTile);
+        std::shared_ptr<TileData> loadTileHedged(const MapTile& mapTile, int hedgingDelay);
+
+        static bool IsAcceptable(const std::shared_ptr<TileData>& tileData);
+
+        static const int HEDGING_THREAD_POOL_SIZE;
+        static const int HEDGING_CLAIM_TIMEOUT;
+
+        std::atomic<int> _hedgingDelay;
+        const std::shared_ptr<TileLatencyHistogram> _latencyHistogram1;
+        const std::shared_ptr<TileLatencyHistogram> _latencyHistogram2;
+        const std::shared_ptr<CancelableThreadPool> _hedgingThreadPool;
+
         std::shared_ptr<DataSourceListener> _dataSourceListener;
     };
     
@@ -7,6 +7,7 @@
 #include "utils/Log.h"
 #include "utils/Const.h"
 
+#include <algorithm>
 #include <memory>
 
 namespace carto {
@@ -15,7 +16,10 @@ namespace carto {
         TileDataSource(0, Const::MAX_SUPPORTED_ZOOM_LEVEL),
         _packageManager(packageManager),
         _cachedOpenPackageHandlers(),
-        _mutex()
+        _maxOpenPackages(MAX_OPEN_PACKAGES),
+        _mutex(),
+        _packageManagerListener(),
+        _memoryBudgetClient("PackageManagerTileDataSource", MAX_OPEN_PACKAGES * OPEN_PACKAGE_MEMORY_FOOTPRINT, [this]() { return getCacheMemoryUsage(); }, [this]() { applyCacheMemoryQuota(); })
     {
         if (!packageManager) {
             throw NullArgumentException("Null packageManager");
@@ -34,6 +38,22 @@ namespace carto {
         return _packageManager;
     }
 
+    std::shared_ptr<PackageTileLoadStatistics> PackageManagerTileDataSource::getTileLoadStatistics() const {
+        MapPackageHandler::TileLoadStats totalStats;
+        _packageManager->accessLocalPackages([&totalStats](const std::map<std::shared_ptr<PackageInfo>, std::shared_ptr<PackageHandler> >& packageHandlerMap) {
+            for (auto it = packageHandlerMap.begin(); it != packageHandlerMap.end(); it++) {
+                if (auto mapHandler = std::dynamic_pointer_cast<MapPackageHandler>(it->second)) {
+                    MapPackageHandler::TileLoadStats stats = mapHandler->getTileLoadStats();
+                    totalStats.tilesLoaded += stats.tilesLoaded;
+                    totalStats.cacheHits += stats.cacheHits;
+                    totalStats.decryptTime += stats.decryptTime;
+                    totalStats.inflateTime += stats.inflateTime;
+                }
+            }
+        });
+        return std::make_shared<PackageTileLoadStatistics>(totalStats.tilesLoaded, totalStats.cacheHits, totalStats.decryptTime, totalStats.inflateTime);
+    }
+
     std::shared_ptr<TileData> PackageManagerTileDataSource::loadTile(const MapTile& mapTile) {
         Log::Infof("PackageManagerTileDataSource::loadTile: Loading %s", mapTile.toString().c_str());
         try {
@@ -56,6 +76,7 @@ namespace carto {
                     data = it->second->loadTile(mapTileFlipped);
                     if (data || tileMask) {
                         std::rotate(_cachedOpenPackageHandlers.begin(), it, it + 1);
+                        _memoryBudgetClient.recordAccess(true);
                         return;
                     }
                 }
@@ -75,10 +96,11 @@ namespace carto {
                         data = mapHandler->loadTile(mapTileFlipped);
                         if (data || tileMask) {
                             _cachedOpenPackageHandlers.insert(_cachedOpenPackageHandlers.begin(), std::make_pair(packageInfo, mapHandler));
-                            if (_cachedOpenPackageHandlers.size() > MAX_OPEN_PACKAGES) {
+                            while (_cachedOpenPackageHandlers.size() > _maxOpenPackages) {
                                 _cachedOpenPackageHandlers.back().second->closeDatabase();
                                 _cachedOpenPackageHandlers.pop_back();
                             }
+                            _memoryBudgetClient.recordAccess(false);
                             return;
                         }
                     }
@@ -103,6 +125,25 @@ namespace carto {
         return std::shared_ptr<TileData>();
     }
         
+    MemoryBudgetManager::Client::Usage PackageManagerTileDataSource::getCacheMemoryUsage() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        std::size_t usage = 0;
+        for (auto it = _cachedOpenPackageHandlers.begin(); it != _cachedOpenPackageHandlers.end(); it++) {
+            usage += it->second->getMemoryUsage();
+        }
+        return MemoryBudgetManager::Client::Usage(usage, 0);
+    }
+
+    void PackageManagerTileDataSource::applyCacheMemoryQuota() {
+        // Keep at least one package open, otherwise each tile would reopen the package database
+        std::lock_guard<std::mutex> lock(_mutex);
+        _maxOpenPackages = std::max(static_cast<std::size_t>(1), std::min(static_cast<std::size_t>(MAX_OPEN_PACKAGES), _memoryBudgetClient.getCacheCapacity(0) / OPEN_PACKAGE_MEMORY_FOOTPRINT));
+        while (_cachedOpenPackageHandlers.size() > _maxOpenPackages) {
+            _cachedOpenPackageHandlers.back().second->closeDatabase();
+            _cachedOpenPackageHandlers.pop_back();
+        }
+    }
+        
     PackageManagerTileDataSource::PackageManagerListener::PackageManagerListener(PackageManagerTileDataSource& dataSource) :
         _dataSource(dataSource)
     {
@@ -124,6 +165,7 @@ namespace carto {
     }
 
     const unsigned int PackageManagerTileDataSource::MAX_OPEN_PACKAGES = 4;
+    const std::size_t PackageManagerTileDataSource::OPEN_PACKAGE_MEMORY_FOOTPRINT = 10 * 1024 * 1024; // tile cache and database page cache of a single package
 
 }
 
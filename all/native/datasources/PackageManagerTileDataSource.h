@@ -10,8 +10,10 @@
 
 #ifdef _CARTO_PACKAGEMANAGER_SUPPORT
 
+#include "components/MemoryBudgetManager.h"
 #include "datasources/TileDataSource.h"
 #include "packagemanager/PackageManager.h"
+#include "packagemanager/PackageTileLoadStatistics.h"
 
 #include <memory>
 #include <mutex>
@@ -38,6 +40,13 @@ namespace carto {
          */
         std::shared_ptr<PackageManager> getPackageManager() const;
 
+        /**
+         * Returns the tile loading statistics of the local map packages.
+         * The statistics are collected per package, so they include tiles loaded by all data sources using the same package manager.
+         * @return The cumulative tile loading statistics of the local map packages.
+         */
+        std::shared_ptr<PackageTileLoadStatistics> getTileLoadStatistics() const;
+
         virtual std::shared_ptr<TileData> loadTile(const MapTile& mapTile);
 
     protected:
@@ -53,15 +62,22 @@ namespace carto {
         };
 
         static const unsigned int MAX_OPEN_PACKAGES;
+        static const std::size_t OPEN_PACKAGE_MEMORY_FOOTPRINT;
 
         const std::shared_ptr<PackageManager> _packageManager;
 
         mutable std::vector<std::pair<std::shared_ptr<PackageInfo>, std::shared_ptr<MapPackageHandler> > > _cachedOpenPackageHandlers;
+        std::size_t _maxOpenPackages;
 
         mutable std::mutex _mutex;
 
     private:
+        MemoryBudgetManager::Client::Usage getCacheMemoryUsage() const;
+        void applyCacheMemoryQuota();
+
         std::shared_ptr<PackageManagerListener> _packageManagerListener;
+
+        MemoryBudgetManager::Client _memoryBudgetClient;
     };
 
 }
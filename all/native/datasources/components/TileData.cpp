@@ -4,7 +4,7 @@
 namespace carto {
     
     TileData::TileData(const std::shared_ptr<BinaryData>& data) :
-        _data(data), _expirationTime(), _replaceWithParent(false), _mutex()
+        _data(data), _expirationTime(), _replaceWithParent(false), _etag(), _lastModified(), _mutex()
     {
     }
 
@@ -42,6 +42,26 @@ namespace carto {
         _replaceWithParent = flag;
     }
     
+    std::string TileData::getETag() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _etag;
+    }
+
+    void TileData::setETag(const std::string& etag) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _etag = etag;
+    }
+
+    std::string TileData::getLastModified() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _lastModified;
+    }
+
+    void TileData::setLastModified(const std::string& lastModified) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _lastModified = lastModified;
+    }
+    
     const std::shared_ptr<BinaryData>& TileData::getData() const {
         return _data;
     }
@@ -10,6 +10,7 @@
 #include <chrono>
 #include <memory>
 #include <mutex>
+#include <string>
 #include <vector>
 
 namespace carto {
@@ -48,6 +49,30 @@ namespace carto {
          * @param flag True when the tile should be replaced with the parent, false otherwise.
          */
         void setReplaceWithParent(bool flag);
+
+        /**
+         * Returns the entity tag (ETag) of the tile data, if provided by the source.
+         * The tag can be used to revalidate the tile data once it has expired.
+         * @return The entity tag of the tile data or empty string if not available.
+         */
+        std::string getETag() const;
+        /**
+         * Sets the entity tag (ETag) of the tile data.
+         * @param etag The entity tag of the tile data or empty string if not available.
+         */
+        void setETag(const std::string& etag);
+
+        /**
+         * Returns the last modification time of the tile data in HTTP date format, if provided by the source.
+         * The time can be used to revalidate the tile data once it has expired.
+         * @return The last modification time of the tile data or empty string if not available.
+         */
+        std::string getLastModified() const;
+        /**
+         * Sets the last modification time of the tile data in HTTP date format.
+         * @param lastModified The last modification time of the tile data or empty string if not available.
+         */
+        void setLastModified(const std::string& lastModified);
         
         /**
          * Returns tile data as binary data.
@@ -59,6 +84,8 @@ namespace carto {
         const std::shared_ptr<BinaryData> _data;
         std::shared_ptr<std::chrono::steady_clock::time_point> _expirationTime;
         bool _replaceWithParent;
+        std::string _etag;
+        std::string _lastModified;
         mutable std::mutex _mutex;
     };
 
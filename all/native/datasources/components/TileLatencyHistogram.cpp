@@ -0,0 +1,67 @@
+#include "TileLatencyHistogram.h"
+#include "core/MapTile.h"
+#include "datasources/TileDataSource.h"
+
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+
+namespace carto {
+
+    TileLatencyHistogram::TileLatencyHistogram() :
+        _counts(BUCKET_COUNT + 1, 0),
+        _mutex()
+    {
+    }
+
+    std::vector<int> TileLatencyHistogram::getCounts() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _counts;
+    }
+
+    void TileLatencyHistogram::addSample(int milliseconds) {
+        int bucket = 0;
+        while (bucket < BUCKET_COUNT && milliseconds >= BUCKET_LIMITS[bucket]) {
+            bucket++;
+        }
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        _counts[bucket]++;
+    }
+
+    void TileLatencyHistogram::clear() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        std::fill(_counts.begin(), _counts.end(), 0);
+    }
+
+    std::shared_ptr<TileData> TileLatencyHistogram::loadTile(const DirectorPtr<TileDataSource>& dataSource, const MapTile& mapTile) {
+        // Failed loads are not recorded, as their latency says nothing about the tile load time
+        auto startTime = std::chrono::steady_clock::now();
+        std::shared_ptr<TileData> result = dataSource->loadTile(mapTile);
+        auto duration = std::chrono::steady_clock::now() - startTime;
+        addSample(static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(duration).count()));
+        return result;
+    }
+
+    std::string TileLatencyHistogram::toString() const {
+        std::vector<int> counts = getCounts();
+        std::stringstream ss;
+        ss << "TileLatencyHistogram [";
+        for (int i = 0; i <= BUCKET_COUNT; i++) {
+            ss << (i > 0 ? ", " : "");
+            if (i < BUCKET_COUNT) {
+                ss << "<" << BUCKET_LIMITS[i] << "ms: ";
+            } else {
+                ss << ">=" << BUCKET_LIMITS[BUCKET_COUNT - 1] << "ms: ";
+            }
+            ss << counts[i];
+        }
+        ss << "]";
+        return ss.str();
+    }
+
+    const int TileLatencyHistogram::BUCKET_LIMITS[] = { 10, 25, 50, 100, 250, 500, 1000, 2500, 5000 };
+
+    const int TileLatencyHistogram::BUCKET_COUNT = sizeof(BUCKET_LIMITS) / sizeof(BUCKET_LIMITS[0]);
+
+}
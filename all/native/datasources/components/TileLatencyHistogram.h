@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2016 CartoDB. All rights reserved.
+ * Copying and using this code is allowed only according
+ * to license terms, as given in https://cartodb.com/terms/
+ */
+
+#ifndef _CARTO_TILELATENCYHISTOGRAM_H_
+#define _CARTO_TILELATENCYHISTOGRAM_H_
+
+#include "components/DirectorPtr.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace carto {
+    class MapTile;
+    class TileData;
+    class TileDataSource;
+
+    /**
+     * Thread-safe histogram of tile load latencies, using fixed buckets.
+     */
+    class TileLatencyHistogram {
+    public:
+        TileLatencyHistogram();
+
+        std::vector<int> getCounts() const;
+
+        void addSample(int milliseconds);
+        void clear();
+
+        std::shared_ptr<TileData> loadTile(const DirectorPtr<TileDataSource>& dataSource, const MapTile& mapTile);
+
+        std::string toString() const;
+
+    private:
+        static const int BUCKET_LIMITS[];
+        static const int BUCKET_COUNT;
+
+        std::vector<int> _counts;
+        mutable std::mutex _mutex;
+    };
+
+}
+
+#endif
@@ -1,6 +1,7 @@
 #ifdef _CARTO_GEOCODING_SUPPORT
 
 #include "GeocodingProxy.h"
+#include "components/CancelableThreadPool.h"
 #include "core/Variant.h"
 #include "geometry/Feature.h"
 #include "geometry/FeatureCollection.h"
@@ -12,13 +13,16 @@
 #include "projections/Projection.h"
 #include "projections/EPSG3857.h"
 #include "utils/Const.h"
+#include "utils/Log.h"
 
 #include <geocoding/Geocoder.h>
 #include <geocoding/RevGeocoder.h>
 
 #include <cmath>
+#include <chrono>
 #include <functional>
 #include <algorithm>
+#include <tuple>
 
 namespace {
 
@@ -70,7 +74,7 @@ namespace carto {
 
         std::vector<std::shared_ptr<GeocodingResult> > results;
         for (const std::pair<geocoding::Address, float>& addr : addrs) {
-            results.push_back(TranslateAddress(request->getProjection(), addr.first, addr.second));
+            results.push_back(TranslateAddress(request->getProjection(), addr.first, addr.second, true));
         }
         return results;
     }
@@ -81,17 +85,175 @@ namespace carto {
 
         std::vector<std::shared_ptr<GeocodingResult> > results;
         for (const std::pair<geocoding::Address, float>& addr : addrs) {
-            results.push_back(TranslateAddress(request->getProjection(), addr.first, addr.second));
+            results.push_back(TranslateAddress(request->getProjection(), addr.first, addr.second, true));
         }
         return results;
     }
 
+    std::vector<std::vector<std::shared_ptr<GeocodingResult> > > GeocodingProxy::CalculateAddressesBatch(const std::vector<std::shared_ptr<geocoding::Geocoder> >& geocoders, const std::shared_ptr<CancelableThreadPool>& threadPool, const std::vector<std::shared_ptr<GeocodingRequest> >& requests) {
+        auto startTime = std::chrono::steady_clock::now();
+
+        // Each geocoder is used by a single worker only. The calling thread uses the first geocoder,
+        // the others are used by pool tasks. Tasks that start after all requests are claimed simply exit.
+        auto state = std::make_shared<BatchState>(requests);
+        std::size_t workerCount = std::min(geocoders.size(), requests.size());
+        if (threadPool) {
+            for (std::size_t i = 1; i < workerCount; i++) {
+                threadPool->execute(std::make_shared<BatchTask>(state, geocoders[i]));
+            }
+        } else {
+            workerCount = std::min(workerCount, static_cast<std::size_t>(1));
+        }
+        if (!geocoders.empty()) {
+            ProcessBatchRequests(*state, geocoders.front());
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(state->mutex);
+            state->condition.wait(lock, [&state]() { return state->completedCount >= state->requests.size(); });
+        }
+
+        for (const std::exception_ptr& exception : state->exceptions) {
+            if (exception) {
+                std::rethrow_exception(exception);
+            }
+        }
+
+        double elapsedTime = std::chrono::duration_cast<std::chrono::duration<double> >(std::chrono::steady_clock::now() - startTime).count();
+        Log::Infof("GeocodingProxy::CalculateAddressesBatch: Processed %d requests using %d geocoders in %.3fs (%.1f requests/s)", static_cast<int>(requests.size()), static_cast<int>(workerCount), elapsedTime, elapsedTime > 0 ? requests.size() / elapsedTime : 0.0);
+        return state->results;
+    }
+
+    struct GeocodingProxy::CachedCellAddresses {
+        struct Entry {
+            double x, y;
+            float radius;
+            std::vector<std::pair<geocoding::Address, float> > addrs;
+        };
+
+        std::vector<Entry> entries; // most recently added last
+    };
+
+    std::vector<std::vector<std::shared_ptr<GeocodingResult> > > GeocodingProxy::CalculateAddressesBatch(const std::shared_ptr<geocoding::RevGeocoder>& revGeocoder, RevAddressCache& addressCache, const std::vector<std::shared_ptr<ReverseGeocodingRequest> >& requests, bool includeGeometry) {
+        auto startTime = std::chrono::steady_clock::now();
+
+        // Recent answers are cached per zoom 14 cell and reused for identical queries, also across batches.
+        // The cache is evicted by whole cells, each cell keeps a few exact (location, radius) answers.
+        std::vector<std::size_t> order = CalculateBatchOrder(requests);
+        std::size_t cacheHits = 0;
+
+        std::vector<std::vector<std::shared_ptr<GeocodingResult> > > results(requests.size());
+        for (std::size_t i = 0; i < order.size(); i++) {
+            const std::shared_ptr<ReverseGeocodingRequest>& request = requests[order[i]];
+            MapPos posWgs84 = request->getProjection()->toWgs84(request->getLocation());
+            std::uint64_t cellKey = CalculateCellKey(posWgs84);
+
+            std::shared_ptr<CachedCellAddresses> cellAddrs;
+            if (!addressCache.read(cellKey, cellAddrs)) {
+                cellAddrs = std::make_shared<CachedCellAddresses>();
+                addressCache.put(cellKey, cellAddrs, 1);
+            }
+            auto entryIt = std::find_if(cellAddrs->entries.begin(), cellAddrs->entries.end(), [&posWgs84, &request](const CachedCellAddresses::Entry& entry) {
+                return entry.x == posWgs84.getX() && entry.y == posWgs84.getY() && entry.radius == request->getSearchRadius();
+            });
+            if (entryIt != cellAddrs->entries.end()) {
+                cacheHits++;
+            } else {
+                if (cellAddrs->entries.size() >= MAX_CACHED_CELL_ADDRESSES) {
+                    cellAddrs->entries.erase(cellAddrs->entries.begin());
+                }
+                cellAddrs->entries.push_back(CachedCellAddresses::Entry { posWgs84.getX(), posWgs84.getY(), request->getSearchRadius(), revGeocoder->findAddresses(posWgs84.getX(), posWgs84.getY(), request->getSearchRadius()) });
+                entryIt = cellAddrs->entries.end() - 1;
+            }
+
+            std::vector<std::shared_ptr<GeocodingResult> >& requestResults = results[order[i]];
+            for (const std::pair<geocoding::Address, float>& addr : entryIt->addrs) {
+                requestResults.push_back(TranslateAddress(request->getProjection(), addr.first, addr.second, includeGeometry));
+            }
+        }
+
+        double elapsedTime = std::chrono::duration_cast<std::chrono::duration<double> >(std::chrono::steady_clock::now() - startTime).count();
+        Log::Infof("GeocodingProxy::CalculateAddressesBatch: Processed %d reverse requests (%d cache hits) in %.3fs (%.1f requests/s)", static_cast<int>(requests.size()), static_cast<int>(cacheHits), elapsedTime, elapsedTime > 0 ? requests.size() / elapsedTime : 0.0);
+        return results;
+    }
+
+    std::vector<std::size_t> GeocodingProxy::CalculateBatchOrder(const std::vector<std::shared_ptr<ReverseGeocodingRequest> >& requests) {
+        // Order the requests by the Morton code of their tile, so that requests sharing candidate tiles are processed one after another.
+        // Within a tile, order by exact location and radius, so that identical queries are adjacent.
+        struct OrderKey {
+            std::uint64_t cellKey;
+            double x, y;
+            float radius;
+            std::size_t index;
+
+            bool operator < (const OrderKey& other) const {
+                return std::tie(cellKey, x, y, radius, index) < std::tie(other.cellKey, other.x, other.y, other.radius, other.index);
+            }
+        };
+
+        std::vector<OrderKey> keys;
+        keys.reserve(requests.size());
+        for (std::size_t i = 0; i < requests.size(); i++) {
+            MapPos posWgs84 = requests[i]->getProjection()->toWgs84(requests[i]->getLocation());
+            keys.push_back(OrderKey { CalculateCellKey(posWgs84), posWgs84.getX(), posWgs84.getY(), requests[i]->getSearchRadius(), i });
+        }
+        std::sort(keys.begin(), keys.end());
+
+        std::vector<std::size_t> order;
+        order.reserve(keys.size());
+        for (const OrderKey& key : keys) {
+            order.push_back(key.index);
+        }
+        return order;
+    }
+
+    GeocodingProxy::BatchState::BatchState(const std::vector<std::shared_ptr<GeocodingRequest> >& requests) :
+        requests(requests),
+        results(requests.size()),
+        exceptions(requests.size()),
+        nextIndex(0),
+        completedCount(0),
+        condition(),
+        mutex()
+    {
+    }
+
+    GeocodingProxy::BatchTask::BatchTask(const std::shared_ptr<BatchState>& state, const std::shared_ptr<geocoding::Geocoder>& geocoder) :
+        _state(state),
+        _geocoder(geocoder)
+    {
+    }
+
+    void GeocodingProxy::BatchTask::run() {
+        if (!isCanceled()) {
+            ProcessBatchRequests(*_state, _geocoder);
+        }
+    }
+
     GeocodingProxy::GeocodingProxy() {
     }
 
-    std::shared_ptr<GeocodingResult> GeocodingProxy::TranslateAddress(const std::shared_ptr<Projection>& proj, const geocoding::Address& addr, float rank) {
+    void GeocodingProxy::ProcessBatchRequests(BatchState& state, const std::shared_ptr<geocoding::Geocoder>& geocoder) {
+        for (std::size_t i = state.nextIndex++; i < state.requests.size(); i = state.nextIndex++) {
+            try {
+                state.results[i] = CalculateAddresses(geocoder, state.requests[i]);
+            }
+            catch (...) {
+                state.exceptions[i] = std::current_exception();
+            }
+
+            std::lock_guard<std::mutex> lock(state.mutex);
+            if (++state.completedCount >= state.requests.size()) {
+                state.condition.notify_all();
+            }
+        }
+    }
+
+    std::shared_ptr<GeocodingResult> GeocodingProxy::TranslateAddress(const std::shared_ptr<Projection>& proj, const geocoding::Address& addr, float rank, bool includeGeometry) {
         std::vector<std::shared_ptr<Feature> > features;
-        std::transform(addr.features.begin(), addr.features.end(), std::back_inserter(features), std::bind(&GeocodingProxy::TranslateFeature, proj, std::placeholders::_1));
+        if (includeGeometry) {
+            std::transform(addr.features.begin(), addr.features.end(), std::back_inserter(features), std::bind(&GeocodingProxy::TranslateFeature, proj, std::placeholders::_1));
+        }
         auto featureCollection = std::make_shared<FeatureCollection>(features);
         std::vector<std::string> categories(addr.categories.begin(), addr.categories.end());
         Address address(addr.country, addr.region, addr.county, addr.locality, addr.neighbourhood, addr.street, addr.postcode, addr.houseNumber, addr.name, categories);
@@ -136,6 +298,24 @@ namespace carto {
         }
         return std::shared_ptr<Geometry>();
     }
+
+    std::uint64_t GeocodingProxy::CalculateCellKey(const MapPos& posWgs84) {
+        // Interleave the bits of cell coordinates to get Morton code of the cell
+        std::uint64_t x = static_cast<std::uint64_t>(std::max(0.0, std::min(360.0, posWgs84.getX() + 180.0)) / BATCH_CELL_SIZE);
+        std::uint64_t y = static_cast<std::uint64_t>(std::max(0.0, std::min(180.0, posWgs84.getY() + 90.0)) / BATCH_CELL_SIZE);
+        std::uint64_t key = 0;
+        for (int i = 0; i < 32; i++) {
+            key |= ((x >> i) & 1) << (2 * i);
+            key |= ((y >> i) & 1) << (2 * i + 1);
+        }
+        return key;
+    }
+
+    const std::size_t GeocodingProxy::BATCH_CACHE_SIZE = 256;
+
+    const double GeocodingProxy::BATCH_CELL_SIZE = 360.0 / (1 << 14); // width of a zoom level 14 tile
+
+    const std::size_t GeocodingProxy::MAX_CACHED_CELL_ADDRESSES = 16;
     
 }
 
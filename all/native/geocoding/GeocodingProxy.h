@@ -9,12 +9,19 @@
 
 #ifdef _CARTO_GEOCODING_SUPPORT
 
+#include "components/CancelableTask.h"
 #include "geocoding/GeocodingService.h"
 #include "geocoding/ReverseGeocodingService.h"
 
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
 #include <memory>
 #include <vector>
 
+#include <stdext/timed_lru_cache.h>
+
 namespace carto {
     namespace geocoding {
         struct Address;
@@ -27,6 +34,7 @@ namespace carto {
     class Geometry;
     class Feature;
     class FeatureCollection;
+    class CancelableThreadPool;
     
     class GeocodingProxy {
     public:
@@ -34,14 +42,55 @@ namespace carto {
 
         static std::vector<std::shared_ptr<GeocodingResult> > CalculateAddresses(const std::shared_ptr<geocoding::RevGeocoder>& revGeocoder, const std::shared_ptr<ReverseGeocodingRequest>& request);
 
+        static std::vector<std::vector<std::shared_ptr<GeocodingResult> > > CalculateAddressesBatch(const std::vector<std::shared_ptr<geocoding::Geocoder> >& geocoders, const std::shared_ptr<CancelableThreadPool>& threadPool, const std::vector<std::shared_ptr<GeocodingRequest> >& requests);
+
+        struct CachedCellAddresses;
+        typedef cache::timed_lru_cache<std::uint64_t, std::shared_ptr<CachedCellAddresses> > RevAddressCache;
+
+        static std::vector<std::vector<std::shared_ptr<GeocodingResult> > > CalculateAddressesBatch(const std::shared_ptr<geocoding::RevGeocoder>& revGeocoder, RevAddressCache& addressCache, const std::vector<std::shared_ptr<ReverseGeocodingRequest> >& requests, bool includeGeometry);
+
+        static std::vector<std::size_t> CalculateBatchOrder(const std::vector<std::shared_ptr<ReverseGeocodingRequest> >& requests);
+
+        static const std::size_t BATCH_CACHE_SIZE;
+
     private:
+        struct BatchState {
+            std::vector<std::shared_ptr<GeocodingRequest> > requests;
+            std::vector<std::vector<std::shared_ptr<GeocodingResult> > > results;
+            std::vector<std::exception_ptr> exceptions;
+            std::atomic<std::size_t> nextIndex;
+            std::size_t completedCount; // guarded by mutex
+            std::condition_variable condition;
+            std::mutex mutex;
+
+            explicit BatchState(const std::vector<std::shared_ptr<GeocodingRequest> >& requests);
+        };
+
+        class BatchTask : public CancelableTask {
+        public:
+            BatchTask(const std::shared_ptr<BatchState>& state, const std::shared_ptr<geocoding::Geocoder>& geocoder);
+
+            virtual void run();
+
+        private:
+            std::shared_ptr<BatchState> _state;
+            std::shared_ptr<geocoding::Geocoder> _geocoder;
+        };
+
         GeocodingProxy();
 
-        static std::shared_ptr<GeocodingResult> TranslateAddress(const std::shared_ptr<Projection>& proj, const geocoding::Address& addr, float rank);
+        static void ProcessBatchRequests(BatchState& state, const std::shared_ptr<geocoding::Geocoder>& geocoder);
+
+        static std::shared_ptr<GeocodingResult> TranslateAddress(const std::shared_ptr<Projection>& proj, const geocoding::Address& addr, float rank, bool includeGeometry);
 
         static std::shared_ptr<Feature> TranslateFeature(const std::shared_ptr<Projection>& proj, const geocoding::Feature& feature);
 
         static std::shared_ptr<Geometry> TranslateGeometry(const std::shared_ptr<Projection>& proj, const std::shared_ptr<geocoding::Geometry>& geom);
+
+        static std::uint64_t CalculateCellKey(const MapPos& posWgs84);
+
+        static const double BATCH_CELL_SIZE;
+        static const std::size_t MAX_CACHED_CELL_ADDRESSES;
     };
     
 }
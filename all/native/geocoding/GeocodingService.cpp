@@ -10,6 +10,15 @@ namespace carto {
     GeocodingService::~GeocodingService() {
     }
 
+    std::vector<std::vector<std::shared_ptr<GeocodingResult> > > GeocodingService::calculateAddressesBatch(const std::vector<std::shared_ptr<GeocodingRequest> >& requests) const {
+        std::vector<std::vector<std::shared_ptr<GeocodingResult> > > results;
+        results.reserve(requests.size());
+        for (const std::shared_ptr<GeocodingRequest>& request : requests) {
+            results.push_back(calculateAddresses(request));
+        }
+        return results;
+    }
+
 }
 
 #endif
@@ -67,6 +67,15 @@ namespace carto {
          */
         virtual std::vector<std::shared_ptr<GeocodingResult> > calculateAddresses(const std::shared_ptr<GeocodingRequest>& request) const = 0;
 
+        /**
+         * Calculates matching addresses for a list of geocoding requests.
+         * The default implementation processes the requests one by one. Services based on a single database file may process the requests in parallel.
+         * @param requests The list of geocoding requests to use.
+         * @result The list of matching geocoding results for each request, in the same order as the requests.
+         * @throws std::runtime_error If IO error occured during the calculation.
+         */
+        virtual std::vector<std::vector<std::shared_ptr<GeocodingResult> > > calculateAddressesBatch(const std::vector<std::shared_ptr<GeocodingRequest> >& requests) const;
+
     protected:
         /**
          * The default constructor.
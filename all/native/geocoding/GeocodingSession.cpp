@@ -0,0 +1,95 @@
+#ifdef _CARTO_GEOCODING_SUPPORT
+
+#include "GeocodingSession.h"
+#include "components/Exceptions.h"
+#include "geocoding/GeocodingService.h"
+#include "projections/Projection.h"
+
+#include <iomanip>
+#include <sstream>
+
+namespace carto {
+
+    GeocodingSession::GeocodingSession(const std::shared_ptr<GeocodingService>& service) :
+        _service(service),
+        _queryCache(MAX_CACHED_QUERIES),
+        _mutex()
+    {
+        if (!service) {
+            throw NullArgumentException("Null service");
+        }
+    }
+
+    GeocodingSession::~GeocodingSession() {
+    }
+
+    const std::shared_ptr<GeocodingService>& GeocodingSession::getService() const {
+        return _service;
+    }
+
+    std::vector<std::shared_ptr<GeocodingResult> > GeocodingSession::calculateAddresses(const std::shared_ptr<GeocodingRequest>& request) {
+        if (!request) {
+            throw NullArgumentException("Null request");
+        }
+
+        std::string context = GetRequestContext(request);
+        const std::string& query = request->getQuery();
+
+        // Empty queries are not cached, their results say nothing about longer queries
+        if (query.empty()) {
+            return _service->calculateAddresses(request);
+        }
+
+        bool autocomplete = _service->isAutocomplete();
+        Variant autocompleteParam = request->getCustomParameter("autocomplete");
+        if (autocompleteParam.getType() != VariantType::VARIANT_TYPE_NULL) {
+            autocomplete = autocompleteParam.getBool();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            std::vector<std::shared_ptr<GeocodingResult> > results;
+            if (_queryCache.read(context + query, results)) {
+                return results;
+            }
+
+            // In autocomplete mode, a query extending a prefix without matches can not have matches either
+            if (autocomplete) {
+                for (std::size_t len = query.size() - 1; len >= 1; len--) {
+                    if (_queryCache.peek(context + query.substr(0, len), results) && results.empty()) {
+                        return results;
+                    }
+                }
+            }
+        }
+
+        std::vector<std::shared_ptr<GeocodingResult> > results = _service->calculateAddresses(request);
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        _queryCache.put(context + query, results, 1);
+        return results;
+    }
+
+    void GeocodingSession::clear() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _queryCache.clear();
+    }
+
+    std::string GeocodingSession::GetRequestContext(const std::shared_ptr<GeocodingRequest>& request) {
+        std::stringstream ss;
+        ss << std::setiosflags(std::ios::fixed);
+        ss << request->getProjection()->getName();
+        if (request->isLocationDefined()) {
+            ss << ";" << request->getLocation().toString();
+        }
+        ss << ";" << request->getLocationRadius();
+        ss << ";" << request->getCustomParameters().toString();
+        ss << "\n";
+        return ss.str();
+    }
+
+    const std::size_t GeocodingSession::MAX_CACHED_QUERIES = 64;
+
+}
+
+#endif
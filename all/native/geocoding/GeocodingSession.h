@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2016 CartoDB. All rights reserved.
+ * Copying and using this code is allowed only according
+ * to license terms, as given in https://cartodb.com/terms/
+ */
+
+#ifndef _CARTO_GEOCODINGSESSION_H_
+#define _CARTO_GEOCODINGSESSION_H_
+
+#ifdef _CARTO_GEOCODING_SUPPORT
+
+#include "geocoding/GeocodingRequest.h"
+#include "geocoding/GeocodingResult.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <stdext/timed_lru_cache.h>
+
+namespace carto {
+    class GeocodingService;
+
+    /**
+     * A geocoding session for interactive (autocomplete) queries.
+     * The session caches the results of recent queries, so that repeated queries (for example, when user deletes characters)
+     * are not recalculated. In autocomplete mode the session also detects queries extending a prefix that had no matches
+     * and returns empty result for these queries without querying the service.
+     */
+    class GeocodingSession {
+    public:
+        /**
+         * Constructs a new GeocodingSession instance for the given geocoding service.
+         * @param service The geocoding service to use.
+         */
+        explicit GeocodingSession(const std::shared_ptr<GeocodingService>& service);
+        virtual ~GeocodingSession();
+
+        /**
+         * Returns the geocoding service of the session.
+         * @return The geocoding service of the session.
+         */
+        const std::shared_ptr<GeocodingService>& getService() const;
+
+        /**
+         * Calculates matching addresses from the specified geocoding request, using cached results when possible.
+         * @param request The geocoding request to use.
+         * @result The list of matching geocoding results, sorted by descending ranks.
+         * @throws std::runtime_error If IO error occured during the calculation.
+         */
+        std::vector<std::shared_ptr<GeocodingResult> > calculateAddresses(const std::shared_ptr<GeocodingRequest>& request);
+
+        /**
+         * Clears the cached results of the session.
+         * This should be called when the data of the geocoding service or its options change.
+         */
+        void clear();
+
+    private:
+        static std::string GetRequestContext(const std::shared_ptr<GeocodingRequest>& request);
+
+        static const std::size_t MAX_CACHED_QUERIES;
+
+        const std::shared_ptr<GeocodingService> _service;
+
+        cache::timed_lru_cache<std::string, std::vector<std::shared_ptr<GeocodingResult> > > _queryCache;
+
+        mutable std::mutex _mutex;
+    };
+    
+}
+
+#endif
+
+#endif
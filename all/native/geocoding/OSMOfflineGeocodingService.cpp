@@ -1,6 +1,7 @@
 #if defined(_CARTO_GEOCODING_SUPPORT) && defined(_CARTO_OFFLINE_SUPPORT)
 
 #include "OSMOfflineGeocodingService.h"
+#include "components/CancelableThreadPool.h"
 #include "components/Exceptions.h"
 #include "geocoding/GeocodingProxy.h"
 
@@ -8,45 +9,52 @@
 
 #include <sqlite3pp.h>
 
+#include <algorithm>
+#include <thread>
+
 namespace carto {
 
     OSMOfflineGeocodingService::OSMOfflineGeocodingService(const std::string& path) :
-        _geocoder()
+        _path(path),
+        _geocoder(CreateGeocoder(path)),
+        _idleBatchGeocoders(),
+        _batchThreadPool(std::make_shared<CancelableThreadPool>()),
+        _mutex()
     {
-        auto database = std::make_shared<sqlite3pp::database>();
-        if (database->connect_v2(path.c_str(), SQLITE_OPEN_READONLY) != SQLITE_OK) {
-            throw FileException("Failed to open geocoding database", path);
-        }
-        _geocoder = std::make_shared<geocoding::Geocoder>();
-        if (!_geocoder->import(database)) {
-            throw GenericException("Failed to import geocoding database", path);
-        }
+        _batchThreadPool->setPoolSize(MAX_BATCH_GEOCODERS - 1);
     }
 
     OSMOfflineGeocodingService::~OSMOfflineGeocodingService() {
+        _batchThreadPool->deinit();
     }
 
     bool OSMOfflineGeocodingService::isAutocomplete() const {
+        std::lock_guard<std::mutex> lock(_mutex);
         return _geocoder->getAutocomplete();
     }
 
     void OSMOfflineGeocodingService::setAutocomplete(bool autocomplete) {
+        std::lock_guard<std::mutex> lock(_mutex);
         _geocoder->setAutocomplete(autocomplete);
     }
 
     std::string OSMOfflineGeocodingService::getLanguage() const {
+        std::lock_guard<std::mutex> lock(_mutex);
         return _geocoder->getLanguage();
     }
 
     void OSMOfflineGeocodingService::setLanguage(const std::string& lang) {
+        std::lock_guard<std::mutex> lock(_mutex);
         _geocoder->setLanguage(lang);
     }
 
     int OSMOfflineGeocodingService::getMaxResults() const {
+        std::lock_guard<std::mutex> lock(_mutex);
         return _geocoder->getMaxResults();
     }
 
     void OSMOfflineGeocodingService::setMaxResults(int maxResults) {
+        std::lock_guard<std::mutex> lock(_mutex);
         _geocoder->setMaxResults(maxResults);
     }
 
@@ -57,6 +65,75 @@ namespace carto {
 
         return GeocodingProxy::CalculateAddresses(_geocoder, request);
     }
+
+    std::vector<std::vector<std::shared_ptr<GeocodingResult> > > OSMOfflineGeocodingService::calculateAddressesBatch(const std::vector<std::shared_ptr<GeocodingRequest> >& requests) const {
+        for (const std::shared_ptr<GeocodingRequest>& request : requests) {
+            if (!request) {
+                throw NullArgumentException("Null request");
+            }
+        }
+
+        // Batch workers use geocoders of their own with separate database connections. The main geocoder is used
+        // by calculateAddresses without locking, so it is never used by batch workers. Only the settings are copied.
+        std::size_t geocoderCount = std::max(static_cast<std::size_t>(1), std::min(requests.size(), static_cast<std::size_t>(std::max(1u, std::min(std::thread::hardware_concurrency(), static_cast<unsigned int>(MAX_BATCH_GEOCODERS))))));
+        std::vector<std::shared_ptr<geocoding::Geocoder> > geocoders;
+        bool autocomplete = false;
+        std::string language;
+        int maxResults = 0;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            autocomplete = _geocoder->getAutocomplete();
+            language = _geocoder->getLanguage();
+            maxResults = _geocoder->getMaxResults();
+            while (geocoders.size() < geocoderCount && !_idleBatchGeocoders.empty()) {
+                geocoders.push_back(_idleBatchGeocoders.back());
+                _idleBatchGeocoders.pop_back();
+            }
+        }
+        while (geocoders.size() < geocoderCount) {
+            geocoders.push_back(CreateGeocoder(_path));
+        }
+        for (const std::shared_ptr<geocoding::Geocoder>& geocoder : geocoders) {
+            geocoder->setAutocomplete(autocomplete);
+            geocoder->setLanguage(language);
+            geocoder->setMaxResults(maxResults);
+        }
+
+        // The lock is not held during the batch, so concurrent batches use separate geocoders
+        std::vector<std::vector<std::shared_ptr<GeocodingResult> > > results;
+        try {
+            results = GeocodingProxy::CalculateAddressesBatch(geocoders, _batchThreadPool, requests);
+        }
+        catch (...) {
+            releaseBatchGeocoders(geocoders);
+            throw;
+        }
+        releaseBatchGeocoders(geocoders);
+        return results;
+    }
+
+    void OSMOfflineGeocodingService::releaseBatchGeocoders(const std::vector<std::shared_ptr<geocoding::Geocoder> >& geocoders) const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (const std::shared_ptr<geocoding::Geocoder>& geocoder : geocoders) {
+            if (_idleBatchGeocoders.size() < static_cast<std::size_t>(MAX_BATCH_GEOCODERS)) {
+                _idleBatchGeocoders.push_back(geocoder);
+            }
+        }
+    }
+
+    std::shared_ptr<geocoding::Geocoder> OSMOfflineGeocodingService::CreateGeocoder(const std::string& path) {
+        auto database = std::make_shared<sqlite3pp::database>();
+        if (database->connect_v2(path.c_str(), SQLITE_OPEN_READONLY) != SQLITE_OK) {
+            throw FileException("Failed to open geocoding database", path);
+        }
+        auto geocoder = std::make_shared<geocoding::Geocoder>();
+        if (!geocoder->import(database)) {
+            throw GenericException("Failed to import geocoding database", path);
+        }
+        return geocoder;
+    }
+
+    const int OSMOfflineGeocodingService::MAX_BATCH_GEOCODERS = 4;
     
 }
 
@@ -11,11 +11,16 @@
 
 #include "geocoding/GeocodingService.h"
 
+#include <mutex>
+#include <vector>
+
 namespace carto {
     namespace geocoding {
         class Geocoder;
     }
 
+    class CancelableThreadPool;
+
     /**
      * A geocoding service that uses custom geocoding database files.
      * Note: this class is experimental and may change or even be removed in future SDK versions.
@@ -41,8 +46,21 @@ namespace carto {
 
         virtual std::vector<std::shared_ptr<GeocodingResult> > calculateAddresses(const std::shared_ptr<GeocodingRequest>& request) const;
 
+        virtual std::vector<std::vector<std::shared_ptr<GeocodingResult> > > calculateAddressesBatch(const std::vector<std::shared_ptr<GeocodingRequest> >& requests) const;
+
     protected:
+        void releaseBatchGeocoders(const std::vector<std::shared_ptr<geocoding::Geocoder> >& geocoders) const;
+
+        static std::shared_ptr<geocoding::Geocoder> CreateGeocoder(const std::string& path);
+
+        static const int MAX_BATCH_GEOCODERS;
+
+        const std::string _path;
         std::shared_ptr<geocoding::Geocoder> _geocoder;
+
+        mutable std::vector<std::shared_ptr<geocoding::Geocoder> > _idleBatchGeocoders; // geocoders of finished batches, never contains _geocoder
+        std::shared_ptr<CancelableThreadPool> _batchThreadPool;
+        mutable std::mutex _mutex;
     };
     
 }
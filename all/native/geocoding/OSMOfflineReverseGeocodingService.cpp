@@ -11,7 +11,9 @@
 namespace carto {
 
     OSMOfflineReverseGeocodingService::OSMOfflineReverseGeocodingService(const std::string& path) :
-        _revGeocoder()
+        _revGeocoder(),
+        _batchAddressCache(GeocodingProxy::BATCH_CACHE_SIZE),
+        _batchMutex()
     {
         auto database = std::make_shared<sqlite3pp::database>();
         if (database->connect_v2(path.c_str(), SQLITE_OPEN_READONLY) != SQLITE_OK) {
@@ -31,7 +33,9 @@ namespace carto {
     }
 
     void OSMOfflineReverseGeocodingService::setLanguage(const std::string& lang) {
+        std::lock_guard<std::mutex> lock(_batchMutex);
         _revGeocoder->setLanguage(lang);
+        _batchAddressCache.clear();
     }
 
     std::vector<std::shared_ptr<GeocodingResult> > OSMOfflineReverseGeocodingService::calculateAddresses(const std::shared_ptr<ReverseGeocodingRequest>& request) const {
@@ -41,6 +45,18 @@ namespace carto {
 
         return GeocodingProxy::CalculateAddresses(_revGeocoder, request);
     }
+
+    std::vector<std::vector<std::shared_ptr<GeocodingResult> > > OSMOfflineReverseGeocodingService::calculateAddressesBatch(const std::vector<std::shared_ptr<ReverseGeocodingRequest> >& requests, bool includeGeometry) const {
+        for (const std::shared_ptr<ReverseGeocodingRequest>& request : requests) {
+            if (!request) {
+                throw NullArgumentException("Null request");
+            }
+        }
+
+        // The recent answer cache is shared between batches, so batches are processed one at a time
+        std::lock_guard<std::mutex> lock(_batchMutex);
+        return GeocodingProxy::CalculateAddressesBatch(_revGeocoder, _batchAddressCache, requests, includeGeometry);
+    }
     
 }
 
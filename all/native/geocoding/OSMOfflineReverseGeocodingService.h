@@ -9,8 +9,11 @@
 
 #if defined(_CARTO_GEOCODING_SUPPORT) && defined(_CARTO_OFFLINE_SUPPORT)
 
+#include "geocoding/GeocodingProxy.h"
 #include "geocoding/ReverseGeocodingService.h"
 
+#include <mutex>
+
 namespace carto {
     namespace geocoding {
         class RevGeocoder;
@@ -35,8 +38,13 @@ namespace carto {
 
         virtual std::vector<std::shared_ptr<GeocodingResult> > calculateAddresses(const std::shared_ptr<ReverseGeocodingRequest>& request) const;
 
+        virtual std::vector<std::vector<std::shared_ptr<GeocodingResult> > > calculateAddressesBatch(const std::vector<std::shared_ptr<ReverseGeocodingRequest> >& requests, bool includeGeometry) const;
+
     protected:
         std::shared_ptr<geocoding::RevGeocoder> _revGeocoder;
+
+        mutable GeocodingProxy::RevAddressCache _batchAddressCache;
+        mutable std::mutex _batchMutex;
     };
     
 }
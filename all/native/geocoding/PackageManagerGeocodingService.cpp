@@ -6,6 +6,8 @@
 #include "packagemanager/PackageInfo.h"
 #include "packagemanager/handlers/GeocodingPackageHandler.h"
 
+#include <algorithm>
+
 #include <geocoding/Geocoder.h>
 
 #include <sqlite3pp.h>
@@ -17,8 +19,7 @@ namespace carto {
         _autocomplete(false),
         _language(),
         _maxResults(10),
-        _cachedPackageDatabaseMap(),
-        _cachedGeocoder(),
+        _idleGeocoders(),
         _mutex()
     {
         if (!packageManager) {
@@ -41,10 +42,7 @@ namespace carto {
 
     void PackageManagerGeocodingService::setAutocomplete(bool autocomplete) {
         std::lock_guard<std::mutex> lock(_mutex);
-        if (autocomplete != _autocomplete) {
-            _autocomplete = autocomplete;
-            _cachedGeocoder.reset();
-        }
+        _autocomplete = autocomplete;
     }
 
     std::string PackageManagerGeocodingService::getLanguage() const {
@@ -54,10 +52,7 @@ namespace carto {
 
     void PackageManagerGeocodingService::setLanguage(const std::string& lang) {
         std::lock_guard<std::mutex> lock(_mutex);
-        if (lang != _language) {
-            _language = lang;
-            _cachedGeocoder.reset();
-        }
+        _language = lang;
     }
 
     int PackageManagerGeocodingService::getMaxResults() const {
@@ -67,10 +62,7 @@ namespace carto {
 
     void PackageManagerGeocodingService::setMaxResults(int maxResults) {
         std::lock_guard<std::mutex> lock(_mutex);
-        if (maxResults != _maxResults) {
-            _maxResults = maxResults;
-            _cachedGeocoder.reset();
-        }
+        _maxResults = maxResults;
     }
 
     std::vector<std::shared_ptr<GeocodingResult> > PackageManagerGeocodingService::calculateAddresses(const std::shared_ptr<GeocodingRequest>& request) const {
@@ -78,41 +70,138 @@ namespace carto {
             throw NullArgumentException("Null request");
         }
 
-        // Do routing via package manager, so that all packages are locked during routing
-        std::vector<std::shared_ptr<GeocodingResult> > results;
-        _packageManager->accessLocalPackages([this, &results, &request](const std::map<std::shared_ptr<PackageInfo>, std::shared_ptr<PackageHandler> >& packageHandlerMap) {
-            // Build map of geocoding databases
-            std::map<std::shared_ptr<PackageInfo>, std::shared_ptr<sqlite3pp::database> > packageDatabaseMap;
+        PackageDatabaseMap packageDatabaseMap;
+        std::shared_ptr<void> packagePin = getPackageDatabases(packageDatabaseMap);
+        std::shared_ptr<geocoding::Geocoder> geocoder = getGeocoder(packageDatabaseMap);
+        ApplyGeocoderOptions(*geocoder, getGeocoderOptions(request));
+        return GeocodingProxy::CalculateAddresses(geocoder, request);
+    }
+
+    std::vector<std::vector<std::shared_ptr<GeocodingResult> > > PackageManagerGeocodingService::calculateAddressesBatch(const std::vector<std::shared_ptr<GeocodingRequest> >& requests) const {
+        for (const std::shared_ptr<GeocodingRequest>& request : requests) {
+            if (!request) {
+                throw NullArgumentException("Null request");
+            }
+        }
+
+        // The packages are collected and pinned only once for the whole batch, and a single geocoder is used for all requests
+        PackageDatabaseMap packageDatabaseMap;
+        std::shared_ptr<void> packagePin = getPackageDatabases(packageDatabaseMap);
+        std::shared_ptr<geocoding::Geocoder> geocoder = getGeocoder(packageDatabaseMap);
+        std::vector<std::vector<std::shared_ptr<GeocodingResult> > > results;
+        results.reserve(requests.size());
+        for (const std::shared_ptr<GeocodingRequest>& request : requests) {
+            ApplyGeocoderOptions(*geocoder, getGeocoderOptions(request));
+            results.push_back(GeocodingProxy::CalculateAddresses(geocoder, request));
+        }
+        return results;
+    }
+
+    PackageManagerGeocodingService::GeocoderOptions PackageManagerGeocodingService::getGeocoderOptions(const std::shared_ptr<GeocodingRequest>& request) const {
+        GeocoderOptions options;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            options = GeocoderOptions(_autocomplete, _language, _maxResults);
+        }
+        Variant autocomplete = request->getCustomParameter("autocomplete");
+        if (autocomplete.getType() != VariantType::VARIANT_TYPE_NULL) {
+            std::get<0>(options) = autocomplete.getBool();
+        }
+        Variant language = request->getCustomParameter("language");
+        if (language.getType() != VariantType::VARIANT_TYPE_NULL) {
+            std::get<1>(options) = language.getString();
+        }
+        Variant maxResults = request->getCustomParameter("max_results");
+        if (maxResults.getType() != VariantType::VARIANT_TYPE_NULL) {
+            std::get<2>(options) = static_cast<int>(maxResults.getLong());
+        }
+        return options;
+    }
+
+    std::shared_ptr<void> PackageManagerGeocodingService::getPackageDatabases(PackageDatabaseMap& packageDatabaseMap) const {
+        // Build map of geocoding databases. Keep the package manager locked only while collecting the databases,
+        // the packages are pinned instead so that their files are not deleted while the queries are running.
+        std::shared_ptr<void> packagePin;
+        _packageManager->accessLocalPackages([this, &packageDatabaseMap, &packagePin](const std::map<std::shared_ptr<PackageInfo>, std::shared_ptr<PackageHandler> >& packageHandlerMap) {
+            std::vector<std::shared_ptr<PackageInfo> > packageInfos;
             for (auto it = packageHandlerMap.begin(); it != packageHandlerMap.end(); it++) {
                 if (auto geocodingHandler = std::dynamic_pointer_cast<GeocodingPackageHandler>(it->second)) {
-                    packageDatabaseMap[it->first] = geocodingHandler->getGeocodingDatabase();
+                    if (std::shared_ptr<sqlite3pp::database> database = geocodingHandler->getGeocodingDatabase()) {
+                        packageDatabaseMap[it->first] = database;
+                        packageInfos.push_back(it->first);
+                    }
                 }
             }
+            packagePin = _packageManager->pinLocalPackages(packageInfos);
+        });
+        return packagePin;
+    }
 
-            // Now check if we have to reinitialize the geocoder
+    std::shared_ptr<geocoding::Geocoder> PackageManagerGeocodingService::getGeocoder(const PackageDatabaseMap& packageDatabaseMap) const {
+        // Each query uses a geocoder of its own, as the geocoder options are applied per query. All geocoders import
+        // the same package database connections, which are opened in serialized mode by the package handlers.
+        // An idle geocoder can be reused if none of its packages were removed, new packages are imported incrementally.
+        PackageDatabaseMap importedDatabaseMap;
+        std::shared_ptr<geocoding::Geocoder> geocoder;
+        {
             std::lock_guard<std::mutex> lock(_mutex);
-            if (!_cachedGeocoder || packageDatabaseMap != _cachedPackageDatabaseMap) {
-                auto geocoder = std::make_shared<geocoding::Geocoder>();
-                geocoder->setAutocomplete(_autocomplete);
-                geocoder->setLanguage(_language);
-                geocoder->setMaxResults(_maxResults);
-                for (auto it = packageDatabaseMap.begin(); it != packageDatabaseMap.end(); it++) {
-                    try {
-                        if (!geocoder->import(it->second)) {
-                            throw FileException("Failed to import geocoding database " + it->first->getPackageId(), "");
-                        }
-                    }
-                    catch (const std::exception& ex) {
-                        throw GenericException("Exception while importing geocoding database " + it->first->getPackageId(), ex.what());
-                    }
+            _idleGeocoders.erase(std::remove_if(_idleGeocoders.begin(), _idleGeocoders.end(), [&packageDatabaseMap](const std::pair<PackageDatabaseMap, std::shared_ptr<geocoding::Geocoder> >& idleGeocoder) {
+                return !IsImportedSubset(idleGeocoder.first, packageDatabaseMap);
+            }), _idleGeocoders.end());
+            auto bestIt = _idleGeocoders.end();
+            for (auto it = _idleGeocoders.begin(); it != _idleGeocoders.end(); it++) {
+                if (bestIt == _idleGeocoders.end() || it->first.size() > bestIt->first.size()) {
+                    bestIt = it;
                 }
-                _cachedPackageDatabaseMap = packageDatabaseMap;
-                _cachedGeocoder = geocoder;
             }
+            if (bestIt != _idleGeocoders.end()) {
+                importedDatabaseMap = bestIt->first;
+                geocoder = bestIt->second;
+                _idleGeocoders.erase(bestIt);
+            }
+        }
+        if (!geocoder) {
+            geocoder = std::make_shared<geocoding::Geocoder>();
+        }
+
+        for (auto it = packageDatabaseMap.begin(); it != packageDatabaseMap.end(); it++) {
+            if (importedDatabaseMap.find(it->first) != importedDatabaseMap.end()) {
+                continue;
+            }
+            try {
+                if (!geocoder->import(it->second)) {
+                    throw FileException("Failed to import geocoding database " + it->first->getPackageId(), "");
+                }
+            }
+            catch (const std::exception& ex) {
+                throw GenericException("Exception while importing geocoding database " + it->first->getPackageId(), ex.what());
+            }
+            importedDatabaseMap[it->first] = it->second;
+        }
 
-            results = GeocodingProxy::CalculateAddresses(_cachedGeocoder, request);
+        // Return the geocoder to the idle list once the query is done
+        return std::shared_ptr<geocoding::Geocoder>(geocoder.get(), [this, importedDatabaseMap, geocoder](geocoding::Geocoder*) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_idleGeocoders.size() < MAX_IDLE_GEOCODERS) {
+                _idleGeocoders.emplace_back(importedDatabaseMap, geocoder);
+            }
         });
-        return results;
+    }
+
+    void PackageManagerGeocodingService::ApplyGeocoderOptions(geocoding::Geocoder& geocoder, const GeocoderOptions& options) {
+        geocoder.setAutocomplete(std::get<0>(options));
+        geocoder.setLanguage(std::get<1>(options));
+        geocoder.setMaxResults(std::get<2>(options));
+    }
+
+    bool PackageManagerGeocodingService::IsImportedSubset(const PackageDatabaseMap& importedDatabaseMap, const PackageDatabaseMap& packageDatabaseMap) {
+        for (auto it = importedDatabaseMap.begin(); it != importedDatabaseMap.end(); it++) {
+            auto it2 = packageDatabaseMap.find(it->first);
+            if (it2 == packageDatabaseMap.end() || it2->second != it->second) {
+                return false;
+            }
+        }
+        return true;
     }
     
     PackageManagerGeocodingService::PackageManagerListener::PackageManagerListener(PackageManagerGeocodingService& service) :
@@ -121,15 +210,15 @@ namespace carto {
     }
         
     void PackageManagerGeocodingService::PackageManagerListener::onPackagesChanged() {
-        std::lock_guard<std::mutex> lock(_service._mutex);
-        _service._cachedPackageDatabaseMap.clear();
-        _service._cachedGeocoder.reset();
+        // Idle geocoders with removed packages are dropped by the next query, others import only the new packages
     }
 
     void PackageManagerGeocodingService::PackageManagerListener::onStylesChanged() {
         // Impossible
     }
 
+    const std::size_t PackageManagerGeocodingService::MAX_IDLE_GEOCODERS = 4;
+
 }
 
 #endif
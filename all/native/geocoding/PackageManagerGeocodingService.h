@@ -12,6 +12,11 @@
 #include "geocoding/GeocodingService.h"
 #include "packagemanager/PackageManager.h"
 
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
 namespace sqlite3pp {
     class database;
 }
@@ -42,8 +47,18 @@ namespace carto {
         virtual int getMaxResults() const;
         virtual void setMaxResults(int maxResults);
 
+        /**
+         * Calculates matching addresses from the specified geocoding request.
+         * The autocomplete flag, language and maximum number of results can be overridden per request
+         * using 'autocomplete', 'language' and 'max_results' custom parameters of the request.
+         * @param request The geocoding request to use.
+         * @result The list of matching geocoding results, sorted by descending ranks.
+         * @throws std::runtime_error If IO error occured during the calculation.
+         */
         virtual std::vector<std::shared_ptr<GeocodingResult> > calculateAddresses(const std::shared_ptr<GeocodingRequest>& request) const;
 
+        virtual std::vector<std::vector<std::shared_ptr<GeocodingResult> > > calculateAddressesBatch(const std::vector<std::shared_ptr<GeocodingRequest> >& requests) const;
+
     protected:
         class PackageManagerListener : public PackageManager::OnChangeListener {
         public:
@@ -56,13 +71,24 @@ namespace carto {
             PackageManagerGeocodingService& _service;
         };
 
+        typedef std::tuple<bool, std::string, int> GeocoderOptions;
+        typedef std::map<std::shared_ptr<PackageInfo>, std::shared_ptr<sqlite3pp::database> > PackageDatabaseMap;
+
+        GeocoderOptions getGeocoderOptions(const std::shared_ptr<GeocodingRequest>& request) const;
+        std::shared_ptr<void> getPackageDatabases(PackageDatabaseMap& packageDatabaseMap) const;
+        std::shared_ptr<geocoding::Geocoder> getGeocoder(const PackageDatabaseMap& packageDatabaseMap) const;
+
+        static void ApplyGeocoderOptions(geocoding::Geocoder& geocoder, const GeocoderOptions& options);
+        static bool IsImportedSubset(const PackageDatabaseMap& importedDatabaseMap, const PackageDatabaseMap& packageDatabaseMap);
+
+        static const std::size_t MAX_IDLE_GEOCODERS;
+
         const std::shared_ptr<PackageManager> _packageManager;
         bool _autocomplete;
         std::string _language;
         int _maxResults;
 
-        mutable std::map<std::shared_ptr<PackageInfo>, std::shared_ptr<sqlite3pp::database> > _cachedPackageDatabaseMap;
-        mutable std::shared_ptr<geocoding::Geocoder> _cachedGeocoder;
+        mutable std::vector<std::pair<PackageDatabaseMap, std::shared_ptr<geocoding::Geocoder> > > _idleGeocoders; // idle geocoders with their imported databases
 
         mutable std::mutex _mutex;
 
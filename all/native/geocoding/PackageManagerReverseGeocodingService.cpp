@@ -10,6 +10,8 @@
 
 #include <sqlite3pp.h>
 
+#include <algorithm>
+
 namespace carto {
 
     PackageManagerReverseGeocodingService::PackageManagerReverseGeocodingService(const std::shared_ptr<PackageManager>& packageManager) :
@@ -17,6 +19,7 @@ namespace carto {
         _language(),
         _cachedPackageDatabaseMap(),
         _cachedRevGeocoder(),
+        _batchAddressCache(GeocodingProxy::BATCH_CACHE_SIZE),
         _mutex()
     {
         if (!packageManager) {
@@ -53,37 +56,72 @@ namespace carto {
         // Do routing via package manager, so that all packages are locked during routing
         std::vector<std::shared_ptr<GeocodingResult> > results;
         _packageManager->accessLocalPackages([this, &results, &request](const std::map<std::shared_ptr<PackageInfo>, std::shared_ptr<PackageHandler> >& packageHandlerMap) {
-            // Build map of geocoding databases
-            std::map<std::shared_ptr<PackageInfo>, std::shared_ptr<sqlite3pp::database> > packageDatabaseMap;
-            for (auto it = packageHandlerMap.begin(); it != packageHandlerMap.end(); it++) {
-                if (auto geocodingHandler = std::dynamic_pointer_cast<GeocodingPackageHandler>(it->second)) {
-                    packageDatabaseMap[it->first] = geocodingHandler->getGeocodingDatabase();
-                }
+            std::lock_guard<std::mutex> lock(_mutex);
+            results = GeocodingProxy::CalculateAddresses(getRevGeocoder(packageHandlerMap), request);
+        });
+        return results;
+    }
+
+    std::vector<std::vector<std::shared_ptr<GeocodingResult> > > PackageManagerReverseGeocodingService::calculateAddressesBatch(const std::vector<std::shared_ptr<ReverseGeocodingRequest> >& requests, bool includeGeometry) const {
+        for (const std::shared_ptr<ReverseGeocodingRequest>& request : requests) {
+            if (!request) {
+                throw NullArgumentException("Null request");
             }
+        }
 
-            // Now check if we have to reinitialize the geocoder
-            std::lock_guard<std::mutex> lock(_mutex);
-            if (!_cachedRevGeocoder || packageDatabaseMap != _cachedPackageDatabaseMap) {
-                auto revGeocoder = std::make_shared<geocoding::RevGeocoder>();
-                revGeocoder->setLanguage(_language);
-                for (auto it = packageDatabaseMap.begin(); it != packageDatabaseMap.end(); it++) {
-                    try {
-                        if (!revGeocoder->import(it->second)) {
-                            throw FileException("Failed to import geocoding database " + it->first->getPackageId(), "");
-                        }
-                    }
-                    catch (const std::exception& ex) {
-                        throw GenericException("Exception while importing geocoding database " + it->first->getPackageId(), ex.what());
-                    }
-                }
-                _cachedPackageDatabaseMap = packageDatabaseMap;
-                _cachedRevGeocoder = revGeocoder;
+        // Lock the package manager only for a chunk of spatially ordered requests at a time,
+        // so that package operations and other queries are not blocked for the whole batch.
+        std::vector<std::size_t> order = GeocodingProxy::CalculateBatchOrder(requests);
+        std::vector<std::vector<std::shared_ptr<GeocodingResult> > > results(requests.size());
+        for (std::size_t chunkStart = 0; chunkStart < order.size(); chunkStart += BATCH_CHUNK_SIZE) {
+            std::size_t chunkEnd = std::min(order.size(), chunkStart + BATCH_CHUNK_SIZE);
+            std::vector<std::shared_ptr<ReverseGeocodingRequest> > chunkRequests;
+            chunkRequests.reserve(chunkEnd - chunkStart);
+            for (std::size_t i = chunkStart; i < chunkEnd; i++) {
+                chunkRequests.push_back(requests[order[i]]);
             }
 
-            results = GeocodingProxy::CalculateAddresses(_cachedRevGeocoder, request);
-        });
+            std::vector<std::vector<std::shared_ptr<GeocodingResult> > > chunkResults;
+            _packageManager->accessLocalPackages([this, &chunkResults, &chunkRequests, includeGeometry](const std::map<std::shared_ptr<PackageInfo>, std::shared_ptr<PackageHandler> >& packageHandlerMap) {
+                std::lock_guard<std::mutex> lock(_mutex);
+                chunkResults = GeocodingProxy::CalculateAddressesBatch(getRevGeocoder(packageHandlerMap), _batchAddressCache, chunkRequests, includeGeometry);
+            });
+            for (std::size_t i = chunkStart; i < chunkEnd; i++) {
+                results[order[i]] = std::move(chunkResults[i - chunkStart]);
+            }
+        }
         return results;
     }
+
+    std::shared_ptr<geocoding::RevGeocoder> PackageManagerReverseGeocodingService::getRevGeocoder(const std::map<std::shared_ptr<PackageInfo>, std::shared_ptr<PackageHandler> >& packageHandlerMap) const {
+        // Build map of geocoding databases
+        std::map<std::shared_ptr<PackageInfo>, std::shared_ptr<sqlite3pp::database> > packageDatabaseMap;
+        for (auto it = packageHandlerMap.begin(); it != packageHandlerMap.end(); it++) {
+            if (auto geocodingHandler = std::dynamic_pointer_cast<GeocodingPackageHandler>(it->second)) {
+                packageDatabaseMap[it->first] = geocodingHandler->getGeocodingDatabase();
+            }
+        }
+
+        // Now check if we have to reinitialize the geocoder. Note: _mutex is assumed to be locked by the caller
+        if (!_cachedRevGeocoder || packageDatabaseMap != _cachedPackageDatabaseMap) {
+            auto revGeocoder = std::make_shared<geocoding::RevGeocoder>();
+            revGeocoder->setLanguage(_language);
+            for (auto it = packageDatabaseMap.begin(); it != packageDatabaseMap.end(); it++) {
+                try {
+                    if (!revGeocoder->import(it->second)) {
+                        throw FileException("Failed to import geocoding database " + it->first->getPackageId(), "");
+                    }
+                }
+                catch (const std::exception& ex) {
+                    throw GenericException("Exception while importing geocoding database " + it->first->getPackageId(), ex.what());
+                }
+            }
+            _cachedPackageDatabaseMap = packageDatabaseMap;
+            _cachedRevGeocoder = revGeocoder;
+            _batchAddressCache.clear();
+        }
+        return _cachedRevGeocoder;
+    }
     
     PackageManagerReverseGeocodingService::PackageManagerListener::PackageManagerListener(PackageManagerReverseGeocodingService& service) :
         _service(service)
@@ -100,6 +138,8 @@ namespace carto {
         // Impossible
     }
 
+    const std::size_t PackageManagerReverseGeocodingService::BATCH_CHUNK_SIZE = 64;
+
 }
 
 #endif
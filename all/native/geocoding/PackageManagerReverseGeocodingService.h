@@ -9,6 +9,7 @@
 
 #if defined(_CARTO_GEOCODING_SUPPORT) && defined(_CARTO_PACKAGEMANAGER_SUPPORT)
 
+#include "geocoding/GeocodingProxy.h"
 #include "geocoding/ReverseGeocodingService.h"
 #include "packagemanager/PackageManager.h"
 
@@ -38,6 +39,8 @@ namespace carto {
 
         virtual std::vector<std::shared_ptr<GeocodingResult> > calculateAddresses(const std::shared_ptr<ReverseGeocodingRequest>& request) const;
 
+        virtual std::vector<std::vector<std::shared_ptr<GeocodingResult> > > calculateAddressesBatch(const std::vector<std::shared_ptr<ReverseGeocodingRequest> >& requests, bool includeGeometry) const;
+
     protected:
         class PackageManagerListener : public PackageManager::OnChangeListener {
         public:
@@ -50,11 +53,16 @@ namespace carto {
             PackageManagerReverseGeocodingService& _service;
         };
 
+        std::shared_ptr<geocoding::RevGeocoder> getRevGeocoder(const std::map<std::shared_ptr<PackageInfo>, std::shared_ptr<PackageHandler> >& packageHandlerMap) const;
+
+        static const std::size_t BATCH_CHUNK_SIZE;
+
         const std::shared_ptr<PackageManager> _packageManager;
         std::string _language;
 
         mutable std::map<std::shared_ptr<PackageInfo>, std::shared_ptr<sqlite3pp::database> > _cachedPackageDatabaseMap;
         mutable std::shared_ptr<geocoding::RevGeocoder> _cachedRevGeocoder;
+        mutable GeocodingProxy::RevAddressCache _batchAddressCache; // recent batch answers of _cachedRevGeocoder
 
         mutable std::mutex _mutex;
 
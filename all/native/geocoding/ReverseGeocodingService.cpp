@@ -1,6 +1,7 @@
 #ifdef _CARTO_GEOCODING_SUPPORT
 
 #include "ReverseGeocodingService.h"
+#include "geometry/FeatureCollection.h"
 
 namespace carto {
 
@@ -10,6 +11,21 @@ namespace carto {
     ReverseGeocodingService::~ReverseGeocodingService() {
     }
 
+    std::vector<std::vector<std::shared_ptr<GeocodingResult> > > ReverseGeocodingService::calculateAddressesBatch(const std::vector<std::shared_ptr<ReverseGeocodingRequest> >& requests, bool includeGeometry) const {
+        std::vector<std::vector<std::shared_ptr<GeocodingResult> > > results;
+        results.reserve(requests.size());
+        for (const std::shared_ptr<ReverseGeocodingRequest>& request : requests) {
+            std::vector<std::shared_ptr<GeocodingResult> > requestResults = calculateAddresses(request);
+            if (!includeGeometry) {
+                for (std::shared_ptr<GeocodingResult>& result : requestResults) {
+                    result = std::make_shared<GeocodingResult>(result->getProjection(), result->getAddress(), result->getRank(), std::make_shared<FeatureCollection>(std::vector<std::shared_ptr<Feature> >()));
+                }
+            }
+            results.push_back(std::move(requestResults));
+        }
+        return results;
+    }
+
 }
 
 #endif
@@ -43,6 +43,16 @@ namespace carto {
          */
         virtual std::vector<std::shared_ptr<GeocodingResult> > calculateAddresses(const std::shared_ptr<ReverseGeocodingRequest>& request) const = 0;
 
+        /**
+         * Calculates matching addresses for a list of reverse geocoding requests.
+         * Offline services process the requests in spatial order and reuse the answers for nearby locations.
+         * @param requests The list of reverse geocoding requests to use.
+         * @param includeGeometry If true, the results contain the full feature geometry. If false, only the address attributes are returned and the feature collections are empty.
+         * @result The list of matching geocoding results for each request, in the same order as the requests.
+         * @throws std::runtime_error If IO error occured during the calculation.
+         */
+        virtual std::vector<std::vector<std::shared_ptr<GeocodingResult> > > calculateAddressesBatch(const std::vector<std::shared_ptr<ReverseGeocodingRequest> >& requests, bool includeGeometry) const;
+
     protected:
         /**
          * The default constructor.
@@ -1,6 +1,9 @@
 #include "Bitmap.h"
 #include "core/BinaryData.h"
 #include "components/Exceptions.h"
+#include "graphics/utils/BitmapResampler.h"
+#include "graphics/utils/ETC2Codec.h"
+#include "graphics/utils/PNGEncoder.h"
 #include "utils/Log.h"
 
 #include <algorithm>
@@ -39,14 +42,6 @@ namespace {
         ioContainer->_compressedDataPtr += length;
     }
     
-    void writePNGCallback(png_structp pngPtr, png_bytep data, png_size_t length) {
-        std::vector<unsigned char>* compressedData = static_cast<std::vector<unsigned char>* >(png_get_io_ptr(pngPtr));
-        compressedData->reserve(compressedData->size() + length);
-        for (std::size_t i = 0; i < length; i++) {
-            compressedData->push_back(data[i]);
-        }
-    }
-    
     struct JPEGErrorManager {
         struct jpeg_error_mgr pub;
     
@@ -142,92 +137,44 @@ namespace carto {
     }
     
     std::shared_ptr<BinaryData> Bitmap::compressToPNG() const {
-        png_structp pngPtr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, reportPNGErrorCallback, reportPNGWarningCallback);
-        if (!pngPtr) {
-            Log::Error("Bitmap::compressToPng: Failed to compress bitmap to PNG");
-            return std::shared_ptr<BinaryData>();
-        }
-    
-        png_infop infoPtr = png_create_info_struct(pngPtr);
-        if (!infoPtr) {
-            png_destroy_write_struct(&pngPtr, NULL);
-            Log::Error("Bitmap::compressToPng: Failed to compress bitmap to PNG");
-            return std::shared_ptr<BinaryData>();
-        }
-    
-        if (setjmp(png_jmpbuf(pngPtr))) {
-            png_destroy_write_struct(&pngPtr, &infoPtr);
-            Log::Error("Bitmap::compressToPng: Failed to compress bitmap to PNG");
-            return std::shared_ptr<BinaryData>();
-        }
-    
-        // Set callback for writing data
-        std::vector<unsigned char> compressedData;
-        png_set_write_fn(pngPtr, &compressedData, writePNGCallback, NULL);
-    
-        int colorType;
-        bool unpremultiply = false;
+        return compressToPNG(PNGCompressionPreset::PNG_COMPRESSION_PRESET_DEFAULT);
+    }
+
+    std::shared_ptr<BinaryData> Bitmap::compressToPNG(PNGCompressionPreset::PNGCompressionPreset preset) const {
+        bool premultipliedAlpha = false;
         switch (_colorFormat) {
         case ColorFormat::COLOR_FORMAT_GRAYSCALE:
-            colorType = PNG_COLOR_TYPE_GRAY;
-            break;
-        case ColorFormat::COLOR_FORMAT_GRAYSCALE_ALPHA:
-            colorType = PNG_COLOR_TYPE_GRAY_ALPHA;
-            unpremultiply = true;
-            break;
         case ColorFormat::COLOR_FORMAT_RGB:
-            colorType = PNG_COLOR_TYPE_RGB;
             break;
+        case ColorFormat::COLOR_FORMAT_GRAYSCALE_ALPHA:
         case ColorFormat::COLOR_FORMAT_RGBA:
-            colorType = PNG_COLOR_TYPE_RGB_ALPHA;
-            unpremultiply = true;
+            premultipliedAlpha = true;
             break;
         default:
-            png_destroy_write_struct(&pngPtr, &infoPtr);
-            Log::Errorf("Bitmap::savePNG: Failed to compress bitmap to PNG, unsupported image format: %d", _colorFormat);
+            Log::Errorf("Bitmap::compressToPNG: Failed to compress bitmap to PNG, unsupported image format: %d", _colorFormat);
             return std::shared_ptr<BinaryData>();
         }
-    
-        // Set PNG info
-        png_set_IHDR(pngPtr, infoPtr, _width, _height, 8, colorType, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
-    
-        // Write PNG info
-        png_write_info(pngPtr, infoPtr);
-    
-        // Set row start pointers
-        std::vector<png_bytep> rowPointers(_height);
-    
-        // Unpremultiply
-        std::vector<unsigned char> pixelData = _pixelData;
-        if (unpremultiply) {
-            for (std::size_t i = 0; i < pixelData.size(); i += _bytesPerPixel) {
-                unsigned int a = pixelData[i + _bytesPerPixel - 1];
-                if (a == 0) {
-                    continue;
-                }
-                for (unsigned int j = 0; j < _bytesPerPixel - 1; j++) {
-                    unsigned int c = pixelData[i + j];
-                    pixelData[i + j] = static_cast<unsigned char>(255 * c / a);
-                }
-            }
+
+        PNGEncoder::Preset encoderPreset = PNGEncoder::Preset::DEFAULT;
+        switch (preset) {
+        case PNGCompressionPreset::PNG_COMPRESSION_PRESET_FAST:
+            encoderPreset = PNGEncoder::Preset::FAST;
+            break;
+        case PNGCompressionPreset::PNG_COMPRESSION_PRESET_SMALL:
+            encoderPreset = PNGEncoder::Preset::SMALL;
+            break;
+        default:
+            break;
         }
-    
-        // Set the individual row pointers to point at the correct offsets of image data
-        unsigned char* pixelDataPtr = pixelData.data();
-        int bytesPerRealRow = _width * _bytesPerPixel;
-        for (std::size_t i = 0; i < _height; i++) {
-            rowPointers[_height - 1 - i] = pixelDataPtr + i * bytesPerRealRow;
+
+        // Rows are stored bottom-up, encode starting from the last row
+        std::ptrdiff_t bytesPerRow = static_cast<std::ptrdiff_t>(_width) * _bytesPerPixel;
+        const unsigned char* topRow = _pixelData.data() + (static_cast<std::ptrdiff_t>(_height) - 1) * bytesPerRow;
+        std::vector<unsigned char> compressedData;
+        if (!PNGEncoder::Encode(topRow, _width, _height, -bytesPerRow, _bytesPerPixel, premultipliedAlpha, encoderPreset, compressedData)) {
+            Log::Error("Bitmap::compressToPNG: Failed to compress bitmap to PNG");
+            return std::shared_ptr<BinaryData>();
         }
-    
-        // Write image
-        png_write_image(pngPtr, rowPointers.data());
-    
-        // Write end
-        png_write_end(pngPtr, infoPtr);
-    
-        // Free memory
-        png_destroy_write_struct(&pngPtr, &infoPtr);
-    
         return std::make_shared<BinaryData>(std::move(compressedData));
     }
     
@@ -261,131 +208,8 @@ namespace carto {
             return std::shared_ptr<Bitmap>();
         }
 
-        // This will only scale the actual image part, the padding that was previously added to make the image
-        // dimensions power of 2 will be ignored
-        const unsigned char* dsrc = _pixelData.data();
         std::vector<unsigned char> pixelData(width * height * _bytesPerPixel);
-        unsigned char* ddest = pixelData.data();
-    
-        bool bUpsampleX = (_width < width);
-        bool bUpsampleY = (_height < height);
-    
-        // If too many input pixels map to one output pixel, our 32-bit accumulation values
-        // could overflow - so, if we have huge mappings like that, cut down the weights:
-        //    256 max color value
-        //   *256 weight_x
-        //   *256 weight_y
-        //   *256 (16*16) maximum # of input pixels (x,y) - unless we cut the weights down...
-        int weight_shift = 0;
-        float source_texels_per_out_pixel = ((_width / static_cast<float>(width + 1))
-                * (_height / static_cast<float>(height + 1)));
-        float weight_per_pixel = source_texels_per_out_pixel * 256 * 256; //weight_x * weight_y
-        float accum_per_pixel = weight_per_pixel * 256; //color value is 0-255
-        float weight_div = accum_per_pixel / 4294967000.0f;
-        if (weight_div > 1) {
-            weight_shift = static_cast<int>(ceilf(logf(weight_div) / logf(2)));
-        }
-        weight_shift = std::min(15, weight_shift); // this could go to 15 and still be ok.
-    
-        float fh = 256 * _height / static_cast<float>(height);
-        float fw = 256 * _width / static_cast<float>(width);
-        // Cache x1a, x1b for all the columns
-    
-        std::vector<int> g_px1ab(width * 2 * 2);
-    
-        for (std::size_t x2 = 0; x2 < width; x2++) {
-            // Find the x-range of input pixels that will contribute:
-            int x1a = static_cast<int>((x2) * fw);
-            int x1b = static_cast<int>((x2 + 1) * fw);
-            if (bUpsampleX) {
-                // Map to same pixel -> we want to interpolate between two pixels!
-                x1b = x1a + 256;
-            }
-            x1b = std::min(x1b, static_cast<int>(256 * _width - 1));
-            g_px1ab[x2 * 2 + 0] = x1a;
-            g_px1ab[x2 * 2 + 1] = x1b;
-        }
-    
-        // For every output pixel
-        for (std::size_t y2 = 0; y2 < height; y2++) {
-            // Find the y-range of input pixels that will contribute:
-            int y1a = static_cast<int>((y2) * fh);
-            int y1b = static_cast<int>((y2 + 1) * fh);
-            if (bUpsampleY) {
-                // Map to same pixel -> we want to interpolate between two pixels!
-                y1b = y1a + 256;
-            }
-            y1b = std::min(y1b, static_cast<int>(256 * _height - 1));
-            int y1c = y1a >> 8;
-            int y1d = y1b >> 8;
-    
-            for (std::size_t x2 = 0; x2 < width; x2++) {
-                // Find the x-range of input pixels that will contribute
-                int x1a = g_px1ab[x2 * 2 + 0];
-                int x1b = g_px1ab[x2 * 2 + 1];
-                int x1c = x1a >> 8;
-                int x1d = x1b >> 8;
-    
-                // Add ip all input pixels contributing to this output pixel
-                unsigned int r = 0, g = 0, b = 0, a = 0, wa = 0;
-                for (int y = y1c; y <= y1d; y++) {
-                    unsigned int weight_y = 256;
-                    if (y1c != y1d) {
-                        if (y == y1c) {
-                            weight_y = 256 - (y1a & 0xFF);
-                        } else if (y == y1d) {
-                            weight_y = (y1b & 0xFF);
-                        }
-                    }
-    
-                    const unsigned char* dsrc2 = &dsrc[y * _width * _bytesPerPixel + x1c * _bytesPerPixel];
-                    for (int x = x1c; x <= x1d; x++) {
-                        unsigned int weight_x = 256;
-                        if (x1c != x1d) {
-                            if (x == x1c) {
-                                weight_x = 256 - (x1a & 0xFF);
-                            } else if (x == x1d) {
-                                weight_x = (x1b & 0xFF);
-                            }
-                        }
-    
-                        unsigned int w = (weight_x * weight_y) >> weight_shift;
-
-                        unsigned char r_src = *dsrc2++;
-                        r += r_src * w;
-                        if (_bytesPerPixel > 1) {
-                            unsigned char g_src = *dsrc2++;
-                            g += g_src * w;
-                        }
-                        if (_bytesPerPixel > 2) {
-                            unsigned char b_src = *dsrc2++;
-                            b += b_src * w;
-                        }
-                        if (_bytesPerPixel > 3) {
-                            unsigned char a_src = *dsrc2++;
-                            a += a_src * w;
-                        }
-                        wa += w;
-                    }
-                }
-                if (wa <= 0) {
-                    wa = std::numeric_limits<int>::max();
-                }
-    
-                // Write results
-                *ddest++ = r / wa;
-                if (_bytesPerPixel > 1) {
-                    *ddest++ = g / wa;
-                }
-                if (_bytesPerPixel > 2) {
-                    *ddest++ = b / wa;
-                }
-                if (_bytesPerPixel > 3) {
-                    *ddest++ = a / wa;
-                }
-            }
-        }
-        
+        BitmapResampler::Resample(_pixelData.data(), _width, _height, _width * _bytesPerPixel, _bytesPerPixel, pixelData.data(), width, height, BitmapResampler::Filter::BOX);
         return std::make_shared<Bitmap>(pixelData.data(), width, height, _colorFormat, -static_cast<int>(width * _bytesPerPixel));
     }
     
@@ -511,6 +335,70 @@ namespace carto {
         }
         return bitmap;
     }
+
+    bool Bitmap::DecodePixels(const unsigned char* compressedData, std::size_t dataSize, std::vector<unsigned char>& pixelData, unsigned int& width, unsigned int& height, ColorFormat::ColorFormat& colorFormat) {
+        if (!compressedData) {
+            throw NullArgumentException("Null compressedData");
+        }
+
+        if (pixelData.capacity() == 0) {
+            pixelData = AcquireDecodeBuffer();
+        }
+
+        if (IsJPEG(compressedData, dataSize)) {
+            return DecodeJPEGPixels(compressedData, dataSize, pixelData, width, height, colorFormat);
+        } else if (IsPNG(compressedData, dataSize)) {
+            return DecodePNGPixels(compressedData, dataSize, pixelData, width, height, colorFormat);
+        } else if (IsWEBP(compressedData, dataSize)) {
+            return DecodeWEBPPixels(compressedData, dataSize, pixelData, width, height, colorFormat);
+        } else if (IsKTX(compressedData, dataSize)) {
+            colorFormat = ColorFormat::COLOR_FORMAT_RGBA;
+            return DecodeKTXRGBA(compressedData, dataSize, pixelData, width, height);
+        }
+
+        // Other formats are rare, use the generic path with conversion
+        std::shared_ptr<Bitmap> bitmap = CreateFromCompressed(compressedData, dataSize);
+        if (!bitmap) {
+            return false;
+        }
+        switch (bitmap->getColorFormat()) {
+        case ColorFormat::COLOR_FORMAT_GRAYSCALE:
+        case ColorFormat::COLOR_FORMAT_RGB:
+        case ColorFormat::COLOR_FORMAT_RGBA:
+            break;
+        default:
+            bitmap = bitmap->getRGBABitmap();
+            break;
+        }
+        width = bitmap->getWidth();
+        height = bitmap->getHeight();
+        colorFormat = bitmap->getColorFormat();
+        pixelData.assign(bitmap->getPixelData().begin(), bitmap->getPixelData().end());
+        return true;
+    }
+
+    std::vector<unsigned char> Bitmap::AcquireDecodeBuffer() {
+        std::lock_guard<std::mutex> lock(_DecodeBufferPoolMutex);
+        if (_DecodeBufferPool.empty()) {
+            return std::vector<unsigned char>();
+        }
+        std::vector<unsigned char> buffer = std::move(_DecodeBufferPool.back());
+        _DecodeBufferPool.pop_back();
+        _DecodeBufferPoolSize -= buffer.capacity();
+        return buffer;
+    }
+
+    void Bitmap::RecycleDecodeBuffer(std::vector<unsigned char>& buffer) {
+        std::vector<unsigned char> recycledBuffer;
+        std::swap(recycledBuffer, buffer);
+        recycledBuffer.clear();
+
+        std::lock_guard<std::mutex> lock(_DecodeBufferPoolMutex);
+        if (recycledBuffer.capacity() > 0 && _DecodeBufferPoolSize + recycledBuffer.capacity() <= DECODE_BUFFER_POOL_CAPACITY) {
+            _DecodeBufferPoolSize += recycledBuffer.capacity();
+            _DecodeBufferPool.push_back(std::move(recycledBuffer));
+        }
+    }
     
     Bitmap::Bitmap() :
         _width(0),
@@ -530,6 +418,8 @@ namespace carto {
             return loadWEBP(compressedData, dataSize);
         } else if (IsNUTI(compressedData, dataSize)) {
             return loadNUTI(compressedData, dataSize);
+        } else if (IsKTX(compressedData, dataSize)) {
+            return loadKTX(compressedData, dataSize);
         } else {
             std::vector<unsigned char> uncompressedData;
             if (zlib::inflate_gzip(compressedData, dataSize, uncompressedData)) {
@@ -696,6 +586,10 @@ namespace carto {
         }
         return std::equal(NUTiHeader, NUTiHeader + sizeof(NUTiHeader), compressedData);
     }
+
+    bool Bitmap::IsKTX(const unsigned char* compressedData, std::size_t dataSize) {
+        return ETC2Codec::IsKTX(compressedData, dataSize);
+    }
         
     bool Bitmap::loadJPEG(const unsigned char* compressedData, std::size_t dataSize) {
         jpeg_decompress_struct cinfo;
@@ -937,5 +831,231 @@ namespace carto {
     
         return true;
     }
-        
+
+    bool Bitmap::loadKTX(const unsigned char* compressedData, std::size_t dataSize) {
+        if (!DecodeKTXRGBA(compressedData, dataSize, _pixelData, _width, _height)) {
+            return false;
+        }
+        _bytesPerPixel = 4;
+        _colorFormat = ColorFormat::COLOR_FORMAT_RGBA;
+        return true;
+    }
+
+    bool Bitmap::DecodeJPEGPixels(const unsigned char* compressedData, std::size_t dataSize, std::vector<unsigned char>& pixelData, unsigned int& width, unsigned int& height, ColorFormat::ColorFormat& colorFormat) {
+        jpeg_decompress_struct cinfo;
+        JPEGErrorManager jerr;
+        cinfo.err = jpeg_std_error(&jerr.pub);
+        jerr.pub.error_exit = JPEGErrorExit;
+
+        // Establish the setjmp return context for JPEGErrorExit to use
+        if (setjmp(jerr.setjmp_buffer)) {
+            jpeg_destroy_decompress(&cinfo);
+            Log::Error("Bitmap::DecodeJPEGPixels: Failed to decode JPEG");
+            return false;
+        }
+
+        // Create decompressing object, set data source
+        jpeg_create_decompress(&cinfo);
+        unsigned char* compressedDataPtr = const_cast<unsigned char*>(compressedData);
+        jpeg_mem_src(&cinfo, compressedDataPtr, static_cast<unsigned long>(dataSize));
+
+        // Read headers, prepare to decompress
+        jpeg_read_header(&cinfo, TRUE);
+        jpeg_start_decompress(&cinfo);
+
+        int components = cinfo.output_components;
+        if (components != 1 && components != 3) {
+            jpeg_destroy_decompress(&cinfo);
+            Log::Errorf("Bitmap::DecodeJPEGPixels: Failed to decode JPEG, unsupported color format: %d", components);
+            return false;
+        }
+
+        width = cinfo.output_width;
+        height = cinfo.output_height;
+        colorFormat = components == 3 ? ColorFormat::COLOR_FORMAT_RGB : ColorFormat::COLOR_FORMAT_GRAYSCALE;
+        unsigned int bytesPerRow = width * components;
+        pixelData.resize(bytesPerRow * height);
+
+        // Read lines directly to the output rows. Flip y.
+        while (cinfo.output_scanline < height) {
+            unsigned char* row = &pixelData[(height - 1 - cinfo.output_scanline) * bytesPerRow];
+            jpeg_read_scanlines(&cinfo, &row, 1);
+        }
+
+        // Finish and free the memory
+        jpeg_finish_decompress(&cinfo);
+        jpeg_destroy_decompress(&cinfo);
+
+        return true;
+    }
+
+    bool Bitmap::DecodePNGPixels(const unsigned char* compressedData, std::size_t dataSize, std::vector<unsigned char>& pixelData, unsigned int& width, unsigned int& height, ColorFormat::ColorFormat& colorFormat) {
+        png_structp pngPtr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, reportPNGErrorCallback, reportPNGWarningCallback);
+        if (!pngPtr) {
+            Log::Error("Bitmap::DecodePNGPixels: Failed to decode PNG");
+            return false;
+        }
+
+        png_infop infoPtr = png_create_info_struct(pngPtr);
+        if (!infoPtr) {
+            png_destroy_read_struct(&pngPtr, NULL, NULL);
+            Log::Error("Bitmap::DecodePNGPixels: Failed to decode PNG");
+            return false;
+        }
+
+        if (setjmp(png_jmpbuf(pngPtr))) {
+            png_destroy_read_struct(&pngPtr, &infoPtr, NULL);
+            Log::Error("Bitmap::DecodePNGPixels: Failed to decode PNG");
+            return false;
+        }
+
+        // Set callback method for reading data
+        LibPNGIOContainer ioContainer(compressedData);
+        png_set_read_fn(pngPtr, &ioContainer, readPNGCallback);
+
+        // Read all the info up to the image data
+        png_read_info(pngPtr, infoPtr);
+
+        png_uint_32 pngWidth = 0;
+        png_uint_32 pngHeight = 0;
+        int colorType = 0;
+        int bitDepth = 0;
+        if (png_get_IHDR(pngPtr, infoPtr, &pngWidth, &pngHeight, &bitDepth, &colorType, NULL, NULL, NULL) == 0) {
+            png_destroy_read_struct(&pngPtr, &infoPtr, NULL);
+            Log::Error("Bitmap::DecodePNGPixels: Failed to read PNG info");
+            return false;
+        }
+
+        // Let libpng do all the conversions to 8-bit grayscale, RGB or RGBA while decoding the rows
+        bool hasAlpha = (colorType & PNG_COLOR_MASK_ALPHA) != 0 || png_get_valid(pngPtr, infoPtr, PNG_INFO_tRNS);
+        if (bitDepth == 16) {
+            png_set_strip_16(pngPtr);
+        } else if (bitDepth < 8) {
+            png_set_packing(pngPtr);
+        }
+        if (colorType == PNG_COLOR_TYPE_PALETTE) {
+            png_set_palette_to_rgb(pngPtr);
+        } else if (colorType == PNG_COLOR_TYPE_GRAY && bitDepth < 8) {
+            png_set_expand_gray_1_2_4_to_8(pngPtr);
+        }
+        if (png_get_valid(pngPtr, infoPtr, PNG_INFO_tRNS)) {
+            png_set_tRNS_to_alpha(pngPtr);
+        }
+        unsigned int bytesPerPixel = 0;
+        if (hasAlpha) {
+            if (colorType == PNG_COLOR_TYPE_GRAY || colorType == PNG_COLOR_TYPE_GRAY_ALPHA) {
+                png_set_gray_to_rgb(pngPtr);
+            }
+            colorFormat = ColorFormat::COLOR_FORMAT_RGBA;
+            bytesPerPixel = 4;
+        } else if (colorType == PNG_COLOR_TYPE_GRAY) {
+            colorFormat = ColorFormat::COLOR_FORMAT_GRAYSCALE;
+            bytesPerPixel = 1;
+        } else {
+            colorFormat = ColorFormat::COLOR_FORMAT_RGB;
+            bytesPerPixel = 3;
+        }
+        png_read_update_info(pngPtr, infoPtr);
+
+        if (png_get_rowbytes(pngPtr, infoPtr) != pngWidth * bytesPerPixel) {
+            png_destroy_read_struct(&pngPtr, &infoPtr, NULL);
+            Log::Error("Bitmap::DecodePNGPixels: Failed to convert PNG to 8-bit format");
+            return false;
+        }
+
+        width = pngWidth;
+        height = pngHeight;
+        unsigned int bytesPerRow = width * bytesPerPixel;
+        pixelData.resize(bytesPerRow * height);
+
+        // Set the individual row pointers to point at the correct offsets of image data, flip y
+        std::vector<png_bytep> rowPointers(height);
+        for (std::size_t i = 0; i < height; i++) {
+            rowPointers[height - 1 - i] = pixelData.data() + i * bytesPerRow;
+        }
+        png_read_image(pngPtr, rowPointers.data());
+
+        if (hasAlpha) {
+            for (std::size_t i = 0; i < pixelData.size(); i += 4) {
+                unsigned int alpha = pixelData[i + 3];
+                if (alpha != 255) {
+                    pixelData[i + 0] = static_cast<unsigned char>((pixelData[i + 0] * alpha) / 255);
+                    pixelData[i + 1] = static_cast<unsigned char>((pixelData[i + 1] * alpha) / 255);
+                    pixelData[i + 2] = static_cast<unsigned char>((pixelData[i + 2] * alpha) / 255);
+                }
+            }
+        }
+
+        // Free memory
+        png_destroy_read_struct(&pngPtr, &infoPtr, NULL);
+
+        return true;
+    }
+
+    bool Bitmap::DecodeWEBPPixels(const unsigned char* compressedData, std::size_t dataSize, std::vector<unsigned char>& pixelData, unsigned int& width, unsigned int& height, ColorFormat::ColorFormat& colorFormat) {
+        WebPDecoderConfig config;
+        if (!WebPInitDecoderConfig(&config)) {
+            Log::Error("Bitmap::DecodeWEBPPixels: Failed to initialize WEBP decoder");
+            return false;
+        }
+        if (WebPGetFeatures(compressedData, dataSize, &config.input) != VP8_STATUS_OK) {
+            Log::Error("Bitmap::DecodeWEBPPixels: Failed to load WEBP features");
+            return false;
+        }
+
+        width = config.input.width;
+        height = config.input.height;
+        colorFormat = config.input.has_alpha ? ColorFormat::COLOR_FORMAT_RGBA : ColorFormat::COLOR_FORMAT_RGB;
+        unsigned int bytesPerRow = width * (config.input.has_alpha ? 4 : 3);
+        pixelData.resize(bytesPerRow * height);
+
+        // Decode directly to the output buffer, letting the decoder flip the rows
+        config.options.flip = 1;
+        config.output.colorspace = config.input.has_alpha ? MODE_rgbA : MODE_RGB; // premultiplied alpha, as with PNG images
+        config.output.is_external_memory = 1;
+        config.output.u.RGBA.rgba = pixelData.data();
+        config.output.u.RGBA.stride = static_cast<int>(bytesPerRow);
+        config.output.u.RGBA.size = pixelData.size();
+        VP8StatusCode status = WebPDecode(compressedData, dataSize, &config);
+        WebPFreeDecBuffer(&config.output);
+        if (status != VP8_STATUS_OK) {
+            Log::Errorf("Bitmap::DecodeWEBPPixels: Failed to decode WEBP: %d", static_cast<int>(status));
+            return false;
+        }
+
+        return true;
+    }
+
+    bool Bitmap::DecodeKTXRGBA(const unsigned char* compressedData, std::size_t dataSize, std::vector<unsigned char>& pixelData, unsigned int& width, unsigned int& height) {
+        ETC2Codec::Format format = ETC2Codec::Format::RGBA8;
+        int ktxWidth = 0, ktxHeight = 0;
+        bool topDown = true;
+        const unsigned char* blockData = nullptr;
+        std::size_t blockDataSize = 0;
+        if (!ETC2Codec::ReadKTX(compressedData, dataSize, format, ktxWidth, ktxHeight, topDown, blockData, blockDataSize)) {
+            Log::Error("Bitmap::DecodeKTXRGBA: Unsupported KTX texture format");
+            return false;
+        }
+        if (!ETC2Codec::Decompress(blockData, blockDataSize, ktxWidth, ktxHeight, format, pixelData)) {
+            Log::Error("Bitmap::DecodeKTXRGBA: Failed to decompress ETC2 data");
+            return false;
+        }
+
+        width = ktxWidth;
+        height = ktxHeight;
+        if (topDown) {
+            unsigned int bytesPerRow = width * 4;
+            for (unsigned int y = 0; y < height / 2; y++) {
+                std::swap_ranges(&pixelData[y * bytesPerRow], &pixelData[(y + 1) * bytesPerRow], &pixelData[(height - 1 - y) * bytesPerRow]);
+            }
+        }
+        return true;
+    }
+
+    const std::size_t Bitmap::DECODE_BUFFER_POOL_CAPACITY = 4 * 1024 * 1024;
+
+    std::vector<std::vector<unsigned char> > Bitmap::_DecodeBufferPool;
+    std::size_t Bitmap::_DecodeBufferPoolSize = 0;
+    std::mutex Bitmap::_DecodeBufferPoolMutex;
+
 }
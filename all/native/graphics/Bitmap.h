@@ -8,6 +8,7 @@
 #define _CARTO_BITMAP_H_
 
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -58,6 +59,26 @@ namespace carto {
             COLOR_FORMAT_RGB_565 = 3
         };
     }
+
+    namespace PNGCompressionPreset {
+        /**
+         * PNG compression presets, trading encoding speed for the size of the result.
+         */
+        enum PNGCompressionPreset {
+            /**
+             * Fastest encoding with larger result. Suitable for encoding images on the fly.
+             */
+            PNG_COMPRESSION_PRESET_FAST,
+            /**
+             * Balanced encoding speed and size, comparable to the default settings of libpng.
+             */
+            PNG_COMPRESSION_PRESET_DEFAULT,
+            /**
+             * Slowest encoding with smallest result. Suitable for offline packages.
+             */
+            PNG_COMPRESSION_PRESET_SMALL
+        };
+    }
     
     /**
      * A class that provides the functionality to store, compress, uncompress and resize basic image formats.
@@ -138,6 +159,13 @@ namespace carto {
          * @return A byte vector of the PNG's data.
          */
         std::shared_ptr<BinaryData> compressToPNG() const;
+        /**
+         * Compresses this bitmap to a PNG format using the specified compression preset.
+         * Large bitmaps are encoded using multiple threads.
+         * @param preset The compression preset to use.
+         * @return A byte vector of the PNG's data.
+         */
+        std::shared_ptr<BinaryData> compressToPNG(PNGCompressionPreset::PNGCompressionPreset preset) const;
     
         /**
          * Compresses this bitmap to a internal format.
@@ -195,6 +223,33 @@ namespace carto {
          * @return The bitmap created from the compressed data. If the decompression fails, null is returned.
          */
         static std::shared_ptr<Bitmap> CreateFromCompressed(const unsigned char* compressedData, std::size_t dataSize);
+
+        /**
+         * Decodes compressed byte data directly to pixels, without creating an intermediate bitmap.
+         * Opaque images are kept in grayscale or RGB format, images with alpha are decoded to RGBA format.
+         * The pixels are stored in the caller-provided buffer, which is resized as needed.
+         * If the buffer has no capacity, a buffer from the shared decode buffer pool is used instead.
+         * The rows are stored in the same (bottom-up) order as in bitmaps. Alpha is premultiplied for PNG and WebP images.
+         * @param compressedData The compressed bitmap data.
+         * @param dataSize size of the compressed data.
+         * @param pixelData The buffer for the decoded pixels.
+         * @param width The width of the decoded image.
+         * @param height The height of the decoded image.
+         * @param colorFormat The color format of the decoded pixels: grayscale, RGB or RGBA.
+         * @return True if the data was successfully decoded, false otherwise.
+         */
+        static bool DecodePixels(const unsigned char* compressedData, std::size_t dataSize, std::vector<unsigned char>& pixelData, unsigned int& width, unsigned int& height, ColorFormat::ColorFormat& colorFormat);
+        /**
+         * Takes a buffer from the shared decode buffer pool.
+         * @return An empty buffer, with the capacity of a previously recycled buffer if the pool is not empty.
+         */
+        static std::vector<unsigned char> AcquireDecodeBuffer();
+        /**
+         * Returns a scratch buffer to the shared decode buffer pool, so that later decodes can reuse its memory.
+         * The pool is bounded, a buffer that does not fit into the pool is released.
+         * @param buffer The buffer to recycle. The buffer is empty after the call.
+         */
+        static void RecycleDecodeBuffer(std::vector<unsigned char>& buffer);
         
     protected:
         Bitmap();
@@ -207,11 +262,18 @@ namespace carto {
         static bool IsPNG(const unsigned char* compressedData, std::size_t dataSize);
         static bool IsWEBP(const unsigned char* compressedData, std::size_t dataSize);
         static bool IsNUTI(const unsigned char* compressedData, std::size_t dataSize);
+        static bool IsKTX(const unsigned char* compressedData, std::size_t dataSize);
     
         bool loadJPEG(const unsigned char* compressedData, std::size_t dataSize);
         bool loadPNG(const unsigned char* compressedData, std::size_t dataSize);
         bool loadWEBP(const unsigned char* compressedData, std::size_t dataSize);
         bool loadNUTI(const unsigned char* compressedData, std::size_t dataSize);
+        bool loadKTX(const unsigned char* compressedData, std::size_t dataSize);
+
+        static bool DecodeJPEGPixels(const unsigned char* compressedData, std::size_t dataSize, std::vector<unsigned char>& pixelData, unsigned int& width, unsigned int& height, ColorFormat::ColorFormat& colorFormat);
+        static bool DecodePNGPixels(const unsigned char* compressedData, std::size_t dataSize, std::vector<unsigned char>& pixelData, unsigned int& width, unsigned int& height, ColorFormat::ColorFormat& colorFormat);
+        static bool DecodeWEBPPixels(const unsigned char* compressedData, std::size_t dataSize, std::vector<unsigned char>& pixelData, unsigned int& width, unsigned int& height, ColorFormat::ColorFormat& colorFormat);
+        static bool DecodeKTXRGBA(const unsigned char* compressedData, std::size_t dataSize, std::vector<unsigned char>& pixelData, unsigned int& width, unsigned int& height);
         
         unsigned int _width;
         unsigned int _height;
@@ -219,6 +281,13 @@ namespace carto {
         ColorFormat::ColorFormat _colorFormat;
     
         std::vector<unsigned char> _pixelData;
+
+    private:
+        static const std::size_t DECODE_BUFFER_POOL_CAPACITY;
+
+        static std::vector<std::vector<unsigned char> > _DecodeBufferPool;
+        static std::size_t _DecodeBufferPoolSize;
+        static std::mutex _DecodeBufferPoolMutex;
     };
     
 }
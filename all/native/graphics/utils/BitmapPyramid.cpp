@@ -0,0 +1,314 @@
+#include "BitmapPyramid.h"
+#include "graphics/Bitmap.h"
+#include "utils/Log.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <thread>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace carto {
+
+    BitmapPyramid::~BitmapPyramid() {
+    }
+
+    std::shared_ptr<BitmapPyramid> BitmapPyramid::Create(const std::shared_ptr<Bitmap>& bitmap, bool includeBaseLevel, const std::string& fileName, const std::atomic<bool>& canceled) {
+        if (!bitmap || bitmap->getColorFormat() != ColorFormat::COLOR_FORMAT_RGBA) {
+            Log::Error("BitmapPyramid::Create: Bitmap must be in RGBA format");
+            return std::shared_ptr<BitmapPyramid>();
+        }
+
+        std::shared_ptr<BitmapPyramid> pyramid(new BitmapPyramid(bitmap->getWidth(), bitmap->getHeight(), includeBaseLevel));
+        if (!pyramid->calculateDataSize()) {
+            return std::shared_ptr<BitmapPyramid>();
+        }
+
+        // Reuse the pyramid file if it was completely built from the same bitmap
+        FileHeader header;
+        if (!fileName.empty()) {
+            header = CreateFileHeader(*bitmap, includeBaseLevel, pyramid->_dataSize);
+            if (pyramid->open(fileName, header)) {
+                return pyramid;
+            }
+        }
+
+        if (!pyramid->allocate(fileName)) {
+            return std::shared_ptr<BitmapPyramid>();
+        }
+
+        // Each level is built from the previous one, so levels must be built in order
+        for (int level = includeBaseLevel ? 0 : 1; level < pyramid->getLevelCount(); level++) {
+            if (!pyramid->buildLevel(level, *bitmap, canceled)) {
+                return std::shared_ptr<BitmapPyramid>();
+            }
+        }
+
+        if (!fileName.empty()) {
+            pyramid->commit(header);
+        }
+        return pyramid;
+    }
+
+    int BitmapPyramid::getLevelCount() const {
+        return static_cast<int>(_levels.size());
+    }
+
+    int BitmapPyramid::getLevelWidth(int level) const {
+        return _levels.at(level).width;
+    }
+
+    int BitmapPyramid::getLevelHeight(int level) const {
+        return _levels.at(level).height;
+    }
+
+    bool BitmapPyramid::hasLevel(int level) const {
+        return level >= 0 && level < static_cast<int>(_levels.size()) && _levels[level].stored;
+    }
+
+    const unsigned char* BitmapPyramid::getPixel(int level, int u, int v) const {
+        const Level& levelInfo = _levels[level];
+        std::size_t blockIndex = static_cast<std::size_t>(v >> BLOCK_SHIFT) * levelInfo.blocksX + (u >> BLOCK_SHIFT);
+        std::size_t pixelIndex = (blockIndex << (BLOCK_SHIFT * 2)) + ((v & (BLOCK_SIZE - 1)) << BLOCK_SHIFT) + (u & (BLOCK_SIZE - 1));
+        return _data + levelInfo.offset + pixelIndex * 4;
+    }
+
+    BitmapPyramid::BitmapPyramid(int width, int height, bool includeBaseLevel) :
+        _levels(),
+        _dataSize(0),
+        _memoryData(),
+        _mappedData(),
+        _data(nullptr)
+    {
+        while (true) {
+            Level level;
+            level.width = width;
+            level.height = height;
+            level.blocksX = (width + BLOCK_SIZE - 1) / BLOCK_SIZE;
+            level.blocksY = (height + BLOCK_SIZE - 1) / BLOCK_SIZE;
+            level.offset = 0;
+            level.stored = includeBaseLevel || !_levels.empty();
+            _levels.push_back(level);
+            if (width <= 1 && height <= 1) {
+                break;
+            }
+            width = (width + 1) / 2;
+            height = (height + 1) / 2;
+        }
+    }
+
+    bool BitmapPyramid::calculateDataSize() {
+        std::uint64_t size = 0;
+        for (Level& level : _levels) {
+            if (level.stored) {
+                level.offset = static_cast<std::size_t>(size);
+                size += static_cast<std::uint64_t>(level.blocksX) * level.blocksY * BLOCK_SIZE * BLOCK_SIZE * 4;
+            }
+        }
+        // Offsets and sizes must be addressable on 32-bit targets, too
+        if (size + FILE_HEADER_SIZE > std::numeric_limits<std::size_t>::max()) {
+            Log::Error("BitmapPyramid::calculateDataSize: Pyramid is too large");
+            return false;
+        }
+        _dataSize = size;
+        return true;
+    }
+
+    bool BitmapPyramid::open(const std::string& fileName, const FileHeader& header) {
+#ifndef _WIN32
+        int fd = ::open(fileName.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        FileHeader fileHeader;
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || static_cast<std::uint64_t>(st.st_size) != FILE_HEADER_SIZE + _dataSize || ::pread(fd, &fileHeader, sizeof(FileHeader), 0) != static_cast<ssize_t>(sizeof(FileHeader)) || std::memcmp(&fileHeader, &header, sizeof(FileHeader)) != 0) {
+            ::close(fd);
+            return false;
+        }
+        std::size_t size = static_cast<std::size_t>(FILE_HEADER_SIZE + _dataSize);
+        void* ptr = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (ptr == MAP_FAILED) {
+            Log::Errorf("BitmapPyramid::open: Could not map file %s", fileName.c_str());
+            return false;
+        }
+        _mappedData = std::shared_ptr<void>(ptr, [size](void* ptr) { ::munmap(ptr, size); });
+        _data = static_cast<unsigned char*>(ptr) + FILE_HEADER_SIZE;
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    bool BitmapPyramid::allocate(const std::string& fileName) {
+#ifndef _WIN32
+        if (!fileName.empty()) {
+            std::uint64_t fileSize = FILE_HEADER_SIZE + _dataSize;
+            if (fileSize > static_cast<std::uint64_t>(std::numeric_limits<off_t>::max())) {
+                Log::Errorf("BitmapPyramid::allocate: Pyramid is too large for file %s", fileName.c_str());
+                return false;
+            }
+            // The header stays zeroed until the build is complete, so that partially built files are never reused
+            int fd = ::open(fileName.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+            if (fd < 0) {
+                Log::Errorf("BitmapPyramid::allocate: Could not create file %s", fileName.c_str());
+                return false;
+            }
+            if (::ftruncate(fd, static_cast<off_t>(fileSize)) != 0) {
+                ::close(fd);
+                ::unlink(fileName.c_str());
+                Log::Errorf("BitmapPyramid::allocate: Could not resize file %s", fileName.c_str());
+                return false;
+            }
+            std::size_t size = static_cast<std::size_t>(fileSize);
+            void* ptr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if (ptr == MAP_FAILED) {
+                ::unlink(fileName.c_str());
+                Log::Errorf("BitmapPyramid::allocate: Could not map file %s", fileName.c_str());
+                return false;
+            }
+            _mappedData = std::shared_ptr<void>(ptr, [size](void* ptr) { ::munmap(ptr, size); });
+            _data = static_cast<unsigned char*>(ptr) + FILE_HEADER_SIZE;
+            return true;
+        }
+#endif
+
+        // No file given or memory mapping is not supported, keep the pyramid in memory
+        try {
+            _memoryData.resize(static_cast<std::size_t>(_dataSize));
+        }
+        catch (const std::bad_alloc&) {
+            Log::Error("BitmapPyramid::allocate: Not enough memory for the pyramid");
+            return false;
+        }
+        _data = _memoryData.data();
+        return true;
+    }
+
+    void BitmapPyramid::commit(const FileHeader& header) {
+#ifndef _WIN32
+        if (!_mappedData) {
+            return;
+        }
+        // Flush the levels before writing the header, the header marks the file as complete
+        unsigned char* ptr = static_cast<unsigned char*>(_mappedData.get());
+        std::size_t size = static_cast<std::size_t>(FILE_HEADER_SIZE + _dataSize);
+        if (::msync(ptr, size, MS_SYNC) != 0) {
+            Log::Error("BitmapPyramid::commit: Could not flush pyramid file");
+            return;
+        }
+        std::memcpy(ptr, &header, sizeof(FileHeader));
+        ::msync(ptr, FILE_HEADER_SIZE, MS_ASYNC);
+#endif
+    }
+
+    bool BitmapPyramid::buildLevel(int level, const Bitmap& bitmap, const std::atomic<bool>& canceled) {
+        int blocksY = _levels[level].blocksY;
+        std::atomic<int> nextBlockRow(0);
+        auto buildBlockRows = [&]() {
+            for (int blockY = nextBlockRow++; blockY < blocksY && !canceled; blockY = nextBlockRow++) {
+                buildBlockRow(level, blockY, bitmap);
+            }
+        };
+        unsigned int threadCount = std::min(static_cast<unsigned int>(blocksY), std::min(std::max(1u, std::thread::hardware_concurrency()), MAX_THREADS));
+        std::vector<std::thread> threads;
+        for (unsigned int i = 1; i < threadCount; i++) {
+            threads.emplace_back(buildBlockRows);
+        }
+        buildBlockRows();
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        return !canceled;
+    }
+
+    void BitmapPyramid::buildBlockRow(int level, int blockY, const Bitmap& bitmap) {
+        const Level& levelInfo = _levels[level];
+        int minV = blockY * BLOCK_SIZE;
+        int maxV = std::min(minV + BLOCK_SIZE, levelInfo.height);
+
+        if (level == 0) {
+            // Copy the rows of the bitmap into blocks
+            const unsigned char* pixelData = bitmap.getPixelData().data();
+            for (int v = minV; v < maxV; v++) {
+                for (int u = 0; u < levelInfo.width; u += BLOCK_SIZE) {
+                    int count = std::min(BLOCK_SIZE, levelInfo.width - u);
+                    std::memcpy(const_cast<unsigned char*>(getPixel(level, u, v)), &pixelData[(static_cast<std::size_t>(v) * levelInfo.width + u) * 4], count * 4);
+                }
+            }
+            return;
+        }
+
+        // Downsample the previous level using 2x2 box filter. As pixel data is premultiplied, channels can be averaged independently
+        const Level& prevLevelInfo = _levels[level - 1];
+        const unsigned char* pixelData = bitmap.getPixelData().data();
+        auto getPrevPixel = [&](int u, int v) -> const unsigned char* {
+            if (prevLevelInfo.stored) {
+                return getPixel(level - 1, u, v);
+            }
+            return &pixelData[(static_cast<std::size_t>(v) * prevLevelInfo.width + u) * 4];
+        };
+        for (int v = minV; v < maxV; v++) {
+            int v0 = v * 2;
+            int v1 = std::min(v0 + 1, prevLevelInfo.height - 1);
+            for (int u = 0; u < levelInfo.width; u++) {
+                int u0 = u * 2;
+                int u1 = std::min(u0 + 1, prevLevelInfo.width - 1);
+                const unsigned char* p00 = getPrevPixel(u0, v0);
+                const unsigned char* p01 = getPrevPixel(u1, v0);
+                const unsigned char* p10 = getPrevPixel(u0, v1);
+                const unsigned char* p11 = getPrevPixel(u1, v1);
+                unsigned char* pixel = const_cast<unsigned char*>(getPixel(level, u, v));
+                for (int c = 0; c < 4; c++) {
+                    pixel[c] = static_cast<unsigned char>((p00[c] + p01[c] + p10[c] + p11[c] + 2) >> 2);
+                }
+            }
+        }
+    }
+
+    BitmapPyramid::FileHeader BitmapPyramid::CreateFileHeader(const Bitmap& bitmap, bool includeBaseLevel, std::uint64_t dataSize) {
+        FileHeader header;
+        std::memset(&header, 0, sizeof(FileHeader));
+        std::memcpy(header.magic, FILE_MAGIC, sizeof(header.magic));
+        header.version = FILE_VERSION;
+        header.width = bitmap.getWidth();
+        header.height = bitmap.getHeight();
+        header.includeBaseLevel = includeBaseLevel ? 1 : 0;
+        header.dataSize = dataSize;
+        header.bitmapHash = CalculateBitmapHash(bitmap);
+        return header;
+    }
+
+    std::uint64_t BitmapPyramid::CalculateBitmapHash(const Bitmap& bitmap) {
+        // 64-bit FNV-1a over 8-byte words, a single pass is much cheaper than building the pyramid
+        const std::vector<unsigned char>& pixelData = bitmap.getPixelData();
+        std::uint64_t hash = 14695981039346656037ULL;
+        std::size_t i = 0;
+        for (; i + sizeof(std::uint64_t) <= pixelData.size(); i += sizeof(std::uint64_t)) {
+            std::uint64_t word;
+            std::memcpy(&word, &pixelData[i], sizeof(std::uint64_t));
+            hash = (hash ^ word) * 1099511628211ULL;
+        }
+        for (; i < pixelData.size(); i++) {
+            hash = (hash ^ pixelData[i]) * 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    const char BitmapPyramid::FILE_MAGIC[8] = { 'C', 'B', 'M', 'P', 'Y', 'R', 'M', 'D' };
+    const std::uint32_t BitmapPyramid::FILE_VERSION = 1;
+    const std::size_t BitmapPyramid::FILE_HEADER_SIZE = 4096; // keeps the blocks page aligned
+
+    const int BitmapPyramid::BLOCK_SHIFT = 7;
+    const int BitmapPyramid::BLOCK_SIZE = 1 << BLOCK_SHIFT;
+    const unsigned int BitmapPyramid::MAX_THREADS = 4;
+
+}
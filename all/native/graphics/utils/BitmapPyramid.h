@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2016 CartoDB. All rights reserved.
+ * Copying and using this code is allowed only according
+ * to license terms, as given in https://cartodb.com/terms/
+ */
+
+#ifndef _CARTO_BITMAPPYRAMID_H_
+#define _CARTO_BITMAPPYRAMID_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace carto {
+    class Bitmap;
+
+    /**
+     * Mip-map pyramid of an RGBA bitmap. Each level is half the size of the previous one and is stored
+     * in square blocks, so that reading a small area of a level touches only a few contiguous memory ranges.
+     * The pyramid can be kept in a memory mapped file, in which case the operating system pages in only the blocks that are read.
+     * The file is kept after use and reused later if it was built from a bitmap with the same size and content.
+     */
+    class BitmapPyramid {
+    public:
+        ~BitmapPyramid();
+
+        /**
+         * Builds the pyramid of the given RGBA bitmap.
+         * @param bitmap The source bitmap, must be in RGBA format. Pixel coordinates of the levels follow the row order of the bitmap pixel data.
+         * @param includeBaseLevel If true, the full resolution level is also stored. Otherwise level 0 must be read from the bitmap itself.
+         * @param fileName The file for memory mapped storage. If the file already contains a complete pyramid of the same bitmap, it is reused without building. If empty, the pyramid is kept in memory.
+         * @param canceled The flag that can be used to cancel the building.
+         * @return The pyramid or null if the building failed or was canceled.
+         */
+        static std::shared_ptr<BitmapPyramid> Create(const std::shared_ptr<Bitmap>& bitmap, bool includeBaseLevel, const std::string& fileName, const std::atomic<bool>& canceled);
+
+        int getLevelCount() const;
+        int getLevelWidth(int level) const;
+        int getLevelHeight(int level) const;
+        bool hasLevel(int level) const;
+
+        const unsigned char* getPixel(int level, int u, int v) const;
+
+    private:
+        struct Level {
+            int width;
+            int height;
+            int blocksX;
+            int blocksY;
+            std::size_t offset;
+            bool stored;
+        };
+
+        struct FileHeader {
+            char magic[8];
+            std::uint32_t version;
+            std::uint32_t width;
+            std::uint32_t height;
+            std::uint32_t includeBaseLevel;
+            std::uint64_t dataSize;
+            std::uint64_t bitmapHash;
+        };
+
+        BitmapPyramid(int width, int height, bool includeBaseLevel);
+
+        bool calculateDataSize();
+        bool open(const std::string& fileName, const FileHeader& header);
+        bool allocate(const std::string& fileName);
+        void commit(const FileHeader& header);
+        bool buildLevel(int level, const Bitmap& bitmap, const std::atomic<bool>& canceled);
+        void buildBlockRow(int level, int blockY, const Bitmap& bitmap);
+
+        static FileHeader CreateFileHeader(const Bitmap& bitmap, bool includeBaseLevel, std::uint64_t dataSize);
+        static std::uint64_t CalculateBitmapHash(const Bitmap& bitmap);
+
+        static const char FILE_MAGIC[8];
+        static const std::uint32_t FILE_VERSION;
+        static const std::size_t FILE_HEADER_SIZE;
+        static const int BLOCK_SHIFT;
+        static const int BLOCK_SIZE;
+        static const unsigned int MAX_THREADS;
+
+        std::vector<Level> _levels;
+        std::uint64_t _dataSize;
+        std::vector<unsigned char> _memoryData;
+        std::shared_ptr<void> _mappedData;
+        unsigned char* _data;
+    };
+
+}
+
+#endif
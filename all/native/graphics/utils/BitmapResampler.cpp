@@ -0,0 +1,339 @@
+#include "BitmapResampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+    double LanczosKernel(double x, double radius) {
+        x = std::abs(x);
+        if (x < 1.0e-8) {
+            return 1.0;
+        }
+        if (x >= radius) {
+            return 0.0;
+        }
+        const double pi = 3.14159265358979323846;
+        double px = pi * x;
+        return radius * std::sin(px) * std::sin(px / radius) / (px * px);
+    }
+
+}
+
+namespace carto {
+
+    void BitmapResampler::Resample(const unsigned char* srcData, int srcWidth, int srcHeight, int srcStride, int bytesPerPixel, unsigned char* dstData, int dstWidth, int dstHeight, Filter filter) {
+        if (srcWidth <= 0 || srcHeight <= 0 || dstWidth <= 0 || dstHeight <= 0 || bytesPerPixel <= 0 || bytesPerPixel > 4) {
+            return;
+        }
+
+        switch (filter) {
+        case Filter::LANCZOS3:
+            ResampleLanczos(srcData, srcWidth, srcHeight, srcStride, bytesPerPixel, dstData, dstWidth, dstHeight);
+            break;
+        default:
+            {
+                int weightShift = 0;
+                if (!IsSeparableBox(srcWidth, srcHeight, dstWidth, dstHeight, weightShift)) {
+                    ResampleBoxGeneric(srcData, srcWidth, srcHeight, srcStride, bytesPerPixel, dstData, dstWidth, dstHeight, weightShift);
+                } else if (dstWidth == 2 * srcWidth && dstHeight == 2 * srcHeight) {
+                    ResampleBoxUpsample2x(srcData, srcWidth, srcHeight, srcStride, bytesPerPixel, dstData);
+                } else {
+                    ResampleBoxSeparable(srcData, srcWidth, srcHeight, srcStride, bytesPerPixel, dstData, dstWidth, dstHeight);
+                }
+            }
+            break;
+        }
+    }
+
+    bool BitmapResampler::IsSeparableBox(int srcWidth, int srcHeight, int dstWidth, int dstHeight, int& weightShift) {
+        // If too many input pixels map to one output pixel, our 32-bit accumulation values
+        // could overflow - so, if we have huge mappings like that, cut down the weights:
+        //    256 max color value
+        //   *256 weight_x
+        //   *256 weight_y
+        //   *256 (16*16) maximum # of input pixels (x,y) - unless we cut the weights down...
+        weightShift = 0;
+        float source_texels_per_out_pixel = ((srcWidth / static_cast<float>(dstWidth + 1))
+                * (srcHeight / static_cast<float>(dstHeight + 1)));
+        float weight_per_pixel = source_texels_per_out_pixel * 256 * 256; //weight_x * weight_y
+        float accum_per_pixel = weight_per_pixel * 256; //color value is 0-255
+        float weight_div = accum_per_pixel / 4294967000.0f;
+        if (weight_div > 1) {
+            weightShift = static_cast<int>(ceilf(logf(weight_div) / logf(2)));
+        }
+        weightShift = std::min(15, weightShift);
+
+        // Shifted weights are not separable, the generic path must be used to produce identical results
+        return weightShift == 0;
+    }
+
+    BitmapResampler::Taps BitmapResampler::CalculateBoxTaps(int srcSize, int dstSize) {
+        bool upsample = srcSize < dstSize;
+        float f = 256 * srcSize / static_cast<float>(dstSize);
+
+        Taps taps;
+        taps.stride = 0;
+        taps.offsets.resize(dstSize);
+        taps.counts.resize(dstSize);
+        taps.weightSums.resize(dstSize);
+        std::vector<int> ranges(dstSize * 2);
+        for (std::size_t i = 0; i < static_cast<std::size_t>(dstSize); i++) {
+            int a = static_cast<int>((i) * f);
+            int b = static_cast<int>((i + 1) * f);
+            if (upsample) {
+                b = a + 256;
+            }
+            b = std::min(b, static_cast<int>(256 * srcSize - 1));
+            ranges[i * 2 + 0] = a;
+            ranges[i * 2 + 1] = b;
+            taps.offsets[i] = a >> 8;
+            taps.counts[i] = (b >> 8) - (a >> 8) + 1;
+            taps.stride = std::max(taps.stride, taps.counts[i]);
+        }
+
+        taps.weights.resize(dstSize * taps.stride, 0);
+        for (int i = 0; i < dstSize; i++) {
+            int a = ranges[i * 2 + 0];
+            int b = ranges[i * 2 + 1];
+            int* weights = &taps.weights[i * taps.stride];
+            unsigned int weightSum = 0;
+            for (int j = 0; j < taps.counts[i]; j++) {
+                int weight = 256;
+                if (taps.counts[i] > 1) {
+                    if (j == 0) {
+                        weight = 256 - (a & 0xFF);
+                    } else if (j == taps.counts[i] - 1) {
+                        weight = (b & 0xFF);
+                    }
+                }
+                weights[j] = weight;
+                weightSum += weight;
+            }
+            taps.weightSums[i] = weightSum;
+        }
+        return taps;
+    }
+
+    BitmapResampler::Taps BitmapResampler::CalculateLanczosTaps(int srcSize, int dstSize) {
+        double scale = static_cast<double>(srcSize) / dstSize;
+        double filterScale = std::max(scale, 1.0); // widen the kernel when downsampling to avoid aliasing
+        double support = LANCZOS_RADIUS * filterScale;
+
+        Taps taps;
+        taps.stride = std::min(static_cast<int>(std::ceil(support)) * 2 + 1, srcSize);
+        taps.offsets.resize(dstSize);
+        taps.counts.resize(dstSize);
+        taps.weights.resize(dstSize * taps.stride, 0);
+        taps.weightSums.resize(dstSize);
+        std::vector<double> weights(taps.stride);
+        for (int i = 0; i < dstSize; i++) {
+            double center = (i + 0.5) * scale - 0.5;
+            int start = static_cast<int>(std::ceil(center - support));
+            int end = static_cast<int>(std::floor(center + support));
+
+            // Taps outside of the source are clamped to the edge pixels
+            int first = std::min(std::max(start, 0), srcSize - 1);
+            int last = std::max(std::min(end, srcSize - 1), first);
+            int count = std::min(last - first + 1, taps.stride);
+            std::fill(weights.begin(), weights.end(), 0.0);
+            double weightSum = 0;
+            for (int j = start; j <= end; j++) {
+                double weight = LanczosKernel((j - center) / filterScale, LANCZOS_RADIUS);
+                int k = std::min(std::max(j, first), first + count - 1) - first;
+                weights[k] += weight;
+                weightSum += weight;
+            }
+
+            // Normalize to fixed point, keeping the sum exact so that flat areas stay flat
+            int* fixedWeights = &taps.weights[i * taps.stride];
+            int fixedSum = 0;
+            int maxIndex = 0;
+            for (int k = 0; k < count; k++) {
+                double weight = weightSum != 0 ? weights[k] / weightSum : (k == 0 ? 1.0 : 0.0);
+                fixedWeights[k] = static_cast<int>(std::floor(weight * (1 << LANCZOS_WEIGHT_BITS) + 0.5));
+                fixedSum += fixedWeights[k];
+                if (fixedWeights[k] > fixedWeights[maxIndex]) {
+                    maxIndex = k;
+                }
+            }
+            fixedWeights[maxIndex] += (1 << LANCZOS_WEIGHT_BITS) - fixedSum;
+
+            taps.offsets[i] = first;
+            taps.counts[i] = count;
+            taps.weightSums[i] = 1 << LANCZOS_WEIGHT_BITS;
+        }
+        return taps;
+    }
+
+    void BitmapResampler::ResampleBoxUpsample2x(const unsigned char* srcData, int srcWidth, int srcHeight, int srcStride, int bytesPerPixel, unsigned char* dstData) {
+        // Exact 2x magnification: even output pixels copy the source pixel, odd pixels average it with the next one
+        int dstWidth = srcWidth * 2;
+        int dstHeight = srcHeight * 2;
+        std::vector<int> columns(dstWidth * 2);
+        for (int x = 0; x < dstWidth; x++) {
+            int x0 = x >> 1;
+            int x1 = (x & 1) ? std::min(x0 + 1, srcWidth - 1) : x0;
+            columns[x * 2 + 0] = x0 * bytesPerPixel;
+            columns[x * 2 + 1] = x1 * bytesPerPixel;
+        }
+
+        for (int y = 0; y < dstHeight; y++) {
+            int y0 = y >> 1;
+            int y1 = (y & 1) ? std::min(y0 + 1, srcHeight - 1) : y0;
+            const unsigned char* row0 = srcData + static_cast<std::size_t>(y0) * srcStride;
+            const unsigned char* row1 = srcData + static_cast<std::size_t>(y1) * srcStride;
+            unsigned char* dstRow = dstData + static_cast<std::size_t>(y) * dstWidth * bytesPerPixel;
+            for (int x = 0; x < dstWidth; x++) {
+                int i0 = columns[x * 2 + 0];
+                int i1 = columns[x * 2 + 1];
+                for (int c = 0; c < bytesPerPixel; c++) {
+                    unsigned int sum = row0[i0 + c] + row0[i1 + c] + row1[i0 + c] + row1[i1 + c];
+                    dstRow[x * bytesPerPixel + c] = static_cast<unsigned char>(sum >> 2);
+                }
+            }
+        }
+    }
+
+    void BitmapResampler::ResampleBoxSeparable(const unsigned char* srcData, int srcWidth, int srcHeight, int srcStride, int bytesPerPixel, unsigned char* dstData, int dstWidth, int dstHeight) {
+        // Unshifted box weights are products of the x and y weights, so the sums can be calculated in two passes.
+        // As all arithmetic is modulo 2^32, the results are identical to the generic path.
+        Taps tapsX = CalculateBoxTaps(srcWidth, dstWidth);
+        Taps tapsY = CalculateBoxTaps(srcHeight, dstHeight);
+
+        int rowSize = srcWidth * bytesPerPixel;
+        std::vector<unsigned int> acc(rowSize);
+        for (int y2 = 0; y2 < dstHeight; y2++) {
+            // Vertical pass, simple loop over the full row
+            std::fill(acc.begin(), acc.end(), 0);
+            const int* weightsY = &tapsY.weights[y2 * tapsY.stride];
+            for (int j = 0; j < tapsY.counts[y2]; j++) {
+                const unsigned char* srcRow = srcData + static_cast<std::size_t>(tapsY.offsets[y2] + j) * srcStride;
+                unsigned int weight = weightsY[j];
+                unsigned int* accPtr = acc.data();
+                for (int i = 0; i < rowSize; i++) {
+                    accPtr[i] += srcRow[i] * weight;
+                }
+            }
+
+            // Horizontal pass
+            unsigned char* dstRow = dstData + static_cast<std::size_t>(y2) * dstWidth * bytesPerPixel;
+            for (int x2 = 0; x2 < dstWidth; x2++) {
+                const int* weightsX = &tapsX.weights[x2 * tapsX.stride];
+                const unsigned int* accPtr = &acc[tapsX.offsets[x2] * bytesPerPixel];
+                unsigned int sums[4] = { 0, 0, 0, 0 };
+                for (int j = 0; j < tapsX.counts[x2]; j++) {
+                    unsigned int weight = weightsX[j];
+                    for (int c = 0; c < bytesPerPixel; c++) {
+                        sums[c] += accPtr[j * bytesPerPixel + c] * weight;
+                    }
+                }
+                unsigned int wa = tapsX.weightSums[x2] * tapsY.weightSums[y2];
+                if (wa <= 0) {
+                    wa = std::numeric_limits<int>::max();
+                }
+                for (int c = 0; c < bytesPerPixel; c++) {
+                    dstRow[x2 * bytesPerPixel + c] = static_cast<unsigned char>(sums[c] / wa);
+                }
+            }
+        }
+    }
+
+    void BitmapResampler::ResampleBoxGeneric(const unsigned char* srcData, int srcWidth, int srcHeight, int srcStride, int bytesPerPixel, unsigned char* dstData, int dstWidth, int dstHeight, int weightShift) {
+        Taps tapsX = CalculateBoxTaps(srcWidth, dstWidth);
+        Taps tapsY = CalculateBoxTaps(srcHeight, dstHeight);
+
+        unsigned char* ddest = dstData;
+        for (int y2 = 0; y2 < dstHeight; y2++) {
+            const int* weightsY = &tapsY.weights[y2 * tapsY.stride];
+            for (int x2 = 0; x2 < dstWidth; x2++) {
+                const int* weightsX = &tapsX.weights[x2 * tapsX.stride];
+
+                // Add up all input pixels contributing to this output pixel
+                unsigned int sums[4] = { 0, 0, 0, 0 };
+                unsigned int wa = 0;
+                for (int j = 0; j < tapsY.counts[y2]; j++) {
+                    const unsigned char* dsrc2 = srcData + static_cast<std::size_t>(tapsY.offsets[y2] + j) * srcStride + tapsX.offsets[x2] * bytesPerPixel;
+                    for (int i = 0; i < tapsX.counts[x2]; i++) {
+                        unsigned int w = (static_cast<unsigned int>(weightsX[i]) * static_cast<unsigned int>(weightsY[j])) >> weightShift;
+                        for (int c = 0; c < bytesPerPixel; c++) {
+                            sums[c] += *dsrc2++ * w;
+                        }
+                        wa += w;
+                    }
+                }
+                if (wa <= 0) {
+                    wa = std::numeric_limits<int>::max();
+                }
+
+                // Write results
+                for (int c = 0; c < bytesPerPixel; c++) {
+                    *ddest++ = static_cast<unsigned char>(sums[c] / wa);
+                }
+            }
+        }
+    }
+
+    void BitmapResampler::ResampleLanczos(const unsigned char* srcData, int srcWidth, int srcHeight, int srcStride, int bytesPerPixel, unsigned char* dstData, int dstWidth, int dstHeight) {
+        Taps tapsX = CalculateLanczosTaps(srcWidth, dstWidth);
+        Taps tapsY = CalculateLanczosTaps(srcHeight, dstHeight);
+
+        // Horizontal pass into a reduced precision intermediate buffer
+        const int intermediateRound = 1 << (LANCZOS_WEIGHT_BITS - LANCZOS_INTERMEDIATE_BITS - 1);
+        int tempRowSize = dstWidth * bytesPerPixel;
+        std::vector<int> temp(static_cast<std::size_t>(srcHeight) * tempRowSize);
+        for (int y = 0; y < srcHeight; y++) {
+            const unsigned char* srcRow = srcData + static_cast<std::size_t>(y) * srcStride;
+            int* tempRow = &temp[static_cast<std::size_t>(y) * tempRowSize];
+            for (int x2 = 0; x2 < dstWidth; x2++) {
+                const int* weightsX = &tapsX.weights[x2 * tapsX.stride];
+                const unsigned char* srcPtr = srcRow + tapsX.offsets[x2] * bytesPerPixel;
+                int sums[4] = { 0, 0, 0, 0 };
+                for (int j = 0; j < tapsX.counts[x2]; j++) {
+                    for (int c = 0; c < bytesPerPixel; c++) {
+                        sums[c] += srcPtr[j * bytesPerPixel + c] * weightsX[j];
+                    }
+                }
+                for (int c = 0; c < bytesPerPixel; c++) {
+                    tempRow[x2 * bytesPerPixel + c] = (sums[c] + intermediateRound) >> (LANCZOS_WEIGHT_BITS - LANCZOS_INTERMEDIATE_BITS);
+                }
+            }
+        }
+
+        // Vertical pass, accumulating full rows
+        const int finalShift = LANCZOS_WEIGHT_BITS + LANCZOS_INTERMEDIATE_BITS;
+        std::vector<int> acc(tempRowSize);
+        for (int y2 = 0; y2 < dstHeight; y2++) {
+            std::fill(acc.begin(), acc.end(), 1 << (finalShift - 1));
+            const int* weightsY = &tapsY.weights[y2 * tapsY.stride];
+            for (int j = 0; j < tapsY.counts[y2]; j++) {
+                const int* tempRow = &temp[static_cast<std::size_t>(tapsY.offsets[y2] + j) * tempRowSize];
+                int weight = weightsY[j];
+                int* accPtr = acc.data();
+                for (int i = 0; i < tempRowSize; i++) {
+                    accPtr[i] += tempRow[i] * weight;
+                }
+            }
+
+            unsigned char* dstRow = dstData + static_cast<std::size_t>(y2) * tempRowSize;
+            for (int i = 0; i < tempRowSize; i++) {
+                dstRow[i] = static_cast<unsigned char>(std::min(std::max(acc[i] >> finalShift, 0), 255));
+            }
+            if (bytesPerPixel == 4) {
+                // The negative lobes can overshoot, keep premultiplied color channels within alpha
+                for (int i = 0; i < tempRowSize; i += 4) {
+                    unsigned char alpha = dstRow[i + 3];
+                    dstRow[i + 0] = std::min(dstRow[i + 0], alpha);
+                    dstRow[i + 1] = std::min(dstRow[i + 1], alpha);
+                    dstRow[i + 2] = std::min(dstRow[i + 2], alpha);
+                }
+            }
+        }
+    }
+
+    const int BitmapResampler::LANCZOS_RADIUS = 3;
+    const int BitmapResampler::LANCZOS_WEIGHT_BITS = 14;
+    const int BitmapResampler::LANCZOS_INTERMEDIATE_BITS = 7;
+
+}
@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2016 CartoDB. All rights reserved.
+ * Copying and using this code is allowed only according
+ * to license terms, as given in https://cartodb.com/terms/
+ */
+
+#ifndef _CARTO_BITMAPRESAMPLER_H_
+#define _CARTO_BITMAPRESAMPLER_H_
+
+#include <vector>
+
+namespace carto {
+
+    /**
+     * Resampler for 8-bit interleaved pixel data, using separable filter kernels.
+     * Source data can be a sub-rectangle of a larger image, given by the row stride.
+     * Pixels with 4 channels are assumed to be RGBA with premultiplied alpha.
+     */
+    class BitmapResampler {
+    public:
+        enum class Filter {
+            BOX,     // legacy fixed-point box filter, interpolates bilinearly when upsampling
+            LANCZOS3 // windowed sinc filter with 3 lobes, sharper results when upsampling
+        };
+
+        static void Resample(const unsigned char* srcData, int srcWidth, int srcHeight, int srcStride, int bytesPerPixel, unsigned char* dstData, int dstWidth, int dstHeight, Filter filter);
+
+    private:
+        struct Taps {
+            int stride; // maximum number of taps per destination pixel
+            std::vector<int> offsets; // first source index of each destination pixel
+            std::vector<int> counts; // number of consecutive source pixels contributing to each destination pixel
+            std::vector<int> weights; // stride weights per destination pixel
+            std::vector<unsigned int> weightSums;
+        };
+
+        static bool IsSeparableBox(int srcWidth, int srcHeight, int dstWidth, int dstHeight, int& weightShift);
+
+        static Taps CalculateBoxTaps(int srcSize, int dstSize);
+        static Taps CalculateLanczosTaps(int srcSize, int dstSize);
+
+        static void ResampleBoxUpsample2x(const unsigned char* srcData, int srcWidth, int srcHeight, int srcStride, int bytesPerPixel, unsigned char* dstData);
+        static void ResampleBoxSeparable(const unsigned char* srcData, int srcWidth, int srcHeight, int srcStride, int bytesPerPixel, unsigned char* dstData, int dstWidth, int dstHeight);
+        static void ResampleBoxGeneric(const unsigned char* srcData, int srcWidth, int srcHeight, int srcStride, int bytesPerPixel, unsigned char* dstData, int dstWidth, int dstHeight, int weightShift);
+        static void ResampleLanczos(const unsigned char* srcData, int srcWidth, int srcHeight, int srcStride, int bytesPerPixel, unsigned char* dstData, int dstWidth, int dstHeight);
+
+        static const int LANCZOS_RADIUS;
+        static const int LANCZOS_WEIGHT_BITS;
+        static const int LANCZOS_INTERMEDIATE_BITS;
+    };
+
+}
+
+#endif
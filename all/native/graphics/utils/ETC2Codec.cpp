@@ -0,0 +1,513 @@
+#include "ETC2Codec.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <string>
+
+namespace {
+
+    int Clamp255(int value) {
+        return std::max(0, std::min(255, value));
+    }
+
+    int Expand4(int value) {
+        return (value << 4) | value;
+    }
+
+    int Expand5(int value) {
+        return (value << 3) | (value >> 2);
+    }
+
+    int Expand6(int value) {
+        return (value << 2) | (value >> 4);
+    }
+
+    int Expand7(int value) {
+        return (value << 1) | (value >> 6);
+    }
+
+    int SignExtend3(int value) {
+        return (value & 4) ? value - 8 : value;
+    }
+
+    std::uint64_t ReadBlockBits(const unsigned char* data) {
+        std::uint64_t bits = 0;
+        for (int i = 0; i < 8; i++) {
+            bits = (bits << 8) | data[i];
+        }
+        return bits;
+    }
+
+    void WriteBlockBits(std::uint64_t bits, unsigned char* data) {
+        for (int i = 7; i >= 0; i--) {
+            data[i] = static_cast<unsigned char>(bits & 255);
+            bits >>= 8;
+        }
+    }
+
+    std::uint32_t ReadUInt32LE(const unsigned char* data) {
+        return static_cast<std::uint32_t>(data[0]) | (static_cast<std::uint32_t>(data[1]) << 8) | (static_cast<std::uint32_t>(data[2]) << 16) | (static_cast<std::uint32_t>(data[3]) << 24);
+    }
+
+}
+
+namespace carto {
+
+    std::size_t ETC2Codec::GetCompressedSize(int width, int height, Format format) {
+        std::size_t blockCount = static_cast<std::size_t>((width + 3) / 4) * static_cast<std::size_t>((height + 3) / 4);
+        return blockCount * (format == Format::RGBA8 ? 16 : 8);
+    }
+
+    void ETC2Codec::Compress(const unsigned char* rgbaData, int width, int height, Format format, std::vector<unsigned char>& compressedData) {
+        compressedData.resize(GetCompressedSize(width, height, format));
+        if (width <= 0 || height <= 0) {
+            return;
+        }
+
+        unsigned char* output = compressedData.data();
+        for (int by = 0; by < height; by += 4) {
+            for (int bx = 0; bx < width; bx += 4) {
+                // Gather the block, replicating the edge pixels of partial blocks
+                Block block;
+                for (int y = 0; y < 4; y++) {
+                    const unsigned char* row = &rgbaData[static_cast<std::size_t>(std::min(by + y, height - 1)) * width * 4];
+                    for (int x = 0; x < 4; x++) {
+                        std::memcpy(block[y * 4 + x], &row[std::min(bx + x, width - 1) * 4], 4);
+                    }
+                }
+
+                if (format == Format::RGBA8) {
+                    WriteBlockBits(CompressAlphaBlock(block), output);
+                    output += 8;
+                }
+                WriteBlockBits(CompressColorBlock(block), output);
+                output += 8;
+            }
+        }
+    }
+
+    bool ETC2Codec::Decompress(const unsigned char* compressedData, std::size_t dataSize, int width, int height, Format format, std::vector<unsigned char>& rgbaData) {
+        if (width <= 0 || height <= 0 || dataSize < GetCompressedSize(width, height, format)) {
+            return false;
+        }
+
+        rgbaData.resize(static_cast<std::size_t>(width) * height * 4);
+        const unsigned char* input = compressedData;
+        for (int by = 0; by < height; by += 4) {
+            for (int bx = 0; bx < width; bx += 4) {
+                Block block;
+                if (format == Format::RGBA8) {
+                    DecompressAlphaBlock(ReadBlockBits(input), block);
+                    input += 8;
+                } else {
+                    for (int i = 0; i < 16; i++) {
+                        block[i][3] = 255;
+                    }
+                }
+                DecompressColorBlock(ReadBlockBits(input), block);
+                input += 8;
+
+                for (int y = 0; y < 4 && by + y < height; y++) {
+                    unsigned char* row = &rgbaData[static_cast<std::size_t>(by + y) * width * 4];
+                    for (int x = 0; x < 4 && bx + x < width; x++) {
+                        std::memcpy(&row[(bx + x) * 4], block[y * 4 + x], 4);
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+    bool ETC2Codec::IsKTX(const unsigned char* data, std::size_t dataSize) {
+        if (dataSize < sizeof(KTX_IDENTIFIER)) {
+            return false;
+        }
+        return std::equal(KTX_IDENTIFIER, KTX_IDENTIFIER + sizeof(KTX_IDENTIFIER), data);
+    }
+
+    bool ETC2Codec::ReadKTX(const unsigned char* data, std::size_t dataSize, Format& format, int& width, int& height, bool& topDown, const unsigned char*& compressedData, std::size_t& compressedSize) {
+        static const std::size_t HEADER_SIZE = 64;
+        static const std::uint32_t ENDIANNESS = 0x04030201;
+
+        if (!IsKTX(data, dataSize) || dataSize < HEADER_SIZE + 4 || ReadUInt32LE(&data[12]) != ENDIANNESS) {
+            return false;
+        }
+
+        // Only single 2D ETC1/ETC2 images are supported, mipmap levels other than the first one are ignored
+        std::uint32_t internalFormat = ReadUInt32LE(&data[28]);
+        switch (internalFormat) {
+        case 0x8D64: // GL_ETC1_RGB8_OES
+        case 0x9274: // GL_COMPRESSED_RGB8_ETC2
+            format = Format::RGB8;
+            break;
+        case 0x9278: // GL_COMPRESSED_RGBA8_ETC2_EAC
+            format = Format::RGBA8;
+            break;
+        default:
+            return false;
+        }
+        std::uint32_t pixelWidth = ReadUInt32LE(&data[36]);
+        std::uint32_t pixelHeight = ReadUInt32LE(&data[40]);
+        if (pixelWidth == 0 || pixelHeight == 0 || pixelWidth > 65536 || pixelHeight > 65536 || ReadUInt32LE(&data[44]) > 1 || ReadUInt32LE(&data[48]) > 1 || ReadUInt32LE(&data[52]) != 1) {
+            return false;
+        }
+        width = static_cast<int>(pixelWidth);
+        height = static_cast<int>(pixelHeight);
+
+        // Scan the key/value pairs for the orientation. Tools write the rows top-down unless stated otherwise
+        std::size_t keyValueSize = ReadUInt32LE(&data[60]);
+        if (keyValueSize > dataSize - HEADER_SIZE - 4) {
+            return false;
+        }
+        topDown = true;
+        for (std::size_t offset = HEADER_SIZE; offset + 4 <= HEADER_SIZE + keyValueSize; ) {
+            std::size_t pairSize = ReadUInt32LE(&data[offset]);
+            if (pairSize > HEADER_SIZE + keyValueSize - offset - 4) {
+                break;
+            }
+            std::string keyValue(reinterpret_cast<const char*>(&data[offset + 4]), pairSize);
+            if (keyValue.compare(0, 14, "KTXorientation") == 0 && keyValue.find("T=u") != std::string::npos) {
+                topDown = false;
+            }
+            offset += 4 + ((pairSize + 3) & ~static_cast<std::size_t>(3));
+        }
+
+        std::size_t imageOffset = HEADER_SIZE + keyValueSize;
+        std::size_t imageSize = ReadUInt32LE(&data[imageOffset]);
+        if (imageSize < GetCompressedSize(width, height, format) || imageSize > dataSize - imageOffset - 4) {
+            return false;
+        }
+        compressedData = &data[imageOffset + 4];
+        compressedSize = imageSize;
+        return true;
+    }
+
+    std::uint64_t ETC2Codec::CompressColorBlock(const Block& block) {
+        // Only the ETC1 compatible individual and differential modes are used. Both subblock orientations are tried
+        std::uint64_t bestBits = 0;
+        long long bestError = std::numeric_limits<long long>::max();
+        for (int flip = 0; flip < 2; flip++) {
+            int averageColors[2][3] = { { 0, 0, 0 }, { 0, 0, 0 } };
+            for (int i = 0; i < 16; i++) {
+                int x = i % 4, y = i / 4;
+                int subBlock = (flip ? y : x) >= 2 ? 1 : 0;
+                for (int c = 0; c < 3; c++) {
+                    averageColors[subBlock][c] += block[i][c];
+                }
+            }
+
+            for (int differential = 1; differential >= 0; differential--) {
+                int maxValue = differential ? 31 : 15;
+                int quantizedColors[2][3];
+                int baseColors[2][3];
+                bool valid = true;
+                for (int s = 0; s < 2; s++) {
+                    for (int c = 0; c < 3; c++) {
+                        quantizedColors[s][c] = ((averageColors[s][c] + 4) / 8 * maxValue + 127) / 255;
+                        baseColors[s][c] = differential ? Expand5(quantizedColors[s][c]) : Expand4(quantizedColors[s][c]);
+                    }
+                }
+                if (differential) {
+                    for (int c = 0; c < 3; c++) {
+                        int delta = quantizedColors[1][c] - quantizedColors[0][c];
+                        valid = valid && delta >= -4 && delta <= 3;
+                    }
+                }
+                if (!valid) {
+                    continue;
+                }
+
+                int tables[2] = { 0, 0 };
+                std::uint32_t indices = 0;
+                long long error = 0;
+                for (int s = 0; s < 2; s++) {
+                    error += FitSubBlock(block, flip, s, baseColors[s], tables[s], indices);
+                }
+                if (error >= bestError) {
+                    continue;
+                }
+
+                std::uint64_t bits = 0;
+                for (int c = 0; c < 3; c++) {
+                    int shift = 56 - c * 8;
+                    if (differential) {
+                        bits |= static_cast<std::uint64_t>(quantizedColors[0][c]) << (shift + 3);
+                        bits |= static_cast<std::uint64_t>((quantizedColors[1][c] - quantizedColors[0][c]) & 7) << shift;
+                    } else {
+                        bits |= static_cast<std::uint64_t>(quantizedColors[0][c]) << (shift + 4);
+                        bits |= static_cast<std::uint64_t>(quantizedColors[1][c]) << shift;
+                    }
+                }
+                bits |= static_cast<std::uint64_t>(tables[0]) << 37;
+                bits |= static_cast<std::uint64_t>(tables[1]) << 34;
+                bits |= static_cast<std::uint64_t>(differential) << 33;
+                bits |= static_cast<std::uint64_t>(flip) << 32;
+                bits |= indices;
+                bestBits = bits;
+                bestError = error;
+            }
+        }
+        return bestBits;
+    }
+
+    std::uint64_t ETC2Codec::CompressAlphaBlock(const Block& block) {
+        int minAlpha = 255, maxAlpha = 0;
+        for (int i = 0; i < 16; i++) {
+            minAlpha = std::min(minAlpha, static_cast<int>(block[i][3]));
+            maxAlpha = std::max(maxAlpha, static_cast<int>(block[i][3]));
+        }
+
+        // Constant alpha can be represented exactly using the zero modifier of the table 13
+        int bestBase = minAlpha, bestMultiplier = 1, bestTable = 13;
+        long long bestError = std::numeric_limits<long long>::max();
+        if (minAlpha != maxAlpha) {
+            for (int t = 0; t < 16; t++) {
+                int minModifier = ALPHA_MODIFIER_TABLE[t][3];
+                int maxModifier = ALPHA_MODIFIER_TABLE[t][7];
+                int multiplier0 = ((maxAlpha - minAlpha) + (maxModifier - minModifier) / 2) / (maxModifier - minModifier);
+                for (int multiplier = std::max(1, multiplier0 - 1); multiplier <= std::min(15, multiplier0 + 1); multiplier++) {
+                    int base0 = (minAlpha + maxAlpha - (minModifier + maxModifier) * multiplier + 1) / 2;
+                    for (int base = std::max(0, base0 - 1); base <= std::min(255, base0 + 1); base++) {
+                        long long error = 0;
+                        for (int i = 0; i < 16 && error < bestError; i++) {
+                            int bestPixelError = std::numeric_limits<int>::max();
+                            for (int j = 0; j < 8; j++) {
+                                int delta = Clamp255(base + ALPHA_MODIFIER_TABLE[t][j] * multiplier) - block[i][3];
+                                bestPixelError = std::min(bestPixelError, delta * delta);
+                            }
+                            error += bestPixelError;
+                        }
+                        if (error < bestError) {
+                            bestBase = base;
+                            bestMultiplier = multiplier;
+                            bestTable = t;
+                            bestError = error;
+                        }
+                    }
+                }
+            }
+        }
+
+        std::uint64_t bits = (static_cast<std::uint64_t>(bestBase) << 56) | (static_cast<std::uint64_t>(bestMultiplier) << 52) | (static_cast<std::uint64_t>(bestTable) << 48);
+        for (int i = 0; i < 16; i++) {
+            int x = i % 4, y = i / 4;
+            int bestIndex = 0;
+            int bestPixelError = std::numeric_limits<int>::max();
+            for (int j = 0; j < 8; j++) {
+                int delta = Clamp255(bestBase + ALPHA_MODIFIER_TABLE[bestTable][j] * bestMultiplier) - block[i][3];
+                if (delta * delta < bestPixelError) {
+                    bestIndex = j;
+                    bestPixelError = delta * delta;
+                }
+            }
+            bits |= static_cast<std::uint64_t>(bestIndex) << (45 - 3 * (x * 4 + y));
+        }
+        return bits;
+    }
+
+    void ETC2Codec::DecompressColorBlock(std::uint64_t bits, Block& block) {
+        int flip = static_cast<int>((bits >> 32) & 1);
+        bool differential = ((bits >> 33) & 1) != 0;
+
+        int colors[2][3];
+        int tables[2] = { static_cast<int>((bits >> 37) & 7), static_cast<int>((bits >> 34) & 7) };
+        if (!differential) {
+            for (int c = 0; c < 3; c++) {
+                int shift = 56 - c * 8;
+                colors[0][c] = Expand4(static_cast<int>((bits >> (shift + 4)) & 15));
+                colors[1][c] = Expand4(static_cast<int>((bits >> shift) & 15));
+            }
+        } else {
+            int values[3], deltas[3];
+            for (int c = 0; c < 3; c++) {
+                int shift = 56 - c * 8;
+                values[c] = static_cast<int>((bits >> (shift + 3)) & 31);
+                deltas[c] = SignExtend3(static_cast<int>((bits >> shift) & 7));
+            }
+
+            int overflowChannel = -1;
+            for (int c = 0; c < 3 && overflowChannel < 0; c++) {
+                if (values[c] + deltas[c] < 0 || values[c] + deltas[c] > 31) {
+                    overflowChannel = c;
+                }
+            }
+
+            if (overflowChannel == 0 || overflowChannel == 1) {
+                // T and H modes, four paint colors derived from two base colors and a distance
+                int colors1[3], colors2[3], distance;
+                if (overflowChannel == 0) {
+                    colors1[0] = static_cast<int>((((bits >> 59) & 3) << 2) | ((bits >> 56) & 3));
+                    colors1[1] = static_cast<int>((bits >> 52) & 15);
+                    colors1[2] = static_cast<int>((bits >> 48) & 15);
+                    colors2[0] = static_cast<int>((bits >> 44) & 15);
+                    colors2[1] = static_cast<int>((bits >> 40) & 15);
+                    colors2[2] = static_cast<int>((bits >> 36) & 15);
+                    distance = DISTANCE_TABLE[(((bits >> 34) & 3) << 1) | ((bits >> 32) & 1)];
+                } else {
+                    colors1[0] = static_cast<int>((bits >> 59) & 15);
+                    colors1[1] = static_cast<int>((((bits >> 56) & 7) << 1) | ((bits >> 52) & 1));
+                    colors1[2] = static_cast<int>((((bits >> 51) & 1) << 3) | ((bits >> 47) & 7));
+                    colors2[0] = static_cast<int>((bits >> 43) & 15);
+                    colors2[1] = static_cast<int>((bits >> 39) & 15);
+                    colors2[2] = static_cast<int>((bits >> 35) & 15);
+                    int value1 = (colors1[0] << 8) | (colors1[1] << 4) | colors1[2];
+                    int value2 = (colors2[0] << 8) | (colors2[1] << 4) | colors2[2];
+                    distance = DISTANCE_TABLE[(((bits >> 34) & 1) << 2) | (((bits >> 32) & 1) << 1) | (value1 >= value2 ? 1 : 0)];
+                }
+
+                int paintColors[4][3];
+                for (int c = 0; c < 3; c++) {
+                    int color1 = Expand4(colors1[c]);
+                    int color2 = Expand4(colors2[c]);
+                    if (overflowChannel == 0) {
+                        paintColors[0][c] = color1;
+                        paintColors[1][c] = Clamp255(color2 + distance);
+                        paintColors[2][c] = color2;
+                        paintColors[3][c] = Clamp255(color2 - distance);
+                    } else {
+                        paintColors[0][c] = Clamp255(color1 + distance);
+                        paintColors[1][c] = Clamp255(color1 - distance);
+                        paintColors[2][c] = Clamp255(color2 + distance);
+                        paintColors[3][c] = Clamp255(color2 - distance);
+                    }
+                }
+
+                for (int i = 0; i < 16; i++) {
+                    int x = i % 4, y = i / 4;
+                    int bit = x * 4 + y;
+                    int index = static_cast<int>((((bits >> (16 + bit)) & 1) << 1) | ((bits >> bit) & 1));
+                    for (int c = 0; c < 3; c++) {
+                        block[i][c] = static_cast<unsigned char>(paintColors[index][c]);
+                    }
+                }
+                return;
+            }
+
+            if (overflowChannel == 2) {
+                // Planar mode, colors are interpolated from the origin, horizontal and vertical colors
+                int origin[3] = {
+                    Expand6(static_cast<int>((bits >> 57) & 63)),
+                    Expand7(static_cast<int>((((bits >> 56) & 1) << 6) | ((bits >> 49) & 63))),
+                    Expand6(static_cast<int>((((bits >> 48) & 1) << 5) | (((bits >> 43) & 3) << 3) | ((bits >> 39) & 7)))
+                };
+                int horizontal[3] = {
+                    Expand6(static_cast<int>((((bits >> 34) & 31) << 1) | ((bits >> 32) & 1))),
+                    Expand7(static_cast<int>((bits >> 25) & 127)),
+                    Expand6(static_cast<int>((bits >> 19) & 63))
+                };
+                int vertical[3] = {
+                    Expand6(static_cast<int>((bits >> 13) & 63)),
+                    Expand7(static_cast<int>((bits >> 6) & 127)),
+                    Expand6(static_cast<int>(bits & 63))
+                };
+
+                for (int i = 0; i < 16; i++) {
+                    int x = i % 4, y = i / 4;
+                    for (int c = 0; c < 3; c++) {
+                        int value = x * (horizontal[c] - origin[c]) + y * (vertical[c] - origin[c]) + 4 * origin[c] + 2;
+                        block[i][c] = static_cast<unsigned char>(Clamp255(value >= 0 ? value >> 2 : 0));
+                    }
+                }
+                return;
+            }
+
+            for (int c = 0; c < 3; c++) {
+                colors[0][c] = Expand5(values[c]);
+                colors[1][c] = Expand5(values[c] + deltas[c]);
+            }
+        }
+
+        for (int i = 0; i < 16; i++) {
+            int x = i % 4, y = i / 4;
+            int subBlock = (flip ? y : x) >= 2 ? 1 : 0;
+            int bit = x * 4 + y;
+            int index = static_cast<int>((((bits >> (16 + bit)) & 1) << 1) | ((bits >> bit) & 1));
+            int modifier = COLOR_MODIFIER_TABLE[tables[subBlock]][index & 1] * ((index & 2) ? -1 : 1);
+            for (int c = 0; c < 3; c++) {
+                block[i][c] = static_cast<unsigned char>(Clamp255(colors[subBlock][c] + modifier));
+            }
+        }
+    }
+
+    void ETC2Codec::DecompressAlphaBlock(std::uint64_t bits, Block& block) {
+        int base = static_cast<int>((bits >> 56) & 255);
+        int multiplier = static_cast<int>((bits >> 52) & 15);
+        int table = static_cast<int>((bits >> 48) & 15);
+        for (int i = 0; i < 16; i++) {
+            int x = i % 4, y = i / 4;
+            int index = static_cast<int>((bits >> (45 - 3 * (x * 4 + y))) & 7);
+            block[i][3] = static_cast<unsigned char>(Clamp255(base + ALPHA_MODIFIER_TABLE[table][index] * multiplier));
+        }
+    }
+
+    long long ETC2Codec::FitSubBlock(const Block& block, int flip, int subBlock, const int (&baseColor)[3], int& table, std::uint32_t& indices) {
+        long long bestError = std::numeric_limits<long long>::max();
+        std::uint32_t bestIndices = 0;
+        for (int t = 0; t < 8; t++) {
+            long long error = 0;
+            std::uint32_t tableIndices = 0;
+            for (int i = 0; i < 16 && error < bestError; i++) {
+                int x = i % 4, y = i / 4;
+                if (((flip ? y : x) >= 2 ? 1 : 0) != subBlock) {
+                    continue;
+                }
+
+                int bestIndex = 0;
+                int bestPixelError = std::numeric_limits<int>::max();
+                for (int index = 0; index < 4; index++) {
+                    int modifier = COLOR_MODIFIER_TABLE[t][index & 1] * ((index & 2) ? -1 : 1);
+                    int pixelError = 0;
+                    for (int c = 0; c < 3; c++) {
+                        int delta = Clamp255(baseColor[c] + modifier) - block[i][c];
+                        pixelError += delta * delta;
+                    }
+                    if (pixelError < bestPixelError) {
+                        bestIndex = index;
+                        bestPixelError = pixelError;
+                    }
+                }
+                error += bestPixelError;
+
+                int bit = x * 4 + y;
+                tableIndices |= static_cast<std::uint32_t>(bestIndex >> 1) << (16 + bit);
+                tableIndices |= static_cast<std::uint32_t>(bestIndex & 1) << bit;
+            }
+            if (error < bestError) {
+                bestError = error;
+                bestIndices = tableIndices;
+                table = t;
+            }
+        }
+        indices |= bestIndices;
+        return bestError;
+    }
+
+    const int ETC2Codec::COLOR_MODIFIER_TABLE[8][2] = {
+        { 2, 8 }, { 5, 17 }, { 9, 29 }, { 13, 42 }, { 18, 60 }, { 24, 80 }, { 33, 106 }, { 47, 183 }
+    };
+
+    const int ETC2Codec::ALPHA_MODIFIER_TABLE[16][8] = {
+        { -3, -6, -9, -15, 2, 5, 8, 14 },
+        { -3, -7, -10, -13, 2, 6, 9, 12 },
+        { -2, -5, -8, -13, 1, 4, 7, 12 },
+        { -2, -4, -6, -13, 1, 3, 5, 12 },
+        { -3, -6, -8, -12, 2, 5, 7, 11 },
+        { -3, -7, -9, -11, 2, 6, 8, 10 },
+        { -4, -7, -8, -11, 3, 6, 7, 10 },
+        { -3, -5, -8, -11, 2, 4, 7, 10 },
+        { -2, -6, -8, -10, 1, 5, 7, 9 },
+        { -2, -5, -8, -10, 1, 4, 7, 9 },
+        { -2, -4, -8, -10, 1, 3, 7, 9 },
+        { -2, -5, -7, -10, 1, 4, 6, 9 },
+        { -3, -4, -7, -10, 2, 3, 6, 9 },
+        { -1, -2, -3, -10, 0, 1, 2, 9 },
+        { -4, -6, -8, -9, 3, 5, 7, 8 },
+        { -3, -5, -7, -9, 2, 4, 6, 8 }
+    };
+
+    const int ETC2Codec::DISTANCE_TABLE[8] = { 3, 6, 11, 16, 23, 32, 41, 64 };
+
+    const unsigned char ETC2Codec::KTX_IDENTIFIER[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+}
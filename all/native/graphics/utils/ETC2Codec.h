@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2016 CartoDB. All rights reserved.
+ * Copying and using this code is allowed only according
+ * to license terms, as given in https://cartodb.com/terms/
+ */
+
+#ifndef _CARTO_ETC2CODEC_H_
+#define _CARTO_ETC2CODEC_H_
+
+#include <cstdint>
+#include <vector>
+
+namespace carto {
+
+    /**
+     * Encoder and decoder for ETC2 block compressed pixel data, the texture compression format supported by all OpenGL ES 3.0 devices.
+     * Uncompressed data is interleaved 8-bit RGBA, compressed blocks are stored in the same row order as the uncompressed data.
+     */
+    class ETC2Codec {
+    public:
+        enum class Format {
+            RGB8, // ETC2 RGB, backward compatible with ETC1. 8 bytes per 4x4 block
+            RGBA8 // ETC2 RGB with EAC alpha. 16 bytes per 4x4 block
+        };
+
+        static std::size_t GetCompressedSize(int width, int height, Format format);
+
+        static void Compress(const unsigned char* rgbaData, int width, int height, Format format, std::vector<unsigned char>& compressedData);
+        static bool Decompress(const unsigned char* compressedData, std::size_t dataSize, int width, int height, Format format, std::vector<unsigned char>& rgbaData);
+
+        static bool IsKTX(const unsigned char* data, std::size_t dataSize);
+        static bool ReadKTX(const unsigned char* data, std::size_t dataSize, Format& format, int& width, int& height, bool& topDown, const unsigned char*& compressedData, std::size_t& compressedSize);
+
+    private:
+        typedef unsigned char Block[16][4]; // pixels of a 4x4 block in row order
+
+        static std::uint64_t CompressColorBlock(const Block& block);
+        static std::uint64_t CompressAlphaBlock(const Block& block);
+        static void DecompressColorBlock(std::uint64_t bits, Block& block);
+        static void DecompressAlphaBlock(std::uint64_t bits, Block& block);
+
+        static long long FitSubBlock(const Block& block, int flip, int subBlock, const int (&baseColor)[3], int& table, std::uint32_t& indices);
+
+        static const int COLOR_MODIFIER_TABLE[8][2];
+        static const int ALPHA_MODIFIER_TABLE[16][8];
+        static const int DISTANCE_TABLE[8];
+        static const unsigned char KTX_IDENTIFIER[12];
+    };
+
+}
+
+#endif
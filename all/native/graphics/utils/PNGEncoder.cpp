@@ -0,0 +1,305 @@
+#include "PNGEncoder.h"
+#include "components/CancelableThreadPool.h"
+#include "utils/Log.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <cstring>
+
+#include <zlib.h>
+
+namespace {
+
+    const std::array<unsigned int, 256>& GetUnpremultiplyTable() {
+        // 16-bit fixed point reciprocals, c * table[a] >> 16 equals 255 * c / a for all c <= a
+        static const std::array<unsigned int, 256> table = []() {
+            std::array<unsigned int, 256> table;
+            table[0] = 0;
+            for (unsigned int a = 1; a < 256; a++) {
+                table[a] = ((255u << 16) + a - 1) / a;
+            }
+            return table;
+        }();
+        return table;
+    }
+
+    unsigned char PaethPredictor(int a, int b, int c) {
+        int p = a + b - c;
+        int pa = std::abs(p - a);
+        int pb = std::abs(p - b);
+        int pc = std::abs(p - c);
+        if (pa <= pb && pa <= pc) {
+            return static_cast<unsigned char>(a);
+        }
+        return static_cast<unsigned char>(pb <= pc ? b : c);
+    }
+
+}
+
+namespace carto {
+
+    bool PNGEncoder::Encode(const unsigned char* pixelData, int width, int height, std::ptrdiff_t stride, int bytesPerPixel, bool premultipliedAlpha, Preset preset, std::vector<unsigned char>& compressedData) {
+        static const unsigned char PNG_SIGNATURE[8] = { 0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A };
+        static const unsigned char COLOR_TYPES[5] = { 0, 0, 4, 2, 6 };
+
+        if (width <= 0 || height <= 0 || bytesPerPixel < 1 || bytesPerPixel > 4) {
+            Log::Errorf("PNGEncoder::Encode: Unsupported image format, bytes per pixel: %d", bytesPerPixel);
+            return false;
+        }
+
+        // Split the image into stripes, large enough for the deflate streams to stay efficient. Small images are encoded as a single stripe
+        std::size_t rowSize = static_cast<std::size_t>(width) * bytesPerPixel + 1;
+        int rowsPerStripe = height;
+        if (rowSize * height >= MIN_PARALLEL_SIZE) {
+            rowsPerStripe = static_cast<int>(std::max(static_cast<std::size_t>(1), MIN_STRIPE_SIZE / rowSize));
+        }
+        auto state = std::make_shared<EncodeState>(pixelData, width, stride, bytesPerPixel, premultipliedAlpha, preset);
+        std::vector<Stripe>& stripes = state->stripes;
+        stripes.resize((height + rowsPerStripe - 1) / rowsPerStripe);
+        for (std::size_t i = 0; i < stripes.size(); i++) {
+            stripes[i].firstRow = static_cast<int>(i) * rowsPerStripe;
+            stripes[i].rowCount = std::min(rowsPerStripe, height - stripes[i].firstRow);
+            stripes[i].adler = 0;
+            stripes[i].success = false;
+        }
+
+        // Let the shared pool help with the stripes, the calling thread encodes the stripes not picked up by the pool
+        if (stripes.size() > 1) {
+            std::shared_ptr<CancelableThreadPool> threadPool = GetThreadPool();
+            std::size_t taskCount = std::min(stripes.size(), static_cast<std::size_t>(MAX_THREADS)) - 1;
+            for (std::size_t i = 0; i < taskCount; i++) {
+                threadPool->execute(std::make_shared<EncodeTask>(state));
+            }
+        }
+        EncodeStripes(*state);
+        {
+            std::unique_lock<std::mutex> lock(state->mutex);
+            state->condition.wait(lock, [&state]() { return state->completedCount >= state->stripes.size(); });
+        }
+
+        compressedData.clear();
+        compressedData.insert(compressedData.end(), PNG_SIGNATURE, PNG_SIGNATURE + sizeof(PNG_SIGNATURE));
+
+        unsigned char header[13] = { 0 };
+        for (int i = 0; i < 4; i++) {
+            header[i] = static_cast<unsigned char>(static_cast<unsigned int>(width) >> (24 - i * 8));
+            header[4 + i] = static_cast<unsigned char>(static_cast<unsigned int>(height) >> (24 - i * 8));
+        }
+        header[8] = 8; // bit depth
+        header[9] = COLOR_TYPES[bytesPerPixel];
+        WriteChunk("IHDR", header, sizeof(header), compressedData);
+
+        // Each stripe is written as a separate IDAT chunk, the first one starts with the zlib header and the last one ends with the combined checksum
+        unsigned char zlibHeader[2] = { 0x78, static_cast<unsigned char>(preset == Preset::FAST ? 0x01 : preset == Preset::SMALL ? 0xDA : 0x9C) };
+        unsigned long adler = adler32(0L, Z_NULL, 0);
+        for (std::size_t i = 0; i < stripes.size(); i++) {
+            Stripe& stripe = stripes[i];
+            if (!stripe.success) {
+                Log::Error("PNGEncoder::Encode: Failed to deflate image data");
+                return false;
+            }
+            adler = adler32_combine(adler, stripe.adler, static_cast<z_off_t>(rowSize * stripe.rowCount));
+
+            if (i == 0) {
+                stripe.deflatedData.insert(stripe.deflatedData.begin(), zlibHeader, zlibHeader + sizeof(zlibHeader));
+            }
+            if (i + 1 == stripes.size()) {
+                for (int j = 0; j < 4; j++) {
+                    stripe.deflatedData.push_back(static_cast<unsigned char>(adler >> (24 - j * 8)));
+                }
+            }
+            WriteChunk("IDAT", stripe.deflatedData.data(), stripe.deflatedData.size(), compressedData);
+            std::vector<unsigned char>().swap(stripe.deflatedData);
+        }
+
+        WriteChunk("IEND", nullptr, 0, compressedData);
+        return true;
+    }
+
+    PNGEncoder::EncodeState::EncodeState(const unsigned char* pixelData, int width, std::ptrdiff_t stride, int bytesPerPixel, bool premultipliedAlpha, Preset preset) :
+        pixelData(pixelData),
+        width(width),
+        stride(stride),
+        bytesPerPixel(bytesPerPixel),
+        premultipliedAlpha(premultipliedAlpha),
+        preset(preset),
+        stripes(),
+        nextStripe(0),
+        completedCount(0),
+        condition(),
+        mutex()
+    {
+    }
+
+    PNGEncoder::EncodeTask::EncodeTask(const std::shared_ptr<EncodeState>& state) :
+        _state(state)
+    {
+    }
+
+    void PNGEncoder::EncodeTask::run() {
+        if (!isCanceled()) {
+            EncodeStripes(*_state);
+        }
+    }
+
+    std::shared_ptr<CancelableThreadPool> PNGEncoder::GetThreadPool() {
+        static std::shared_ptr<CancelableThreadPool> threadPool = []() {
+            auto threadPool = std::make_shared<CancelableThreadPool>();
+            threadPool->setPoolSize(MAX_THREADS - 1);
+            return threadPool;
+        }();
+        return threadPool;
+    }
+
+    void PNGEncoder::EncodeStripes(EncodeState& state) {
+        for (std::size_t i = state.nextStripe++; i < state.stripes.size(); i = state.nextStripe++) {
+            EncodeStripe(state.pixelData, state.width, state.stride, state.bytesPerPixel, state.premultipliedAlpha, state.preset, i + 1 == state.stripes.size(), state.stripes[i]);
+
+            std::lock_guard<std::mutex> lock(state.mutex);
+            if (++state.completedCount >= state.stripes.size()) {
+                state.condition.notify_all();
+            }
+        }
+    }
+
+    void PNGEncoder::EncodeStripe(const unsigned char* pixelData, int width, std::ptrdiff_t stride, int bytesPerPixel, bool premultipliedAlpha, Preset preset, bool lastStripe, Stripe& stripe) {
+        std::size_t rowSize = static_cast<std::size_t>(width) * bytesPerPixel;
+        bool unpremultiply = premultipliedAlpha && (bytesPerPixel == 2 || bytesPerPixel == 4);
+
+        // Filter the rows, the filters of the first row need the last row of the previous stripe. The row above the image is zero
+        std::vector<unsigned char> filteredData((rowSize + 1) * stripe.rowCount);
+        std::vector<unsigned char> rowBuffers[2];
+        std::vector<unsigned char> zeroRow(rowSize, 0);
+        std::vector<unsigned char> candidateRow(preset != Preset::FAST ? rowSize + 1 : 0);
+        const unsigned char* prevRow = zeroRow.data();
+        if (unpremultiply) {
+            rowBuffers[0].resize(rowSize);
+            rowBuffers[1].resize(rowSize);
+        }
+        for (int y = -1; y < stripe.rowCount; y++) {
+            if (stripe.firstRow + y < 0) {
+                continue;
+            }
+
+            const unsigned char* row = pixelData + (stripe.firstRow + y) * stride;
+            if (unpremultiply) {
+                unsigned char* outputRow = rowBuffers[(y + 2) % 2].data();
+                UnpremultiplyRow(row, width, bytesPerPixel, outputRow);
+                row = outputRow;
+            }
+            if (y >= 0) {
+                unsigned char* outputRow = &filteredData[(rowSize + 1) * y];
+                if (preset == Preset::FAST) {
+                    FilterRow(row, prevRow, rowSize, bytesPerPixel, 1, outputRow);
+                } else {
+                    // Choose the filter minimizing the sum of absolute differences, the heuristic used by libpng
+                    unsigned long bestSum = 0;
+                    for (int filterType = 0; filterType < 5; filterType++) {
+                        FilterRow(row, prevRow, rowSize, bytesPerPixel, filterType, candidateRow.data());
+                        unsigned long sum = 0;
+                        for (std::size_t i = 1; i <= rowSize; i++) {
+                            sum += std::abs(static_cast<int>(static_cast<signed char>(candidateRow[i])));
+                        }
+                        if (filterType == 0 || sum < bestSum) {
+                            std::copy(candidateRow.begin(), candidateRow.end(), outputRow);
+                            bestSum = sum;
+                        }
+                    }
+                }
+            }
+            prevRow = row;
+        }
+        stripe.adler = adler32(adler32(0L, Z_NULL, 0), filteredData.data(), static_cast<uInt>(filteredData.size()));
+
+        // Deflate the stripe as a raw stream. All but the last stripe are byte aligned by a sync flush, so that the streams can be concatenated
+        z_stream stream;
+        std::memset(&stream, 0, sizeof(stream));
+        int level = preset == Preset::FAST ? 1 : preset == Preset::SMALL ? 9 : 6;
+        int memLevel = preset == Preset::SMALL ? 9 : 8;
+        if (deflateInit2(&stream, level, Z_DEFLATED, -15, memLevel, preset == Preset::FAST ? Z_DEFAULT_STRATEGY : Z_FILTERED) != Z_OK) {
+            return;
+        }
+        stripe.deflatedData.resize(deflateBound(&stream, static_cast<uLong>(filteredData.size())) + 16);
+        stream.next_in = filteredData.data();
+        stream.avail_in = static_cast<uInt>(filteredData.size());
+        stream.next_out = stripe.deflatedData.data();
+        stream.avail_out = static_cast<uInt>(stripe.deflatedData.size());
+        int result = deflate(&stream, lastStripe ? Z_FINISH : Z_SYNC_FLUSH);
+        stripe.success = (lastStripe ? result == Z_STREAM_END : result == Z_OK) && stream.avail_in == 0;
+        stripe.deflatedData.resize(stream.total_out);
+        deflateEnd(&stream);
+    }
+
+    void PNGEncoder::UnpremultiplyRow(const unsigned char* row, int width, int bytesPerPixel, unsigned char* outputRow) {
+        const std::array<unsigned int, 256>& table = GetUnpremultiplyTable();
+        for (int x = 0; x < width; x++) {
+            const unsigned char* pixel = &row[x * bytesPerPixel];
+            unsigned char* outputPixel = &outputRow[x * bytesPerPixel];
+            unsigned int alpha = pixel[bytesPerPixel - 1];
+            unsigned int scale = alpha == 0 ? (1u << 16) : table[alpha]; // fully transparent pixels are kept as they are
+            for (int i = 0; i < bytesPerPixel - 1; i++) {
+                outputPixel[i] = static_cast<unsigned char>(std::min((pixel[i] * scale) >> 16, 255u));
+            }
+            outputPixel[bytesPerPixel - 1] = static_cast<unsigned char>(alpha);
+        }
+    }
+
+    void PNGEncoder::FilterRow(const unsigned char* row, const unsigned char* prevRow, std::size_t rowSize, int bytesPerPixel, int filterType, unsigned char* outputRow) {
+        std::size_t bpp = bytesPerPixel;
+        outputRow[0] = static_cast<unsigned char>(filterType);
+        unsigned char* output = outputRow + 1;
+        switch (filterType) {
+        case 1:
+            std::copy(row, row + std::min(bpp, rowSize), output);
+            for (std::size_t i = bpp; i < rowSize; i++) {
+                output[i] = static_cast<unsigned char>(row[i] - row[i - bpp]);
+            }
+            break;
+        case 2:
+            for (std::size_t i = 0; i < rowSize; i++) {
+                output[i] = static_cast<unsigned char>(row[i] - prevRow[i]);
+            }
+            break;
+        case 3:
+            for (std::size_t i = 0; i < std::min(bpp, rowSize); i++) {
+                output[i] = static_cast<unsigned char>(row[i] - (prevRow[i] >> 1));
+            }
+            for (std::size_t i = bpp; i < rowSize; i++) {
+                output[i] = static_cast<unsigned char>(row[i] - ((row[i - bpp] + prevRow[i]) >> 1));
+            }
+            break;
+        case 4:
+            for (std::size_t i = 0; i < std::min(bpp, rowSize); i++) {
+                output[i] = static_cast<unsigned char>(row[i] - prevRow[i]);
+            }
+            for (std::size_t i = bpp; i < rowSize; i++) {
+                output[i] = static_cast<unsigned char>(row[i] - PaethPredictor(row[i - bpp], prevRow[i], prevRow[i - bpp]));
+            }
+            break;
+        default:
+            std::copy(row, row + rowSize, output);
+            break;
+        }
+    }
+
+    void PNGEncoder::WriteChunk(const char* type, const unsigned char* data, std::size_t dataSize, std::vector<unsigned char>& compressedData) {
+        for (int i = 0; i < 4; i++) {
+            compressedData.push_back(static_cast<unsigned char>(dataSize >> (24 - i * 8)));
+        }
+        std::size_t offset = compressedData.size();
+        compressedData.insert(compressedData.end(), type, type + 4);
+        if (dataSize > 0) {
+            compressedData.insert(compressedData.end(), data, data + dataSize);
+        }
+        unsigned long crc = crc32(0L, &compressedData[offset], static_cast<uInt>(compressedData.size() - offset));
+        for (int i = 0; i < 4; i++) {
+            compressedData.push_back(static_cast<unsigned char>(crc >> (24 - i * 8)));
+        }
+    }
+
+    const std::size_t PNGEncoder::MIN_STRIPE_SIZE = 256 * 1024;
+    const std::size_t PNGEncoder::MIN_PARALLEL_SIZE = 1024 * 1024;
+    const unsigned int PNGEncoder::MAX_THREADS = 4;
+
+}
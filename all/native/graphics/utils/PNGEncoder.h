@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2016 CartoDB. All rights reserved.
+ * Copying and using this code is allowed only according
+ * to license terms, as given in https://cartodb.com/terms/
+ */
+
+#ifndef _CARTO_PNGENCODER_H_
+#define _CARTO_PNGENCODER_H_
+
+#include "components/CancelableTask.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace carto {
+    class CancelableThreadPool;
+
+    /**
+     * PNG encoder for 8-bit interleaved pixel data. Large images are split into horizontal stripes
+     * that are filtered and deflated in parallel, the resulting deflate streams are concatenated into a single PNG stream.
+     */
+
+    class PNGEncoder {
+    public:
+        enum class Preset {
+            FAST,    // single row filter and fastest zlib level, for on-the-fly encoding
+            DEFAULT, // adaptive row filters and default zlib level, comparable to libpng defaults
+            SMALL    // adaptive row filters and best zlib level, for offline packages
+        };
+
+        static bool Encode(const unsigned char* pixelData, int width, int height, std::ptrdiff_t stride, int bytesPerPixel, bool premultipliedAlpha, Preset preset, std::vector<unsigned char>& compressedData);
+
+    private:
+        struct Stripe {
+            int firstRow;
+            int rowCount;
+            std::vector<unsigned char> deflatedData;
+            unsigned long adler;
+            bool success;
+        };
+
+        struct EncodeState {
+            const unsigned char* pixelData;
+            int width;
+            std::ptrdiff_t stride;
+            int bytesPerPixel;
+            bool premultipliedAlpha;
+            Preset preset;
+            std::vector<Stripe> stripes;
+            std::atomic<std::size_t> nextStripe;
+            std::size_t completedCount; // guarded by mutex
+            std::condition_variable condition;
+            std::mutex mutex;
+
+            EncodeState(const unsigned char* pixelData, int width, std::ptrdiff_t stride, int bytesPerPixel, bool premultipliedAlpha, Preset preset);
+        };
+
+        class EncodeTask : public CancelableTask {
+        public:
+            explicit EncodeTask(const std::shared_ptr<EncodeState>& state);
+
+            virtual void run();
+
+        private:
+            std::shared_ptr<EncodeState> _state;
+        };
+
+        static std::shared_ptr<CancelableThreadPool> GetThreadPool();
+
+        static void EncodeStripes(EncodeState& state);
+        static void EncodeStripe(const unsigned char* pixelData, int width, std::ptrdiff_t stride, int bytesPerPixel, bool premultipliedAlpha, Preset preset, bool lastStripe, Stripe& stripe);
+
+        static void UnpremultiplyRow(const unsigned char* row, int width, int bytesPerPixel, unsigned char* outputRow);
+        static void FilterRow(const unsigned char* row, const unsigned char* prevRow, std::size_t rowSize, int bytesPerPixel, int filterType, unsigned char* outputRow);
+
+        static void WriteChunk(const char* type, const unsigned char* data, std::size_t dataSize, std::vector<unsigned char>& compressedData);
+
+        static const std::size_t MIN_STRIPE_SIZE;
+        static const std::size_t MIN_PARALLEL_SIZE;
+        static const unsigned int MAX_THREADS;
+    };
+
+}
+
+#endif
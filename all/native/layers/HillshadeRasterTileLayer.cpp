@@ -6,6 +6,7 @@
 
 #include <array>
 #include <algorithm>
+#include <cstring>
 
 #include <vt/TileId.h>
 #include <vt/Tile.h>
@@ -22,7 +23,8 @@ namespace carto {
         _contrast(0.5f),
         _heightScale(1.0f),
         _shadowColor(0, 0, 0, 255),
-        _highlightColor(255, 255, 255, 255)
+        _highlightColor(255, 255, 255, 255),
+        _heightMapBorderCache(HEIGHT_MAP_BORDER_CACHE_SIZE)
     {
     }
     
@@ -39,7 +41,7 @@ namespace carto {
             std::lock_guard<std::recursive_mutex> lock(_mutex);
             _contrast = std::min(1.0f, std::max(0.0f, contrast));
         }
-        tilesChanged(false);
+        redraw();
     }
 
     float HillshadeRasterTileLayer::getHeightScale() const {
@@ -52,7 +54,7 @@ namespace carto {
             std::lock_guard<std::recursive_mutex> lock(_mutex);
             _heightScale = heightScale;
         }
-        tilesChanged(false);
+        RasterTileLayer::tilesChanged(false); // height maps are not changed, keep the cached borders
     }
 
     Color HillshadeRasterTileLayer::getShadowColor() const {
@@ -94,6 +96,7 @@ namespace carto {
             _tileRenderer->setRasterFilterMode(getRasterFilterMode());
             _tileRenderer->setNormalMapShadowColor(getShadowColor());
             _tileRenderer->setNormalMapHighlightColor(getHighlightColor());
+            _tileRenderer->setNormalMapIntensity(getContrast());
             bool refresh = _tileRenderer->onDrawFrame(deltaSeconds, viewState);
 
             if (opacity < 1.0f) {
@@ -105,28 +108,41 @@ namespace carto {
         return false;
     }
     
-    std::shared_ptr<vt::Tile> HillshadeRasterTileLayer::createVectorTile(const MapTile& tile, const std::shared_ptr<Bitmap>& bitmap) const {
-        std::uint8_t alpha = 0;
+    void HillshadeRasterTileLayer::tilesChanged(bool removeTiles) {
+        _heightMapBorderCache.clear();
+        RasterTileLayer::tilesChanged(removeTiles);
+    }
+
+    bool HillshadeRasterTileLayer::isTileCompressionSupported() const {
+        return false; // lossy compression would distort the encoded heights
+    }
+
+    std::shared_ptr<vt::Tile> HillshadeRasterTileLayer::createVectorTile(const MapTile& tile, unsigned int width, unsigned int height, ColorFormat::ColorFormat colorFormat, std::vector<unsigned char> pixelData) const {
+        // Heights are encoded in the RGB channels, expand opaque tiles to 32-bit values
+        ConvertToRGBA(colorFormat, pixelData);
+
         std::array<float, 4> scales;
         {
             std::lock_guard<std::recursive_mutex> lock(_mutex);
-            alpha = static_cast<std::uint8_t>(_contrast * 255.0f);
             float exaggeration = tile.getZoom() < 2 ? 0.2f : tile.getZoom() < 5 ? 0.3f : 0.35f;
-            float scale = 16 * _heightScale * static_cast<float>(bitmap->getHeight() * std::pow(2.0, tile.getZoom() * (1 - exaggeration)) / 40075016.6855785);
+            float scale = 16 * _heightScale * static_cast<float>(height * std::pow(2.0, tile.getZoom() * (1 - exaggeration)) / 40075016.6855785);
             scales = std::array<float, 4> { 65536 * scale, 256 * scale, scale, 0.0f };
         }
         
-        // Build normal map from height map
+        // Build normal map from height map, padded with the borders of the neighbouring tiles.
+        // Contrast is not baked into the normal map, it is applied by the renderer.
         vt::TileId vtTileId(tile.getZoom(), tile.getX(), tile.getY());
-        std::shared_ptr<Bitmap> rgbaBitmap = bitmap->getRGBABitmap();
-        auto rgbaBitmapDataPtr = reinterpret_cast<const std::uint32_t*>(rgbaBitmap->getPixelData().data());
-        std::vector<std::uint32_t> rgbaBitmapData(rgbaBitmapDataPtr, rgbaBitmapDataPtr + rgbaBitmap->getWidth() * rgbaBitmap->getHeight());
-        auto vtBitmap = std::make_shared<vt::Bitmap>(rgbaBitmap->getWidth(), rgbaBitmap->getHeight(), std::move(rgbaBitmapData));
-        vt::NormalMapBuilder normalMapBuilder(scales, alpha);
+        auto vtBitmap = std::make_shared<vt::Bitmap>(width + 2, height + 2, _heightMapBorderCache.buildPaddedHeightMap(tile, width, height, reinterpret_cast<const std::uint32_t*>(pixelData.data())));
+        vt::NormalMapBuilder normalMapBuilder(scales, 255);
         std::shared_ptr<const vt::Bitmap> normalMap = normalMapBuilder.buildNormalMapFromHeightMap(vtTileId, vtBitmap);
-        auto normalMapDataPtr = reinterpret_cast<const std::uint8_t*>(normalMap->data.data());
-        std::vector<std::uint8_t> normalMapData(normalMapDataPtr, normalMapDataPtr + normalMap->data.size() * sizeof(std::uint32_t));
-        auto tileBitmap = std::make_shared<vt::TileBitmap>(vt::TileBitmap::Type::NORMALMAP, vt::TileBitmap::Format::RGBA, normalMap->width, normalMap->height, std::move(normalMapData));
+
+        // Drop the padding, it is only needed for calculating the normals at the tile edges
+        std::vector<std::uint8_t> normalMapData(width * height * sizeof(std::uint32_t));
+        for (unsigned int y = 0; y < height; y++) {
+            const std::uint32_t* normalMapRow = &normalMap->data[(y + 1) * normalMap->width + 1];
+            std::memcpy(&normalMapData[y * width * sizeof(std::uint32_t)], normalMapRow, width * sizeof(std::uint32_t));
+        }
+        auto tileBitmap = std::make_shared<vt::TileBitmap>(vt::TileBitmap::Type::NORMALMAP, vt::TileBitmap::Format::RGBA, width, height, std::move(normalMapData));
         
         // Build vector tile from created normal map
         float tileSize = 256.0f; // 'normalized' tile size in pixels. Not really important
@@ -138,4 +154,6 @@ namespace carto {
         return std::make_shared<vt::Tile>(vtTileId, tileSize, tileBackground, std::vector<std::shared_ptr<vt::TileLayer> > { tileLayer });
     }
 
+    const unsigned int HillshadeRasterTileLayer::HEIGHT_MAP_BORDER_CACHE_SIZE = 1024 * 1024;
+
 }
@@ -9,6 +9,7 @@
 
 #include "graphics/Color.h"
 #include "layers/RasterTileLayer.h"
+#include "layers/components/HeightMapBorderCache.h"
 
 namespace carto {
     
@@ -33,6 +34,7 @@ namespace carto {
         float getContrast() const;
         /**
          * Sets the contrast of the hillshade overlay.
+         * The contrast is applied when rendering, so changing it does not require reloading the tiles.
          * @param contrast The contrast value (between 0..1).
          */
         void setContrast(float contrast);
@@ -44,6 +46,7 @@ namespace carto {
         float getHeightScale() const;
         /**
          * Sets the height scale of the hillshade overlay.
+         * Changing the height scale causes the normal maps of the tiles to be rebuilt.
          * @param heightScale The relative height scale. Actual height is multiplied by this values.
          */
         void setHeightScale(float heightScale);
@@ -73,12 +76,21 @@ namespace carto {
     protected:
         virtual bool onDrawFrame(float deltaSeconds, BillboardSorter& billboardSorter, const ViewState& viewState);
 
-        virtual std::shared_ptr<vt::Tile> createVectorTile(const MapTile& tile, const std::shared_ptr<Bitmap>& bitmap) const;
+        virtual void tilesChanged(bool removeTiles);
+
+        virtual bool isTileCompressionSupported() const;
+
+        virtual std::shared_ptr<vt::Tile> createVectorTile(const MapTile& tile, unsigned int width, unsigned int height, ColorFormat::ColorFormat colorFormat, std::vector<unsigned char> pixelData) const;
 
         float _contrast;
         float _heightScale;
         Color _shadowColor;
         Color _highlightColor;
+
+    private:
+        static const unsigned int HEIGHT_MAP_BORDER_CACHE_SIZE;
+
+        mutable HeightMapBorderCache _heightMapBorderCache; // borders of recently decoded height maps, used as halos for neighbouring tiles
     };
     
 }
@@ -13,6 +13,8 @@
 #include "ui/NMLModelLODTreeClickInfo.h"
 #include "utils/Log.h"
 
+#include <algorithm>
+
 #include <nml/GLModel.h>
 #include <nml/GLMesh.h>
 #include <nml/GLTexture.h>
@@ -73,7 +75,8 @@ namespace carto {
         _nmlModelLODTreeEventListener(),
         _nmlModelLODTreeRenderer(std::make_shared<NMLModelLODTreeRenderer>()),
         _glResourceManager(),
-        _projectionSurface()
+        _projectionSurface(),
+        _memoryBudgetClient("NMLModelLODTreeLayer", DEFAULT_MESH_CACHE_SIZE + DEFAULT_TEXTURE_CACHE_SIZE, [this]() { return getCacheMemoryUsage(); }, [this]() { applyCacheMemoryQuota(); })
     {
         if (!dataSource) {
             throw NullArgumentException("Null dataSource");
@@ -242,6 +245,20 @@ namespace carto {
         _textureMap.clear();
         _textureCache.clear();
     }
+
+    MemoryBudgetManager::Client::Usage NMLModelLODTreeLayer::getCacheMemoryUsage() const {
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+        return MemoryBudgetManager::Client::Usage(_meshCache.size() + _textureCache.size(), 0);
+    }
+
+    void NMLModelLODTreeLayer::applyCacheMemoryQuota() {
+        // Split the quota between the caches in proportion to their default capacities. Model LOD tree cache is limited by the number of trees
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+        double scale = static_cast<double>(_memoryBudgetClient.getCacheCapacity(0)) / (DEFAULT_MESH_CACHE_SIZE + DEFAULT_TEXTURE_CACHE_SIZE);
+        _modelLODTreeCache.resize(std::max(static_cast<std::size_t>(1), static_cast<std::size_t>(DEFAULT_MODELLODTREE_CACHE_SIZE * scale)));
+        _meshCache.resize(static_cast<std::size_t>(DEFAULT_MESH_CACHE_SIZE * scale));
+        _textureCache.resize(static_cast<std::size_t>(DEFAULT_TEXTURE_CACHE_SIZE * scale));
+    }
     
     bool NMLModelLODTreeLayer::isDataAvailable(const NMLModelLODTree* modelLODTree, int nodeId) {
         return loadMeshes(modelLODTree, nodeId, true) && loadTextures(modelLODTree, nodeId, true);
@@ -256,11 +273,13 @@ namespace carto {
                 std::shared_ptr<NMLModelLODTree> modelLODTree;
                 if (_modelLODTreeCache.read(mapTile.modelLODTreeId, modelLODTree)) {
                     _modelLODTreeMap[mapTile.modelLODTreeId] = modelLODTree;
+                    _memoryBudgetClient.recordAccess(true);
                 } else {
                     if (checkOnly) {
                         return false;
                     }
                     if (!_fetchingModelLODTrees.exists(mapTile.modelLODTreeId)) {
+                        _memoryBudgetClient.recordAccess(false);
                         auto task = std::make_shared<ModelLODTreeFetchTask>(std::static_pointer_cast<NMLModelLODTreeLayer>(shared_from_this()), mapTile);
                         _fetchThreadPool->execute(task, getUpdatePriority() + MODELLODTREE_LOADING_PRIORITY_OFFSET);
                     }
@@ -284,11 +303,13 @@ namespace carto {
                 std::shared_ptr<nml::GLMesh> glMesh;
                 if (_meshCache.read(binding.meshId, glMesh)) {
                     _meshMap[binding.meshId] = glMesh;
+                    _memoryBudgetClient.recordAccess(true);
                 } else {
                     if (checkOnly) {
                         return false;
                     }
                     if (!_fetchingMeshes.exists(binding.meshId)) {
+                        _memoryBudgetClient.recordAccess(false);
                         auto task = std::make_shared<MeshFetchTask>(std::static_pointer_cast<NMLModelLODTreeLayer>(shared_from_this()), binding);
                         _fetchThreadPool->execute(task, getUpdatePriority() + MESH_LOADING_PRIORITY_OFFSET);
                     }
@@ -312,11 +333,13 @@ namespace carto {
                 std::shared_ptr<nml::GLTexture> glTexture;
                 if (_textureCache.read(binding.textureId, glTexture)) {
                     _textureMap[binding.textureId] = glTexture;
+                    _memoryBudgetClient.recordAccess(true);
                 } else {
                     if (checkOnly) {
                         return false;
                     }
                     if (!_fetchingTextures.exists(binding.textureId)) {
+                        _memoryBudgetClient.recordAccess(false);
                         auto task = std::make_shared<TextureFetchTask>(std::static_pointer_cast<NMLModelLODTreeLayer>(shared_from_this()), binding);
                         _fetchThreadPool->execute(task, getUpdatePriority() + TEXTURE_LOADING_PRIORITY_OFFSET);
                     }
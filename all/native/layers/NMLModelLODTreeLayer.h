@@ -12,6 +12,7 @@
 #include "components/CancelableTask.h"
 #include "components/CancelableThreadPool.h"
 #include "components/DirectorPtr.h"
+#include "components/MemoryBudgetManager.h"
 #include "datasources/NMLModelLODTreeDataSource.h"
 #include "graphics/ViewState.h"
 #include "layers/Layer.h"
@@ -197,6 +198,8 @@ namespace carto {
         };
     
         void clearCaches();
+        MemoryBudgetManager::Client::Usage getCacheMemoryUsage() const;
+        void applyCacheMemoryQuota();
         bool isDataAvailable(const NMLModelLODTree* modelLODTree, int nodeId);
         bool loadModelLODTrees(const MapTileList& mapTileList, bool checkOnly);
         bool loadMeshes(const NMLModelLODTree* modelLODTree, int nodeId, bool checkOnly);
@@ -245,6 +248,8 @@ namespace carto {
 
         std::weak_ptr<GLResourceManager> _glResourceManager;
         std::weak_ptr<ProjectionSurface> _projectionSurface;
+
+        MemoryBudgetManager::Client _memoryBudgetClient;
     };
     
 }
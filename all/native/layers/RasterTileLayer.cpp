@@ -75,11 +75,17 @@ namespace carto {
     RasterTileLayer::RasterTileLayer(const std::shared_ptr<TileDataSource>& dataSource) :
         TileLayer(dataSource),
         _tileFilterMode(RasterTileFilterMode::RASTER_TILE_FILTER_MODE_BILINEAR),
+        _overzoomTileSharing(false),
+        _tileCompression(false),
         _rasterTileEventListener(),
         _visibleTileIds(),
         _tempDrawDatas(),
         _visibleCache(128 * 1024 * 1024), // limit should be never reached during normal use cases
-        _preloadingCache(DEFAULT_PRELOADING_CACHE_SIZE)
+        _preloadingCache(DEFAULT_PRELOADING_CACHE_SIZE),
+        _compressedCache(DEFAULT_PRELOADING_CACHE_SIZE),
+        _sharedParentTiles(),
+        _sharedParentPruneTileId(0),
+        _memoryBudgetClient("RasterTileLayer", DEFAULT_PRELOADING_CACHE_SIZE, [this]() { return getCacheMemoryUsage(); }, [this]() { applyCacheMemoryQuota(); })
     {
         setCullDelay(DEFAULT_CULL_DELAY);
     }
@@ -88,13 +94,13 @@ namespace carto {
     }
     
     std::size_t RasterTileLayer::getTextureCacheCapacity() const {
-        std::lock_guard<std::recursive_mutex> lock(_mutex);
-        return _preloadingCache.capacity();
+        return _memoryBudgetClient.getCapacity();
     }
     
     void RasterTileLayer::setTextureCacheCapacity(std::size_t capacityInBytes) {
         std::lock_guard<std::recursive_mutex> lock(_mutex);
-        _preloadingCache.resize(capacityInBytes);
+        _memoryBudgetClient.setCapacity(capacityInBytes);
+        applyCacheMemoryQuota();
     }
     
     RasterTileFilterMode::RasterTileFilterMode RasterTileLayer::getTileFilterMode() const {
@@ -110,6 +116,27 @@ namespace carto {
         redraw();
     }
 
+    bool RasterTileLayer::isOverzoomTileSharing() const {
+        return _overzoomTileSharing.load();
+    }
+
+    void RasterTileLayer::setOverzoomTileSharing(bool enabled) {
+        _overzoomTileSharing.store(enabled);
+    }
+
+    bool RasterTileLayer::isTileCompression() const {
+        return _tileCompression.load();
+    }
+
+    void RasterTileLayer::setTileCompression(bool enabled) {
+        _tileCompression.store(enabled);
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+        if (!enabled) {
+            _compressedCache.clear();
+        }
+        applyCacheMemoryQuota();
+    }
+
     std::shared_ptr<RasterTileEventListener> RasterTileLayer::getRasterTileEventListener() const {
         return _rasterTileEventListener.get();
     }
@@ -123,11 +150,18 @@ namespace carto {
         }
     }
     
+    void RasterTileLayer::collectCachedTiles(TileCacheSnapshot& snapshot) const {
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+        snapshot.addCache(_visibleCache);
+        snapshot.addCache(_preloadingCache);
+        snapshot.addCache(_compressedCache);
+    }
+
     bool RasterTileLayer::tileExists(const MapTile& tile, bool preloadingCache) const {
         std::lock_guard<std::recursive_mutex> lock(_mutex);
         long long tileId = tile.getTileId();
         if (preloadingCache) {
-            return _preloadingCache.exists(tileId);
+            return _preloadingCache.exists(tileId) || _compressedCache.exists(tileId);
         } else {
             return _visibleCache.exists(tileId);
         }
@@ -137,7 +171,7 @@ namespace carto {
         std::lock_guard<std::recursive_mutex> lock(_mutex);
         long long tileId = tile.getTileId();
         if (preloadingCache) {
-            return _preloadingCache.exists(tileId) && _preloadingCache.valid(tileId);
+            return (_preloadingCache.exists(tileId) && _preloadingCache.valid(tileId)) || (_compressedCache.exists(tileId) && _compressedCache.valid(tileId));
         } else {
             return _visibleCache.exists(tileId) && _visibleCache.valid(tileId);
         }
@@ -149,6 +183,7 @@ namespace carto {
             return;
         }
 
+        bool cacheHit = false;
         if (!invalidated) {
             std::lock_guard<std::recursive_mutex> lock(_mutex);
             if (_preloadingCache.exists(tileId) && _preloadingCache.valid(tileId)) {
@@ -157,6 +192,7 @@ namespace carto {
                 } else {
                     _preloadingCache.get(tileId);
                 }
+                _memoryBudgetClient.recordAccess(true);
                 return;
             }
     
@@ -164,7 +200,17 @@ namespace carto {
                 _visibleCache.get(tileId); // just mark usage, do not move to preloading, it will be moved at later stage
                 return;
             }
+
+            if (_compressedCache.exists(tileId) && _compressedCache.valid(tileId)) {
+                _compressedCache.get(tileId);
+                if (preloadingTile) {
+                    _memoryBudgetClient.recordAccess(true);
+                    return;
+                }
+                cacheHit = true; // visible tile is restored by the fetch task, decompressing here would block the cull pass
+            }
         }
+        _memoryBudgetClient.recordAccess(cacheHit);
     
         auto task = std::make_shared<FetchTask>(std::static_pointer_cast<RasterTileLayer>(shared_from_this()), tile, preloadingTile);
         _fetchingTiles.add(tile.getTileId(), task);
@@ -183,9 +229,11 @@ namespace carto {
         std::lock_guard<std::recursive_mutex> lock(_mutex);
         if (preloadingTiles) {
             _preloadingCache.clear();
+            _compressedCache.clear();
         } else {
             _visibleCache.clear();
         }
+        _sharedParentTiles.clear();
     }
 
     void RasterTileLayer::tilesChanged(bool removeTiles) {
@@ -199,14 +247,22 @@ namespace carto {
             std::lock_guard<std::recursive_mutex> lock(_mutex);
             _visibleCache.clear();
             _preloadingCache.clear();
+            _compressedCache.clear();
+            _sharedParentTiles.clear();
         } else {
             std::lock_guard<std::recursive_mutex> lock(_mutex);
             _visibleCache.invalidate_all(std::chrono::steady_clock::now());
             _preloadingCache.clear();
+            _compressedCache.clear();
+            _sharedParentTiles.clear();
         }
         refresh();
     }
 
+    bool RasterTileLayer::isTileCompressionSupported() const {
+        return true;
+    }
+
     vt::RasterFilterMode RasterTileLayer::getRasterFilterMode() const {
         std::lock_guard<std::recursive_mutex> lock(_mutex);
         switch (_tileFilterMode) {
@@ -219,24 +275,23 @@ namespace carto {
         }
     }
 
-    std::shared_ptr<vt::Tile> RasterTileLayer::createVectorTile(const MapTile& tile, const std::shared_ptr<Bitmap>& bitmap) const {
-        // Build tile bitmap from the original bitmap, by doing conversion, if necessary
-        std::shared_ptr<vt::TileBitmap> tileBitmap;
-        switch (bitmap->getColorFormat()) {
+    std::shared_ptr<vt::Tile> RasterTileLayer::createVectorTile(const MapTile& tile, unsigned int width, unsigned int height, ColorFormat::ColorFormat colorFormat, std::vector<unsigned char> pixelData) const {
+        vt::TileBitmap::Format format = vt::TileBitmap::Format::RGBA;
+        switch (colorFormat) {
         case ColorFormat::COLOR_FORMAT_GRAYSCALE:
-            tileBitmap = std::make_shared<vt::TileBitmap>(vt::TileBitmap::Type::COLORMAP, vt::TileBitmap::Format::GRAYSCALE, bitmap->getWidth(), bitmap->getHeight(), bitmap->getPixelData());
+            format = vt::TileBitmap::Format::GRAYSCALE;
             break;
         case ColorFormat::COLOR_FORMAT_RGB:
-            tileBitmap = std::make_shared<vt::TileBitmap>(vt::TileBitmap::Type::COLORMAP, vt::TileBitmap::Format::RGB, bitmap->getWidth(), bitmap->getHeight(), bitmap->getPixelData());
-            break;
-        case ColorFormat::COLOR_FORMAT_RGBA:
-            tileBitmap = std::make_shared<vt::TileBitmap>(vt::TileBitmap::Type::COLORMAP, vt::TileBitmap::Format::RGBA, bitmap->getWidth(), bitmap->getHeight(), bitmap->getPixelData());
+            format = vt::TileBitmap::Format::RGB;
             break;
         default:
-            tileBitmap = std::make_shared<vt::TileBitmap>(vt::TileBitmap::Type::COLORMAP, vt::TileBitmap::Format::RGBA, bitmap->getWidth(), bitmap->getHeight(), bitmap->getRGBABitmap()->getPixelData());
+            ConvertToRGBA(colorFormat, pixelData);
             break;
         }
 
+        // Tile bitmap adopts the decoded pixel data, no copy is made
+        auto tileBitmap = std::make_shared<vt::TileBitmap>(vt::TileBitmap::Type::COLORMAP, format, width, height, std::move(pixelData));
+
         // Build actual vector tile using created colormap
         float tileSize = 256.0f; // 'normalized' tile size in pixels. Not really important
         vt::TileId vtTile(tile.getZoom(), tile.getX(), tile.getY());
@@ -248,6 +303,39 @@ namespace carto {
         return std::make_shared<vt::Tile>(vtTile, tileSize, tileBackground, std::vector<std::shared_ptr<vt::TileLayer> > { tileLayer });
     }
 
+    unsigned int RasterTileLayer::GetBytesPerPixel(ColorFormat::ColorFormat colorFormat) {
+        switch (colorFormat) {
+        case ColorFormat::COLOR_FORMAT_GRAYSCALE:
+            return 1;
+        case ColorFormat::COLOR_FORMAT_RGB:
+            return 3;
+        default:
+            return 4;
+        }
+    }
+
+    void RasterTileLayer::ConvertToRGBA(ColorFormat::ColorFormat colorFormat, std::vector<unsigned char>& pixelData) {
+        unsigned int bytesPerPixel = GetBytesPerPixel(colorFormat);
+        if (bytesPerPixel == 4) {
+            return;
+        }
+
+        // Expand in place, starting from the last pixel
+        std::size_t pixelCount = pixelData.size() / bytesPerPixel;
+        pixelData.resize(pixelCount * 4);
+        for (std::size_t i = pixelCount; i-- > 0; ) {
+            const unsigned char* src = &pixelData[i * bytesPerPixel];
+            unsigned char r = src[0];
+            unsigned char g = src[bytesPerPixel == 3 ? 1 : 0];
+            unsigned char b = src[bytesPerPixel == 3 ? 2 : 0];
+            unsigned char* dst = &pixelData[i * 4];
+            dst[0] = r;
+            dst[1] = g;
+            dst[2] = b;
+            dst[3] = 255;
+        }
+    }
+
     void RasterTileLayer::calculateDrawData(const MapTile& visTile, const MapTile& closestTile, bool preloadingTile) {
         std::lock_guard<std::recursive_mutex> lock(_mutex);
 
@@ -257,6 +345,10 @@ namespace carto {
         if (!vtTile) {
             _preloadingCache.read(closestTileId, vtTile);
         }
+        if (!vtTile && !preloadingTile && _compressedCache.exists(closestTileId)) {
+            // Restore the tile in the background, it will be drawn once the fetch task has finished
+            fetchTile(closestTile, false, false);
+        }
         if (vtTile) {
             vt::TileId vtTileId(visTile.getZoom(), visTile.getX(), visTile.getY());
             if (closestTile.getZoom() > visTile.getZoom()) {
@@ -288,10 +380,17 @@ namespace carto {
                 }
             }
             
-            // Move all unused tiles from visible cache to preloading cache
+            // Move all unused tiles from visible cache to preloading cache. Tiles with compressed copies can be simply dropped
             for (long long tileId : lastVisibleCacheTiles) {
-                _visibleCache.move(tileId, _preloadingCache);
+                if (_compressedCache.exists(tileId)) {
+                    _visibleCache.remove(tileId);
+                } else {
+                    _visibleCache.move(tileId, _preloadingCache);
+                }
             }
+
+            // Visible tiles use the same memory quota, so the capacities of the other caches depend on them
+            applyCacheMemoryQuota();
         }
         
         // Update renderer if needed, run culler
@@ -434,6 +533,11 @@ namespace carto {
     
     bool RasterTileLayer::FetchTask::loadTile(const std::shared_ptr<TileLayer>& tileLayer) {
         auto layer = std::static_pointer_cast<RasterTileLayer>(tileLayer);
+
+        // Visible tiles that are cached in compressed form only need to be decompressed
+        if (!isPreloading() && restoreCompressedTile(layer)) {
+            return true;
+        }
     
         bool refresh = false;
         for (const MapTile& dataSourceTile : _dataSourceTiles) {
@@ -448,60 +552,269 @@ namespace carto {
                 break;
             }
     
-            // Save tile to texture cache, unless invalidated
-            vt::TileId vtTile(_tile.getZoom(), _tile.getX(), _tile.getY());
-            vt::TileId vtDataSourceTile(dataSourceTile.getZoom(), dataSourceTile.getX(), dataSourceTile.getY());
-            std::shared_ptr<Bitmap> bitmap = Bitmap::CreateFromCompressed(tileData->getData());
-            if (bitmap) {
-                // Check if we received the requested tile or extract/scale the corresponding part
-                if (dataSourceTile != _tile) {
-                    bitmap = ExtractSubTile(_tile, dataSourceTile, bitmap);
-                }
-                std::shared_ptr<vt::TileTransformer> tileTransformer = layer->getTileTransformer();
-                std::shared_ptr<vt::Tile> vtTile = layer->createVectorTile(_tile, bitmap);
-                std::size_t vtTileSize = EXTRA_TILE_FOOTPRINT + vtTile->getResidentSize();
-
-                if (!isInvalidated()) {
-                    // Build the bitmap object
-                    std::lock_guard<std::recursive_mutex> lock(layer->_mutex);
-                    if (layer->getTileTransformer() == tileTransformer) { // extra check that the tile is created with correct transformer. Otherwise simply drop it.
-                        if (isPreloading()) {
-                            layer->_preloadingCache.put(_tile.getTileId(), vtTile, vtTileSize);
-                            if (tileData->getMaxAge() >= 0) {
-                                layer->_preloadingCache.invalidate(_tile.getTileId(), std::chrono::steady_clock::now() + std::chrono::milliseconds(tileData->getMaxAge()));
-                            }
-                        } else {
-                            layer->_visibleCache.put(_tile.getTileId(), vtTile, vtTileSize);
-                            if (tileData->getMaxAge() >= 0) {
-                                layer->_visibleCache.invalidate(_tile.getTileId(), std::chrono::steady_clock::now() + std::chrono::milliseconds(tileData->getMaxAge()));
-                            }
-                        }
+            std::shared_ptr<vt::TileTransformer> tileTransformer = layer->getTileTransformer();
+            std::shared_ptr<const vt::Tile> vtTile;
+            std::size_t vtTileSize = 0;
+            std::shared_ptr<CompressedTile> compressedTile;
+            bool sharedParentTile = false;
+            if (dataSourceTile != _tile && layer->isOverzoomTileSharing()) {
+                // Reference the parent tile directly, the renderer draws only the part of it corresponding to this tile
+                vtTile = layer->findSharedParentTile(dataSourceTile);
+                if (vtTile) {
+                    // The parent bitmap is already charged to the subtile that decoded it
+                    vtTileSize = EXTRA_TILE_FOOTPRINT;
+                } else {
+                    vtTile = createTile(layer, dataSourceTile, dataSourceTile, tileData->getData());
+                    sharedParentTile = tileData->getMaxAge() < 0;
+                    if (vtTile) {
+                        vtTileSize = EXTRA_TILE_FOOTPRINT + vtTile->getResidentSize();
                     }
                 }
-                refresh = true; // NOTE: need to refresh even when invalidated
+            } else if (layer->isTileCompression() && layer->isTileCompressionSupported()) {
+                // Keep the compressed tile in the cache, preloaded tiles are restored from it once they become visible
+                compressedTile = createCompressedTile(layer, _tile, dataSourceTile, tileData->getData(), isPreloading() ? nullptr : &vtTile);
+                if (compressedTile && tileData->getMaxAge() >= 0) {
+                    compressedTile->expirationTime = std::chrono::steady_clock::now() + std::chrono::milliseconds(tileData->getMaxAge());
+                }
+                if (vtTile) {
+                    vtTileSize = EXTRA_TILE_FOOTPRINT + vtTile->getResidentSize();
+                }
             } else {
+                vtTile = createTile(layer, _tile, dataSourceTile, tileData->getData());
+                if (vtTile) {
+                    vtTileSize = EXTRA_TILE_FOOTPRINT + vtTile->getResidentSize();
+                }
+            }
+            if (!vtTile && !compressedTile) {
                 Log::Error("RasterTileLayer::FetchTask: Failed to decode tile");
+                break;
+            }
+
+            // Save tile to texture cache, unless invalidated
+            if (!isInvalidated()) {
+                std::lock_guard<std::recursive_mutex> lock(layer->_mutex);
+                if (layer->getTileTransformer() == tileTransformer) { // extra check that the tile is created with correct transformer. Otherwise simply drop it.
+                    if (compressedTile) {
+                        layer->_compressedCache.put(_tile.getTileId(), compressedTile, EXTRA_COMPRESSED_TILE_FOOTPRINT + compressedTile->data.size());
+                        if (tileData->getMaxAge() >= 0) {
+                            layer->_compressedCache.invalidate(_tile.getTileId(), compressedTile->expirationTime);
+                        }
+                    }
+                    if (!vtTile) {
+                        // Preloaded tile is cached only in compressed form
+                    } else if (isPreloading()) {
+                        layer->_preloadingCache.put(_tile.getTileId(), vtTile, vtTileSize);
+                        if (tileData->getMaxAge() >= 0) {
+                            layer->_preloadingCache.invalidate(_tile.getTileId(), std::chrono::steady_clock::now() + std::chrono::milliseconds(tileData->getMaxAge()));
+                        }
+                    } else {
+                        layer->_visibleCache.put(_tile.getTileId(), vtTile, vtTileSize);
+                        if (tileData->getMaxAge() >= 0) {
+                            layer->_visibleCache.invalidate(_tile.getTileId(), std::chrono::steady_clock::now() + std::chrono::milliseconds(tileData->getMaxAge()));
+                        }
+                    }
+                    if (sharedParentTile) {
+                        layer->addSharedParentTile(dataSourceTile, vtTile);
+                    }
+                }
             }
+            refresh = true; // NOTE: need to refresh even when invalidated
             break;
         }
         
         return refresh;
     }
     
-    std::shared_ptr<Bitmap> RasterTileLayer::FetchTask::ExtractSubTile(const MapTile& subTile, const MapTile& tile, const std::shared_ptr<Bitmap>& bitmap) {
+    bool RasterTileLayer::FetchTask::decodeTile(const std::shared_ptr<RasterTileLayer>& layer, const MapTile& tile, const MapTile& dataSourceTile, const std::shared_ptr<BinaryData>& data, std::vector<unsigned char>& pixelData, unsigned int& width, unsigned int& height, ColorFormat::ColorFormat& colorFormat) {
+        if (!Bitmap::DecodePixels(data->data(), data->size(), pixelData, width, height, colorFormat)) {
+            Bitmap::RecycleDecodeBuffer(pixelData);
+            return false;
+        }
+
+        // Check if we received the requested tile or extract/scale the corresponding part
+        if (dataSourceTile != tile) {
+            BitmapResampler::Filter filter = BitmapResampler::Filter::BOX;
+            {
+                std::lock_guard<std::recursive_mutex> lock(layer->_mutex);
+                if (layer->_tileFilterMode == RasterTileFilterMode::RASTER_TILE_FILTER_MODE_BICUBIC) {
+                    filter = BitmapResampler::Filter::LANCZOS3;
+                }
+            }
+            std::vector<unsigned char> subPixelData = Bitmap::AcquireDecodeBuffer();
+            ExtractSubTile(tile, dataSourceTile, pixelData, width, height, GetBytesPerPixel(colorFormat), filter, subPixelData);
+            std::swap(pixelData, subPixelData);
+            Bitmap::RecycleDecodeBuffer(subPixelData); // the parent tile pixels are not needed anymore
+        }
+        return true;
+    }
+
+    std::shared_ptr<const vt::Tile> RasterTileLayer::FetchTask::createTile(const std::shared_ptr<RasterTileLayer>& layer, const MapTile& tile, const MapTile& dataSourceTile, const std::shared_ptr<BinaryData>& data) {
+        std::vector<unsigned char> pixelData;
+        unsigned int width = 0;
+        unsigned int height = 0;
+        ColorFormat::ColorFormat colorFormat = ColorFormat::COLOR_FORMAT_RGBA;
+        if (!decodeTile(layer, tile, dataSourceTile, data, pixelData, width, height, colorFormat)) {
+            return std::shared_ptr<const vt::Tile>();
+        }
+        return layer->createVectorTile(tile, width, height, colorFormat, std::move(pixelData));
+    }
+
+    std::shared_ptr<RasterTileLayer::CompressedTile> RasterTileLayer::FetchTask::createCompressedTile(const std::shared_ptr<RasterTileLayer>& layer, const MapTile& tile, const MapTile& dataSourceTile, const std::shared_ptr<BinaryData>& data, std::shared_ptr<const vt::Tile>* vtTile) {
+        auto compressedTile = std::make_shared<CompressedTile>();
+
+        // Pass through ETC1/ETC2 tiles served by the data source, as long as no subtile has to be extracted
+        if (dataSourceTile == tile && ETC2Codec::IsKTX(data->data(), data->size())) {
+            int width = 0, height = 0;
+            const unsigned char* blockData = nullptr;
+            std::size_t blockDataSize = 0;
+            if (ETC2Codec::ReadKTX(data->data(), data->size(), compressedTile->format, width, height, compressedTile->topDown, blockData, blockDataSize)) {
+                compressedTile->width = width;
+                compressedTile->height = height;
+                compressedTile->data.assign(blockData, blockData + ETC2Codec::GetCompressedSize(width, height, compressedTile->format));
+                if (vtTile) {
+                    *vtTile = layer->decompressTile(tile, *compressedTile);
+                }
+                return compressedTile;
+            }
+        }
+
+        std::vector<unsigned char> pixelData;
+        unsigned int width = 0;
+        unsigned int height = 0;
+        ColorFormat::ColorFormat colorFormat = ColorFormat::COLOR_FORMAT_RGBA;
+        if (!decodeTile(layer, tile, dataSourceTile, data, pixelData, width, height, colorFormat)) {
+            return std::shared_ptr<CompressedTile>();
+        }
+        compressedTile->width = width;
+        compressedTile->height = height;
+        if (colorFormat == ColorFormat::COLOR_FORMAT_RGBA) {
+            ETC2Codec::Compress(pixelData.data(), width, height, compressedTile->format, compressedTile->data);
+        } else {
+            // The codec needs RGBA input, keep the opaque pixels in their original format for the tile bitmap
+            std::vector<unsigned char> rgbaPixelData = Bitmap::AcquireDecodeBuffer();
+            rgbaPixelData.assign(pixelData.begin(), pixelData.end());
+            ConvertToRGBA(colorFormat, rgbaPixelData);
+            ETC2Codec::Compress(rgbaPixelData.data(), width, height, compressedTile->format, compressedTile->data);
+            Bitmap::RecycleDecodeBuffer(rgbaPixelData);
+        }
+        if (vtTile) {
+            *vtTile = layer->createVectorTile(tile, width, height, colorFormat, std::move(pixelData));
+        } else {
+            Bitmap::RecycleDecodeBuffer(pixelData);
+        }
+        return compressedTile;
+    }
+
+    bool RasterTileLayer::FetchTask::restoreCompressedTile(const std::shared_ptr<RasterTileLayer>& layer) {
+        long long tileId = _tile.getTileId();
+        std::shared_ptr<const CompressedTile> compressedTile;
+        {
+            std::lock_guard<std::recursive_mutex> lock(layer->_mutex);
+            if (!layer->_compressedCache.exists(tileId) || !layer->_compressedCache.valid(tileId)) {
+                return false;
+            }
+            layer->_compressedCache.read(tileId, compressedTile);
+        }
+
+        std::shared_ptr<vt::TileTransformer> tileTransformer = layer->getTileTransformer();
+        std::shared_ptr<const vt::Tile> vtTile = layer->decompressTile(_tile, *compressedTile);
+
+        std::lock_guard<std::recursive_mutex> lock(layer->_mutex);
+        if (!vtTile) {
+            Log::Error("RasterTileLayer::FetchTask: Failed to decompress tile");
+            layer->_compressedCache.remove(tileId);
+            return false;
+        }
+        if (!isInvalidated() && layer->getTileTransformer() == tileTransformer) {
+            layer->_visibleCache.put(tileId, vtTile, EXTRA_TILE_FOOTPRINT + vtTile->getResidentSize());
+            if (compressedTile->expirationTime != std::chrono::steady_clock::time_point::max()) {
+                layer->_visibleCache.invalidate(tileId, compressedTile->expirationTime);
+            }
+        }
+        return true;
+    }
+
+    void RasterTileLayer::FetchTask::ExtractSubTile(const MapTile& subTile, const MapTile& tile, const std::vector<unsigned char>& pixelData, unsigned int width, unsigned int height, unsigned int bytesPerPixel, BitmapResampler::Filter filter, std::vector<unsigned char>& subPixelData) {
         int deltaZoom = subTile.getZoom() - tile.getZoom();
-        int x = (bitmap->getWidth()  * (subTile.getX() & ((1 << deltaZoom) - 1))) >> deltaZoom;
-        int y = (bitmap->getHeight() * (subTile.getY() & ((1 << deltaZoom) - 1))) >> deltaZoom;
-        int w = bitmap->getWidth()  >> deltaZoom;
-        int h = bitmap->getHeight() >> deltaZoom;
-        std::shared_ptr<Bitmap> subBitmap = bitmap->getSubBitmap(x, y, std::max(w, 1), std::max(h, 1));
-        return subBitmap->getResizedBitmap(bitmap->getWidth(), bitmap->getHeight());
+        int x = (width  * (subTile.getX() & ((1 << deltaZoom) - 1))) >> deltaZoom;
+        int y = (height * (subTile.getY() & ((1 << deltaZoom) - 1))) >> deltaZoom;
+        int w = std::max(static_cast<int>(width  >> deltaZoom), 1);
+        int h = std::max(static_cast<int>(height >> deltaZoom), 1);
+
+        // Resample the sub-rectangle directly from the parent tile. Rows are stored bottom-up, so the first row is at the bottom of the sub-rectangle.
+        const unsigned char* subData = &pixelData[((height - h - y) * width + x) * bytesPerPixel];
+        subPixelData.resize(width * height * bytesPerPixel);
+        BitmapResampler::Resample(subData, w, h, width * bytesPerPixel, bytesPerPixel, subPixelData.data(), width, height, filter);
+    }
+
+    std::shared_ptr<const vt::Tile> RasterTileLayer::findSharedParentTile(const MapTile& parentTile) const {
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+        auto it = _sharedParentTiles.find(parentTile.getTileId());
+        if (it == _sharedParentTiles.end()) {
+            return std::shared_ptr<const vt::Tile>();
+        }
+        return it->second.lock();
+    }
+
+    void RasterTileLayer::addSharedParentTile(const MapTile& parentTile, const std::shared_ptr<const vt::Tile>& vtTile) {
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+        // Drop the parents whose subtiles have all been evicted from the caches. Only a bounded batch
+        // is checked per call, continuing from where the previous call stopped.
+        auto it = _sharedParentTiles.lower_bound(_sharedParentPruneTileId);
+        for (unsigned int i = 0; i < SHARED_PARENT_PRUNE_BATCH_SIZE && !_sharedParentTiles.empty(); i++) {
+            if (it == _sharedParentTiles.end()) {
+                it = _sharedParentTiles.begin();
+            }
+            if (it->second.expired()) {
+                it = _sharedParentTiles.erase(it);
+            } else {
+                it++;
+            }
+        }
+        _sharedParentPruneTileId = (it != _sharedParentTiles.end() ? it->first : 0);
+        _sharedParentTiles[parentTile.getTileId()] = vtTile;
+    }
+
+    MemoryBudgetManager::Client::Usage RasterTileLayer::getCacheMemoryUsage() const {
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+        return MemoryBudgetManager::Client::Usage(_visibleCache.size() + _preloadingCache.size() + _compressedCache.size(), _visibleCache.size());
+    }
+
+    void RasterTileLayer::applyCacheMemoryQuota() {
+        // The quota covers visible tiles, too. Visible tiles are never released, preloading and compressed caches share the rest.
+        // Without compression, the compressed cache is unused.
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+        std::size_t capacity = _memoryBudgetClient.getCacheCapacity(_visibleCache.size());
+        if (isTileCompression()) {
+            _preloadingCache.resize(capacity / 2);
+            _compressedCache.resize(capacity - capacity / 2);
+        } else {
+            _preloadingCache.resize(capacity);
+            _compressedCache.resize(0);
+        }
+    }
+
+    std::shared_ptr<const vt::Tile> RasterTileLayer::decompressTile(const MapTile& tile, const CompressedTile& compressedTile) const {
+        std::vector<unsigned char> pixelData = Bitmap::AcquireDecodeBuffer();
+        if (!ETC2Codec::Decompress(compressedTile.data.data(), compressedTile.data.size(), compressedTile.width, compressedTile.height, compressedTile.format, pixelData)) {
+            Bitmap::RecycleDecodeBuffer(pixelData);
+            return std::shared_ptr<const vt::Tile>();
+        }
+        if (compressedTile.topDown) {
+            unsigned int bytesPerRow = compressedTile.width * 4;
+            for (unsigned int y = 0; y < compressedTile.height / 2; y++) {
+                std::swap_ranges(&pixelData[y * bytesPerRow], &pixelData[(y + 1) * bytesPerRow], &pixelData[(compressedTile.height - 1 - y) * bytesPerRow]);
+            }
+        }
+        return createVectorTile(tile, compressedTile.width, compressedTile.height, ColorFormat::COLOR_FORMAT_RGBA, std::move(pixelData));
     }
 
     const int RasterTileLayer::DEFAULT_CULL_DELAY = 200;
     const int RasterTileLayer::PRELOADING_PRIORITY_OFFSET = -2;
 
     const unsigned int RasterTileLayer::EXTRA_TILE_FOOTPRINT = 4096;
+    const unsigned int RasterTileLayer::SHARED_PARENT_PRUNE_BATCH_SIZE = 8;
+    const unsigned int RasterTileLayer::EXTRA_COMPRESSED_TILE_FOOTPRINT = 256;
     const unsigned int RasterTileLayer::DEFAULT_PRELOADING_CACHE_SIZE = 10 * 1024 * 1024;
 
 }
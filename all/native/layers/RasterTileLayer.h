@@ -10,10 +10,15 @@
 #include "core/MapTile.h"
 #include "components/CancelableTask.h"
 #include "components/DirectorPtr.h"
+#include "components/MemoryBudgetManager.h"
 #include "components/Task.h"
+#include "graphics/Bitmap.h"
+#include "graphics/utils/BitmapResampler.h"
+#include "graphics/utils/ETC2Codec.h"
 #include "layers/TileLayer.h"
 
 #include <atomic>
+#include <chrono>
 #include <memory>
 #include <map>
 
@@ -22,6 +27,7 @@
 #include <vt/Styles.h>
 
 namespace carto {
+    class BinaryData;
     class TileDrawData;
     class RasterTileEventListener;
     namespace vt {
@@ -75,6 +81,7 @@ namespace carto {
          * whether or not preloading is enabled.
          * The default is 10MB, which should be enough for most use cases with preloading enabled. If preloading is
          * disabled, the cache size should be reduced by the user to conserve memory.
+         * If a global memory budget is set, the cache may use less memory than its capacity.
          * @param capacityInBytes The new tile bitmap cache capacity in bytes.
          */
         void setTextureCacheCapacity(std::size_t capacityInBytes);
@@ -86,10 +93,44 @@ namespace carto {
         RasterTileFilterMode::RasterTileFilterMode getTileFilterMode() const;
         /**
          * Sets the current tile filter mode.
+         * The filter mode also affects how overzoomed tiles are upsampled from their parent tiles. Bicubic mode uses
+         * a sharper Lanczos filter for this, which is applied to tiles loaded after the change.
          * @param filterMode The new tile filter mode.
          */
         void setTileFilterMode(RasterTileFilterMode::RasterTileFilterMode filterMode);
 
+        /**
+         * Returns the state of the overzoom tile sharing flag.
+         * @return The state of the overzoom tile sharing flag.
+         */
+        bool isOverzoomTileSharing() const;
+        /**
+         * Sets the state of the overzoom tile sharing flag. If enabled, tiles that are not available at the requested zoom level
+         * reference the decoded bitmap of their parent tile instead of storing an upsampled copy of the corresponding part.
+         * All such tiles share a single texture and each of them is charged only for its part of the parent bitmap in the texture cache.
+         * This considerably reduces memory usage when the map is zoomed far beyond the maximum zoom level of the data source,
+         * but tile filter modes other than nearest and bilinear are not applied to the shared parent tiles.
+         * The change affects tiles loaded after the change. The default is false.
+         * @param enabled The new state of the overzoom tile sharing flag.
+         */
+        void setOverzoomTileSharing(bool enabled);
+
+        /**
+         * Returns the state of the tile compression flag.
+         * @return The state of the tile compression flag.
+         */
+        bool isTileCompression() const;
+        /**
+         * Sets the state of the tile compression flag. If enabled, loaded tiles are kept in the texture cache in ETC2 compressed form,
+         * taking 1 byte per pixel instead of 4 bytes, and only the tiles that are currently visible are kept uncompressed.
+         * This allows to cache about 4 times more tiles within the same texture cache capacity, at the cost of additional CPU time
+         * for compressing the loaded tiles and minor loss of image quality. Tiles served by the data source in KTX format with ETC1/ETC2 data are
+         * cached directly without recompression.
+         * The change affects tiles loaded after the change. The default is false.
+         * @param enabled The new state of the tile compression flag.
+         */
+        void setTileCompression(bool enabled);
+
         /**
          * Returns the raster tile event listener.
          * @return The raster tile event listener.
@@ -102,6 +143,17 @@ namespace carto {
         void setRasterTileEventListener(const std::shared_ptr<RasterTileEventListener>& eventListener);
     
     protected:
+        struct CompressedTile {
+            unsigned int width;
+            unsigned int height;
+            ETC2Codec::Format format;
+            bool topDown; // rows are stored top-down, as in KTX files
+            std::vector<unsigned char> data;
+            std::chrono::steady_clock::time_point expirationTime;
+
+            CompressedTile() : width(0), height(0), format(ETC2Codec::Format::RGBA8), topDown(false), data(), expirationTime(std::chrono::steady_clock::time_point::max()) { }
+        };
+
         class FetchTask : public TileLayer::FetchTaskBase {
         public:
             FetchTask(const std::shared_ptr<RasterTileLayer>& layer, const MapTile& tile, bool preloadingTile);
@@ -110,18 +162,30 @@ namespace carto {
             bool loadTile(const std::shared_ptr<TileLayer>& tileLayer);
             
         private:
-            static std::shared_ptr<Bitmap> ExtractSubTile(const MapTile& subTile, const MapTile& tile, const std::shared_ptr<Bitmap>& bitmap);
+            bool restoreCompressedTile(const std::shared_ptr<RasterTileLayer>& layer);
+
+            static bool decodeTile(const std::shared_ptr<RasterTileLayer>& layer, const MapTile& tile, const MapTile& dataSourceTile, const std::shared_ptr<BinaryData>& data, std::vector<unsigned char>& pixelData, unsigned int& width, unsigned int& height, ColorFormat::ColorFormat& colorFormat);
+            static std::shared_ptr<const vt::Tile> createTile(const std::shared_ptr<RasterTileLayer>& layer, const MapTile& tile, const MapTile& dataSourceTile, const std::shared_ptr<BinaryData>& data);
+            static std::shared_ptr<CompressedTile> createCompressedTile(const std::shared_ptr<RasterTileLayer>& layer, const MapTile& tile, const MapTile& dataSourceTile, const std::shared_ptr<BinaryData>& data, std::shared_ptr<const vt::Tile>* vtTile);
+
+            static void ExtractSubTile(const MapTile& subTile, const MapTile& tile, const std::vector<unsigned char>& pixelData, unsigned int width, unsigned int height, unsigned int bytesPerPixel, BitmapResampler::Filter filter, std::vector<unsigned char>& subPixelData);
         };
     
+        virtual void collectCachedTiles(TileCacheSnapshot& snapshot) const;
         virtual bool tileExists(const MapTile& mapTile, bool preloadingCache) const;
         virtual bool tileValid(const MapTile& mapTile, bool preloadingCache) const;
         virtual void fetchTile(const MapTile& mapTile, bool preloadingTile, bool invalidated);
         virtual void clearTiles(bool preloadingTiles);
         virtual void tilesChanged(bool removeTiles);
 
+        virtual bool isTileCompressionSupported() const;
+
         virtual vt::RasterFilterMode getRasterFilterMode() const;
 
-        virtual std::shared_ptr<vt::Tile> createVectorTile(const MapTile& tile, const std::shared_ptr<Bitmap>& bitmap) const;
+        virtual std::shared_ptr<vt::Tile> createVectorTile(const MapTile& tile, unsigned int width, unsigned int height, ColorFormat::ColorFormat colorFormat, std::vector<unsigned char> pixelData) const;
+
+        static unsigned int GetBytesPerPixel(ColorFormat::ColorFormat colorFormat);
+        static void ConvertToRGBA(ColorFormat::ColorFormat colorFormat, std::vector<unsigned char>& pixelData);
 
         virtual void calculateDrawData(const MapTile& visTile, const MapTile& closestTile, bool preloadingTile);
         virtual void refreshDrawData(const std::shared_ptr<CullState>& cullState);
@@ -144,12 +208,24 @@ namespace carto {
         RasterTileFilterMode::RasterTileFilterMode _tileFilterMode;
 
     private:    
+        std::shared_ptr<const vt::Tile> findSharedParentTile(const MapTile& parentTile) const;
+        void addSharedParentTile(const MapTile& parentTile, const std::shared_ptr<const vt::Tile>& vtTile);
+
+        MemoryBudgetManager::Client::Usage getCacheMemoryUsage() const;
+        void applyCacheMemoryQuota();
+
+        std::shared_ptr<const vt::Tile> decompressTile(const MapTile& tile, const CompressedTile& compressedTile) const;
+
         static const int DEFAULT_CULL_DELAY;
         static const int PRELOADING_PRIORITY_OFFSET;
 
         static const unsigned int EXTRA_TILE_FOOTPRINT;
+        static const unsigned int SHARED_PARENT_PRUNE_BATCH_SIZE;
+        static const unsigned int EXTRA_COMPRESSED_TILE_FOOTPRINT;
         static const unsigned int DEFAULT_PRELOADING_CACHE_SIZE;
         
+        std::atomic<bool> _overzoomTileSharing;
+        std::atomic<bool> _tileCompression;
         ThreadSafeDirectorPtr<RasterTileEventListener> _rasterTileEventListener;
 
         std::vector<long long> _visibleTileIds;
@@ -157,6 +233,11 @@ namespace carto {
         
         cache::timed_lru_cache<long long, std::shared_ptr<const vt::Tile> > _visibleCache;
         cache::timed_lru_cache<long long, std::shared_ptr<const vt::Tile> > _preloadingCache;
+        cache::timed_lru_cache<long long, std::shared_ptr<const CompressedTile> > _compressedCache;
+        std::map<long long, std::weak_ptr<const vt::Tile> > _sharedParentTiles; // parent tiles referenced by overzoomed tiles, keyed by parent tile id
+        long long _sharedParentPruneTileId; // tile id where the next batch of expired parent tiles is pruned
+
+        MemoryBudgetManager::Client _memoryBudgetClient;
     };
     
 }
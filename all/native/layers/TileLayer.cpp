@@ -19,6 +19,9 @@
 #include "utils/TileUtils.h"
 #include "utils/Log.h"
 
+#include <algorithm>
+#include <limits>
+
 #include <vt/TileTransformer.h>
 
 namespace carto {
@@ -36,6 +39,9 @@ namespace carto {
     
     void TileLayer::setUTFGridDataSource(const std::shared_ptr<TileDataSource>& dataSource) {
         _utfGridDataSource.set(dataSource);
+
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+        _utfGridTileCache.clear();
     }
 
     int TileLayer::getFrameNr() const {
@@ -86,6 +92,32 @@ namespace carto {
         refresh();
     }
         
+    TileSelectionMode::TileSelectionMode TileLayer::getTileSelectionMode() const {
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+        return _selectionMode;
+    }
+
+    void TileLayer::setTileSelectionMode(TileSelectionMode::TileSelectionMode mode) {
+        {
+            std::lock_guard<std::recursive_mutex> lock(_mutex);
+            _selectionMode = mode;
+        }
+        refresh();
+    }
+
+    int TileLayer::getMaxTileCount() const {
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+        return _maxTileCount;
+    }
+
+    void TileLayer::setMaxTileCount(int count) {
+        {
+            std::lock_guard<std::recursive_mutex> lock(_mutex);
+            _maxTileCount = std::max(0, count);
+        }
+        refresh();
+    }
+
     float TileLayer::getZoomLevelBias() const {
         std::lock_guard<std::recursive_mutex> lock(_mutex);
         return _zoomLevelBias;
@@ -192,13 +224,17 @@ namespace carto {
         _lastFrameNr(-1),
         _preloading(false),
         _substitutionPolicy(TileSubstitutionPolicy::TILE_SUBSTITUTION_POLICY_ALL),
+        _selectionMode(TileSelectionMode::TILE_SELECTION_MODE_DISTANCE),
+        _maxTileCount(0),
         _zoomLevelBias(0.0f),
         _maxOverzoomLevel(MAX_PARENT_SEARCH_DEPTH),
         _maxUnderzoomLevel(MAX_CHILD_SEARCH_DEPTH),
         _tileRenderer(std::make_shared<TileRenderer>()),
         _visibleTiles(),
         _preloadingTiles(),
+        _cachedTiles(),
         _utfGridTiles(),
+        _utfGridTileCache(UTF_GRID_TILE_CACHE_SIZE),
         _glResourceManager(),
         _projectionSurface()
     {
@@ -249,9 +285,14 @@ namespace carto {
             _glResourceManager = glResourceManager;
         }
 
+        // Take a snapshot of the cached tiles. Tiles are added to the caches only while holding the layer lock,
+        // so the snapshot stays valid for the whole pass and can be used to skip the lookups of missing tiles.
+        _cachedTiles.clear();
+        collectCachedTiles(_cachedTiles);
+
         // Remove UTF grid tiles that are missing from the cache
         for (auto it = _utfGridTiles.begin(); it != _utfGridTiles.end(); ) {
-            if (!tileExists(it->first, false) && !tileExists(it->first, true)) {
+            if (!tileCached(it->first, false) && !tileCached(it->first, true)) {
                 it = _utfGridTiles.erase(it);
             } else {
                 it++;
@@ -265,6 +306,7 @@ namespace carto {
         
         // Check if layer should be drawn
         if (!isVisible() || !getVisibleZoomRange().inRange(cullState->getViewState().getZoom()) || getOpacity() <= 0) {
+            _cachedTiles.clear();
             _calculatingTiles = false;
 
             refreshDrawData(cullState);
@@ -295,6 +337,7 @@ namespace carto {
             }
         }
     
+        _cachedTiles.clear();
         _calculatingTiles = false;
         _refreshedTiles = true;
         
@@ -401,22 +444,43 @@ namespace carto {
         return clickType == ClickType::CLICK_TYPE_SINGLE || clickType == ClickType::CLICK_TYPE_LONG; // by default, disable 'click through' for single and long clicks
     }
 
+    long long TileLayer::getTileId(const MapTile& mapTile) const {
+        return mapTile.getTileId();
+    }
+
+    bool TileLayer::tileCached(const MapTile& tile, bool preloadingCache) const {
+        // Most of the queried tiles are missing, check these against the snapshot without querying the caches
+        if (!_cachedTiles.contains(getTileId(tile))) {
+            return false;
+        }
+        return tileExists(tile, preloadingCache);
+    }
+
     void TileLayer::calculateVisibleTiles(const std::shared_ptr<CullState>& cullState) {
         // Remove last visible and preloading tiles
         _visibleTiles.clear();
         _preloadingTiles.clear();
 
-        // Recursively calculate visible tiles
-        calculateVisibleTilesRecursive(cullState, MapTile(0, 0, 0, _frameNr), _dataSource->getDataExtent());
+        // Build the list of root tiles
+        std::vector<MapTile> rootTiles { MapTile(0, 0, 0, _frameNr) };
         if (auto options = getOptions()) {
             if (options->getRenderProjectionMode() == RenderProjectionMode::RENDER_PROJECTION_MODE_PLANAR && options->isSeamlessPanning()) {
                 // Additional visibility testing has to be done if seamless panning is enabled
                 for (int i = 1; i <= 5; i++) {
-                    calculateVisibleTilesRecursive(cullState, MapTile(-i, 0, 0, _frameNr), _dataSource->getDataExtent());
-                    calculateVisibleTilesRecursive(cullState, MapTile( i, 0, 0, _frameNr), _dataSource->getDataExtent());
+                    rootTiles.push_back(MapTile(-i, 0, 0, _frameNr));
+                    rootTiles.push_back(MapTile( i, 0, 0, _frameNr));
                 }
             }
         }
+
+        if (_selectionMode == TileSelectionMode::TILE_SELECTION_MODE_SCREEN_SPACE_ERROR) {
+            calculateVisibleTilesScreenSpaceError(cullState, rootTiles, _dataSource->getDataExtent());
+        } else {
+            // Recursively calculate visible tiles
+            for (const MapTile& rootTile : rootTiles) {
+                calculateVisibleTilesRecursive(cullState, rootTile, _dataSource->getDataExtent());
+            }
+        }
         
         sortTiles(_visibleTiles, cullState->getViewState(), false);
         sortTiles(_preloadingTiles, cullState->getViewState(), true);
@@ -473,6 +537,93 @@ namespace carto {
         }
     }
     
+    void TileLayer::calculateVisibleTilesScreenSpaceError(const std::shared_ptr<CullState>& cullState, const std::vector<MapTile>& rootTiles, const MapBounds& dataExtent) {
+        const ViewState& viewState = cullState->getViewState();
+
+        // Preload only the tiles that will become visible if the camera keeps moving in the same direction
+        cglib::vec3<double> preloadingOffset(0, 0, 0);
+        if (_preloading && _lastCullState) {
+            preloadingOffset = (viewState.getFocusPos() - _lastCullState->getViewState().getFocusPos()) * PRELOADING_MOTION_LOOKAHEAD;
+        }
+
+        // Distance of the focus point from the camera plane, tiles further away are selected with lower detail
+        const cglib::mat4x4<double>& mvpMat = viewState.getModelviewProjectionMat();
+        const cglib::vec3<double>& focusPos = viewState.getFocusPos();
+        double focusDistance = focusPos(0) * mvpMat(3, 0) + focusPos(1) * mvpMat(3, 1) + focusPos(2) * mvpMat(3, 2) + mvpMat(3, 3);
+
+        // Refine the tiles with the largest screen space error first, until the error is small enough or the tile budget is used up
+        auto calculateCandidate = [&](const MapTile& tile, ScreenSpaceErrorTileSelector::Candidate& candidate) {
+            return calculateTileCandidate(viewState, tile, dataExtent, preloadingOffset, focusDistance, candidate);
+        };
+        std::vector<ScreenSpaceErrorTileSelector::Candidate> selectedCandidates = ScreenSpaceErrorTileSelector::SelectTiles(rootTiles, getMinZoom(), _maxTileCount, calculateCandidate);
+        for (const ScreenSpaceErrorTileSelector::Candidate& candidate : selectedCandidates) {
+            if (candidate.inVisibleFrustum) {
+                _visibleTiles.push_back(candidate.tile);
+            } else {
+                _preloadingTiles.push_back(candidate.tile);
+            }
+        }
+    }
+
+    bool TileLayer::calculateTileCandidate(const ViewState& viewState, const MapTile& tile, const MapBounds& dataExtent, const cglib::vec3<double>& preloadingOffset, double focusDistance, ScreenSpaceErrorTileSelector::Candidate& candidate) const {
+        const cglib::frustum3<double>& visibleFrustum = viewState.getFrustum();
+
+        if (tile.getZoom() > Const::MAX_SUPPORTED_ZOOM_LEVEL) {
+            return false;
+        }
+
+        int tileMask = (1 << tile.getZoom()) - 1;
+        MapTile flippedTile(tile.getX() & tileMask, tileMask - (tile.getY() & tileMask), tile.getZoom(), 0);
+        if (!calculateMapTileBounds(flippedTile).intersects(dataExtent)) {
+            return false;
+        }
+
+        cglib::bbox3<double> tileBounds = getTileTransformer()->calculateTileBBox(vt::TileId(tile.getZoom(), tile.getX(), tile.getY()));
+        bool inVisibleFrustum = visibleFrustum.inside(tileBounds);
+        if (!inVisibleFrustum) {
+            if (cglib::length(preloadingOffset) == 0) {
+                return false;
+            }
+
+            // Check if the tile is swept into the view by the camera movement
+            cglib::bbox3<double> sweptBounds(tileBounds);
+            for (int i = 0; i < 3; i++) {
+                sweptBounds.min(i) = std::min(tileBounds.min(i), tileBounds.min(i) - preloadingOffset(i));
+                sweptBounds.max(i) = std::max(tileBounds.max(i), tileBounds.max(i) - preloadingOffset(i));
+            }
+            if (!visibleFrustum.inside(sweptBounds)) {
+                return false;
+            }
+        }
+
+        // Calculate the screen space error of the tile, relative to the subdivision threshold
+        const cglib::mat4x4<double>& mvpMat = viewState.getModelviewProjectionMat();
+        cglib::vec3<double> tileCenter = tileBounds.center();
+        double tileW = tileCenter(0) * mvpMat(3, 0) + tileCenter(1) * mvpMat(3, 1) + tileCenter(2) * mvpMat(3, 2) + mvpMat(3, 3);
+        double error = std::numeric_limits<double>::infinity();
+        if (tileW > 0) {
+            error = SUBDIVISION_THRESHOLD * Const::SQRT_2 / (tileW * std::pow(2.0f, tile.getZoom() - getZoomLevelBias()));
+            if (focusDistance > 0 && tileW > focusDistance) {
+                error /= 1 + HORIZON_LOD_FALLOFF * (tileW / focusDistance - 1);
+            }
+        }
+
+        bool subDivide = error > 1;
+        int targetTileZoom = std::min(getMaxZoom(), static_cast<int>(viewState.getZoom() + getZoomLevelBias() + DISCRETE_ZOOM_LEVEL_BIAS));
+        if (getMinZoom() > tile.getZoom()) {
+            subDivide = true;
+            error = std::numeric_limits<double>::infinity();
+        } else if (targetTileZoom <= tile.getZoom()) {
+            subDivide = false;
+        }
+
+        candidate.tile = tile;
+        candidate.priority = error * (inVisibleFrustum ? 1.0 : PRELOADING_PRIORITY_SCALE);
+        candidate.inVisibleFrustum = inVisibleFrustum;
+        candidate.subDivide = subDivide;
+        return true;
+    }
+    
     void TileLayer::sortTiles(std::vector<MapTile>& tiles, const ViewState& viewState, bool preloadingTiles) {
         typedef std::pair<std::tuple<int, int, double>, MapTile> TaggedMapTile;
 
@@ -482,13 +633,13 @@ namespace carto {
         for (const MapTile& mapTile : tiles) {
             int parentSubstLevel = 0;
             MapTile parentTile = mapTile.getParent();
-            if (tileExists(parentTile, preloadingTiles) || tileExists(parentTile, !preloadingTiles)) {
+            if (tileCached(parentTile, preloadingTiles) || tileCached(parentTile, !preloadingTiles)) {
                 parentSubstLevel = 1;
             }
             int childSubstLevel = 0;
             for (int n = 0; n < 4; n++) {
                 MapTile subTile = mapTile.getChild(n);
-                if (tileExists(subTile, preloadingTiles) || tileExists(subTile, !preloadingTiles)) {
+                if (tileCached(subTile, preloadingTiles) || tileCached(subTile, !preloadingTiles)) {
                     childSubstLevel = 1;
                     break;
                 }
@@ -517,7 +668,7 @@ namespace carto {
             MapTile tile(visTile.getX() & tileMask, visTile.getY() & tileMask, visTile.getZoom(), visTile.getFrameNr());
 
             // Check caches
-            if (tileExists(tile, preloadingTiles) || tileExists(tile, !preloadingTiles)) {
+            if (tileCached(tile, preloadingTiles) || tileCached(tile, !preloadingTiles)) {
                 calculateDrawData(visTile, tile, preloadingTiles);
 
                 // Re-fetch invalid tile
@@ -546,7 +697,7 @@ namespace carto {
             for (bool preloadingCache : preloadingCaches) {
                 // Check for a tile with the last frame nr
                 MapTile prevFrameTile(tile.getX(), tile.getY(), tile.getZoom(), _lastFrameNr);
-                bool foundSubstitute = tileExists(prevFrameTile, preloadingCache);
+                bool foundSubstitute = tileCached(prevFrameTile, preloadingCache);
 
                 if (foundSubstitute) {
                     calculateDrawData(visTile, prevFrameTile, preloadingTiles);
@@ -578,7 +729,7 @@ namespace carto {
         MapTile parentTile = tile.getParent();
         
         // Check the cache
-        if (tileExists(parentTile, preloadingCache)) {
+        if (tileCached(parentTile, preloadingCache)) {
             calculateDrawData(visTile, parentTile, preloadingTile);
             return true;
         }
@@ -595,7 +746,7 @@ namespace carto {
         int childTileCount = 0;
         for (int n = 0; n < 4; n++) {
             MapTile subTile = tile.getChild(n);
-            if (tileExists(subTile, preloadingCache)) {
+            if (tileCached(subTile, preloadingCache)) {
                 calculateDrawData(visTile, subTile, preloadingTile);
                 childTileCount++;
             } else {
@@ -736,10 +887,19 @@ namespace carto {
                 continue;
             }
 
-            std::shared_ptr<UTFGridTile> utfTile = UTFGridTile::DecodeUTFTile(tileData->getData());
+            // Reuse the previously decoded tile if the data has not changed
+            std::shared_ptr<UTFGridTile> utfTile;
+            {
+                std::lock_guard<std::recursive_mutex> lock(tileLayer->_mutex);
+                tileLayer->_utfGridTileCache.read(dataSourceTile.getTileId(), utfTile);
+            }
+            if (!utfTile || !tileData->getData() || *utfTile->getTileData() != *tileData->getData()) {
+                utfTile = UTFGridTile::DecodeUTFTile(tileData->getData());
+            }
             if (utfTile) {
                 std::lock_guard<std::recursive_mutex> lock(tileLayer->_mutex);
                 tileLayer->_utfGridTiles[dataSourceTile] = utfTile; // we ignore expiration info here
+                tileLayer->_utfGridTileCache.put(dataSourceTile.getTileId(), utfTile, utfTile->getResidentSize());
                 refresh = true;
             } else {
                 Log::Error("TileLayer::FetchTaskBase: Failed to decode UTF grid tile");
@@ -755,6 +915,11 @@ namespace carto {
     const int TileLayer::MAX_CHILD_SEARCH_DEPTH = 3;
 
     const double TileLayer::PRELOADING_TILE_SCALE = 1.5;
+    const double TileLayer::PRELOADING_MOTION_LOOKAHEAD = 2.0;
+    const double TileLayer::PRELOADING_PRIORITY_SCALE = 0.5;
+    const double TileLayer::HORIZON_LOD_FALLOFF = 0.5;
     const float TileLayer::SUBDIVISION_THRESHOLD = Const::WORLD_SIZE;
+
+    const std::size_t TileLayer::UTF_GRID_TILE_CACHE_SIZE = 4 * 1024 * 1024;
     
 }
@@ -15,10 +15,14 @@
 #include "datasources/TileDataSource.h"
 #include "layers/Layer.h"
 #include "layers/components/FetchingTileTasks.h"
+#include "layers/components/ScreenSpaceErrorTileSelector.h"
+#include "layers/components/TileCacheSnapshot.h"
 
 #include <atomic>
 #include <unordered_map>
 
+#include <stdext/timed_lru_cache.h>
+
 namespace carto {
     class CancelableTask;
     class CullState;
@@ -52,6 +56,24 @@ namespace carto {
             TILE_SUBSTITUTION_POLICY_NONE
         };
     }
+
+    namespace TileSelectionMode {
+        /**
+         * The method to use when selecting the tiles for the current view.
+         */
+        enum TileSelectionMode {
+            /**
+             * Select tiles based on their distance from the camera. Tiles close to the view are preloaded in all directions.
+             */
+            TILE_SELECTION_MODE_DISTANCE,
+            /**
+             * Select tiles based on their projected screen space error, using coarser tiles towards the horizon.
+             * The number of selected tiles can be limited and only tiles in the direction of the camera movement are preloaded.
+             * This is recommended for strongly tilted views.
+             */
+            TILE_SELECTION_MODE_SCREEN_SPACE_ERROR
+        };
+    }
         
     /**
      * An abstract base class for all tile layers.
@@ -129,6 +151,30 @@ namespace carto {
          */
         void setTileSubstitutionPolicy(TileSubstitutionPolicy::TileSubstitutionPolicy policy);
         
+        /**
+         * Returns the current tile selection mode.
+         * @return The current tile selection mode. Default is TILE_SELECTION_MODE_DISTANCE.
+         */
+        TileSelectionMode::TileSelectionMode getTileSelectionMode() const;
+        /**
+         * Sets the current tile selection mode.
+         * @param mode The new tile selection mode.
+         */
+        void setTileSelectionMode(TileSelectionMode::TileSelectionMode mode);
+
+        /**
+         * Returns the maximum number of tiles selected for the current view.
+         * @return The maximum number of tiles, including the preloading tiles. Zero means that the number of tiles is not limited.
+         */
+        int getMaxTileCount() const;
+        /**
+         * Sets the maximum number of tiles selected for the current view. If the limit is reached, coarser tiles are used
+         * instead of subdividing them, starting with the tiles with the smallest screen space error.
+         * This is only used with TILE_SELECTION_MODE_SCREEN_SPACE_ERROR mode. The default is 0 (no limit).
+         * @param count The new maximum number of tiles, including the preloading tiles.
+         */
+        void setMaxTileCount(int count);
+
         /**
          * Gets the current zoom level bias for this layer.
          * @return The current zoom level bias for this layer.
@@ -268,6 +314,9 @@ namespace carto {
 
         virtual void updateTileLoadListener();
 
+        virtual long long getTileId(const MapTile& mapTile) const;
+        virtual void collectCachedTiles(TileCacheSnapshot& snapshot) const = 0;
+
         virtual bool tileExists(const MapTile& tile, bool preloadingCache) const = 0;
         virtual bool tileValid(const MapTile& tile, bool preloadingCache) const = 0;
         virtual void fetchTile(const MapTile& tile, bool preloadingTile, bool invalidated) = 0;
@@ -314,6 +363,8 @@ namespace carto {
         
         TileSubstitutionPolicy::TileSubstitutionPolicy _substitutionPolicy;
     
+        TileSelectionMode::TileSelectionMode _selectionMode;
+        int _maxTileCount;
         float _zoomLevelBias;
         int _maxOverzoomLevel;
         int _maxUnderzoomLevel;
@@ -323,6 +374,10 @@ namespace carto {
     private:
         void calculateVisibleTiles(const std::shared_ptr<CullState>& cullState);
         void calculateVisibleTilesRecursive(const std::shared_ptr<CullState>& cullState, const MapTile& mapTile, const MapBounds& dataExtent);
+        void calculateVisibleTilesScreenSpaceError(const std::shared_ptr<CullState>& cullState, const std::vector<MapTile>& rootTiles, const MapBounds& dataExtent);
+        bool calculateTileCandidate(const ViewState& viewState, const MapTile& mapTile, const MapBounds& dataExtent, const cglib::vec3<double>& preloadingOffset, double focusDistance, ScreenSpaceErrorTileSelector::Candidate& candidate) const;
+
+        bool tileCached(const MapTile& tile, bool preloadingCache) const;
 
         void sortTiles(std::vector<MapTile>& tiles, const ViewState& viewState, bool preloadingTiles);
         void findTiles(const std::vector<MapTile>& visTiles, bool preloadingTiles);
@@ -333,11 +388,18 @@ namespace carto {
         static const int MAX_CHILD_SEARCH_DEPTH;
         
         static const double PRELOADING_TILE_SCALE;
+        static const double PRELOADING_MOTION_LOOKAHEAD;
+        static const double PRELOADING_PRIORITY_SCALE;
+        static const double HORIZON_LOD_FALLOFF;
         static const float SUBDIVISION_THRESHOLD;
+
+        static const std::size_t UTF_GRID_TILE_CACHE_SIZE;
         
         std::vector<MapTile> _visibleTiles;
         std::vector<MapTile> _preloadingTiles;
+        TileCacheSnapshot _cachedTiles; // snapshot of the tile ids in all caches, only valid during loadData
         std::unordered_map<MapTile, std::shared_ptr<UTFGridTile> > _utfGridTiles;
+        cache::timed_lru_cache<long long, std::shared_ptr<UTFGridTile> > _utfGridTileCache; // decoded tiles, reused on reload if the data is unchanged
 
         std::weak_ptr<GLResourceManager> _glResourceManager;
         std::weak_ptr<ProjectionSurface> _projectionSurface;
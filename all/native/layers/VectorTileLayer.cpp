@@ -42,7 +42,8 @@ namespace carto {
         _visibleTileIds(),
         _tempDrawDatas(),
         _visibleCache(DEFAULT_VISIBLE_CACHE_SIZE),
-        _preloadingCache(DEFAULT_PRELOADING_CACHE_SIZE)
+        _preloadingCache(DEFAULT_PRELOADING_CACHE_SIZE),
+        _memoryBudgetClient("VectorTileLayer", DEFAULT_PRELOADING_CACHE_SIZE, [this]() { return getCacheMemoryUsage(); }, [this]() { applyCacheMemoryQuota(); })
     {
         if (!decoder) {
             throw NullArgumentException("Null decoder");
@@ -59,13 +60,13 @@ namespace carto {
     }
     
     std::size_t VectorTileLayer::getTileCacheCapacity() const {
-        std::lock_guard<std::recursive_mutex> lock(_mutex);
-        return _preloadingCache.capacity();
+        return _memoryBudgetClient.getCapacity();
     }
     
     void VectorTileLayer::setTileCacheCapacity(std::size_t capacityInBytes) {
         std::lock_guard<std::recursive_mutex> lock(_mutex);
-        _preloadingCache.resize(capacityInBytes);
+        _memoryBudgetClient.setCapacity(capacityInBytes);
+        applyCacheMemoryQuota();
     }
     
     VectorTileRenderOrder::VectorTileRenderOrder VectorTileLayer::getLabelRenderOrder() const {
@@ -117,6 +118,12 @@ namespace carto {
         }
     }
     
+    void VectorTileLayer::collectCachedTiles(TileCacheSnapshot& snapshot) const {
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+        snapshot.addCache(_visibleCache);
+        snapshot.addCache(_preloadingCache);
+    }
+
     bool VectorTileLayer::tileExists(const MapTile& tile, bool preloadingCache) const {
         std::lock_guard<std::recursive_mutex> lock(_mutex);
         long long tileId = getTileId(tile);
@@ -151,6 +158,7 @@ namespace carto {
                 } else {
                     _preloadingCache.get(tileId);
                 }
+                _memoryBudgetClient.recordAccess(true);
                 return;
             }
 
@@ -159,6 +167,7 @@ namespace carto {
                 return;
             }
         }
+        _memoryBudgetClient.recordAccess(false);
         
         auto task = std::make_shared<FetchTask>(std::static_pointer_cast<VectorTileLayer>(shared_from_this()), MapTile(tile.getX(), tile.getY(), tile.getZoom(), 0), preloadingTile);
         _fetchingTiles.add(tileId, task);
@@ -282,6 +291,9 @@ namespace carto {
             for (long long tileId : lastVisibleCacheTiles) {
                 _visibleCache.move(tileId, _preloadingCache);
             }
+
+            // Visible tiles use the same memory quota, so the preloading cache capacity depends on them
+            applyCacheMemoryQuota();
         }
         
         // Update renderer if needed, run culler
@@ -498,6 +510,17 @@ namespace carto {
         _tileDecoderListener.reset();
     }
     
+    MemoryBudgetManager::Client::Usage VectorTileLayer::getCacheMemoryUsage() const {
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+        return MemoryBudgetManager::Client::Usage(_visibleCache.size() + _preloadingCache.size(), _visibleCache.size());
+    }
+
+    void VectorTileLayer::applyCacheMemoryQuota() {
+        // The quota covers visible tiles, too. Visible tiles are never released, only the preloading cache is limited
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+        _preloadingCache.resize(_memoryBudgetClient.getCacheCapacity(_visibleCache.size()));
+    }
+    
     VectorTileLayer::TileDecoderListener::TileDecoderListener(const std::shared_ptr<VectorTileLayer>& layer) :
         _layer(layer)
     {
@@ -11,6 +11,7 @@
 #include "core/MapBounds.h"
 #include "components/CancelableTask.h"
 #include "components/DirectorPtr.h"
+#include "components/MemoryBudgetManager.h"
 #include "components/Task.h"
 #include "layers/TileLayer.h"
 #include "vectortiles/VectorTileDecoder.h"
@@ -80,6 +81,7 @@ namespace carto {
          * The more tiles are visible on the screen, the larger this cache should be. 
          * The default is 10MB, which should be enough for most use cases with preloading enabled. If preloading is
          * disabled, the cache size should be reduced by the user to conserve memory.
+         * If a global memory budget is set, the cache may use less memory than its capacity.
          * @param capacityInBytes The new tile bitmap cache capacity in bytes.
          */
         void setTileCacheCapacity(std::size_t capacityInBytes);
@@ -134,6 +136,7 @@ namespace carto {
     protected:
         friend class VTLabelPlacementWorker;
 
+        virtual void collectCachedTiles(TileCacheSnapshot& snapshot) const;
         virtual bool tileExists(const MapTile& mapTile, bool preloadingCache) const;
         virtual bool tileValid(const MapTile& mapTile, bool preloadingCache) const;
         virtual void fetchTile(const MapTile& mapTile, bool preloadingTile, bool invalidated);
@@ -204,6 +207,9 @@ namespace carto {
             std::shared_ptr<VectorTileDecoder::TileMap> _tileMap;
         };
 
+        MemoryBudgetManager::Client::Usage getCacheMemoryUsage() const;
+        void applyCacheMemoryQuota();
+
         static const int BACKGROUND_BLOCK_SIZE;
         static const int BACKGROUND_BLOCK_COUNT;
 
@@ -235,6 +241,8 @@ namespace carto {
 
         cache::timed_lru_cache<long long, TileInfo> _visibleCache;
         cache::timed_lru_cache<long long, TileInfo> _preloadingCache;
+
+        MemoryBudgetManager::Client _memoryBudgetClient;
     };
     
 }
@@ -0,0 +1,87 @@
+#include "HeightMapBorderCache.h"
+
+#include <algorithm>
+
+namespace carto {
+
+    HeightMapBorderCache::HeightMapBorderCache(std::size_t capacity) :
+        _bordersCache(capacity),
+        _mutex()
+    {
+    }
+
+    std::vector<std::uint32_t> HeightMapBorderCache::buildPaddedHeightMap(const MapTile& tile, unsigned int width, unsigned int height, const std::uint32_t* heightMap) {
+        unsigned int paddedWidth = width + 2;
+        unsigned int paddedHeight = height + 2;
+        std::vector<std::uint32_t> paddedHeightMap(paddedWidth * paddedHeight);
+        for (unsigned int y = 0; y < height; y++) {
+            std::copy(heightMap + y * width, heightMap + (y + 1) * width, &paddedHeightMap[(y + 1) * paddedWidth + 1]);
+        }
+
+        // Store the borders of this tile for the neighbours
+        auto borders = std::make_shared<Borders>();
+        borders->width = width;
+        borders->height = height;
+        borders->bottomRow.assign(heightMap, heightMap + width);
+        borders->topRow.assign(heightMap + (height - 1) * width, heightMap + height * width);
+        borders->leftColumn.resize(height);
+        borders->rightColumn.resize(height);
+        for (unsigned int y = 0; y < height; y++) {
+            borders->leftColumn[y] = heightMap[y * width];
+            borders->rightColumn[y] = heightMap[y * width + width - 1];
+        }
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _bordersCache.put(tile.getTileId(), borders, sizeof(Borders) + (width + height) * 2 * sizeof(std::uint32_t));
+        }
+
+        // Fill the padding from the neighbours, if available. Otherwise replicate the edges of this tile.
+        std::shared_ptr<const Borders> bottom = findBorders(tile, 0, 1, width, height);
+        std::shared_ptr<const Borders> top = findBorders(tile, 0, -1, width, height);
+        std::shared_ptr<const Borders> left = findBorders(tile, -1, 0, width, height);
+        std::shared_ptr<const Borders> right = findBorders(tile, 1, 0, width, height);
+        for (unsigned int x = 0; x < width; x++) {
+            paddedHeightMap[x + 1] = bottom ? bottom->topRow[x] : borders->bottomRow[x];
+            paddedHeightMap[(paddedHeight - 1) * paddedWidth + x + 1] = top ? top->bottomRow[x] : borders->topRow[x];
+        }
+        for (unsigned int y = 0; y < height; y++) {
+            paddedHeightMap[(y + 1) * paddedWidth] = left ? left->rightColumn[y] : borders->leftColumn[y];
+            paddedHeightMap[(y + 1) * paddedWidth + paddedWidth - 1] = right ? right->leftColumn[y] : borders->rightColumn[y];
+        }
+
+        std::shared_ptr<const Borders> bottomLeft = findBorders(tile, -1, 1, width, height);
+        std::shared_ptr<const Borders> bottomRight = findBorders(tile, 1, 1, width, height);
+        std::shared_ptr<const Borders> topLeft = findBorders(tile, -1, -1, width, height);
+        std::shared_ptr<const Borders> topRight = findBorders(tile, 1, -1, width, height);
+        paddedHeightMap[0] = bottomLeft ? bottomLeft->topRow[width - 1] : borders->bottomRow[0];
+        paddedHeightMap[paddedWidth - 1] = bottomRight ? bottomRight->topRow[0] : borders->bottomRow[width - 1];
+        paddedHeightMap[(paddedHeight - 1) * paddedWidth] = topLeft ? topLeft->bottomRow[width - 1] : borders->topRow[0];
+        paddedHeightMap[paddedHeight * paddedWidth - 1] = topRight ? topRight->bottomRow[0] : borders->topRow[width - 1];
+        return paddedHeightMap;
+    }
+
+    void HeightMapBorderCache::clear() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _bordersCache.clear();
+    }
+
+    std::shared_ptr<const HeightMapBorderCache::Borders> HeightMapBorderCache::findBorders(const MapTile& tile, int dx, int dy, unsigned int width, unsigned int height) {
+        int tileMask = (1 << tile.getZoom()) - 1;
+        int y = tile.getY() + dy;
+        if (y < 0 || y > tileMask) {
+            return std::shared_ptr<const Borders>();
+        }
+        MapTile neighbourTile((tile.getX() + dx) & tileMask, y, tile.getZoom(), tile.getFrameNr());
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        std::shared_ptr<const Borders> borders;
+        if (!_bordersCache.read(neighbourTile.getTileId(), borders)) {
+            return std::shared_ptr<const Borders>();
+        }
+        if (borders->width != width || borders->height != height) {
+            return std::shared_ptr<const Borders>();
+        }
+        return borders;
+    }
+
+}
@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2016 CartoDB. All rights reserved.
+ * Copying and using this code is allowed only according
+ * to license terms, as given in https://cartodb.com/terms/
+ */
+
+#ifndef _CARTO_HEIGHTMAPBORDERCACHE_H_
+#define _CARTO_HEIGHTMAPBORDERCACHE_H_
+
+#include "core/MapTile.h"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <stdext/timed_lru_cache.h>
+
+namespace carto {
+
+    class HeightMapBorderCache {
+    public:
+        explicit HeightMapBorderCache(std::size_t capacity);
+
+        // Stores the borders of the height map (rows bottom-up) and returns the height map padded by one pixel.
+        // The padding is taken from the cached borders of the eight neighbours, x wraps around the antimeridian.
+        // If a neighbour is missing, the edge of the height map itself is replicated.
+        std::vector<std::uint32_t> buildPaddedHeightMap(const MapTile& tile, unsigned int width, unsigned int height, const std::uint32_t* heightMap);
+
+        void clear();
+
+    private:
+        struct Borders {
+            unsigned int width;
+            unsigned int height;
+            std::vector<std::uint32_t> bottomRow;
+            std::vector<std::uint32_t> topRow;
+            std::vector<std::uint32_t> leftColumn;
+            std::vector<std::uint32_t> rightColumn;
+        };
+
+        std::shared_ptr<const Borders> findBorders(const MapTile& tile, int dx, int dy, unsigned int width, unsigned int height);
+
+        cache::timed_lru_cache<long long, std::shared_ptr<const Borders> > _bordersCache;
+        mutable std::mutex _mutex;
+    };
+
+}
+
+#endif
@@ -0,0 +1,60 @@
+#include "ScreenSpaceErrorTileSelector.h"
+
+#include <algorithm>
+
+namespace carto {
+
+    std::vector<ScreenSpaceErrorTileSelector::Candidate> ScreenSpaceErrorTileSelector::SelectTiles(const std::vector<MapTile>& rootTiles, int minZoom, int maxTileCount, const CandidateFunction& calculateCandidate) {
+        auto compareCandidates = [](const Candidate& candidate1, const Candidate& candidate2) {
+            return candidate1.priority < candidate2.priority;
+        };
+        std::vector<Candidate> refinedCandidates;
+        std::vector<Candidate> selectedCandidates;
+        int tileCount = 0;
+        for (const MapTile& rootTile : rootTiles) {
+            Candidate candidate;
+            if (calculateCandidate(rootTile, candidate)) {
+                if (candidate.subDivide) {
+                    refinedCandidates.push_back(candidate);
+                    std::push_heap(refinedCandidates.begin(), refinedCandidates.end(), compareCandidates);
+                } else {
+                    selectedCandidates.push_back(candidate);
+                }
+                tileCount++;
+            }
+        }
+
+        while (!refinedCandidates.empty()) {
+            std::pop_heap(refinedCandidates.begin(), refinedCandidates.end(), compareCandidates);
+            Candidate candidate = refinedCandidates.back();
+            refinedCandidates.pop_back();
+
+            std::vector<Candidate> childCandidates;
+            for (int n = 0; n < 4; n++) {
+                Candidate childCandidate;
+                if (calculateCandidate(candidate.tile.getChild(n), childCandidate)) {
+                    childCandidates.push_back(childCandidate);
+                }
+            }
+
+            // Tiles below the minimum zoom level must always be subdivided
+            bool forceSubDivide = minZoom > candidate.tile.getZoom();
+            if (!forceSubDivide && maxTileCount > 0 && tileCount - 1 + static_cast<int>(childCandidates.size()) > maxTileCount) {
+                selectedCandidates.push_back(candidate);
+                continue;
+            }
+
+            tileCount += static_cast<int>(childCandidates.size()) - 1;
+            for (const Candidate& childCandidate : childCandidates) {
+                if (childCandidate.subDivide) {
+                    refinedCandidates.push_back(childCandidate);
+                    std::push_heap(refinedCandidates.begin(), refinedCandidates.end(), compareCandidates);
+                } else {
+                    selectedCandidates.push_back(childCandidate);
+                }
+            }
+        }
+        return selectedCandidates;
+    }
+
+}
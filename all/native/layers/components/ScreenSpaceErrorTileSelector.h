@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) 2016 CartoDB. All rights reserved.
+ * Copying and using this code is allowed only according
+ * to license terms, as given in https://cartodb.com/terms/
+ */
+
+#ifndef _CARTO_SCREENSPACEERRORTILESELECTOR_H_
+#define _CARTO_SCREENSPACEERRORTILESELECTOR_H_
+
+#include "core/MapTile.h"
+
+#include <functional>
+#include <vector>
+
+namespace carto {
+
+    class ScreenSpaceErrorTileSelector {
+    public:
+        struct Candidate {
+            MapTile tile;
+            double priority; // screen space error relative to the subdivision threshold, scaled down for preloading tiles
+            bool inVisibleFrustum;
+            bool subDivide;
+        };
+
+        // Calculates the candidate for a tile, returns false if the tile is culled
+        typedef std::function<bool(const MapTile& tile, Candidate& candidate)> CandidateFunction;
+
+        // Refines the candidates with the largest priority first, until no candidate needs subdividing or the tile budget is used up.
+        // Tiles below the minimum zoom level are always subdivided, even if this exceeds the budget. Budget 0 means no limit.
+        static std::vector<Candidate> SelectTiles(const std::vector<MapTile>& rootTiles, int minZoom, int maxTileCount, const CandidateFunction& calculateCandidate);
+    };
+
+}
+
+#endif
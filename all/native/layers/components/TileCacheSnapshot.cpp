@@ -0,0 +1,18 @@
+#include "TileCacheSnapshot.h"
+
+namespace carto {
+
+    TileCacheSnapshot::TileCacheSnapshot() :
+        _tileIds()
+    {
+    }
+
+    bool TileCacheSnapshot::contains(long long tileId) const {
+        return _tileIds.find(tileId) != _tileIds.end();
+    }
+
+    void TileCacheSnapshot::clear() {
+        _tileIds.clear();
+    }
+
+}
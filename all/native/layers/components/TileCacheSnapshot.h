@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) 2016 CartoDB. All rights reserved.
+ * Copying and using this code is allowed only according
+ * to license terms, as given in https://cartodb.com/terms/
+ */
+
+#ifndef _CARTO_TILECACHESNAPSHOT_H_
+#define _CARTO_TILECACHESNAPSHOT_H_
+
+#include <unordered_set>
+
+namespace carto {
+
+    // Tile ids held in the tile caches of a layer at the time the snapshot was taken.
+    // Used to reject lookups of missing tiles without querying the caches, so it must never miss an existing tile.
+    class TileCacheSnapshot {
+    public:
+        TileCacheSnapshot();
+
+        template <typename Cache>
+        void addCache(const Cache& cache) {
+            std::unordered_set<long long> tileIds = cache.keys();
+            _tileIds.insert(tileIds.begin(), tileIds.end());
+        }
+
+        bool contains(long long tileId) const;
+
+        void clear();
+
+    private:
+        std::unordered_set<long long> _tileIds;
+    };
+
+}
+
+#endif
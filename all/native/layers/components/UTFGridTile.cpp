@@ -9,6 +9,8 @@
 
 #include <utf8.h>
 
+#include <algorithm>
+
 namespace {
 
     carto::Variant rapidJSONToVariant(const rapidjson::Value& value) {
@@ -44,71 +46,279 @@ namespace {
         return carto::Variant();
     }
 
+
+    void skipWhitespace(const char*& ptr, const char* end) {
+        while (ptr < end && (*ptr == ' ' || *ptr == '\t' || *ptr == '\n' || *ptr == '\r')) {
+            ptr++;
+        }
+    }
+
+    bool skipString(const char*& ptr, const char* end) {
+        if (ptr >= end || *ptr != '"') {
+            return false;
+        }
+        for (ptr++; ptr < end; ptr++) {
+            if (*ptr == '\\') {
+                ptr++;
+            } else if (*ptr == '"') {
+                ptr++;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool skipValue(const char*& ptr, const char* end) {
+        if (ptr >= end) {
+            return false;
+        }
+        if (*ptr == '"') {
+            return skipString(ptr, end);
+        }
+        if (*ptr == '{' || *ptr == '[') {
+            int depth = 0;
+            while (ptr < end) {
+                if (*ptr == '"') {
+                    if (!skipString(ptr, end)) {
+                        return false;
+                    }
+                    continue;
+                }
+                if (*ptr == '{' || *ptr == '[') {
+                    depth++;
+                } else if (*ptr == '}' || *ptr == ']') {
+                    if (--depth == 0) {
+                        ptr++;
+                        return true;
+                    }
+                }
+                ptr++;
+            }
+            return false;
+        }
+        while (ptr < end && *ptr != ',' && *ptr != '}' && *ptr != ']' && *ptr != ' ' && *ptr != '\t' && *ptr != '\n' && *ptr != '\r') {
+            ptr++;
+        }
+        return true;
+    }
+
+    bool decodeString(const char* begin, const char* end, std::string& str) {
+        // Fast path for strings without escape sequences
+        if (std::find(begin, end, '\\') == end) {
+            str.assign(begin + 1, end - 1);
+            return true;
+        }
+        rapidjson::Document doc;
+        if (doc.Parse<rapidjson::kParseDefaultFlags>(std::string(begin, end).c_str()).HasParseError() || !doc.IsString()) {
+            return false;
+        }
+        str = doc.GetString();
+        return true;
+    }
+
+    typedef std::pair<const char*, const char*> JSONRange;
+
+    bool scanObjectMembers(const char*& ptr, const char* end, std::vector<std::pair<std::string, JSONRange> >& members) {
+        // Scans the members of a JSON object without decoding the values
+        skipWhitespace(ptr, end);
+        if (ptr >= end || *ptr != '{') {
+            return false;
+        }
+        ptr++;
+        skipWhitespace(ptr, end);
+        if (ptr < end && *ptr == '}') {
+            ptr++;
+            return true;
+        }
+        while (ptr < end) {
+            const char* nameBegin = ptr;
+            if (!skipString(ptr, end)) {
+                return false;
+            }
+            std::string name;
+            if (!decodeString(nameBegin, ptr, name)) {
+                return false;
+            }
+            skipWhitespace(ptr, end);
+            if (ptr >= end || *ptr != ':') {
+                return false;
+            }
+            ptr++;
+            skipWhitespace(ptr, end);
+            const char* valueBegin = ptr;
+            if (!skipValue(ptr, end)) {
+                return false;
+            }
+            members.emplace_back(name, JSONRange(valueBegin, ptr));
+            skipWhitespace(ptr, end);
+            if (ptr < end && *ptr == ',') {
+                ptr++;
+                skipWhitespace(ptr, end);
+                continue;
+            }
+            if (ptr < end && *ptr == '}') {
+                ptr++;
+                return true;
+            }
+            return false;
+        }
+        return false;
+    }
+
 }
 
 namespace carto {
 
+    UTFGridTile::UTFGridTile(const std::vector<std::string>& keys, const std::shared_ptr<BinaryData>& tileData, const std::map<std::string, DataRange>& dataRanges, const std::vector<Run>& runs, const std::vector<std::size_t>& rowOffsets, int xSize, int ySize) :
+        _keys(keys),
+        _tileData(tileData),
+        _dataRanges(dataRanges),
+        _runs(runs),
+        _rowOffsets(rowOffsets),
+        _xSize(xSize),
+        _ySize(ySize),
+        _decodedData(),
+        _mutex()
+    {
+    }
+
+    Variant UTFGridTile::getData(const std::string& key) const {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        auto decodedIt = _decodedData.find(key);
+        if (decodedIt != _decodedData.end()) {
+            return decodedIt->second;
+        }
+
+        Variant value;
+        auto it = _dataRanges.find(key);
+        if (it != _dataRanges.end()) {
+            std::string json(reinterpret_cast<const char*>(_tileData->data()) + it->second.first, it->second.second - it->second.first);
+            rapidjson::Document doc;
+            if (doc.Parse<rapidjson::kParseDefaultFlags>(json.c_str()).HasParseError()) {
+                Log::Errorf("UTFGridTile::getData: Failed to parse data for key %s", key.c_str());
+            } else {
+                value = rapidJSONToVariant(doc);
+            }
+        }
+        _decodedData[key] = value;
+        return value;
+    }
+
+    int UTFGridTile::getKeyId(int x, int y) const {
+        if (x < 0 || y < 0 || x >= _xSize || y >= _ySize) {
+            return 0;
+        }
+        auto begin = _runs.begin() + _rowOffsets[y];
+        auto end = _runs.begin() + _rowOffsets[y + 1];
+        auto it = std::upper_bound(begin, end, x, [](int x, const Run& run) { return x < run.endX; });
+        return it != end ? it->keyId : 0;
+    }
+
+    std::size_t UTFGridTile::getResidentSize() const {
+        std::size_t size = _tileData->size() + _runs.size() * sizeof(Run) + _rowOffsets.size() * sizeof(std::size_t);
+        for (const std::string& key : _keys) {
+            size += key.size() + sizeof(std::string);
+        }
+        return size + _dataRanges.size() * (sizeof(DataRange) + sizeof(std::string));
+    }
+
     std::shared_ptr<UTFGridTile> UTFGridTile::DecodeUTFTile(const std::shared_ptr<BinaryData>& tileData) {
         if (!tileData) {
             Log::Error("UTFGridTile::DecodeUTFTile: Null tile data");
             return std::shared_ptr<UTFGridTile>();
         }
 
-        std::string json(reinterpret_cast<const char*>(tileData->data()), tileData->size());
-        rapidjson::Document doc;
-        if (doc.Parse<rapidjson::kParseDefaultFlags>(json.c_str()).HasParseError()) {
+        // Scan the top level members only, the data values are decoded lazily when queried
+        const char* begin = reinterpret_cast<const char*>(tileData->data());
+        const char* end = begin + tileData->size();
+        const char* ptr = begin;
+        std::vector<std::pair<std::string, JSONRange> > members;
+        if (!scanObjectMembers(ptr, end, members)) {
             Log::Error("UTFGridTile::DecodeUTFTile: Failed to parse JSON");
             return std::shared_ptr<UTFGridTile>();
         }
 
         std::vector<std::string> keys;
-        for (unsigned int i = 0; i < doc["keys"].Size(); i++) {
-            keys.push_back(doc["keys"][i].GetString());
-        }
+        std::map<std::string, DataRange> dataRanges;
+        std::vector<Run> runs;
+        std::vector<std::size_t> rowOffsets;
+        int cols = 0;
+        bool mismatchingRows = false;
+        for (const std::pair<std::string, JSONRange>& member : members) {
+            if (member.first == "keys" || member.first == "grid") {
+                rapidjson::Document doc;
+                if (doc.Parse<rapidjson::kParseDefaultFlags>(std::string(member.second.first, member.second.second).c_str()).HasParseError() || !doc.IsArray()) {
+                    Log::Errorf("UTFGridTile::DecodeUTFTile: Failed to parse %s", member.first.c_str());
+                    return std::shared_ptr<UTFGridTile>();
+                }
 
-        std::map<std::string, Variant> data;
-        if (doc.FindMember("data") != doc.MemberEnd()) {
-            for (rapidjson::Value::ConstMemberIterator it = doc["data"].MemberBegin(); it != doc["data"].MemberEnd(); ++it) {
-                if (!it->name.IsString()) {
+                if (member.first == "keys") {
+                    keys.reserve(doc.Size());
+                    for (rapidjson::Value::ConstValueIterator it = doc.Begin(); it != doc.End(); it++) {
+                        keys.push_back(it->IsString() ? it->GetString() : std::string());
+                    }
                     continue;
                 }
 
-                data[it->name.GetString()] = rapidJSONToVariant(it->value);
-            }
-        }
-
-        unsigned int rows = doc["grid"].Size();
-        unsigned int cols = 0;
-        for (unsigned int i = 0; i < rows; i++) {
-            std::string columnUTF8 = doc["grid"][i].GetString();
-            std::vector<std::uint32_t> column;
-            column.reserve(columnUTF8.size());
-            utf8::utf8to32(columnUTF8.begin(), columnUTF8.end(), std::back_inserter(column));
+                // Decode the rows in a single pass, merging equal consecutive key ids into runs
+                rowOffsets.reserve(doc.Size() + 1);
+                for (rapidjson::Value::ConstValueIterator it = doc.Begin(); it != doc.End(); it++) {
+                    rowOffsets.push_back(runs.size());
+                    if (!it->IsString()) {
+                        continue;
+                    }
 
-            cols = std::max(cols, static_cast<unsigned int>(column.size()));
-        }
-        std::vector<int> keyIds;
-        keyIds.reserve(cols * rows);
-        for (unsigned int i = 0; i < rows; i++) {
-            std::string columnUTF8 = doc["grid"][i].GetString();
-            std::vector<std::uint32_t> column;
-            column.reserve(columnUTF8.size());
-            utf8::utf8to32(columnUTF8.begin(), columnUTF8.end(), std::back_inserter(column));
+                    const char* rowIt = it->GetString();
+                    const char* rowEnd = rowIt + it->GetStringLength();
+                    int x = 0;
+                    try {
+                        while (rowIt != rowEnd) {
+                            std::uint32_t code = utf8::next(rowIt, rowEnd);
+                            if (code >= 93) code--;
+                            if (code >= 35) code--;
+                            code -= 32;
 
-            if (column.size() != cols) {
-                Log::Warnf("UTFGridTile::DecodeUTFTile: Mismatching rows/columns");
-                column.resize(cols - column.size(), ' ');
+                            int keyId = static_cast<int>(code);
+                            if (runs.size() > rowOffsets.back() && runs.back().keyId == keyId) {
+                                runs.back().endX = ++x;
+                            } else {
+                                runs.push_back(Run { ++x, keyId });
+                            }
+                        }
+                    }
+                    catch (const std::exception& ex) {
+                        Log::Errorf("UTFGridTile::DecodeUTFTile: Invalid grid row: %s", ex.what());
+                        return std::shared_ptr<UTFGridTile>();
+                    }
+                    if (it != doc.Begin() && x != cols) {
+                        mismatchingRows = true;
+                    }
+                    cols = std::max(cols, x);
+                }
+                rowOffsets.push_back(runs.size());
+            } else if (member.first == "data") {
+                const char* dataPtr = member.second.first;
+                std::vector<std::pair<std::string, JSONRange> > dataMembers;
+                if (!scanObjectMembers(dataPtr, member.second.second, dataMembers)) {
+                    Log::Error("UTFGridTile::DecodeUTFTile: Failed to parse data");
+                    return std::shared_ptr<UTFGridTile>();
+                }
+                for (const std::pair<std::string, JSONRange>& dataMember : dataMembers) {
+                    dataRanges[dataMember.first] = DataRange(dataMember.second.first - begin, dataMember.second.second - begin);
+                }
             }
+        }
 
-            for (std::size_t j = 0; j < column.size(); j++) {
-                std::uint32_t code = column[j];
-                if (code >= 93) code--;
-                if (code >= 35) code--;
-                code -= 32;
-                keyIds.push_back(code);
-            }
+        if (rowOffsets.empty()) {
+            rowOffsets.push_back(0);
+        }
+        if (mismatchingRows) {
+            Log::Warnf("UTFGridTile::DecodeUTFTile: Mismatching rows/columns");
         }
-        return std::make_shared<UTFGridTile>(keys, data, keyIds, cols, rows);
+        runs.shrink_to_fit();
+        int rows = static_cast<int>(rowOffsets.size()) - 1;
+        return std::make_shared<UTFGridTile>(keys, tileData, dataRanges, runs, rowOffsets, cols, rows);
     }
 
 }
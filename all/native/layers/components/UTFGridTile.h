@@ -11,47 +11,62 @@
 
 #include <memory>
 #include <map>
+#include <mutex>
 #include <vector>
 #include <string>
+#include <utility>
 
 namespace carto {
     class BinaryData;
-        
+
     class UTFGridTile {
     public:
-        UTFGridTile(const std::vector<std::string>& keys, const std::map<std::string, Variant>& data, const std::vector<int>& keyIds, int xSize, int ySize) : _keys(keys), _data(data), _keyIds(keyIds), _xSize(xSize), _ySize(ySize) { }
+        struct Run {
+            int endX; // exclusive
+            int keyId;
+        };
+
+        typedef std::pair<std::size_t, std::size_t> DataRange;
+
+        UTFGridTile(const std::vector<std::string>& keys, const std::shared_ptr<BinaryData>& tileData, const std::map<std::string, DataRange>& dataRanges, const std::vector<Run>& runs, const std::vector<std::size_t>& rowOffsets, int xSize, int ySize);
 
         std::string getKey(int keyId) const {
-            return keyId >= 0 && keyId <= static_cast<int>(_keys.size()) ? _keys[keyId] : std::string();
-        }
-        
-        Variant getData(const std::string& key) const {
-            auto it = _data.find(key);
-            return it != _data.end() ? it->second : Variant();
+            return keyId >= 0 && keyId < static_cast<int>(_keys.size()) ? _keys[keyId] : std::string();
         }
 
+        Variant getData(const std::string& key) const;
+
         int getXSize() const {
             return _xSize;
         }
-        
+
         int getYSize() const {
             return _ySize;
         }
-        
-        int getKeyId(int x, int y) const {
-            return x >= 0 && y >= 0 && x < getXSize() && y < getYSize() ? _keyIds[y * getXSize() + x] : 0;
+
+        int getKeyId(int x, int y) const;
+
+        const std::shared_ptr<BinaryData>& getTileData() const {
+            return _tileData;
         }
 
+        std::size_t getResidentSize() const;
+
         static std::shared_ptr<UTFGridTile> DecodeUTFTile(const std::shared_ptr<BinaryData>& tileData);
 
     private:
         std::vector<std::string> _keys;
-        std::map<std::string, Variant> _data;
-        std::vector<int> _keyIds;
+        std::shared_ptr<BinaryData> _tileData; // original JSON, data values are decoded from it on demand
+        std::map<std::string, DataRange> _dataRanges;
+        std::vector<Run> _runs; // run-length encoded rows
+        std::vector<std::size_t> _rowOffsets; // offsets of the first run of each row, plus the total number of runs
         int _xSize;
         int _ySize;
+
+        mutable std::map<std::string, Variant> _decodedData;
+        mutable std::mutex _mutex;
     };
-    
+
 }
 
 #endif
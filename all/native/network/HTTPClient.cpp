@@ -36,6 +36,18 @@ namespace carto {
         _impl->setTimeout(milliseconds);
     }
 
+    void HTTPClient::setMaxConnectionsPerHost(int count) {
+        _impl->setMaxConnectionsPerHost(count);
+    }
+
+    void HTTPClient::setConnectionIdleTimeout(int milliseconds) {
+        _impl->setConnectionIdleTimeout(milliseconds);
+    }
+
+    HTTPClient::ConnectionStats HTTPClient::getConnectionStats() const {
+        return _impl->getConnectionStats();
+    }
+
     int HTTPClient::get(const std::string& url, const std::map<std::string, std::string>& requestHeaders, std::map<std::string, std::string>& responseHeaders, std::shared_ptr<BinaryData>& responseData, int* statusCode) const {
         Request request("GET", url);
         request.headers.insert(requestHeaders.begin(), requestHeaders.end());
@@ -96,7 +108,7 @@ namespace carto {
         if (request.headers.count("Accept") == 0) {
             request.headers["Accept"] = "*/*";
         }
-        if (offset > 0) {
+        if (offset > 0 && request.headers.count("Range") == 0) {
             request.headers["Range"] = "bytes=" + boost::lexical_cast<std::string>(offset) + "-";
         }
 
@@ -129,6 +141,9 @@ namespace carto {
                     }
                     return false;
                 }
+            } else if (statusCode == 200 && offset > 0) {
+                // Range request was ignored, the full content is returned
+                offset = 0;
             }
 
             // Read Content-Length
@@ -165,6 +180,10 @@ namespace carto {
             }
         }
 
+        if (response.statusCode == 304) {
+            return response.statusCode; // not modified, not an error for conditional requests
+        }
+
         if (response.statusCode < 200 || response.statusCode >= 300) {
             if (_log) {
                 Log::Errorf("HTTPClient::makeRequest: Bad status code: %d, URL: %s", response.statusCode, request.url.c_str());
@@ -178,4 +197,14 @@ namespace carto {
     HTTPClient::Impl::~Impl() {
     }
 
+    void HTTPClient::Impl::setMaxConnectionsPerHost(int count) {
+    }
+
+    void HTTPClient::Impl::setConnectionIdleTimeout(int milliseconds) {
+    }
+
+    HTTPClient::ConnectionStats HTTPClient::Impl::getConnectionStats() const {
+        return ConnectionStats();
+    }
+
 }
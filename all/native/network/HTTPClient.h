@@ -22,10 +22,22 @@ namespace carto {
     public:
         typedef std::function<bool(std::uint64_t, std::uint64_t, const unsigned char*, std::size_t)> HandlerFunc;
 
+        struct ConnectionStats {
+            std::uint64_t newConnections = 0;
+            std::uint64_t reusedConnections = 0;
+        };
+
         explicit HTTPClient(bool log);
 
         void setTimeout(int milliseconds);
 
+        // Persistent connection pool settings. Implementations that use the platform network stack ignore these.
+        // Idle timeout 0 disables connection reuse, each request then uses a new connection. Negative timeout keeps idle connections open.
+        void setMaxConnectionsPerHost(int count);
+        void setConnectionIdleTimeout(int milliseconds);
+
+        ConnectionStats getConnectionStats() const;
+
         int get(const std::string& url, const std::map<std::string, std::string>& requestHeaders, std::map<std::string, std::string>& responseHeaders, std::shared_ptr<BinaryData>& responseData, int* statusCode = 0) const;
         int post(const std::string& url, const std::string& contentType, const std::shared_ptr<BinaryData>& requestData, const std::map<std::string, std::string>& requestHeaders, std::map<std::string, std::string>& responseHeaders, std::shared_ptr<BinaryData>& responseData);
         int streamResponse(const std::string& method, const std::string& url, const std::map<std::string, std::string>& requestHeaders, std::map<std::string, std::string>& responseHeaders, HandlerFunc handlerFn, std::uint64_t offset) const;
@@ -71,6 +83,9 @@ namespace carto {
             virtual ~Impl();
 
             virtual void setTimeout(int milliseconds) = 0;
+            virtual void setMaxConnectionsPerHost(int count);
+            virtual void setConnectionIdleTimeout(int milliseconds);
+            virtual ConnectionStats getConnectionStats() const;
             virtual bool makeRequest(const HTTPClient::Request& request, HeadersFunc headersFn, DataFunc dataFn) const = 0;
         };
 
@@ -2,22 +2,47 @@
 #include "components/Exceptions.h"
 #include "utils/Log.h"
 
+#include <algorithm>
 #include <chrono>
 #include <limits>
-#include <regex>
 
 #include <boost/algorithm/string.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/logic/tribool.hpp>
 
 namespace carto {
 
     HTTPClient::PionImpl::PionImpl(bool log) :
         _log(log),
-        _connectionMap(),
+        _maxConnectionsPerHost(DEFAULT_MAX_CONNECTIONS_PER_HOST),
+        _connectionIdleTimeout(DEFAULT_CONNECTION_IDLE_TIMEOUT),
+        _connectionStats(),
+        _connectionPools(),
+        _connectionCondition(),
         _mutex()
     {
     }
 
+    void HTTPClient::PionImpl::setTimeout(int milliseconds) {
+        // Not supported, blocking socket operations are used
+    }
+
+    void HTTPClient::PionImpl::setMaxConnectionsPerHost(int count) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _maxConnectionsPerHost = std::max(1, count);
+        _connectionCondition.notify_all();
+    }
+
+    void HTTPClient::PionImpl::setConnectionIdleTimeout(int milliseconds) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _connectionIdleTimeout = milliseconds;
+    }
+
+    HTTPClient::ConnectionStats HTTPClient::PionImpl::getConnectionStats() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _connectionStats;
+    }
+
     bool HTTPClient::PionImpl::makeRequest(const HTTPClient::Request& request, HeadersFunc headersFn, DataFunc dataFn) const {
         // Parse request URL
         std::string proto, host, path, query;
@@ -28,56 +53,116 @@ namespace carto {
         if (proto == "https") {
             throw NetworkException("HTTPS protocol not supported", request.url);
         }
-        auto connectionKey = std::make_pair(host, port);
+        ConnectionKey connectionKey(host, port);
+        bool idempotent = request.method == "GET" || request.method == "HEAD";
 
-        // Try to reuse existing connection from the pool for GET methods
-        bool result = false;
         while (true) {
-            std::shared_ptr<Connection> connection;
-            {
-                std::lock_guard<std::mutex> lock(_mutex);
-                auto it = _connectionMap.find(connectionKey);
-                if (it != _connectionMap.end()) {
-                    connection = it->second;
-                    _connectionMap.erase(it);
+            bool reused = false;
+            std::shared_ptr<Connection> connection = acquireConnection(connectionKey, reused);
+            if (!connection) {
+                return false;
+            }
+
+            bool responseStarted = false;
+            auto trackingHeadersFn = [&headersFn, &responseStarted](int statusCode, const std::map<std::string, std::string>& headers) {
+                responseStarted = true;
+                return headersFn(statusCode, headers);
+            };
+
+            bool persistent = false;
+            bool result = false;
+            try {
+                result = makeRequest(*connection, request, trackingHeadersFn, dataFn, persistent);
+            }
+            catch (const NetworkException&) {
+                releaseConnection(connectionKey, connection, false);
+
+                // The server may have closed the reused connection, retry idempotent requests if nothing was received yet
+                if (reused && idempotent && !responseStarted) {
+                    if (_log) {
+                        Log::Infof("HTTPClient::PionImpl::makeRequest: Retrying request with new connection, URL: %s", request.url.c_str());
+                    }
+                    continue;
                 }
+                throw;
             }
-            if (!connection) {
-                break;
+
+            releaseConnection(connectionKey, connection, result && persistent);
+            return result;
+        }
+    }
+
+    std::shared_ptr<HTTPClient::PionImpl::Connection> HTTPClient::PionImpl::acquireConnection(const ConnectionKey& connectionKey, bool& reused) const {
+        std::unique_lock<std::mutex> lock(_mutex);
+        while (true) {
+            std::vector<std::shared_ptr<Connection> >& connections = _connectionPools[connectionKey];
+            std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+            // Drop expired idle connections
+            for (auto it = connections.begin(); it != connections.end(); ) {
+                if (!(*it)->busy && !(*it)->isValid(now, _connectionIdleTimeout)) {
+                    (*it)->close();
+                    it = connections.erase(it);
+                } else {
+                    it++;
+                }
             }
-            if (!connection->isValid()) {
-                continue;
+
+            // Try to reuse an idle connection
+            for (const std::shared_ptr<Connection>& connection : connections) {
+                if (!connection->busy) {
+                    connection->busy = true;
+                    connection->maxRequests--;
+                    _connectionStats.reusedConnections++;
+                    reused = true;
+                    return connection;
+                }
             }
 
-            result = makeRequest(*connection, request, headersFn, dataFn);
+            // Create new connection if the pool is not full
+            if (static_cast<int>(connections.size()) < _maxConnectionsPerHost) {
+                auto connection = std::make_shared<Connection>();
+                connection->busy = true;
+                connection->maxRequests--;
+                connections.push_back(connection);
+
+                lock.unlock();
+                bool connected = connection->connect(connectionKey.first, static_cast<std::uint16_t>(connectionKey.second));
+                lock.lock();
 
-            if (result) {
-                std::lock_guard<std::mutex> lock(_mutex);
-                if (request.method == "GET") {
-                    _connectionMap.insert(std::make_pair(connectionKey, connection));
+                if (!connected) {
+                    std::vector<std::shared_ptr<Connection> >& currentConnections = _connectionPools[connectionKey];
+                    currentConnections.erase(std::remove(currentConnections.begin(), currentConnections.end(), connection), currentConnections.end());
+                    _connectionCondition.notify_all();
+                    return std::shared_ptr<Connection>();
                 }
-                return result;
+                _connectionStats.newConnections++;
+                reused = false;
+                return connection;
             }
-        }
 
-        // Create new connection
-        auto connection = std::make_shared<Connection>(host, port);
-        if (!connection->isValid()) {
-            return false;
+            _connectionCondition.wait(lock);
         }
+    }
 
-        result = makeRequest(*connection, request, headersFn, dataFn);
+    void HTTPClient::PionImpl::releaseConnection(const ConnectionKey& connectionKey, const std::shared_ptr<Connection>& connection, bool reusable) const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        connection->busy = false;
+        connection->idleTime = std::chrono::steady_clock::now();
+        if (!reusable || _connectionIdleTimeout == 0) {
+            connection->maxRequests = 0;
+        }
 
-        if (result) {
-            std::lock_guard<std::mutex> lock(_mutex);
-            if (request.method == "GET") {
-                _connectionMap.insert(std::make_pair(connectionKey, connection));
-            }
+        // Remove the connection from the pool once it can not be used anymore
+        if (connection->maxRequests <= 0) {
+            connection->close();
+            std::vector<std::shared_ptr<Connection> >& connections = _connectionPools[connectionKey];
+            connections.erase(std::remove(connections.begin(), connections.end(), connection), connections.end());
         }
-        return result;
+        _connectionCondition.notify_all();
     }
 
-    bool HTTPClient::PionImpl::makeRequest(Connection& connection, const HTTPClient::Request& request, HeadersFunc headersFn, DataFunc dataFn) const {
+    bool HTTPClient::PionImpl::makeRequest(Connection& connection, const HTTPClient::Request& request, HeadersFunc headersFn, DataFunc dataFn, bool& persistent) const {
         std::string url = request.url;
         std::string proto, host, path, query;
         std::uint16_t port;
@@ -85,9 +170,7 @@ namespace carto {
             throw NetworkException("Invalid URL", request.url);
         }
 
-        // Form and send request
-        asio::error_code socketError;
-        std::chrono::steady_clock::time_point requestTime = std::chrono::steady_clock::now();
+        // Form the request
         pion::http::request pionRequest(path);
         pionRequest.set_method(request.method);
         pionRequest.set_query_string(query);
@@ -96,122 +179,185 @@ namespace carto {
         } else {
             pionRequest.set_do_not_send_content_length();
         }
-        pionRequest.add_header("Host", request.url);
+        pionRequest.add_header("Host", port == 80 ? host : host + ":" + boost::lexical_cast<std::string>(port));
         for (auto it = request.headers.begin(); it != request.headers.end(); it++) {
             pionRequest.add_header(it->first, it->second);
         }
-        pionRequest.send(*connection.connection, socketError);
-        if (socketError) {
-            throw NetworkException(socketError.message(), request.url);
+
+        auto closeConnection = [this, &connection]() {
+            connection.close();
+            std::lock_guard<std::mutex> lock(_mutex);
+            connection.maxRequests = 0;
+        };
+
+        if (connection.closed) {
+            throw NetworkException("Connection closed", request.url);
         }
 
         // Send the request
-        bool cancel = false;
-        asio::error_code parserError;
-        pion::http::parser parser(false, 0);
-        parser.set_payload_handler([&dataFn, &cancel](const char* buf, std::size_t size) {
-            if (!dataFn(reinterpret_cast<const unsigned char*>(buf), size)) {
-                cancel = true;
-            }
-        });
-
-        // Read headers
-        asio::streambuf buffer;
-        std::size_t bytesRead = asio::read_until(*connection.connection, buffer, "\r\n\r\n", socketError);
+        asio::error_code socketError;
+        std::chrono::steady_clock::time_point requestTime = std::chrono::steady_clock::now();
+        pionRequest.send(*connection.connection, socketError);
         if (socketError) {
+            closeConnection();
             throw NetworkException(socketError.message(), request.url);
         }
 
-        // Feed read data to HTTP parser
-        pion::http::response pionResponse;
-        std::vector<char> bufferData(asio::buffers_begin(buffer.data()), asio::buffers_end(buffer.data()));
-        parser.set_read_buffer(bufferData.data(), bufferData.size());
-        parser.parse(pionResponse, parserError);
-        buffer.consume(bufferData.size());
-        if (parserError) {
-            throw NetworkException(parserError.message(), request.url);
-        }
+        try {
+            bool cancel = false;
+            asio::error_code parserError;
+            pion::http::parser parser(false, 0);
+            parser.set_payload_handler([&dataFn, &cancel](const char* buf, std::size_t size) {
+                if (!dataFn(reinterpret_cast<const unsigned char*>(buf), size)) {
+                    cancel = true;
+                }
+            });
 
-        // Call headers callback
-        std::map<std::string, std::string> headers;
-        headers.insert(pionResponse.get_headers().begin(), pionResponse.get_headers().end());
-        if (!headersFn(pionResponse.get_status_code(), headers)) {
-            cancel = true;
-        }
+            // Read headers. The buffer may already contain data received after the previous response.
+            pion::http::response pionResponse(pionRequest);
+            std::size_t headersSize = asio::read_until(*connection.connection, connection.buffer, "\r\n\r\n", socketError);
+            if (socketError) {
+                throw NetworkException(socketError.message(), request.url);
+            }
+
+            // Feed headers to HTTP parser, content is parsed separately after the headers callback
+            std::vector<char> bufferData(asio::buffers_begin(connection.buffer.data()), asio::buffers_begin(connection.buffer.data()) + headersSize);
+            parser.set_read_buffer(bufferData.data(), bufferData.size());
+            boost::tribool parseResult = parser.parse(pionResponse, parserError);
+            connection.buffer.consume(bufferData.size() - parser.bytes_available());
+            if (parserError) {
+                throw NetworkException(parserError.message(), request.url);
+            }
 
-        // Check Keep-Alive directive
-        connection.maxRequests--;
-        it = pionResponse.get_headers().find("Keep-Alive");
-        if (it != pionResponse.get_headers().end()) {
-            std::cmatch what;
-            if (std::regex_match(it->second.c_str(), what, std::regex(".*[^a-zA-Z0-9]timeout=([0-9]*).*"))) {
-                long long timeout = boost::lexical_cast<long long>(what[1]);
-                connection.keepAliveTime = requestTime + std::chrono::seconds(timeout);
+            // Call headers callback
+            std::map<std::string, std::string> headers;
+            headers.insert(pionResponse.get_headers().begin(), pionResponse.get_headers().end());
+            if (!headersFn(pionResponse.get_status_code(), headers)) {
+                cancel = true;
             }
-            if (std::regex_match(it->second.c_str(), what, std::regex(".*[^a-zA-Z0-9]max=([0-9]*).*"))) {
-                int maxRequests = boost::lexical_cast<int>(what[1]);
-                connection.maxRequests = std::min(connection.maxRequests, maxRequests);
+
+            // Check Keep-Alive directive
+            bool keepAlive = pionResponse.check_keep_alive();
+            int keepAliveTimeout = DEFAULT_KEEP_ALIVE_TIMEOUT;
+            int maxRequests = std::numeric_limits<int>::max();
+            auto it = pionResponse.get_headers().find("Keep-Alive");
+            if (it != pionResponse.get_headers().end()) {
+                ParseKeepAliveHeader(it->second, keepAliveTimeout, maxRequests);
             }
-        } else {
-            connection.keepAliveTime = requestTime + std::chrono::seconds(5); // Apache servers have this limitation typically
-        }
 
-        // Read Content-Length
-        std::uint64_t contentLength = std::numeric_limits<std::uint64_t>::max();
-        auto it = pionResponse.get_headers().find("Content-Length");
-        if (it != pionResponse.get_headers().end()) {
-            contentLength = boost::lexical_cast<std::uint64_t>(it->second);
-        } else {
-            connection.maxRequests = 0; // force new connection next time
-        }
+            // Read the content until the parser has received the full message
+            while (!cancel && boost::indeterminate(parseResult)) {
+                if (connection.buffer.size() == 0) {
+                    asio::read(*connection.connection, connection.buffer, asio::transfer_at_least(1), socketError);
+                    if (socketError) {
+                        // If the message length is not explicitly defined, the message ends at EOF
+                        if (socketError == asio::error::eof && !parser.check_premature_eof(pionResponse)) {
+                            keepAlive = false;
+                            parseResult = true;
+                            break;
+                        }
+                        throw NetworkException(socketError.message(), request.url);
+                    }
+                }
 
-        // Read response
-        for (std::uint64_t offset = 0; offset < contentLength && !cancel; ) {
-            bytesRead = asio::read(*connection.connection, buffer, asio::transfer_at_least(1), socketError);
-            if (socketError) {
-                // If Content-Length was not explicitly defined, break at EOF
-                if (socketError == asio::error::eof && contentLength == std::numeric_limits<std::uint64_t>::max()) {
-                    break;
+                bufferData.assign(asio::buffers_begin(connection.buffer.data()), asio::buffers_end(connection.buffer.data()));
+                parser.set_read_buffer(bufferData.data(), bufferData.size());
+                parseResult = parser.parse(pionResponse, parserError);
+                connection.buffer.consume(bufferData.size() - parser.bytes_available());
+                if (parserError) {
+                    throw NetworkException(parserError.message(), request.url);
                 }
-                throw NetworkException(socketError.message(), request.url);
             }
 
-            // Parse read data
-            bufferData.assign(asio::buffers_begin(buffer.data()), asio::buffers_end(buffer.data()));
-            parser.set_read_buffer(bufferData.data(), bufferData.size());
-            parser.parse(pionResponse, parserError);
-            buffer.consume(bufferData.size());
-            if (parserError) {
-                throw NetworkException(parserError.message(), request.url);
+            if (cancel) {
+                closeConnection(); // the rest of the response is not read
+                return false;
+            }
+
+            persistent = keepAlive;
+            if (!keepAlive) {
+                closeConnection();
+                return true;
             }
 
-            offset += bytesRead;
+            std::lock_guard<std::mutex> lock(_mutex);
+            connection.keepAliveTime = requestTime + std::chrono::seconds(keepAliveTimeout);
+            connection.maxRequests = std::min(connection.maxRequests, maxRequests);
+            return true;
+        }
+        catch (...) {
+            closeConnection();
+            throw;
         }
+    }
 
-        return !cancel;
+    void HTTPClient::PionImpl::ParseKeepAliveHeader(const std::string& value, int& timeout, int& maxRequests) {
+        std::vector<std::string> params;
+        boost::split(params, value, boost::is_any_of(","));
+        for (std::string param : params) {
+            boost::trim(param);
+            try {
+                if (boost::istarts_with(param, "timeout=")) {
+                    timeout = boost::lexical_cast<int>(boost::trim_copy(param.substr(8)));
+                } else if (boost::istarts_with(param, "max=")) {
+                    maxRequests = std::min(maxRequests, boost::lexical_cast<int>(boost::trim_copy(param.substr(4))));
+                }
+            }
+            catch (const boost::bad_lexical_cast&) {
+                Log::Warnf("HTTPClient::PionImpl::ParseKeepAliveHeader: Invalid Keep-Alive parameter: %s", param.c_str());
+            }
+        }
     }
 
-    HTTPClient::PionImpl::Connection::Connection(const std::string& host, std::uint16_t port) :
-        maxRequests(std::numeric_limits<int>::max()), keepAliveTime(), ioService(), connection()
+    HTTPClient::PionImpl::Connection::Connection() :
+        maxRequests(std::numeric_limits<int>::max()),
+        busy(false),
+        keepAliveTime(),
+        idleTime(),
+        ioService(),
+        connection(),
+        buffer(),
+        closed(false)
     {
-        // Connect to server
+    }
+
+    bool HTTPClient::PionImpl::Connection::connect(const std::string& host, std::uint16_t port) {
         connection = std::make_shared<pion::tcp::connection>(ioService);
         connection->set_lifecycle(pion::tcp::connection::LIFECYCLE_KEEPALIVE);
         asio::error_code socketError = connection->connect(host, port);
         if (socketError) {
             connection.reset();
+            closed = true;
+            return false;
+        }
+        return true;
+    }
+
+    void HTTPClient::PionImpl::Connection::close() {
+        if (connection && !closed) {
+            connection->close();
         }
+        closed = true;
     }
 
-    bool HTTPClient::PionImpl::Connection::isValid() const {
+    bool HTTPClient::PionImpl::Connection::isValid(const std::chrono::steady_clock::time_point& now, int idleTimeout) const {
         if (!connection) {
             return false;
         }
         if (connection->get_lifecycle() == pion::tcp::connection::LIFECYCLE_CLOSE) {
             return false;
         }
+        if (idleTimeout >= 0 && idleTime + std::chrono::milliseconds(idleTimeout) < now) {
+            return false;
+        }
         std::chrono::steady_clock::time_point nullTime;
-        return maxRequests > 0 && (keepAliveTime == nullTime || keepAliveTime > std::chrono::steady_clock::now());
+        return maxRequests > 0 && (keepAliveTime == nullTime || keepAliveTime > now);
     }
 
+    const int HTTPClient::PionImpl::DEFAULT_MAX_CONNECTIONS_PER_HOST = 8;
+
+    const int HTTPClient::PionImpl::DEFAULT_CONNECTION_IDLE_TIMEOUT = 30000;
+
+    const int HTTPClient::PionImpl::DEFAULT_KEEP_ALIVE_TIMEOUT = 5; // Apache servers have this limitation typically
+
 }
@@ -14,30 +14,59 @@
 
 #include "network/HTTPClient.h"
 
+#include <condition_variable>
+
 namespace carto {
 
     class HTTPClient::PionImpl : public HTTPClient::Impl {
     public:
         explicit PionImpl(bool log);
 
+        virtual void setTimeout(int milliseconds);
+        virtual void setMaxConnectionsPerHost(int count);
+        virtual void setConnectionIdleTimeout(int milliseconds);
+        virtual ConnectionStats getConnectionStats() const;
+
         virtual bool makeRequest(const HTTPClient::Request& request, HeadersFunc headersFn, DataFunc dataFn) const;
 
     private:
         struct Connection {
-            int maxRequests;
-            std::chrono::steady_clock::time_point keepAliveTime;
+            int maxRequests; // guarded by PionImpl::_mutex
+            bool busy; // guarded by PionImpl::_mutex
+            std::chrono::steady_clock::time_point keepAliveTime; // guarded by PionImpl::_mutex
+            std::chrono::steady_clock::time_point idleTime; // guarded by PionImpl::_mutex
             asio::io_service ioService;
             std::shared_ptr<pion::tcp::connection> connection;
+            asio::streambuf buffer; // data received but not yet parsed
+            bool closed;
 
-            Connection(const std::string& host, std::uint16_t port);
+            Connection();
 
-            bool isValid() const;
+            bool connect(const std::string& host, std::uint16_t port);
+            void close();
+
+            bool isValid(const std::chrono::steady_clock::time_point& now, int idleTimeout) const;
         };
 
-        bool makeRequest(Connection& connection, const HTTPClient::Request& request, HeadersFunc headersFn, DataFunc dataFn) const;
+        typedef std::pair<std::string, int> ConnectionKey;
+
+        std::shared_ptr<Connection> acquireConnection(const ConnectionKey& connectionKey, bool& reused) const;
+        void releaseConnection(const ConnectionKey& connectionKey, const std::shared_ptr<Connection>& connection, bool reusable) const;
+
+        bool makeRequest(Connection& connection, const HTTPClient::Request& request, HeadersFunc headersFn, DataFunc dataFn, bool& persistent) const;
+
+        static void ParseKeepAliveHeader(const std::string& value, int& timeout, int& maxRequests);
+
+        static const int DEFAULT_MAX_CONNECTIONS_PER_HOST;
+        static const int DEFAULT_CONNECTION_IDLE_TIMEOUT;
+        static const int DEFAULT_KEEP_ALIVE_TIMEOUT;
 
         bool _log;
-        mutable std::multimap<std::pair<std::string, int>, std::shared_ptr<Connection> > _connectionMap;
+        int _maxConnectionsPerHost; // guarded by _mutex
+        int _connectionIdleTimeout; // guarded by _mutex
+        mutable ConnectionStats _connectionStats; // guarded by _mutex
+        mutable std::map<ConnectionKey, std::vector<std::shared_ptr<Connection> > > _connectionPools;
+        mutable std::condition_variable _connectionCondition;
         mutable std::mutex _mutex;
     };
 
@@ -7,6 +7,7 @@
 #include "projections/EPSG3857.h"
 #include "packagemanager/handlers/PackageHandler.h"
 #include "packagemanager/handlers/PackageHandlerFactory.h"
+#include "network/HTTPClient.h"
 #include "utils/URLFileLoader.h"
 #include "utils/GeneralUtils.h"
 #include "utils/Log.h"
@@ -16,8 +17,15 @@
 #include <utility>
 #include <algorithm>
 #include <limits>
+#include <atomic>
+#include <deque>
+#include <functional>
 #include <time.h>
 
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
 #include <boost/lexical_cast.hpp>
 
 #include <stdext/utf8_filesystem.h>
@@ -62,14 +70,26 @@ namespace carto {
         _taskQueue(),
         _taskQueueCondition(),
         _packageManagerThread(),
+        _taskThreads(),
+        _runningTaskIds(),
+        _finishedTaskIds(),
         _onChangeListeners(),
         _stopped(true),
-        _prevTaskId(-1),
-        _prevAction(PackageAction::PACKAGE_ACTION_WAITING),
-        _prevRoundedProgress(0),
+        _maxParallelDownloads(DEFAULT_MAX_PARALLEL_DOWNLOADS),
+        _maxDownloadConnections(DEFAULT_MAX_DOWNLOAD_CONNECTIONS),
+        _activeDownloadConnections(0),
+        _downloadConnectionCondition(),
+        _chunkDownloadThreadPool(std::make_shared<CancelableThreadPool>()),
+        _activeTaskIds(),
+        _activeTaskIdsRunningTaskIds(),
+        _activeTaskIdsQueueVersion(-1),
+        _activeTaskIdsMaxCount(0),
+        _reportedTaskProgress(),
         _packageManagerListener(),
         _serverPackageCache(),
         _packageHandlerCache(),
+        _pinnedPackageFiles(),
+        _deferredPackageFiles(),
         _mutex()
     {
         if (_packageListURL.empty()) {
@@ -111,10 +131,15 @@ namespace carto {
         }
 
         syncLocalPackages();
+
+        _chunkDownloadThreadPool->setPoolSize(_maxDownloadConnections);
     }
 
     PackageManager::~PackageManager() {
         stop(true);
+
+        // All download tasks are finished at this point, so no chunk downloads are pending
+        _chunkDownloadThreadPool->deinit();
     }
 
     std::shared_ptr<PackageManagerListener> PackageManager::getPackageManagerListener() const {
@@ -361,6 +386,24 @@ namespace carto {
         // Use the callback
         callback(packageHandlerMap);
     }
+
+    std::shared_ptr<void> PackageManager::pinLocalPackages(const std::vector<std::shared_ptr<PackageInfo> >& packageInfos) const {
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+        std::vector<std::string> fileNames;
+        for (const std::shared_ptr<PackageInfo>& packageInfo : packageInfos) {
+            std::string fileName = createLocalFilePath(createPackageFileName(packageInfo->getPackageId(), packageInfo->getPackageType(), packageInfo->getVersion()));
+            _pinnedPackageFiles[fileName]++;
+            fileNames.push_back(fileName);
+        }
+        // The pin may outlive the package manager, in that case there is nothing to unpin
+        std::weak_ptr<const PackageManager> packageManagerWeak(shared_from_this());
+        return std::shared_ptr<void>(nullptr, [packageManagerWeak, fileNames](void*) {
+            if (auto packageManager = packageManagerWeak.lock()) {
+                packageManager->unpinPackageFiles(fileNames);
+            }
+        });
+    }
     
     std::vector<std::shared_ptr<PackageInfo> > PackageManager::suggestPackages(const MapPos& mapPos, const std::shared_ptr<Projection>& projection) const {
         if (!_localDb) {
@@ -614,6 +657,29 @@ namespace carto {
         }
     }
 
+    int PackageManager::getMaxParallelDownloads() const {
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+        return _maxParallelDownloads;
+    }
+
+    void PackageManager::setMaxParallelDownloads(int count) {
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+        _maxParallelDownloads = std::max(1, count);
+        _taskQueueCondition.notify_all();
+    }
+
+    int PackageManager::getMaxDownloadConnections() const {
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+        return _maxDownloadConnections;
+    }
+
+    void PackageManager::setMaxDownloadConnections(int count) {
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+        _maxDownloadConnections = std::max(1, count);
+        _chunkDownloadThreadPool->setPoolSize(_maxDownloadConnections);
+        _downloadConnectionCondition.notify_all();
+    }
+
     bool PackageManager::startStyleDownload(const std::string& styleName) {
         if (!_localDb) {
             return false;
@@ -641,65 +707,128 @@ namespace carto {
                 int taskId = -1;
                 {
                     std::unique_lock<std::recursive_mutex> lock(_mutex);
+                    for (int finishedTaskId : _finishedTaskIds) {
+                        auto it = _taskThreads.find(finishedTaskId);
+                        if (it != _taskThreads.end()) {
+                            it->second->join();
+                            _taskThreads.erase(it);
+                        }
+                    }
+                    _finishedTaskIds.clear();
+
                     if (_stopped) {
                         break;
                     }
-                    taskId = _taskQueue->getActiveTaskId();
+                    for (int activeTaskId : _taskQueue->getActiveTaskIds(_runningTaskIds, _maxParallelDownloads)) {
+                        if (std::find(_runningTaskIds.begin(), _runningTaskIds.end(), activeTaskId) == _runningTaskIds.end()) {
+                            taskId = activeTaskId;
+                            break;
+                        }
+                    }
                     if (taskId == -1) {
                         _taskQueueCondition.wait(lock);
                         continue;
                     }
-                }
-                try {
-                    Task::Command command = _taskQueue->getTask(taskId).command;
-                    bool success = false;
-                    switch (command) {
-                    case Task::NOP:
-                        success = true;
-                        break;
-                    case Task::DOWNLOAD_PACKAGE_LIST:
-                        success = downloadPackageList(taskId);
-                        break;
-                    case Task::DOWNLOAD_PACKAGE:
-                        success = downloadPackage(taskId);
-                        break;
-                    case Task::IMPORT_PACKAGE:
-                        success = importPackage(taskId);
-                        break;
-                    case Task::REMOVE_PACKAGE:
-                        success = removePackage(taskId);
-                        break;
-                    case Task::DOWNLOAD_STYLE:
-                        success = downloadStyle(taskId);
-                        break;
+
+                    // Package downloads can be processed in parallel in separate threads, other tasks are processed here once all downloads have finished
+                    if (_maxParallelDownloads > 1 && _taskQueue->getTask(taskId).command == Task::DOWNLOAD_PACKAGE) {
+                        _runningTaskIds.push_back(taskId);
+                        _taskThreads[taskId] = std::make_shared<std::thread>(std::bind(&PackageManager::runTask, this, taskId));
+                        continue;
                     }
-                    if (success) {
-                        setTaskFinished(taskId);
-                    } else {
-                        setTaskFailed(taskId, PackageErrorType::PACKAGE_ERROR_TYPE_SYSTEM);
+                    if (!_taskThreads.empty()) {
+                        _taskQueueCondition.wait(lock);
+                        continue;
                     }
+                    _runningTaskIds.push_back(taskId);
                 }
-                catch (const PauseException&) {
-                    setTaskPaused(taskId);
-                    Log::Info("PackageManager: Paused task");
-                }
-                catch (const CancelException&) {
-                    setTaskCancelled(taskId);
-                    Log::Info("PackageManager: Cancelled task");
-                }
-                catch (const PackageException& ex) {
-                    setTaskFailed(taskId, ex.getErrorType());
-                    Log::Errorf("PackageManager: Exception while executing task: %s", ex.what());
-                }
-                catch (const std::exception& ex) {
-                    setTaskFailed(taskId, PackageErrorType::PACKAGE_ERROR_TYPE_SYSTEM);
-                    Log::Errorf("PackageManager: Exception while executing task: %s", ex.what());
-                }
+
+                executeTask(taskId);
+
+                std::lock_guard<std::recursive_mutex> lock(_mutex);
+                _runningTaskIds.erase(std::remove(_runningTaskIds.begin(), _runningTaskIds.end(), taskId), _runningTaskIds.end());
             }
         }
         catch (const std::exception& ex) {
             Log::Errorf("PackageManager: Unexpected exception while handling tasks, shutting down: %s", ex.what());
         }
+
+        // Wait until all parallel downloads are paused
+        std::map<int, std::shared_ptr<std::thread> > taskThreads;
+        {
+            std::lock_guard<std::recursive_mutex> lock(_mutex);
+            std::swap(taskThreads, _taskThreads);
+        }
+        for (auto it = taskThreads.begin(); it != taskThreads.end(); it++) {
+            it->second->join();
+        }
+        {
+            std::lock_guard<std::recursive_mutex> lock(_mutex);
+            _runningTaskIds.clear();
+            _finishedTaskIds.clear();
+        }
+    }
+
+    void PackageManager::runTask(int taskId) {
+        try {
+            executeTask(taskId);
+        }
+        catch (const std::exception& ex) {
+            Log::Errorf("PackageManager: Unexpected exception while handling task: %s", ex.what());
+        }
+
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+        _runningTaskIds.erase(std::remove(_runningTaskIds.begin(), _runningTaskIds.end(), taskId), _runningTaskIds.end());
+        _finishedTaskIds.push_back(taskId);
+        _taskQueueCondition.notify_all();
+    }
+
+    void PackageManager::executeTask(int taskId) {
+        try {
+            Task::Command command = _taskQueue->getTask(taskId).command;
+            bool success = false;
+            switch (command) {
+            case Task::NOP:
+                success = true;
+                break;
+            case Task::DOWNLOAD_PACKAGE_LIST:
+                success = downloadPackageList(taskId);
+                break;
+            case Task::DOWNLOAD_PACKAGE:
+                success = downloadPackage(taskId);
+                break;
+            case Task::IMPORT_PACKAGE:
+                success = importPackage(taskId);
+                break;
+            case Task::REMOVE_PACKAGE:
+                success = removePackage(taskId);
+                break;
+            case Task::DOWNLOAD_STYLE:
+                success = downloadStyle(taskId);
+                break;
+            }
+            if (success) {
+                setTaskFinished(taskId);
+            } else {
+                setTaskFailed(taskId, PackageErrorType::PACKAGE_ERROR_TYPE_SYSTEM);
+            }
+        }
+        catch (const PauseException&) {
+            setTaskPaused(taskId);
+            Log::Info("PackageManager: Paused task");
+        }
+        catch (const CancelException&) {
+            setTaskCancelled(taskId);
+            Log::Info("PackageManager: Cancelled task");
+        }
+        catch (const PackageException& ex) {
+            setTaskFailed(taskId, ex.getErrorType());
+            Log::Errorf("PackageManager: Exception while executing task: %s", ex.what());
+        }
+        catch (const std::exception& ex) {
+            setTaskFailed(taskId, PackageErrorType::PACKAGE_ERROR_TYPE_SYSTEM);
+            Log::Errorf("PackageManager: Exception while executing task: %s", ex.what());
+        }
     }
 
     bool PackageManager::downloadPackageList(int taskId) {
@@ -796,10 +925,37 @@ namespace carto {
         }
 
         std::string packageFileName = createLocalFilePath(createPackageFileName(task.packageId, task.packageType, task.packageVersion));
+        deleteDeferredPackageFile(packageFileName);
+        std::shared_ptr<PackageHandler> packageHandler = PackageHandlerFactory(_serverEncKey, _localEncKey).createPackageHandler(task.packageType, packageFileName);
         try {
-            // Determine file size, copy file
+            // Determine file size, link or copy file. Package handler processes the data while it is copied.
             std::uint64_t fileSize = 0;
-            {
+            bool linked = false;
+#ifndef _WIN32
+            // Local packages that are not modified on import can share the file with the source, avoiding the copy.
+            // The package handler then processes the package after it is in place.
+            std::string sourceFileName = task.packageLocation;
+            if (sourceFileName.substr(0, 7) == "file://") {
+                sourceFileName = sourceFileName.substr(7);
+            }
+            if (sourceFileName.find("://") == std::string::npos && !(packageHandler && packageHandler->isPackageModifiedOnImport())) {
+                utf8_filesystem::unlink(packageFileName.c_str());
+                if (::link(sourceFileName.c_str(), packageFileName.c_str()) == 0) {
+                    if (FILE* fpRaw = utf8_filesystem::fopen(packageFileName.c_str(), "rb")) {
+                        std::shared_ptr<FILE> fp(fpRaw, fclose);
+                        utf8_filesystem::fseek64(fp.get(), 0, SEEK_END);
+                        fileSize = utf8_filesystem::ftell64(fp.get());
+                        linked = true;
+                    } else {
+                        utf8_filesystem::unlink(packageFileName.c_str());
+                    }
+                }
+            }
+#endif
+            if (linked) {
+                Log::Infof("PackageManager: Linked package file %s", packageFileName.c_str());
+                updateTaskStatus(taskId, PackageAction::PACKAGE_ACTION_COPYING, 1.0f);
+            } else {
                 FILE* fpDestRaw = utf8_filesystem::fopen(packageFileName.c_str(), "wb");
                 if (!fpDestRaw) {
                     throw PackageException(PackageErrorType::PACKAGE_ERROR_TYPE_SYSTEM, std::string("Could not create file ") + packageFileName);
@@ -824,6 +980,9 @@ namespace carto {
                         Log::Errorf("PackageManager: Storage full? Could not write to package file %s", packageFileName.c_str());
                         return false;
                     }
+                    if (packageHandler) {
+                        packageHandler->onImportPackageData(fileSize, buf, size);
+                    }
                     fileSize += size;
                     if (length > 0) {
                         updateTaskStatus(taskId, PackageAction::PACKAGE_ACTION_COPYING, static_cast<float>(fileSize) / static_cast<float>(length));
@@ -842,8 +1001,8 @@ namespace carto {
 
             // Find package tiles and calculate tile mask
             std::string tileMaskValue;
-            if (auto handler = PackageHandlerFactory(_serverEncKey, _localEncKey).createPackageHandler(task.packageType, packageFileName)) {
-                tileMaskValue = EncodeTileMask(handler->calculateTileMask());
+            if (packageHandler) {
+                tileMaskValue = EncodeTileMask(packageHandler->calculateTileMask());
             }
 
             // Get package id
@@ -869,9 +1028,12 @@ namespace carto {
             }
 
             // Import package
-            importLocalPackage(id, taskId, task.packageId, task.packageType, packageFileName);
+            importLocalPackage(id, taskId, task.packageId, packageHandler);
         }
         catch (...) {
+            if (packageHandler) {
+                packageHandler->onDeletePackage();
+            }
             utf8_filesystem::unlink(packageFileName.c_str());
             throw;
         }
@@ -917,9 +1079,21 @@ namespace carto {
         // Create new package file or reuse partly downloaded file
         bool packageSizeIndeterminate = package->getSize() == 0;
         std::string packageFileName = createLocalFilePath(createPackageFileName(task.packageId, task.packageType, task.packageVersion));
+        deleteDeferredPackageFile(packageFileName);
+        std::shared_ptr<PackageHandler> packageHandler = PackageHandlerFactory(_serverEncKey, _localEncKey).createPackageHandler(task.packageType, packageFileName);
         try {
+            // Try to download large packages in parallel chunks first. If the server does not support range requests, download the package sequentially.
+            bool chunksDownloaded = false;
+            if (!packageSizeIndeterminate && package->getSize() >= MIN_CHUNKED_DOWNLOAD_SIZE) {
+                std::string packageURL = createPackageURL(task.packageId, task.packageVersion, task.packageLocation, downloaded);
+                if (packageURL.empty()) {
+                    throw PackageException(PackageErrorType::PACKAGE_ERROR_TYPE_NO_OFFLINE_PLAN, "Offline packages not available");
+                }
+                chunksDownloaded = downloadPackageChunks(taskId, task.packageId, packageURL, packageFileName, package->getSize(), packageHandler);
+            }
+
             // Try to download the package
-            for (int retry = 0; true; retry++) {
+            for (int retry = 0; !chunksDownloaded; retry++) {
                 if (retry > 0) {
                     utf8_filesystem::unlink(packageFileName.c_str());
                     Log::Infof("PackageManager: Retrying package %s download", task.packageId.c_str());
@@ -943,7 +1117,8 @@ namespace carto {
                 if (packageURL.empty()) {
                     throw PackageException(PackageErrorType::PACKAGE_ERROR_TYPE_NO_OFFLINE_PLAN, "Offline packages not available");
                 }
-                int errorCode = DownloadFile(packageURL, [this, fp, taskId, packageFileName, &fileOffset, fileSize](std::uint64_t offset, std::uint64_t length, const unsigned char* buf, std::size_t size) {
+                DownloadConnectionGuard connectionGuard(*this);
+                int errorCode = DownloadFile(packageURL, [this, fp, taskId, packageFileName, packageHandler, &fileOffset, fileSize](std::uint64_t offset, std::uint64_t length, const unsigned char* buf, std::size_t size) {
                     if (isTaskCancelled(taskId)) {
                         return false;
                     }
@@ -960,6 +1135,9 @@ namespace carto {
                         Log::Errorf("PackageManager: Storage full? Could not write to package file %s", packageFileName.c_str());
                         return false;
                     }
+                    if (packageHandler) {
+                        packageHandler->onImportPackageData(offset, buf, size);
+                    }
                     fileOffset = offset + size;
                     std::uint64_t realSize = fileSize;
                     if (fileSize == 0 && length != std::numeric_limits<std::uint64_t>::max()) {
@@ -970,6 +1148,7 @@ namespace carto {
                     }
                     return true;
                 }, fileOffset);
+                connectionGuard.release();
 
                 if (errorCode == 0) {
                     if (packageSizeIndeterminate || fileOffset == fileSize) {
@@ -985,18 +1164,7 @@ namespace carto {
                     throw PauseException();
                 }
                 if (retry > 0) {
-                    switch (errorCode) {
-                    case 402: // Payment required
-                        throw PackageException(PackageErrorType::PACKAGE_ERROR_TYPE_DOWNLOAD_LIMIT_EXCEEDED, "Subscription limit exceeded while downloading: " + task.packageId);
-                    case 403: // Forbidden
-                        throw PackageException(PackageErrorType::PACKAGE_ERROR_TYPE_NO_OFFLINE_PLAN, "Offline packages not available");
-                        break;
-                    case 406: // Not acceptable
-                        throw PackageException(PackageErrorType::PACKAGE_ERROR_TYPE_PACKAGE_TOO_BIG, "Package contains too many tiles: " + task.packageId);
-                        break;
-                    default:
-                        throw PackageException(errorCode < 0 ? PackageErrorType::PACKAGE_ERROR_TYPE_CONNECTION : PackageErrorType::PACKAGE_ERROR_TYPE_SYSTEM, "Failed to download package " + task.packageId);
-                    }
+                    ThrowDownloadException(errorCode, task.packageId);
                 }
             }
 
@@ -1018,8 +1186,8 @@ namespace carto {
                     std::string tileMaskValue;
                     if (package->getTileMask()) {
                         tileMaskValue = EncodeTileMask(package->getTileMask());
-                    } else if (auto handler = PackageHandlerFactory(_serverEncKey, _localEncKey).createPackageHandler(task.packageType, packageFileName)) {
-                        tileMaskValue = EncodeTileMask(handler->calculateTileMask());
+                    } else if (packageHandler) {
+                        tileMaskValue = EncodeTileMask(packageHandler->calculateTileMask());
                     }
                     std::uint64_t fileSize = package->getSize();
                     if (packageSizeIndeterminate) {
@@ -1044,16 +1212,15 @@ namespace carto {
             }
 
             // Import download package
-            importLocalPackage(id, taskId, task.packageId, task.packageType, packageFileName);
+            importLocalPackage(id, taskId, task.packageId, packageHandler);
         }
         catch (const PauseException&) {
             throw;
         }
-        catch (const CancelException&) {
-            utf8_filesystem::unlink(packageFileName.c_str());
-            throw;
-        }
         catch (...) {
+            if (packageHandler) {
+                packageHandler->onDeletePackage();
+            }
             utf8_filesystem::unlink(packageFileName.c_str());
             throw;
         }
@@ -1153,10 +1320,10 @@ namespace carto {
         }
     }
 
-    void PackageManager::importLocalPackage(int id, int taskId, const std::string& packageId, PackageType::PackageType packageType, const std::string& packageFileName) {
-        // Invoke handler callback
-        if (auto handler = PackageHandlerFactory(_serverEncKey, _localEncKey).createPackageHandler(packageType, packageFileName)) {
-            handler->onImportPackage();
+    void PackageManager::importLocalPackage(int id, int taskId, const std::string& packageId, const std::shared_ptr<PackageHandler>& packageHandler) {
+        // Invoke handler callback. If the handler already processed the package data while it was received, this is cheap.
+        if (packageHandler) {
+            packageHandler->onImportPackage();
         }
 
         // Mark downloaded package as valid and older packages as invalid.
@@ -1211,6 +1378,16 @@ namespace carto {
         syncLocalPackages();
         notifyPackagesChanged();
 
+        // If the package is in use, delete the file once it is unpinned
+        {
+            std::lock_guard<std::recursive_mutex> lock(_mutex);
+            if (_pinnedPackageFiles.count(packageFileName) > 0) {
+                Log::Infof("PackageManager: Package file %s is in use, deferring deletion", packageFileName.c_str());
+                _deferredPackageFiles[packageFileName] = packageType;
+                return;
+            }
+        }
+
         // Invoke handler callback
         if (auto handler = PackageHandlerFactory(_serverEncKey, _localEncKey).createPackageHandler(packageType, packageFileName)) {
             handler->onDeletePackage();
@@ -1220,6 +1397,336 @@ namespace carto {
         utf8_filesystem::unlink(packageFileName.c_str());
     }
 
+    void PackageManager::unpinPackageFiles(const std::vector<std::string>& fileNames) const {
+        std::vector<std::pair<std::string, PackageType::PackageType> > deletedFiles;
+        {
+            std::lock_guard<std::recursive_mutex> lock(_mutex);
+            for (const std::string& fileName : fileNames) {
+                auto it = _pinnedPackageFiles.find(fileName);
+                if (it == _pinnedPackageFiles.end() || --it->second > 0) {
+                    continue;
+                }
+                _pinnedPackageFiles.erase(it);
+
+                auto it2 = _deferredPackageFiles.find(fileName);
+                if (it2 != _deferredPackageFiles.end()) {
+                    deletedFiles.push_back(*it2);
+                    _deferredPackageFiles.erase(it2);
+                }
+            }
+        }
+
+        for (const std::pair<std::string, PackageType::PackageType>& deletedFile : deletedFiles) {
+            if (auto handler = PackageHandlerFactory(_serverEncKey, _localEncKey).createPackageHandler(deletedFile.second, deletedFile.first)) {
+                handler->onDeletePackage();
+            }
+            utf8_filesystem::unlink(deletedFile.first.c_str());
+        }
+    }
+
+    void PackageManager::deleteDeferredPackageFile(const std::string& fileName) {
+        // The file of a removed package is about to be replaced. Delete it now, open handles keep using the old data.
+        PackageType::PackageType packageType = PackageType::PACKAGE_TYPE_MAP;
+        {
+            std::lock_guard<std::recursive_mutex> lock(_mutex);
+            auto it = _deferredPackageFiles.find(fileName);
+            if (it == _deferredPackageFiles.end()) {
+                return;
+            }
+            packageType = it->second;
+            _deferredPackageFiles.erase(it);
+        }
+
+        if (auto handler = PackageHandlerFactory(_serverEncKey, _localEncKey).createPackageHandler(packageType, fileName)) {
+            handler->onDeletePackage();
+        }
+        utf8_filesystem::unlink(fileName.c_str());
+    }
+
+    bool PackageManager::downloadPackageChunks(int taskId, const std::string& packageId, const std::string& packageURL, const std::string& packageFileName, std::uint64_t fileSize, const std::shared_ptr<PackageHandler>& packageHandler) {
+        std::string chunkFileName = packageFileName + ".chunks";
+        std::size_t chunkCount = static_cast<std::size_t>((fileSize + DOWNLOAD_CHUNK_SIZE - 1) / DOWNLOAD_CHUNK_SIZE);
+
+        // Read the state of the chunks from the previous download attempt. The state is stored as a string with one character per chunk.
+        std::string chunkStates;
+        if (FILE* fpRaw = utf8_filesystem::fopen(chunkFileName.c_str(), "rb")) {
+            std::shared_ptr<FILE> fp(fpRaw, fclose);
+            char buf[4096];
+            while (std::size_t size = fread(buf, sizeof(char), sizeof(buf), fp.get())) {
+                chunkStates.append(buf, size);
+            }
+        }
+        bool chunkStatesValid = chunkStates.size() == chunkCount && chunkStates.find_first_not_of("01") == std::string::npos;
+        if (!chunkStatesValid) {
+            // A file of full size without a valid state may be preallocated by an earlier chunked download
+            // and contain unwritten ranges. It can not be trusted, so start from scratch.
+            if (FILE* fpRaw = utf8_filesystem::fopen(packageFileName.c_str(), "rb")) {
+                std::shared_ptr<FILE> fp(fpRaw, fclose);
+                utf8_filesystem::fseek64(fp.get(), 0, SEEK_END);
+                std::uint64_t fileOffset = utf8_filesystem::ftell64(fp.get());
+                fp.reset();
+                if (fileOffset >= fileSize) {
+                    Log::Infof("PackageManager: Download state of package %s is missing, restarting download", packageId.c_str());
+                    utf8_filesystem::unlink(packageFileName.c_str());
+                }
+            }
+            if (getMaxDownloadConnections() <= 1) {
+                return false;
+            }
+        }
+
+        std::uint64_t downloadedSize = 0;
+        try {
+            // Preallocate the package file. If there is no chunk state, reuse complete chunks of a partial sequential download.
+            FILE* fpRaw = utf8_filesystem::fopen(packageFileName.c_str(), "ab");
+            if (!fpRaw) {
+                throw PackageException(PackageErrorType::PACKAGE_ERROR_TYPE_SYSTEM, std::string("Could not create download package file ") + packageFileName);
+            }
+            std::shared_ptr<FILE> fp(fpRaw, fclose);
+            utf8_filesystem::fseek64(fp.get(), 0, SEEK_END);
+            std::uint64_t fileOffset = utf8_filesystem::ftell64(fp.get());
+            if (!chunkStatesValid) {
+                chunkStates.assign(chunkCount, '0');
+                for (std::size_t i = 0; i < chunkCount && fileOffset <= fileSize; i++) {
+                    if (std::min(fileSize, (i + 1) * DOWNLOAD_CHUNK_SIZE) <= fileOffset) {
+                        chunkStates[i] = '1';
+                    }
+                }
+                if (!SaveChunkStates(chunkFileName, chunkStates)) {
+                    throw PackageException(PackageErrorType::PACKAGE_ERROR_TYPE_SYSTEM, std::string("Could not create download state file ") + chunkFileName);
+                }
+            }
+            if (fileOffset != fileSize) {
+                fflush(fp.get());
+                if (utf8_filesystem::ftruncate64(fp.get(), fileSize) != 0) {
+                    throw PackageException(PackageErrorType::PACKAGE_ERROR_TYPE_SYSTEM, std::string("Storage full? Could not allocate package file ") + packageFileName);
+                }
+            }
+        }
+        catch (...) {
+            utf8_filesystem::unlink(chunkFileName.c_str());
+            throw;
+        }
+
+        auto state = std::make_shared<ChunkDownloadState>(taskId, packageId, packageURL, packageFileName, fileSize, packageHandler, chunkStates);
+        for (std::size_t i = 0; i < chunkCount; i++) {
+            if (chunkStates[i] == '1') {
+                downloadedSize += std::min(fileSize, (i + 1) * DOWNLOAD_CHUNK_SIZE) - i * DOWNLOAD_CHUNK_SIZE;
+            } else {
+                state->pendingChunks.push_back(i);
+            }
+        }
+        state->totalSize = downloadedSize;
+        updateTaskStatus(taskId, PackageAction::PACKAGE_ACTION_DOWNLOADING, static_cast<float>(downloadedSize) / static_cast<float>(fileSize));
+
+        // Download pending chunks using multiple connections. The calling thread works as one of the workers, the others run in the shared pool.
+        while (true) {
+            std::size_t workerCount = 0;
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                workerCount = std::max(std::size_t(1), std::min(state->pendingChunks.size(), static_cast<std::size_t>(getMaxDownloadConnections())));
+                state->runningWorkers = static_cast<int>(workerCount);
+                state->interrupted = false;
+            }
+            for (std::size_t i = 1; i < workerCount; i++) {
+                _chunkDownloadThreadPool->execute(std::make_shared<ChunkDownloadTask>(this, state));
+            }
+            downloadChunks(*state);
+            {
+                std::unique_lock<std::mutex> lock(state->mutex);
+                state->runningWorkers--;
+                state->condition.wait(lock, [&state]() { return state->runningWorkers == 0; });
+            }
+
+            // Workers stop once they see the task paused. If the task was resumed meanwhile, continue with the remaining chunks.
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (!state->interrupted || state->failed || !state->rangesSupported || state->pendingChunks.empty()) {
+                break;
+            }
+            if (isTaskCancelled(taskId) || isTaskPaused(taskId)) {
+                break;
+            }
+        }
+
+        if (!state->rangesSupported) {
+            Log::Infof("PackageManager: Server does not support range requests, downloading package %s sequentially", packageId.c_str());
+            utf8_filesystem::unlink(chunkFileName.c_str());
+            utf8_filesystem::unlink(packageFileName.c_str());
+            return false;
+        }
+        if (isTaskCancelled(taskId)) {
+            utf8_filesystem::unlink(chunkFileName.c_str());
+            throw CancelException();
+        }
+        if (state->failed) {
+            utf8_filesystem::unlink(chunkFileName.c_str());
+            ThrowDownloadException(state->errorCode, packageId);
+        }
+        if (state->chunkStates.find('0') != std::string::npos) {
+            // Only an interrupted download leaves chunks pending, keep the state for resuming
+            throw PauseException();
+        }
+
+        // Pass the chunks that were not streamed during the download to the package handler
+        streamDownloadedChunks(*state);
+        if (isTaskCancelled(taskId)) {
+            utf8_filesystem::unlink(chunkFileName.c_str());
+            throw CancelException();
+        }
+
+        utf8_filesystem::unlink(chunkFileName.c_str());
+        if (!VerifyPackageFile(packageFileName)) {
+            Log::Errorf("PackageManager: Downloaded package %s is corrupt", packageId.c_str());
+            throw PackageException(PackageErrorType::PACKAGE_ERROR_TYPE_SYSTEM, "Downloaded package is corrupt: " + packageId);
+        }
+        updateTaskStatus(taskId, PackageAction::PACKAGE_ACTION_DOWNLOADING, 1.0f);
+        return true;
+    }
+
+    void PackageManager::downloadChunks(ChunkDownloadState& state) {
+        std::string chunkFileName = state.packageFileName + ".chunks";
+        try {
+            // Each worker has its own file handle and HTTP client
+            FILE* fpRaw = utf8_filesystem::fopen(state.packageFileName.c_str(), "r+b");
+            if (!fpRaw) {
+                Log::Errorf("PackageManager: Could not open package file %s", state.packageFileName.c_str());
+                std::lock_guard<std::mutex> lock(state.mutex);
+                state.failed = true;
+                return;
+            }
+            std::shared_ptr<FILE> fp(fpRaw, fclose);
+            HTTPClient client(Log::IsShowDebug());
+            while (true) {
+                std::size_t chunkIndex = 0;
+                {
+                    std::lock_guard<std::mutex> lock(state.mutex);
+                    if (state.failed || !state.rangesSupported || state.pendingChunks.empty()) {
+                        break;
+                    }
+                    if (isTaskCancelled(state.taskId) || isTaskPaused(state.taskId)) {
+                        state.interrupted = true;
+                        break;
+                    }
+                    chunkIndex = state.pendingChunks.front();
+                    state.pendingChunks.pop_front();
+                }
+
+                std::uint64_t chunkBegin = chunkIndex * DOWNLOAD_CHUNK_SIZE;
+                std::uint64_t chunkEnd = std::min(state.fileSize, chunkBegin + DOWNLOAD_CHUNK_SIZE);
+                std::uint64_t chunkOffset = chunkBegin;
+                bool chunkRangeValid = true;
+                std::map<std::string, std::string> requestHeaders = NetworkUtils::CreateAppRefererHeader();
+                requestHeaders["Range"] = "bytes=" + boost::lexical_cast<std::string>(chunkBegin) + "-" + boost::lexical_cast<std::string>(chunkEnd - 1);
+                std::map<std::string, std::string> responseHeaders;
+                int chunkErrorCode = -1;
+                DownloadConnectionGuard connectionGuard(*this);
+                try {
+                    chunkErrorCode = client.streamResponse("GET", state.packageURL, requestHeaders, responseHeaders, [&](std::uint64_t offset, std::uint64_t length, const unsigned char* buf, std::size_t size) {
+                        if (isTaskCancelled(state.taskId) || isTaskPaused(state.taskId)) {
+                            return false;
+                        }
+                        if (offset != chunkOffset || length != chunkEnd || offset + size > chunkEnd) {
+                            chunkRangeValid = false;
+                            return false;
+                        }
+
+                        if (offset == chunkBegin) {
+                            utf8_filesystem::fseek64(fp.get(), offset, SEEK_SET);
+                        }
+                        if (fwrite(buf, sizeof(unsigned char), size, fp.get()) != size) {
+                            Log::Errorf("PackageManager: Storage full? Could not write to package file %s", state.packageFileName.c_str());
+                            return false;
+                        }
+                        chunkOffset = offset + size;
+                        updateTaskStatus(state.taskId, PackageAction::PACKAGE_ACTION_DOWNLOADING, static_cast<float>(state.totalSize += size) / static_cast<float>(state.fileSize));
+                        return true;
+                    }, chunkBegin);
+                }
+                catch (const std::exception& ex) {
+                    Log::Errorf("PackageManager: Exception while downloading package chunk: %s", ex.what());
+                }
+                connectionGuard.release();
+
+                std::unique_lock<std::mutex> lock(state.mutex);
+                if (!chunkRangeValid) {
+                    state.rangesSupported = false;
+                    break;
+                }
+                if (chunkErrorCode == 0 && chunkOffset == chunkEnd && fflush(fp.get()) == 0) {
+                    state.chunkStates[chunkIndex] = '1';
+                    SaveChunkStates(chunkFileName, state.chunkStates);
+                    lock.unlock();
+                    streamDownloadedChunks(state);
+                    continue;
+                }
+
+                // Requeue the chunk. Retry failed chunks independently unless the task was paused/cancelled or the server refused the request.
+                state.totalSize -= chunkOffset - chunkBegin;
+                state.pendingChunks.push_front(chunkIndex);
+                if (isTaskCancelled(state.taskId) || isTaskPaused(state.taskId)) {
+                    state.interrupted = true;
+                    break;
+                }
+                if (++state.chunkRetries[chunkIndex] > MAX_DOWNLOAD_CHUNK_RETRIES || (chunkErrorCode >= 400 && chunkErrorCode < 500)) {
+                    Log::Errorf("PackageManager: Failed to download chunk %d of package %s", static_cast<int>(chunkIndex), state.packageId.c_str());
+                    state.errorCode = chunkErrorCode;
+                    state.failed = true;
+                    break;
+                }
+                Log::Infof("PackageManager: Retrying chunk %d of package %s download", static_cast<int>(chunkIndex), state.packageId.c_str());
+            }
+        }
+        catch (const std::exception& ex) {
+            Log::Errorf("PackageManager: Exception while downloading package chunks: %s", ex.what());
+            std::lock_guard<std::mutex> lock(state.mutex);
+            state.failed = true;
+        }
+    }
+
+    void PackageManager::streamDownloadedChunks(ChunkDownloadState& state) {
+        // The package handler expects the data in file order, so pass on the leading downloaded chunks only.
+        // A worker that finds another one streaming skips this, the final call after all workers have finished streams the rest.
+        std::unique_lock<std::mutex> streamLock(state.streamMutex, std::try_to_lock);
+        if (!streamLock.owns_lock() || !state.packageHandler) {
+            return;
+        }
+
+        std::shared_ptr<FILE> fp;
+        std::vector<unsigned char> buf;
+        while (!isTaskCancelled(state.taskId)) {
+            std::size_t chunkIndex = state.streamedChunks;
+            {
+                std::lock_guard<std::mutex> lock(state.mutex);
+                if (chunkIndex >= state.chunkStates.size() || state.chunkStates[chunkIndex] != '1') {
+                    break;
+                }
+            }
+
+            if (!fp) {
+                FILE* fpRaw = utf8_filesystem::fopen(state.packageFileName.c_str(), "rb");
+                if (!fpRaw) {
+                    Log::Errorf("PackageManager: Could not open package file %s", state.packageFileName.c_str());
+                    return;
+                }
+                fp = std::shared_ptr<FILE>(fpRaw, fclose);
+                buf.resize(CHUNK_STREAM_BUFFER_SIZE);
+            }
+            std::uint64_t chunkBegin = chunkIndex * DOWNLOAD_CHUNK_SIZE;
+            std::uint64_t chunkEnd = std::min(state.fileSize, chunkBegin + DOWNLOAD_CHUNK_SIZE);
+            utf8_filesystem::fseek64(fp.get(), chunkBegin, SEEK_SET);
+            for (std::uint64_t offset = chunkBegin; offset < chunkEnd; ) {
+                std::size_t size = fread(buf.data(), sizeof(unsigned char), static_cast<std::size_t>(std::min(static_cast<std::uint64_t>(buf.size()), chunkEnd - offset)), fp.get());
+                if (size == 0) {
+                    Log::Errorf("PackageManager: Could not read package file %s", state.packageFileName.c_str());
+                    return;
+                }
+                state.packageHandler->onImportPackageData(offset, buf.data(), size);
+                offset += size;
+            }
+            state.streamedChunks++;
+        }
+    }
+
     bool PackageManager::isTaskCancelled(int taskId) const {
         std::lock_guard<std::recursive_mutex> lock(_mutex);
         return _taskQueue->isTaskCancelled(taskId);
@@ -1230,21 +1737,30 @@ namespace carto {
         if (_stopped) {
             return true;
         }
-        return _taskQueue->getActiveTaskId(taskId) != taskId;
+
+        // This is called for every received data block, so query the task queue only when it or the running tasks have changed
+        int taskQueueVersion = _taskQueue->getVersion();
+        if (taskQueueVersion != _activeTaskIdsQueueVersion || _runningTaskIds != _activeTaskIdsRunningTaskIds || _maxParallelDownloads != _activeTaskIdsMaxCount) {
+            _activeTaskIds = _taskQueue->getActiveTaskIds(_runningTaskIds, _maxParallelDownloads);
+            _activeTaskIdsQueueVersion = taskQueueVersion;
+            _activeTaskIdsRunningTaskIds = _runningTaskIds;
+            _activeTaskIdsMaxCount = _maxParallelDownloads;
+        }
+        return std::find(_activeTaskIds.begin(), _activeTaskIds.end(), taskId) == _activeTaskIds.end();
     }
 
     void PackageManager::updateTaskStatus(int taskId, PackageAction::PackageAction action, float progress) {
         {
             std::lock_guard<std::recursive_mutex> lock(_mutex);
             int roundedProgress = std::min(100, std::max(0, static_cast<int>(progress * 100.0f)));
-            if (taskId == _prevTaskId && action == _prevAction && roundedProgress == _prevRoundedProgress) {
+            std::pair<PackageAction::PackageAction, int> reportedProgress(action, roundedProgress);
+            auto it = _reportedTaskProgress.find(taskId);
+            if (it != _reportedTaskProgress.end() && it->second == reportedProgress) {
                 return;
             }
 
             _taskQueue->updateTaskStatus(taskId, action, progress);
-            _prevTaskId = taskId;
-            _prevAction = action;
-            _prevRoundedProgress = roundedProgress;
+            _reportedTaskProgress[taskId] = reportedProgress;
         }
 
         DirectorPtr<PackageManagerListener> packageManagerListener = _packageManagerListener;
@@ -1266,6 +1782,10 @@ namespace carto {
 
     void PackageManager::setTaskFinished(int taskId) {
         Task task = _taskQueue->getTask(taskId);
+        {
+            std::lock_guard<std::recursive_mutex> lock(_mutex);
+            _reportedTaskProgress.erase(taskId);
+        }
         _taskQueue->deleteTask(taskId);
 
         DirectorPtr<PackageManagerListener> packageManagerListener = _packageManagerListener;
@@ -1291,6 +1811,10 @@ namespace carto {
 
     void PackageManager::setTaskPaused(int taskId) {
         Task task = _taskQueue->getTask(taskId);
+        {
+            std::lock_guard<std::recursive_mutex> lock(_mutex);
+            _reportedTaskProgress.erase(taskId);
+        }
 
         DirectorPtr<PackageManagerListener> packageManagerListener = _packageManagerListener;
 
@@ -1311,6 +1835,10 @@ namespace carto {
 
     void PackageManager::setTaskCancelled(int taskId) {
         Task task = _taskQueue->getTask(taskId);
+        {
+            std::lock_guard<std::recursive_mutex> lock(_mutex);
+            _reportedTaskProgress.erase(taskId);
+        }
         _taskQueue->deleteTask(taskId);
 
         DirectorPtr<PackageManagerListener> packageManagerListener = _packageManagerListener;
@@ -1330,6 +1858,10 @@ namespace carto {
 
     void PackageManager::setTaskFailed(int taskId, PackageErrorType::PackageErrorType errorType) {
         Task task = _taskQueue->getTask(taskId);
+        {
+            std::lock_guard<std::recursive_mutex> lock(_mutex);
+            _reportedTaskProgress.erase(taskId);
+        }
         _taskQueue->deleteTask(taskId);
 
         DirectorPtr<PackageManagerListener> packageManagerListener = _packageManagerListener;
@@ -1353,6 +1885,78 @@ namespace carto {
         }
     }
 
+    PackageManager::ChunkDownloadState::ChunkDownloadState(int taskId, const std::string& packageId, const std::string& packageURL, const std::string& packageFileName, std::uint64_t fileSize, const std::shared_ptr<PackageHandler>& packageHandler, const std::string& chunkStates) :
+        taskId(taskId),
+        packageId(packageId),
+        packageURL(packageURL),
+        packageFileName(packageFileName),
+        fileSize(fileSize),
+        packageHandler(packageHandler),
+        chunkStates(chunkStates),
+        pendingChunks(),
+        chunkRetries(chunkStates.size(), 0),
+        totalSize(0),
+        rangesSupported(true),
+        failed(false),
+        interrupted(false),
+        errorCode(0),
+        runningWorkers(0),
+        streamedChunks(0),
+        condition(),
+        mutex(),
+        streamMutex()
+    {
+    }
+
+    PackageManager::ChunkDownloadTask::ChunkDownloadTask(PackageManager* packageManager, const std::shared_ptr<ChunkDownloadState>& state) :
+        _packageManager(packageManager),
+        _state(state)
+    {
+    }
+
+    void PackageManager::ChunkDownloadTask::run() {
+        if (!isCanceled()) {
+            _packageManager->downloadChunks(*_state);
+        }
+
+        std::lock_guard<std::mutex> lock(_state->mutex);
+        if (--_state->runningWorkers == 0) {
+            _state->condition.notify_all();
+        }
+    }
+
+    PackageManager::DownloadConnectionGuard::DownloadConnectionGuard(PackageManager& packageManager) :
+        _packageManager(packageManager),
+        _acquired(true)
+    {
+        _packageManager.acquireDownloadConnection();
+    }
+
+    PackageManager::DownloadConnectionGuard::~DownloadConnectionGuard() {
+        release();
+    }
+
+    void PackageManager::DownloadConnectionGuard::release() {
+        if (_acquired) {
+            _acquired = false;
+            _packageManager.releaseDownloadConnection();
+        }
+    }
+
+    void PackageManager::acquireDownloadConnection() {
+        std::unique_lock<std::recursive_mutex> lock(_mutex);
+        while (_activeDownloadConnections >= _maxDownloadConnections) {
+            _downloadConnectionCondition.wait(lock);
+        }
+        _activeDownloadConnections++;
+    }
+
+    void PackageManager::releaseDownloadConnection() {
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+        _activeDownloadConnections--;
+        _downloadConnectionCondition.notify_one();
+    }
+
     std::string PackageManager::createLocalFilePath(const std::string& name) const {
         std::string fileName = _dataFolder;
         if (!fileName.empty()) {
@@ -1550,7 +2154,77 @@ namespace carto {
         return NetworkUtils::StreamHTTPResponse("GET", url, requestHeaders, responseHeaders, handler, offset, Log::IsShowDebug());
     }
 
-    PackageManager::PersistentTaskQueue::PersistentTaskQueue(const std::string& dbFileName) {
+    bool PackageManager::VerifyPackageFile(const std::string& fileName) {
+        FILE* fpRaw = utf8_filesystem::fopen(fileName.c_str(), "rb");
+        if (!fpRaw) {
+            return false;
+        }
+        std::shared_ptr<FILE> fp(fpRaw, fclose);
+        char header[16] = { 0 };
+        std::size_t headerSize = fread(header, sizeof(char), sizeof(header), fp.get());
+        fp.reset();
+
+        // Most packages are SQLite databases, check their structure. For other formats only detect unwritten (zero) headers.
+        static const char sqliteHeader[16] = { 'S', 'Q', 'L', 'i', 't', 'e', ' ', 'f', 'o', 'r', 'm', 'a', 't', ' ', '3', 0 };
+        if (headerSize == sizeof(header) && std::equal(header, header + sizeof(header), sqliteHeader)) {
+            try {
+                sqlite3pp::database packageDb;
+                if (packageDb.connect_v2(fileName.c_str(), SQLITE_OPEN_READONLY) != SQLITE_OK) {
+                    return false;
+                }
+                sqlite3pp::query query(packageDb, "PRAGMA quick_check");
+                for (auto qit = query.begin(); qit != query.end(); qit++) {
+                    const char* result = qit->get<const char*>(0);
+                    return result && std::string(result) == "ok";
+                }
+            }
+            catch (const std::exception& ex) {
+                Log::Errorf("PackageManager::VerifyPackageFile: Exception while checking %s: %s", fileName.c_str(), ex.what());
+            }
+            return false;
+        }
+        return headerSize > 0 && std::find_if(header, header + headerSize, [](char c) { return c != 0; }) != header + headerSize;
+    }
+
+    bool PackageManager::SaveChunkStates(const std::string& chunkFileName, const std::string& chunkStates) {
+        // Write the state to a temporary file first, so that an interrupted write never leaves a partial state behind
+        std::string tempChunkFileName = chunkFileName + ".tmp";
+        FILE* fpRaw = utf8_filesystem::fopen(tempChunkFileName.c_str(), "wb");
+        if (!fpRaw) {
+            return false;
+        }
+        std::shared_ptr<FILE> fp(fpRaw, fclose);
+        if (fwrite(chunkStates.data(), sizeof(char), chunkStates.size(), fp.get()) != chunkStates.size() || fflush(fp.get()) != 0) {
+            return false;
+        }
+        fp.reset();
+        if (utf8_filesystem::rename(tempChunkFileName.c_str(), chunkFileName.c_str()) != 0) {
+            utf8_filesystem::unlink(chunkFileName.c_str());
+            if (utf8_filesystem::rename(tempChunkFileName.c_str(), chunkFileName.c_str()) != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void PackageManager::ThrowDownloadException(int errorCode, const std::string& packageId) {
+        switch (errorCode) {
+        case 402: // Payment required
+            throw PackageException(PackageErrorType::PACKAGE_ERROR_TYPE_DOWNLOAD_LIMIT_EXCEEDED, "Subscription limit exceeded while downloading: " + packageId);
+        case 403: // Forbidden
+            throw PackageException(PackageErrorType::PACKAGE_ERROR_TYPE_NO_OFFLINE_PLAN, "Offline packages not available");
+        case 406: // Not acceptable
+            throw PackageException(PackageErrorType::PACKAGE_ERROR_TYPE_PACKAGE_TOO_BIG, "Package contains too many tiles: " + packageId);
+        default:
+            throw PackageException(errorCode < 0 ? PackageErrorType::PACKAGE_ERROR_TYPE_CONNECTION : PackageErrorType::PACKAGE_ERROR_TYPE_SYSTEM, "Failed to download package " + packageId);
+        }
+    }
+
+    PackageManager::PersistentTaskQueue::PersistentTaskQueue(const std::string& dbFileName) :
+        _localDb(),
+        _version(0),
+        _mutex()
+    {
         _localDb = std::make_shared<sqlite3pp::database>(dbFileName.c_str());
         _localDb->execute("PRAGMA encoding='UTF-8'");
 
@@ -1570,26 +2244,68 @@ namespace carto {
         _localDb->execute("CREATE INDEX IF NOT EXISTS manager_tasks_package_id ON manager_tasks(package_id)");
     }
 
-    int PackageManager::PersistentTaskQueue::getActiveTaskId(int currentActiveTaskId) const {
-        // Find task with highest priority. Do not process paused tasks (priority < 0) unless they are cancelled. Cancelled tasks should be always processed.
+    int PackageManager::PersistentTaskQueue::getVersion() const {
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+        return _version;
+    }
+
+    std::vector<int> PackageManager::PersistentTaskQueue::getActiveTaskIds(const std::vector<int>& currentActiveTaskIds, int maxCount) const {
+        // Find tasks with highest priority, prefer currently active tasks. Do not process paused tasks (priority < 0) unless they are cancelled. Cancelled tasks should be always processed.
         std::lock_guard<std::recursive_mutex> lock(_mutex);
-        sqlite3pp::query query(*_localDb, "SELECT id, package_id, (CASE WHEN id=:active_id THEN -1 ELSE id END) as ordering FROM manager_tasks WHERE priority>=0 OR cancelled=1 ORDER BY priority DESC, ordering ASC LIMIT 1");
-        query.bind(":active_id", currentActiveTaskId);
+        struct Candidate {
+            int taskId;
+            int priority;
+            bool active;
+            bool packageTask;
+            std::string packageId;
+        };
+        std::vector<Candidate> candidates;
+        sqlite3pp::query query(*_localDb, "SELECT id, package_id, priority FROM manager_tasks WHERE priority>=0 OR cancelled=1 ORDER BY priority DESC, id ASC");
         for (auto qit = query.begin(); qit != query.end(); qit++) {
-            int taskId = qit->get<int>(0);
+            Candidate candidate;
+            candidate.taskId = qit->get<int>(0);
             const char* packageId = qit->get<const char*>(1);
-            if (!packageId) {
-                return taskId;
+            candidate.packageTask = packageId != nullptr;
+            candidate.packageId = packageId ? packageId : "";
+            candidate.priority = qit->get<int>(2);
+            candidate.active = std::find(currentActiveTaskIds.begin(), currentActiveTaskIds.end(), candidate.taskId) != currentActiveTaskIds.end();
+            candidates.push_back(candidate);
+        }
+        std::stable_sort(candidates.begin(), candidates.end(), [](const Candidate& candidate1, const Candidate& candidate2) {
+            if (candidate1.priority != candidate2.priority) {
+                return candidate1.priority > candidate2.priority;
             }
+            return candidate1.active && !candidate2.active;
+        });
 
-            // This is a package task - package tasks have to be processed in-order, so take the first task with the same package (even if it is paused).
-            sqlite3pp::query query2(*_localDb, "SELECT id FROM manager_tasks WHERE package_id=:package_id ORDER BY id ASC LIMIT 1");
-            query2.bind(":package_id", packageId);
-            for (auto qit2 = query2.begin(); qit2 != query2.end(); qit2++) {
-                return qit2->get<int>(0);
+        std::vector<int> taskIds;
+        for (const Candidate& candidate : candidates) {
+            int taskId = candidate.taskId;
+            if (candidate.packageTask) {
+                // This is a package task - package tasks have to be processed in-order, so take the first task with the same package (even if it is paused).
+                sqlite3pp::query query2(*_localDb, "SELECT id FROM manager_tasks WHERE package_id=:package_id ORDER BY id ASC LIMIT 1");
+                query2.bind(":package_id", candidate.packageId.c_str());
+                for (auto qit2 = query2.begin(); qit2 != query2.end(); qit2++) {
+                    taskId = qit2->get<int>(0);
+                }
+            }
+            if (std::find(taskIds.begin(), taskIds.end(), taskId) != taskIds.end()) {
+                continue;
+            }
+
+            // Only package downloads can be processed in parallel with other tasks
+            if (getTask(taskId).command != Task::DOWNLOAD_PACKAGE) {
+                if (taskIds.empty()) {
+                    taskIds.push_back(taskId);
+                }
+                break;
+            }
+            taskIds.push_back(taskId);
+            if (static_cast<int>(taskIds.size()) >= maxCount) {
+                break;
             }
         }
-        return -1;
+        return taskIds;
     }
 
     std::vector<int> PackageManager::PersistentTaskQueue::getTaskIds() const {
@@ -1631,6 +2347,7 @@ namespace carto {
         command.bind(":package_version", task.packageVersion);
         command.bind(":package_location", task.packageLocation.c_str());
         command.execute();
+        _version++;
         int taskId = static_cast<int>(_localDb->last_insert_rowid());
         return taskId;
     }
@@ -1651,6 +2368,7 @@ namespace carto {
         sqlite3pp::command command(*_localDb, "UPDATE manager_tasks SET cancelled=1, priority=1000000 WHERE id=:task_id");
         command.bind(":task_id", taskId);
         command.execute();
+        _version++;
     }
 
     void PackageManager::PersistentTaskQueue::setTaskPriority(int taskId, int priority) {
@@ -1659,6 +2377,7 @@ namespace carto {
         command.bind(":task_id", taskId);
         command.bind(":priority", priority);
         command.execute();
+        _version++;
     }
 
     void PackageManager::PersistentTaskQueue::updateTaskStatus(int taskId, PackageAction::PackageAction action, float progress) {
@@ -1675,9 +2394,22 @@ namespace carto {
         sqlite3pp::command command(*_localDb, "DELETE FROM manager_tasks WHERE id=:task_id");
         command.bind(":task_id", taskId);
         command.execute();
+        _version++;
     }
 
     const int PackageManager::DEFAULT_TILEMASK_ZOOMLEVEL = 14;
+
+    const int PackageManager::DEFAULT_MAX_PARALLEL_DOWNLOADS = 1;
+
+    const int PackageManager::DEFAULT_MAX_DOWNLOAD_CONNECTIONS = 4;
+
+    const std::uint64_t PackageManager::DOWNLOAD_CHUNK_SIZE = 8 * 1024 * 1024;
+
+    const std::uint64_t PackageManager::MIN_CHUNKED_DOWNLOAD_SIZE = 32 * 1024 * 1024;
+
+    const int PackageManager::MAX_DOWNLOAD_CHUNK_RETRIES = 3;
+
+    const std::size_t PackageManager::CHUNK_STREAM_BUFFER_SIZE = 65536;
 }
 
 #endif
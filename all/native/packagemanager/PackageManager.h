@@ -12,6 +12,8 @@
 #include "core/MapPos.h"
 #include "core/MapBounds.h"
 #include "core/MapTile.h"
+#include "components/CancelableTask.h"
+#include "components/CancelableThreadPool.h"
 #include "components/DirectorPtr.h"
 #include "packagemanager/PackageInfo.h"
 #include "packagemanager/PackageMetaInfo.h"
@@ -27,6 +29,9 @@
 #include <mutex>
 #include <condition_variable>
 #include <thread>
+#include <map>
+#include <atomic>
+#include <deque>
 
 namespace sqlite3pp {
     class database;
@@ -47,7 +52,7 @@ namespace carto {
      * It works persistently. If a package download is started and app is closed, the download will resume
      * when the package manager is started next time.
      */
-    class PackageManager {
+    class PackageManager : public std::enable_shared_from_this<PackageManager> {
     public:
 
         /**
@@ -168,6 +173,13 @@ namespace carto {
          * @param callback The callback function.
          */
         void accessLocalPackages(const std::function<void(const std::map<std::shared_ptr<PackageInfo>, std::shared_ptr<PackageHandler> >&)>& callback) const;
+        /**
+         * Pins the files of the specified local packages, so that they are not deleted while the returned object exists.
+         * If a pinned package is removed, its file is deleted once the last pin of the file is released.
+         * @param packageInfos The local packages to pin.
+         * @return The pin object. The packages are unpinned when the object is released.
+         */
+        std::shared_ptr<void> pinLocalPackages(const std::vector<std::shared_ptr<PackageInfo> >& packageInfos) const;
 
         /**
          * Suggests packages for given map position. Note that in order this to work, local package list must be available first.
@@ -195,6 +207,7 @@ namespace carto {
          * Starts importing the specified package asynchronously. When this task finishes, listener is called and local package list is updated.
          * Note 1: In general, package manager may need temporary storage equal to the size of the package during import. It is the responsibility of the app to perform such checks.
          * Note 2: the package may not be deleted after this call, as the import is asynchronous operation. It is safe to delete the original file once import is complete (this is notified via manager listener).
+         * Note 3: local packages are hard linked instead of copied when the file system allows it, so the original file should not be modified after the import.
          * @param packageId The id of the package to download.
          * @param version The version of the package.
          * @param packageFileName The fully qualified path of the package. The file name may also refer to URL or asset (using 'asset://' prefix).
@@ -229,6 +242,31 @@ namespace carto {
          * @param priority The priority of the download package. If it is less than zero, package download is paused.
          */
         void setPackagePriority(const std::string& packageId, int priority);
+
+        /**
+         * Returns the maximum number of packages that are downloaded in parallel.
+         * @return The maximum number of packages that are downloaded in parallel.
+         */
+        int getMaxParallelDownloads() const;
+        /**
+         * Sets the maximum number of packages that are downloaded in parallel.
+         * Only package downloads are processed in parallel, other tasks are processed one at a time. The default is 1.
+         * @param count The maximum number of packages to download in parallel.
+         */
+        void setMaxParallelDownloads(int count);
+
+        /**
+         * Returns the maximum number of HTTP connections used for downloading packages.
+         * @return The maximum number of HTTP connections used for downloading packages.
+         */
+        int getMaxDownloadConnections() const;
+        /**
+         * Sets the maximum number of HTTP connections used for downloading packages.
+         * Large packages are downloaded in chunks using multiple connections if the server supports range requests.
+         * The connection count is shared between all parallel package downloads. The default is 4.
+         * @param count The maximum number of HTTP connections to use. If 1, packages are downloaded sequentially.
+         */
+        void setMaxDownloadConnections(int count);
         
     protected:
         /**
@@ -275,7 +313,9 @@ namespace carto {
         public:
             PersistentTaskQueue(const std::string& dbFileName);
 
-            int getActiveTaskId(int currentActiveTaskId = -1) const;
+            int getVersion() const;
+
+            std::vector<int> getActiveTaskIds(const std::vector<int>& currentActiveTaskIds, int maxCount) const;
             std::vector<int> getTaskIds() const;
             Task getTask(int taskId) const;
 
@@ -288,9 +328,57 @@ namespace carto {
 
         private:
             std::shared_ptr<sqlite3pp::database> _localDb;
+            int _version; // incremented whenever tasks are added, removed or reprioritized
             mutable std::recursive_mutex _mutex;
         };
 
+        class DownloadConnectionGuard {
+        public:
+            explicit DownloadConnectionGuard(PackageManager& packageManager);
+            ~DownloadConnectionGuard();
+
+            void release();
+
+        private:
+            PackageManager& _packageManager;
+            bool _acquired;
+        };
+
+        struct ChunkDownloadState {
+            int taskId;
+            std::string packageId;
+            std::string packageURL;
+            std::string packageFileName;
+            std::uint64_t fileSize;
+            std::shared_ptr<PackageHandler> packageHandler;
+            std::string chunkStates; // guarded by mutex, one character per chunk, '1' for downloaded chunks
+            std::deque<std::size_t> pendingChunks; // guarded by mutex
+            std::vector<int> chunkRetries; // guarded by mutex
+            std::atomic<std::uint64_t> totalSize;
+            bool rangesSupported; // guarded by mutex
+            bool failed; // guarded by mutex
+            bool interrupted; // guarded by mutex, set when a worker stops because the task was paused or cancelled
+            int errorCode; // guarded by mutex
+            int runningWorkers; // guarded by mutex
+            std::size_t streamedChunks; // guarded by streamMutex, number of leading chunks passed to the package handler
+            std::condition_variable condition;
+            std::mutex mutex;
+            std::mutex streamMutex;
+
+            ChunkDownloadState(int taskId, const std::string& packageId, const std::string& packageURL, const std::string& packageFileName, std::uint64_t fileSize, const std::shared_ptr<PackageHandler>& packageHandler, const std::string& chunkStates);
+        };
+
+        class ChunkDownloadTask : public CancelableTask {
+        public:
+            ChunkDownloadTask(PackageManager* packageManager, const std::shared_ptr<ChunkDownloadState>& state);
+
+            virtual void run();
+
+        private:
+            PackageManager* _packageManager;
+            std::shared_ptr<ChunkDownloadState> _state;
+        };
+
         struct PauseException : std::exception {
             PauseException() { }
         };
@@ -308,16 +396,23 @@ namespace carto {
         };
 
         void run();
+        void runTask(int taskId);
+        void executeTask(int taskId);
 
         bool downloadPackageList(int taskId);
         bool importPackage(int taskId);
         bool downloadPackage(int taskId);
+        bool downloadPackageChunks(int taskId, const std::string& packageId, const std::string& packageURL, const std::string& packageFileName, std::uint64_t fileSize, const std::shared_ptr<PackageHandler>& packageHandler);
+        void downloadChunks(ChunkDownloadState& state);
+        void streamDownloadedChunks(ChunkDownloadState& state);
         bool removePackage(int taskId);
         bool downloadStyle(int taskId);
         
         void syncLocalPackages();
-        void importLocalPackage(int id, int taskId, const std::string& packageId, PackageType::PackageType packageType, const std::string& packageFileName);
+        void importLocalPackage(int id, int taskId, const std::string& packageId, const std::shared_ptr<PackageHandler>& packageHandler);
         void deleteLocalPackage(int id);
+        void unpinPackageFiles(const std::vector<std::string>& fileNames) const;
+        void deleteDeferredPackageFile(const std::string& fileName);
 
         bool isTaskCancelled(int taskId) const;
         bool isTaskPaused(int taskId) const;
@@ -327,6 +422,9 @@ namespace carto {
         void setTaskCancelled(int taskId);
         void setTaskFailed(int taskId, PackageErrorType::PackageErrorType errorType);
 
+        void acquireDownloadConnection();
+        void releaseDownloadConnection();
+
         std::string loadPackageListJson(const std::string& jsonFileName) const;
         void savePackageListJson(const std::string& jsonFileName, const std::string& json) const;
 
@@ -340,8 +438,17 @@ namespace carto {
         static std::string EncodeTileMask(const std::shared_ptr<PackageTileMask>& tileMask);
 
         static int DownloadFile(const std::string& url, NetworkUtils::HandlerFunc handler, std::uint64_t offset = 0);
+        static bool VerifyPackageFile(const std::string& fileName);
+        static bool SaveChunkStates(const std::string& chunkFileName, const std::string& chunkStates);
+        static void ThrowDownloadException(int errorCode, const std::string& packageId);
 
         static const int DEFAULT_TILEMASK_ZOOMLEVEL;
+        static const int DEFAULT_MAX_PARALLEL_DOWNLOADS;
+        static const int DEFAULT_MAX_DOWNLOAD_CONNECTIONS;
+        static const std::uint64_t DOWNLOAD_CHUNK_SIZE;
+        static const std::uint64_t MIN_CHUNKED_DOWNLOAD_SIZE;
+        static const int MAX_DOWNLOAD_CHUNK_RETRIES;
+        static const std::size_t CHUNK_STREAM_BUFFER_SIZE;
 
         const std::string _packageListURL;
         const std::string _packageListFileName;
@@ -354,17 +461,31 @@ namespace carto {
         std::shared_ptr<PersistentTaskQueue> _taskQueue;
         std::condition_variable_any _taskQueueCondition; // notified when new tasks are available
         std::shared_ptr<std::thread> _packageManagerThread;
+        std::map<int, std::shared_ptr<std::thread> > _taskThreads;
+        std::vector<int> _runningTaskIds;
+        std::vector<int> _finishedTaskIds;
         std::vector<std::shared_ptr<OnChangeListener> > _onChangeListeners;
         bool _stopped;
 
-        int _prevTaskId;
-        PackageAction::PackageAction _prevAction;
-        int _prevRoundedProgress;
+        int _maxParallelDownloads;
+        int _maxDownloadConnections;
+        int _activeDownloadConnections;
+        std::condition_variable_any _downloadConnectionCondition; // notified when download connections are released
+        std::shared_ptr<CancelableThreadPool> _chunkDownloadThreadPool;
+
+        mutable std::vector<int> _activeTaskIds; // cached result of the task queue query, used for pause checks
+        mutable std::vector<int> _activeTaskIdsRunningTaskIds;
+        mutable int _activeTaskIdsQueueVersion;
+        mutable int _activeTaskIdsMaxCount;
+
+        std::map<int, std::pair<PackageAction::PackageAction, int> > _reportedTaskProgress; // last reported action and rounded progress per task
 
         ThreadSafeDirectorPtr<PackageManagerListener> _packageManagerListener;
 
         mutable std::shared_ptr<std::vector<std::shared_ptr<PackageInfo> > > _serverPackageCache;
         mutable std::map<std::shared_ptr<PackageInfo>, std::shared_ptr<PackageHandler> > _packageHandlerCache;
+        mutable std::map<std::string, int> _pinnedPackageFiles; // reference counts of package files in use
+        mutable std::map<std::string, PackageType::PackageType> _deferredPackageFiles; // files of removed packages, deleted once unpinned
 
         mutable std::recursive_mutex _mutex; // guards all state
     };
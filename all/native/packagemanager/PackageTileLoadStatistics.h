@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2016 CartoDB. All rights reserved.
+ * Copying and using this code is allowed only according
+ * to license terms, as given in https://cartodb.com/terms/
+ */
+
+#ifndef _CARTO_PACKAGETILELOADSTATISTICS_H_
+#define _CARTO_PACKAGETILELOADSTATISTICS_H_
+
+#ifdef _CARTO_PACKAGEMANAGER_SUPPORT
+
+namespace carto {
+
+    /**
+     * Cumulative tile loading statistics of map packages.
+     * Decryption and decompression times can be used to check which of the two dominates tile loading.
+     */
+    class PackageTileLoadStatistics {
+    public:
+        /**
+         * Constructs a new statistics object.
+         * @param loadedTileCount The number of tiles read from the packages.
+         * @param cacheHitCount The number of tiles returned from the decoded tile caches.
+         * @param decryptTime The total time spent on decrypting tiles (in microseconds).
+         * @param inflateTime The total time spent on decompressing tiles (in microseconds).
+         */
+        PackageTileLoadStatistics(long long loadedTileCount, long long cacheHitCount, long long decryptTime, long long inflateTime) : _loadedTileCount(loadedTileCount), _cacheHitCount(cacheHitCount), _decryptTime(decryptTime), _inflateTime(inflateTime) { }
+
+        /**
+         * Returns the number of tiles read from the packages.
+         * @return The number of tiles read from the packages.
+         */
+        long long getLoadedTileCount() const {
+            return _loadedTileCount;
+        }
+
+        /**
+         * Returns the number of tiles returned from the decoded tile caches.
+         * @return The number of tiles returned from the decoded tile caches.
+         */
+        long long getCacheHitCount() const {
+            return _cacheHitCount;
+        }
+
+        /**
+         * Returns the total time spent on decrypting tiles.
+         * @return The total time spent on decrypting tiles (in microseconds).
+         */
+        long long getDecryptTime() const {
+            return _decryptTime;
+        }
+
+        /**
+         * Returns the total time spent on decompressing tiles.
+         * @return The total time spent on decompressing tiles (in microseconds).
+         */
+        long long getInflateTime() const {
+            return _inflateTime;
+        }
+
+    private:
+        long long _loadedTileCount;
+        long long _cacheHitCount;
+        long long _decryptTime;
+        long long _inflateTime;
+    };
+}
+
+#endif
+
+#endif
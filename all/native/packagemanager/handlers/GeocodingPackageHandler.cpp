@@ -4,17 +4,103 @@
 #include "packagemanager/PackageTileMask.h"
 #include "utils/Log.h"
 
+#include <vector>
+
 #include <stdext/utf8_filesystem.h>
 #include <stdext/ungzip.h>
 
+#include <zlib.h>
+
 #include <sqlite3pp.h>
 
 namespace carto {
 
+    class GeocodingPackageHandler::ImportStream {
+    public:
+        explicit ImportStream(const std::string& fileName) : _stream(), _file(), _buffer(65536), _offset(0), _finished(false), _failed(false) {
+            if (inflateInit2(&_stream, 16 + MAX_WBITS) != Z_OK) { // gzip format
+                _failed = true;
+                return;
+            }
+            FILE* fpRaw = utf8_filesystem::fopen(fileName.c_str(), "wb");
+            if (!fpRaw) {
+                _failed = true;
+                return;
+            }
+            _file = std::shared_ptr<FILE>(fpRaw, fclose);
+        }
+
+        ~ImportStream() {
+            inflateEnd(&_stream);
+        }
+
+        std::uint64_t getOffset() const {
+            return _offset;
+        }
+
+        bool isFinished() const {
+            return _finished && !_failed;
+        }
+
+        void write(std::uint64_t offset, const unsigned char* data, std::size_t size) {
+            if (_failed || offset != _offset) {
+                _failed = true;
+                return;
+            }
+            _offset += size;
+            if (_finished) {
+                _failed = true; // trailing data after the gzip stream
+                return;
+            }
+
+            _stream.next_in = const_cast<Bytef*>(data);
+            _stream.avail_in = static_cast<uInt>(size);
+            while (true) {
+                _stream.next_out = _buffer.data();
+                _stream.avail_out = static_cast<uInt>(_buffer.size());
+                int result = inflate(&_stream, Z_NO_FLUSH);
+                if (result != Z_OK && result != Z_STREAM_END && result != Z_BUF_ERROR) {
+                    _failed = true;
+                    return;
+                }
+                std::size_t outputSize = _buffer.size() - _stream.avail_out;
+                if (outputSize > 0 && fwrite(_buffer.data(), sizeof(unsigned char), outputSize, _file.get()) != outputSize) {
+                    _failed = true;
+                    return;
+                }
+                if (result == Z_STREAM_END) {
+                    _finished = true;
+                    _failed = _stream.avail_in > 0;
+                    return;
+                }
+                if (_stream.avail_in == 0 && _stream.avail_out > 0) {
+                    return;
+                }
+            }
+        }
+
+        bool close() {
+            if (_file && fflush(_file.get()) != 0) {
+                _failed = true;
+            }
+            _file.reset();
+            return !_failed;
+        }
+
+    private:
+        z_stream _stream;
+        std::shared_ptr<FILE> _file;
+        std::vector<unsigned char> _buffer;
+        std::uint64_t _offset;
+        bool _finished;
+        bool _failed;
+    };
+
     GeocodingPackageHandler::GeocodingPackageHandler(const std::string& fileName) :
         PackageHandler(fileName),
         _uncompressedFileName(fileName + ".uncompressed"),
-        _database()
+        _database(),
+        _importStream()
     {
     }
 
@@ -24,10 +110,11 @@ namespace carto {
     std::shared_ptr<sqlite3pp::database> GeocodingPackageHandler::getGeocodingDatabase() {
         std::lock_guard<std::recursive_mutex> lock(_mutex);
 
+        // The connection is shared by concurrent geocoder queries, so it is opened in serialized mode
         if (!_database) {
             _database = std::make_shared<sqlite3pp::database>();
-            if (_database->connect_v2(_uncompressedFileName.c_str(), SQLITE_OPEN_READONLY) != SQLITE_OK) { // try locally uncompressed package first
-                if (_database->connect_v2(_fileName.c_str(), SQLITE_OPEN_READONLY) != SQLITE_OK) { // assume that the package was not gzipped, so use original file
+            if (_database->connect_v2(_uncompressedFileName.c_str(), SQLITE_OPEN_READONLY | SQLITE_OPEN_FULLMUTEX) != SQLITE_OK) { // try locally uncompressed package first
+                if (_database->connect_v2(_fileName.c_str(), SQLITE_OPEN_READONLY | SQLITE_OPEN_FULLMUTEX) != SQLITE_OK) { // assume that the package was not gzipped, so use original file
                     Log::Errorf("GeocodingPackageHandler::getGeocodingDatabase: Can not connect to database %s", _fileName.c_str());
                     _database.reset();
                 }
@@ -36,7 +123,32 @@ namespace carto {
         return _database;
     }
 
+    void GeocodingPackageHandler::onImportPackageData(std::uint64_t offset, const unsigned char* data, std::size_t size) {
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+        // Uncompress the package while it is received, so that no extra pass is needed after the package is complete
+        if (offset == 0 && (!_importStream || _importStream->getOffset() != 0)) {
+            _importStream.reset();
+            _importStream = std::make_shared<ImportStream>(_uncompressedFileName);
+        }
+        if (_importStream) {
+            _importStream->write(offset, data, size);
+        }
+    }
+
     void GeocodingPackageHandler::onImportPackage() {
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+        std::shared_ptr<ImportStream> importStream;
+        std::swap(importStream, _importStream);
+        if (importStream) {
+            bool finished = importStream->isFinished();
+            if (importStream->close() && finished) {
+                return;
+            }
+            Log::Infof("GeocodingPackageHandler::onImportPackage: Package was not uncompressed while streaming, uncompressing %s", _fileName.c_str());
+        }
+
         std::shared_ptr<FILE> fpIn(utf8_filesystem::fopen(_fileName.c_str(), "rb"), fclose);
         std::shared_ptr<FILE> fpOut(utf8_filesystem::fopen(_uncompressedFileName.c_str(), "wb"), fclose);
         if (!zlib::ungzip_file(fpIn.get(), fpOut.get())) {
@@ -46,6 +158,9 @@ namespace carto {
     }
 
     void GeocodingPackageHandler::onDeletePackage() {
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+        _importStream.reset();
         utf8_filesystem::unlink(_uncompressedFileName.c_str());
     }
 
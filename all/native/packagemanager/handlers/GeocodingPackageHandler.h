@@ -24,14 +24,18 @@ namespace carto {
 
         std::shared_ptr<sqlite3pp::database> getGeocodingDatabase();
 
+        virtual void onImportPackageData(std::uint64_t offset, const unsigned char* data, std::size_t size);
         virtual void onImportPackage();
         virtual void onDeletePackage();
 
         virtual std::shared_ptr<PackageTileMask> calculateTileMask() const;
 
     private:
+        class ImportStream;
+
         const std::string _uncompressedFileName;
         std::shared_ptr<sqlite3pp::database> _database;
+        std::shared_ptr<ImportStream> _importStream;
     };
     
 }
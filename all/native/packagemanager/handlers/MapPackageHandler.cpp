@@ -6,10 +6,16 @@
 #include "packagemanager/PackageTileMask.h"
 #include "utils/Log.h"
 
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <set>
+
 #include <stdext/zlib.h>
 
 #include <sqlite3pp.h>
-#include <sqlite3ppext.h>
 
 #include <rc5.h>
 #include <sha.h>
@@ -19,13 +25,367 @@
 
 namespace carto {
 
+    // Parses the SQLite b-tree pages of the package while it is received and collects the coordinates of all rows of the tiles table.
+    // The pages can arrive in any order, so the tree is only walked once the package is complete. Any unexpected structure
+    // (schema spanning several pages, views, integer primary keys, overflowing records) disables the scanner.
+    class MapPackageHandler::ImportScanner {
+    public:
+        ImportScanner() : _page(), _pageSize(0), _usableSize(0), _pageNumber(1), _offset(0), _tilesRootPage(0), _zoomColumn(-1), _xColumn(-1), _yColumn(-1), _interiorPages(), _leafPages(), _failed(false) {
+        }
+
+        std::uint64_t getOffset() const {
+            return _offset;
+        }
+
+        void write(std::uint64_t offset, const unsigned char* data, std::size_t size) {
+            if (_failed || offset != _offset) {
+                _failed = true;
+                return;
+            }
+            _offset += size;
+
+            while (size > 0 && !_failed) {
+                std::size_t pageSize = (_pageSize > 0 ? _pageSize : FILE_HEADER_SIZE);
+                std::size_t count = std::min(size, pageSize - _page.size());
+                _page.insert(_page.end(), data, data + count);
+                data += count;
+                size -= count;
+                if (_page.size() < pageSize) {
+                    continue;
+                }
+                if (_pageSize == 0) {
+                    readFileHeader();
+                    continue;
+                }
+                readPage();
+                _page.clear();
+                _pageNumber++;
+            }
+        }
+
+        bool getTiles(std::vector<MapTile>& tiles) const {
+            if (_failed || _tilesRootPage == 0) {
+                return false;
+            }
+
+            std::vector<std::uint32_t> pageStack(1, _tilesRootPage);
+            std::set<std::uint32_t> visitedPages;
+            while (!pageStack.empty()) {
+                std::uint32_t pageNumber = pageStack.back();
+                pageStack.pop_back();
+                if (!visitedPages.insert(pageNumber).second) {
+                    return false;
+                }
+                auto interiorIt = _interiorPages.find(pageNumber);
+                if (interiorIt != _interiorPages.end()) {
+                    pageStack.insert(pageStack.end(), interiorIt->second.begin(), interiorIt->second.end());
+                    continue;
+                }
+                auto leafIt = _leafPages.find(pageNumber);
+                if (leafIt == _leafPages.end() || !leafIt->second.valid) {
+                    return false; // missing page or a page that could not be parsed
+                }
+                tiles.insert(tiles.end(), leafIt->second.tiles.begin(), leafIt->second.tiles.end());
+            }
+            return true;
+        }
+
+    private:
+        struct LeafPage {
+            bool valid;
+            std::vector<MapTile> tiles;
+        };
+
+        struct Column {
+            std::uint64_t serialType;
+            std::size_t offset;
+        };
+
+        void readFileHeader() {
+            static const char sqliteHeader[16] = { 'S', 'Q', 'L', 'i', 't', 'e', ' ', 'f', 'o', 'r', 'm', 'a', 't', ' ', '3', 0 };
+            if (!std::equal(sqliteHeader, sqliteHeader + sizeof(sqliteHeader), reinterpret_cast<const char*>(_page.data()))) {
+                _failed = true;
+                return;
+            }
+            std::size_t pageSize = ReadUInt(&_page[16], 2);
+            if (pageSize == 1) {
+                pageSize = 65536;
+            }
+            if (pageSize < 512 || (pageSize & (pageSize - 1)) != 0 || _page[20] >= pageSize - 480 || ReadUInt(&_page[56], 4) != 1) { // only UTF-8 schemas are supported
+                _failed = true;
+                return;
+            }
+            _pageSize = pageSize;
+            _usableSize = pageSize - _page[20];
+        }
+
+        void readPage() {
+            std::size_t headerOffset = (_pageNumber == 1 ? FILE_HEADER_SIZE : 0);
+            unsigned char pageType = _page[headerOffset];
+            if (pageType == INTERIOR_TABLE_PAGE) {
+                if (_pageNumber == 1) {
+                    _failed = true; // schema does not fit on the first page
+                    return;
+                }
+                readInteriorPage(headerOffset);
+            } else if (pageType == LEAF_TABLE_PAGE) {
+                if (_pageNumber == 1) {
+                    readSchemaPage(headerOffset);
+                } else if (_tilesRootPage != 0) {
+                    readLeafPage(headerOffset);
+                }
+            } else if (_pageNumber == 1) {
+                _failed = true;
+            }
+        }
+
+        void readSchemaPage(std::size_t headerOffset) {
+            std::size_t cellCount = ReadUInt(&_page[headerOffset + 3], 2);
+            for (std::size_t i = 0; i < cellCount; i++) {
+                std::vector<Column> columns;
+                if (!readLeafCell(headerOffset, i, 5, columns)) {
+                    continue;
+                }
+                std::string type, name, sql;
+                if (!readText(columns[0], type) || !readText(columns[1], name) || !readText(columns[4], sql) || type != "table" || ToLower(name) != "tiles") {
+                    continue;
+                }
+                long long rootPage = 0;
+                if (!readInteger(columns[3], rootPage) || rootPage <= 1 || !FindTileColumns(sql, _zoomColumn, _xColumn, _yColumn)) {
+                    break;
+                }
+                _tilesRootPage = static_cast<std::uint32_t>(rootPage);
+            }
+            if (_tilesRootPage == 0) {
+                _failed = true; // tiles is a view or is not stored in a regular table
+            }
+        }
+
+        void readInteriorPage(std::size_t headerOffset) {
+            std::size_t cellCount = ReadUInt(&_page[headerOffset + 3], 2);
+            if (headerOffset + 12 + cellCount * 2 > _usableSize) {
+                return;
+            }
+            std::vector<std::uint32_t>& childPages = _interiorPages[_pageNumber];
+            childPages.reserve(cellCount + 1);
+            for (std::size_t i = 0; i < cellCount; i++) {
+                std::size_t cellOffset = ReadUInt(&_page[headerOffset + 12 + i * 2], 2);
+                if (cellOffset + 4 > _usableSize) {
+                    _interiorPages.erase(_pageNumber);
+                    return;
+                }
+                childPages.push_back(static_cast<std::uint32_t>(ReadUInt(&_page[cellOffset], 4)));
+            }
+            childPages.push_back(static_cast<std::uint32_t>(ReadUInt(&_page[headerOffset + 8], 4)));
+        }
+
+        void readLeafPage(std::size_t headerOffset) {
+            LeafPage& leafPage = _leafPages[_pageNumber];
+            leafPage.valid = false;
+            std::size_t columnCount = std::max(_zoomColumn, std::max(_xColumn, _yColumn)) + 1;
+            std::size_t cellCount = ReadUInt(&_page[headerOffset + 3], 2);
+            for (std::size_t i = 0; i < cellCount; i++) {
+                std::vector<Column> columns;
+                long long zoom = 0, x = 0, y = 0;
+                if (!readLeafCell(headerOffset, i, columnCount, columns) || !readInteger(columns[_zoomColumn], zoom) || !readInteger(columns[_xColumn], x) || !readInteger(columns[_yColumn], y)) {
+                    leafPage.tiles.clear();
+                    return;
+                }
+                if (zoom < 0 || zoom > MAX_ZOOM_LEVEL || x < 0 || y < 0 || x >= (1LL << zoom) || y >= (1LL << zoom)) {
+                    leafPage.tiles.clear();
+                    return;
+                }
+                leafPage.tiles.emplace_back(static_cast<int>(x), static_cast<int>(y), static_cast<int>(zoom), 0);
+            }
+            leafPage.valid = true;
+        }
+
+        bool readLeafCell(std::size_t headerOffset, std::size_t cellIndex, std::size_t columnCount, std::vector<Column>& columns) const {
+            std::size_t pointerOffset = headerOffset + 8 + cellIndex * 2;
+            if (pointerOffset + 2 > _usableSize) {
+                return false;
+            }
+            std::size_t offset = ReadUInt(&_page[pointerOffset], 2);
+            std::uint64_t payloadSize = 0, rowId = 0;
+            if (!ReadVarint(_page, _usableSize, offset, payloadSize) || !ReadVarint(_page, _usableSize, offset, rowId)) {
+                return false;
+            }
+
+            // Only the locally stored part of the payload is available
+            std::uint64_t maxLocal = _usableSize - 35;
+            std::uint64_t localSize = payloadSize;
+            if (payloadSize > maxLocal) {
+                std::uint64_t minLocal = (_usableSize - 12) * 32 / 255 - 23;
+                localSize = minLocal + (payloadSize - minLocal) % (_usableSize - 4);
+                if (localSize > maxLocal) {
+                    localSize = minLocal;
+                }
+            }
+            std::size_t payloadEnd = static_cast<std::size_t>(std::min(static_cast<std::uint64_t>(_usableSize), offset + localSize));
+
+            std::size_t headerStart = offset;
+            std::uint64_t recordHeaderSize = 0;
+            if (!ReadVarint(_page, payloadEnd, offset, recordHeaderSize) || recordHeaderSize > payloadEnd - headerStart) {
+                return false;
+            }
+            std::size_t headerEnd = headerStart + static_cast<std::size_t>(recordHeaderSize);
+            std::size_t valueOffset = headerEnd;
+            while (columns.size() < columnCount && offset < headerEnd) {
+                Column column;
+                if (!ReadVarint(_page, headerEnd, offset, column.serialType)) {
+                    return false;
+                }
+                column.offset = valueOffset;
+                if (GetSerialTypeSize(column.serialType) > payloadEnd - valueOffset) {
+                    return false;
+                }
+                valueOffset += GetSerialTypeSize(column.serialType);
+                columns.push_back(column);
+            }
+            return columns.size() == columnCount;
+        }
+
+        bool readInteger(const Column& column, long long& value) const {
+            switch (column.serialType) {
+            case 1: case 2: case 3: case 4: case 5: case 6: {
+                std::size_t size = GetSerialTypeSize(column.serialType);
+                std::uint64_t bits = ReadUInt(&_page[column.offset], size);
+                if (size < 8 && (bits >> (size * 8 - 1)) != 0) {
+                    bits |= ~std::uint64_t(0) << (size * 8); // sign extend
+                }
+                value = static_cast<long long>(bits);
+                return true;
+            }
+            case 8:
+                value = 0;
+                return true;
+            case 9:
+                value = 1;
+                return true;
+            default:
+                return false;
+            }
+        }
+
+        bool readText(const Column& column, std::string& value) const {
+            if (column.serialType < 13 || column.serialType % 2 == 0) {
+                return false;
+            }
+            value.assign(reinterpret_cast<const char*>(&_page[column.offset]), GetSerialTypeSize(column.serialType));
+            return true;
+        }
+
+        static std::size_t GetSerialTypeSize(std::uint64_t serialType) {
+            static const std::size_t sizes[12] = { 0, 1, 2, 3, 4, 6, 8, 8, 0, 0, 0, 0 };
+            if (serialType < 12) {
+                return sizes[serialType];
+            }
+            return static_cast<std::size_t>((serialType - 12) / 2);
+        }
+
+        static std::uint64_t ReadUInt(const unsigned char* data, std::size_t size) {
+            std::uint64_t value = 0;
+            for (std::size_t i = 0; i < size; i++) {
+                value = (value << 8) | data[i];
+            }
+            return value;
+        }
+
+        static bool ReadVarint(const std::vector<unsigned char>& data, std::size_t end, std::size_t& offset, std::uint64_t& value) {
+            value = 0;
+            for (int i = 0; i < 9; i++) {
+                if (offset >= end) {
+                    return false;
+                }
+                unsigned char byte = data[offset++];
+                if (i == 8) {
+                    value = (value << 8) | byte;
+                    return true;
+                }
+                value = (value << 7) | (byte & 0x7f);
+                if ((byte & 0x80) == 0) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        static std::string ToLower(std::string str) {
+            std::transform(str.begin(), str.end(), str.begin(), [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+            return str;
+        }
+
+        static bool FindTileColumns(const std::string& sql, int& zoomColumn, int& xColumn, int& yColumn) {
+            std::string::size_type begin = sql.find('(');
+            std::string::size_type end = sql.rfind(')');
+            if (begin == std::string::npos || end == std::string::npos || end < begin || ToLower(sql.substr(end)).find("without") != std::string::npos) {
+                return false;
+            }
+
+            // Split column definitions at top level commas and match the names of the columns
+            std::vector<std::string> definitions(1);
+            int depth = 0;
+            for (std::string::size_type i = begin + 1; i < end; i++) {
+                char c = sql[i];
+                if (c == ',' && depth == 0) {
+                    definitions.emplace_back();
+                    continue;
+                }
+                depth += (c == '(' ? 1 : (c == ')' ? -1 : 0));
+                definitions.back() += c;
+            }
+            zoomColumn = xColumn = yColumn = -1;
+            for (std::size_t i = 0; i < definitions.size(); i++) {
+                std::string definition = definitions[i];
+                definition.erase(0, definition.find_first_not_of(" \t\r\n"));
+                std::string name;
+                if (!definition.empty() && std::strchr("\"`[", definition[0])) {
+                    char quote = (definition[0] == '[' ? ']' : definition[0]);
+                    name = definition.substr(1, definition.find(quote, 1) - 1);
+                } else {
+                    name = definition.substr(0, definition.find_first_of(" \t\r\n"));
+                }
+                name = ToLower(name);
+                if (name == "zoom_level") {
+                    zoomColumn = static_cast<int>(i);
+                } else if (name == "tile_column") {
+                    xColumn = static_cast<int>(i);
+                } else if (name == "tile_row") {
+                    yColumn = static_cast<int>(i);
+                }
+            }
+            return zoomColumn >= 0 && xColumn >= 0 && yColumn >= 0;
+        }
+
+        static const std::size_t FILE_HEADER_SIZE;
+        static const unsigned char INTERIOR_TABLE_PAGE;
+        static const unsigned char LEAF_TABLE_PAGE;
+        static const int MAX_ZOOM_LEVEL;
+
+        std::vector<unsigned char> _page;
+        std::size_t _pageSize;
+        std::size_t _usableSize;
+        std::uint32_t _pageNumber;
+        std::uint64_t _offset;
+        std::uint32_t _tilesRootPage;
+        int _zoomColumn;
+        int _xColumn;
+        int _yColumn;
+        std::map<std::uint32_t, std::vector<std::uint32_t> > _interiorPages;
+        std::map<std::uint32_t, LeafPage> _leafPages;
+        bool _failed;
+    };
+
     MapPackageHandler::MapPackageHandler(const std::string& fileName, const std::string& serverEncKey, const std::string& localEncKey) :
         PackageHandler(fileName),
         _serverEncKey(serverEncKey),
         _localEncKey(localEncKey),
         _packageDb(),
-        _decryptFunc(),
-        _sharedDictionary()
+        _encrypted(false),
+        _sharedDictionary(),
+        _importScanner(),
+        _tileCache(TILE_CACHE_SIZE),
+        _tileLoadStats()
     {
     }
 
@@ -47,22 +407,8 @@ namespace carto {
                 return;
             }
 
-            // Create new sqlite decryption function. First check if the database is crypted.
-            std::string encKey = _serverEncKey;
-            bool encrypted = CheckDbEncryption(*_packageDb, _serverEncKey + _localEncKey); // NOTE: this is a hack - though tiles are actually encrypted with server key only, with check that local key is included in the hash also
-            _decryptFunc.reset(new sqlite3pp::ext::function(*_packageDb));
-            _decryptFunc->create("tile_decrypt", [encrypted, encKey](sqlite3pp::ext::context& ctx) {
-                const unsigned char* encData = reinterpret_cast<const unsigned char*>(ctx.get<const void*>(0));
-                std::size_t encSize = ctx.args_bytes(0);
-                int zoom = ctx.get<int>(1);
-                int x = ctx.get<int>(2);
-                int y = ctx.get<int>(3);
-                std::vector<unsigned char> encVector(encData, encData + encSize);
-                if (encrypted) {
-                    DecryptTile(encVector, zoom, x, y, encKey);
-                }
-                ctx.result(encVector.empty() ? nullptr : &encVector[0], static_cast<int>(encVector.size()), false);
-            }, 4);
+            // Check if the database is crypted. Tiles are decrypted when loaded, outside of database queries.
+            _encrypted = CheckDbEncryption(*_packageDb, _serverEncKey + _localEncKey); // NOTE: this is a hack - though tiles are actually encrypted with server key only, with check that local key is included in the hash also
 
             // Try to load shared dictionary
             _sharedDictionary.reset();
@@ -70,7 +416,7 @@ namespace carto {
             for (auto qit = query.begin(); qit != query.end(); qit++) {
                 const unsigned char* dataPtr = reinterpret_cast<const unsigned char*>(qit->get<const void*>(0));
                 std::size_t dataSize = qit->column_bytes(0);
-                _sharedDictionary.reset(new BinaryData(dataPtr, dataSize));
+                _sharedDictionary = std::make_shared<BinaryData>(dataPtr, dataSize);
             }
         }
         catch (const std::exception& ex) {
@@ -82,35 +428,72 @@ namespace carto {
         std::lock_guard<std::recursive_mutex> lock(_mutex);
 
         _packageDb.reset();
-        _decryptFunc.reset();
+        _encrypted = false;
         _sharedDictionary.reset();
+        _tileCache.clear();
     }
 
     std::shared_ptr<BinaryData> MapPackageHandler::loadTile(const MapTile& mapTile) {
-        std::lock_guard<std::recursive_mutex> lock(_mutex);
-
         try {
-            openDatabase();
+            // Read raw tile data from the database. Decryption and decompression is done without holding the lock.
+            std::vector<unsigned char> data;
+            bool encrypted = false;
+            std::shared_ptr<BinaryData> sharedDictionary;
+            {
+                std::lock_guard<std::recursive_mutex> lock(_mutex);
 
-            // Try to load the tile (this could fail, as tile masks may not be complete to the last zoom level)
-            sqlite3pp::query query(*_packageDb, "SELECT tile_decrypt(tile_data, zoom_level, tile_column, tile_row) FROM tiles WHERE zoom_level=:zoom AND tile_column=:x AND tile_row=:y");
-            query.bind(":zoom", mapTile.getZoom());
-            query.bind(":x", mapTile.getX());
-            query.bind(":y", mapTile.getY());
-            for (auto qit = query.begin(); qit != query.end(); qit++) {
-                const unsigned char* dataPtr = reinterpret_cast<const unsigned char*>(qit->get<const void*>(0));
-                std::size_t dataSize = qit->column_bytes(0);
-                std::vector<unsigned char> data(dataPtr, dataPtr + dataSize);
-                if (_sharedDictionary) {
-                    std::vector<unsigned char> uncompressedData;
-                    if (!zlib::inflate_raw(data.data(), data.size(), _sharedDictionary->data(), _sharedDictionary->size(), uncompressedData)) {
-                        Log::Warnf("MapPackageHandler::loadTile: Failed to decompress tile with shared dictionary");
-                        return std::shared_ptr<BinaryData>();
-                    }
-                    std::swap(data, uncompressedData);
+                std::shared_ptr<BinaryData> tileData;
+                if (_tileCache.read(mapTile.getTileId(), tileData)) {
+                    _tileLoadStats.cacheHits++;
+                    return tileData;
                 }
-                return std::make_shared<BinaryData>(std::move(data));
+
+                openDatabase();
+
+                // Try to load the tile (this could fail, as tile masks may not be complete to the last zoom level)
+                bool found = false;
+                sqlite3pp::query query(*_packageDb, "SELECT tile_data FROM tiles WHERE zoom_level=:zoom AND tile_column=:x AND tile_row=:y");
+                query.bind(":zoom", mapTile.getZoom());
+                query.bind(":x", mapTile.getX());
+                query.bind(":y", mapTile.getY());
+                for (auto qit = query.begin(); qit != query.end(); qit++) {
+                    const unsigned char* dataPtr = reinterpret_cast<const unsigned char*>(qit->get<const void*>(0));
+                    std::size_t dataSize = qit->column_bytes(0);
+                    data.assign(dataPtr, dataPtr + dataSize);
+                    found = true;
+                }
+                if (!found) {
+                    return std::shared_ptr<BinaryData>();
+                }
+                encrypted = _encrypted;
+                sharedDictionary = _sharedDictionary;
             }
+
+            auto decryptStartTime = std::chrono::steady_clock::now();
+            if (encrypted) {
+                DecryptTile(data, mapTile.getZoom(), mapTile.getX(), mapTile.getY(), _serverEncKey);
+            }
+            auto inflateStartTime = std::chrono::steady_clock::now();
+            if (sharedDictionary) {
+                std::vector<unsigned char> uncompressedData;
+                if (!zlib::inflate_raw(data.data(), data.size(), sharedDictionary->data(), sharedDictionary->size(), uncompressedData)) {
+                    Log::Warnf("MapPackageHandler::loadTile: Failed to decompress tile with shared dictionary");
+                    return std::shared_ptr<BinaryData>();
+                }
+                std::swap(data, uncompressedData);
+            }
+            auto inflateEndTime = std::chrono::steady_clock::now();
+
+            std::shared_ptr<BinaryData> tileData = std::make_shared<BinaryData>(std::move(data));
+
+            std::lock_guard<std::recursive_mutex> lock(_mutex);
+            _tileLoadStats.tilesLoaded++;
+            _tileLoadStats.decryptTime += std::chrono::duration_cast<std::chrono::microseconds>(inflateStartTime - decryptStartTime).count();
+            _tileLoadStats.inflateTime += std::chrono::duration_cast<std::chrono::microseconds>(inflateEndTime - inflateStartTime).count();
+            if (_packageDb) {
+                _tileCache.put(mapTile.getTileId(), tileData, tileData->size());
+            }
+            return tileData;
         }
         catch (const std::exception& ex) {
             Log::Errorf("MapPackageHandler::loadTile: Exception %s", ex.what());
@@ -118,39 +501,84 @@ namespace carto {
         return std::shared_ptr<BinaryData>();
     }
 
+    MapPackageHandler::TileLoadStats MapPackageHandler::getTileLoadStats() const {
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+        return _tileLoadStats;
+    }
+
+    std::size_t MapPackageHandler::getMemoryUsage() const {
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+        std::size_t usage = _tileCache.size();
+        if (_packageDb) {
+            usage += DATABASE_MEMORY_FOOTPRINT;
+        }
+        if (_sharedDictionary) {
+            usage += _sharedDictionary->size();
+        }
+        return usage;
+    }
+
+    void MapPackageHandler::onImportPackageData(std::uint64_t offset, const unsigned char* data, std::size_t size) {
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+        // Collect tile coordinates while the package is received, so that the tile mask does not need a full table scan afterwards
+        if (offset == 0 && (!_importScanner || _importScanner->getOffset() != 0)) {
+            _importScanner = std::make_shared<ImportScanner>();
+        }
+        if (_importScanner) {
+            _importScanner->write(offset, data, size);
+        }
+    }
+
     void MapPackageHandler::onImportPackage() {
         std::lock_guard<std::recursive_mutex> lock(_mutex);
 
+        _importScanner.reset();
+
         sqlite3pp::database packageDb;
         if (packageDb.connect_v2(_fileName.c_str(), SQLITE_OPEN_READWRITE) != SQLITE_OK) {
             Log::Errorf("MapPackageHandler::onImportPackage: Failed to open database %s", _fileName.c_str());
             return;
         }
         bool encrypted = CheckDbEncryption(packageDb, _serverEncKey);
-        if (encrypted) {
+        if (encrypted && !_localEncKey.empty()) {
             UpdateDbEncryption(packageDb, _serverEncKey + _localEncKey);
         }
     }
 
     void MapPackageHandler::onDeletePackage() {
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+        _importScanner.reset();
+    }
+
+    bool MapPackageHandler::isPackageModifiedOnImport() const {
+        return !_localEncKey.empty(); // the key hash of encrypted packages is updated
     }
 
     std::shared_ptr<PackageTileMask> MapPackageHandler::calculateTileMask() const {
         std::lock_guard<std::recursive_mutex> lock(_mutex);
 
-        // Fetch all tile coordinates and create tilemask from them
-        sqlite3pp::database packageDb;
-        if (packageDb.connect_v2(_fileName.c_str(), SQLITE_OPEN_READONLY) != SQLITE_OK) {
-            Log::Errorf("MapPackageHandler::calculateTileMask: Failed to open database %s", _fileName.c_str());
-            return std::shared_ptr<PackageTileMask>();
-        }
-        sqlite3pp::query query(packageDb, "SELECT zoom_level, tile_column, tile_row FROM tiles");
+        // Use the tile coordinates collected while the package was received, or fetch all of them from the database
         std::vector<MapTile> tiles;
+        if (!_importScanner || !_importScanner->getTiles(tiles)) {
+            if (_importScanner) {
+                Log::Infof("MapPackageHandler::calculateTileMask: Package was not scanned while streaming, reading tiles from %s", _fileName.c_str());
+            }
+            tiles.clear();
+            sqlite3pp::database packageDb;
+            if (packageDb.connect_v2(_fileName.c_str(), SQLITE_OPEN_READONLY) != SQLITE_OK) {
+                Log::Errorf("MapPackageHandler::calculateTileMask: Failed to open database %s", _fileName.c_str());
+                return std::shared_ptr<PackageTileMask>();
+            }
+            sqlite3pp::query query(packageDb, "SELECT zoom_level, tile_column, tile_row FROM tiles");
+            for (auto qit = query.begin(); qit != query.end(); qit++) {
+                tiles.emplace_back(qit->get<int>(1), qit->get<int>(2), qit->get<int>(0), 0);
+            }
+        }
         int maxZoomLevel = 0;
-        for (auto qit = query.begin(); qit != query.end(); qit++) {
-            MapTile tile(qit->get<int>(1), qit->get<int>(2), qit->get<int>(0), 0);
+        for (const MapTile& tile : tiles) {
             maxZoomLevel = std::max(maxZoomLevel, tile.getZoom());
-            tiles.push_back(tile);
         }
         return std::make_shared<PackageTileMask>(tiles, maxZoomLevel);
     }
@@ -247,6 +675,14 @@ namespace carto {
         std::copy(encKey.begin(), encKey.begin() + std::min(encKey.size(), static_cast<std::size_t>(CryptoPP::RC5::DEFAULT_KEYLENGTH)), k);
     }
 
+    const std::size_t MapPackageHandler::TILE_CACHE_SIZE = 8 * 1024 * 1024;
+    const std::size_t MapPackageHandler::DATABASE_MEMORY_FOOTPRINT = 2 * 1024 * 1024; // default SQLite page cache size
+
+    const std::size_t MapPackageHandler::ImportScanner::FILE_HEADER_SIZE = 100;
+    const unsigned char MapPackageHandler::ImportScanner::INTERIOR_TABLE_PAGE = 0x05;
+    const unsigned char MapPackageHandler::ImportScanner::LEAF_TABLE_PAGE = 0x0d;
+    const int MapPackageHandler::ImportScanner::MAX_ZOOM_LEVEL = 24;
+
 }
 
 #endif
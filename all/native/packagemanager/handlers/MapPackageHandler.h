@@ -12,13 +12,13 @@
 #include "core/MapTile.h"
 #include "packagemanager/handlers/PackageHandler.h"
 
+#include <cstdint>
 #include <vector>
 
+#include <stdext/timed_lru_cache.h>
+
 namespace sqlite3pp {
     class database;
-    namespace ext {
-        class function;
-    }
 }
 
 namespace carto {
@@ -26,6 +26,13 @@ namespace carto {
     
     class MapPackageHandler : public PackageHandler {
     public:
+        struct TileLoadStats {
+            std::uint64_t tilesLoaded = 0;
+            std::uint64_t cacheHits = 0;
+            std::uint64_t decryptTime = 0; // in microseconds
+            std::uint64_t inflateTime = 0; // in microseconds
+        };
+
         MapPackageHandler(const std::string& fileName, const std::string& serverEncKey, const std::string& localEncKey);
         virtual ~MapPackageHandler();
 
@@ -33,12 +40,21 @@ namespace carto {
         void closeDatabase();
         std::shared_ptr<BinaryData> loadTile(const MapTile& mapTile);
 
+        TileLoadStats getTileLoadStats() const;
+
+        std::size_t getMemoryUsage() const;
+
+        virtual void onImportPackageData(std::uint64_t offset, const unsigned char* data, std::size_t size);
         virtual void onImportPackage();
         virtual void onDeletePackage();
 
+        virtual bool isPackageModifiedOnImport() const;
+
         virtual std::shared_ptr<PackageTileMask> calculateTileMask() const;
 
     private:
+        class ImportScanner;
+
         static bool CheckDbEncryption(sqlite3pp::database& db, const std::string& encKey);
         static void UpdateDbEncryption(sqlite3pp::database& db, const std::string& encKey);
 
@@ -47,12 +63,19 @@ namespace carto {
         static void DecryptTile(std::vector<unsigned char>& data, int zoom, int x, int y, const std::string& encKey);
         static void SetCipherKeyIV(unsigned char* k, unsigned char* iv, int zoom, int x, int y, const std::string& encKey);
 
+        static const std::size_t TILE_CACHE_SIZE;
+        static const std::size_t DATABASE_MEMORY_FOOTPRINT;
+
         const std::string _serverEncKey;
         const std::string _localEncKey;
 
         std::unique_ptr<sqlite3pp::database> _packageDb;
-        std::unique_ptr<sqlite3pp::ext::function> _decryptFunc;
-        std::unique_ptr<BinaryData> _sharedDictionary;
+        bool _encrypted;
+        std::shared_ptr<BinaryData> _sharedDictionary;
+        std::shared_ptr<ImportScanner> _importScanner;
+
+        cache::timed_lru_cache<long long, std::shared_ptr<BinaryData> > _tileCache; // decrypted and decompressed tiles
+        TileLoadStats _tileLoadStats;
     };
     
 }
@@ -12,6 +12,7 @@
 #include <memory>
 #include <mutex>
 #include <string>
+#include <cstdint>
 
 namespace carto {
     class PackageTileMask;
@@ -20,9 +21,14 @@ namespace carto {
     public:
         virtual ~PackageHandler() { }
 
+        const std::string& getFileName() const { return _fileName; }
+
+        virtual void onImportPackageData(std::uint64_t offset, const unsigned char* data, std::size_t size) { } // called with package data while the package is being downloaded or copied
         virtual void onImportPackage() = 0;
         virtual void onDeletePackage() = 0;
 
+        virtual bool isPackageModifiedOnImport() const { return false; } // if false, the package file may be shared with the import source instead of being copied
+
         virtual std::shared_ptr<PackageTileMask> calculateTileMask() const = 0;
     
     protected:
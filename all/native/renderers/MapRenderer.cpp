@@ -1,6 +1,7 @@
 #include "MapRenderer.h"
 #include "components/Exceptions.h"
 #include "components/Layers.h"
+#include "components/MemoryBudgetManager.h"
 #include "components/ThreadWorker.h"
 #include "core/MapPos.h"
 #include "core/ScreenPos.h"
@@ -541,6 +542,9 @@ namespace carto {
         // Create pending resources
         _glResourceManager->processResources();
 
+        // Redistribute the global memory budget between the caches, if needed. Quotas are applied in a background thread
+        MemoryBudgetManager::GetInstance().update();
+
         // Check if surface has changed
         if (_surfaceChanged.exchange(false)) {
             int width = 0, height = 0;
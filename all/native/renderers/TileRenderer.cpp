@@ -31,6 +31,7 @@ namespace carto {
         _rasterFilterMode(vt::RasterFilterMode::BILINEAR),
         _normalMapShadowColor(0, 0, 0, 255),
         _normalMapHighlightColor(255, 255, 255, 255),
+        _normalMapIntensity(1.0f),
         _horizontalLayerOffset(0),
         _viewDir(0, 0, 0),
         _mainLightDir(0, 0, 0),
@@ -97,6 +98,11 @@ namespace carto {
         _normalMapHighlightColor = color;
     }
 
+    void TileRenderer::setNormalMapIntensity(float intensity) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _normalMapIntensity = intensity;
+    }
+
     void TileRenderer::offsetLayerHorizontally(double offset) {
         std::lock_guard<std::mutex> lock(_mutex);
         _horizontalLayerOffset += offset;
@@ -329,6 +335,7 @@ namespace carto {
                 float highlightAlpha = _normalMapHighlightColor.getA() / 255.0f;
                 glUniform4f(glGetUniformLocation(shaderProgram, "u_highlightColor"), _normalMapHighlightColor.getR() * highlightAlpha / 255.0f, _normalMapHighlightColor.getG() * highlightAlpha / 255.0f, _normalMapHighlightColor.getB() * highlightAlpha / 255.0f, highlightAlpha);
                 glUniform3fv(glGetUniformLocation(shaderProgram, "u_lightDir"), 1, _mainLightDir.data());
+                glUniform1f(glGetUniformLocation(shaderProgram, "u_intensityScale"), _normalMapIntensity);
             });
             tileRenderer->setLightingShaderNormalMap(lightingShaderNormalMap);
         }
@@ -365,10 +372,11 @@ namespace carto {
         uniform vec4 u_shadowColor;
         uniform vec4 u_highlightColor;
         uniform vec3 u_lightDir;
+        uniform mediump float u_intensityScale;
         vec4 applyLighting(lowp vec4 color, mediump vec3 normal, mediump float intensity) {
             mediump float lighting = max(0.0, dot(normal, u_lightDir));
             lowp vec4 shadeColor = mix(u_shadowColor, u_highlightColor, lighting);
-            return shadeColor * color * intensity;
+            return shadeColor * color * (intensity * u_intensityScale);
         }
     )GLSL";
 
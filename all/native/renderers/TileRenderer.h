@@ -53,6 +53,7 @@ namespace carto {
         void setRasterFilterMode(vt::RasterFilterMode filterMode);
         void setNormalMapShadowColor(const Color& color);
         void setNormalMapHighlightColor(const Color& color);
+        void setNormalMapIntensity(float intensity);
 
         void offsetLayerHorizontally(double offset);
     
@@ -86,6 +87,7 @@ namespace carto {
         vt::RasterFilterMode _rasterFilterMode;
         Color _normalMapShadowColor;
         Color _normalMapHighlightColor;
+        float _normalMapIntensity;
         double _horizontalLayerOffset;
         cglib::vec3<float> _viewDir;
         cglib::vec3<float> _mainLightDir;
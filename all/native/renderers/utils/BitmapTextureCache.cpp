@@ -10,13 +10,13 @@ namespace carto {
     }
     
     std::size_t BitmapTextureCache::getCapacity() const {
-        std::lock_guard<std::mutex> lock(_mutex);
-        return _cache.capacity();
+        return _memoryBudgetClient.getCapacity();
     }
     
     void BitmapTextureCache::setCapacity(std::size_t capacityInBytes) {
         std::lock_guard<std::mutex> lock(_mutex);
-        _cache.resize(capacityInBytes);
+        _memoryBudgetClient.setCapacity(capacityInBytes);
+        _cache.resize(_memoryBudgetClient.getCacheCapacity(0));
     }
 
     void BitmapTextureCache::clear() {
@@ -30,13 +30,15 @@ namespace carto {
             std::lock_guard<std::mutex> lock(_mutex);
             _cache.read(bitmap, texture);
         }
+        _memoryBudgetClient.recordAccess(static_cast<bool>(texture));
         return (texture && texture->isValid() ? texture : std::shared_ptr<Texture>());
     }
     
     BitmapTextureCache::BitmapTextureCache(const std::weak_ptr<GLResourceManager>& manager, std::size_t capacityInBytes) :
         GLResource(manager),
         _cache(capacityInBytes),
-        _mutex()
+        _mutex(),
+        _memoryBudgetClient("BitmapTextureCache", capacityInBytes, [this]() { return getCacheMemoryUsage(); }, [this]() { applyCacheMemoryQuota(); })
     {
     }
     
@@ -56,6 +58,16 @@ namespace carto {
         return texture;
     }
         
+    MemoryBudgetManager::Client::Usage BitmapTextureCache::getCacheMemoryUsage() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return MemoryBudgetManager::Client::Usage(_cache.size(), 0);
+    }
+
+    void BitmapTextureCache::applyCacheMemoryQuota() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _cache.resize(_memoryBudgetClient.getCacheCapacity(0));
+    }
+
     void BitmapTextureCache::create() {
         std::lock_guard<std::mutex> lock(_mutex);
         _cache.clear();
@@ -7,6 +7,7 @@
 #ifndef _CARTO_BITMAPTEXTURECACHE_H_
 #define _CARTO_BITMAPTEXTURECACHE_H_
 
+#include "components/MemoryBudgetManager.h"
 #include "renderers/utils/GLResource.h"
 
 #include <memory>
@@ -39,9 +40,14 @@ namespace carto {
         virtual void destroy();
 
     private:
+        MemoryBudgetManager::Client::Usage getCacheMemoryUsage() const;
+        void applyCacheMemoryQuota();
+
         mutable cache::timed_lru_cache<std::shared_ptr<Bitmap>, std::shared_ptr<Texture> > _cache;
         
         mutable std::mutex _mutex;
+
+        mutable MemoryBudgetManager::Client _memoryBudgetClient;
     };
         
 }
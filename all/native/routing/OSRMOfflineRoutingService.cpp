@@ -2,6 +2,7 @@
 
 #include "OSRMOfflineRoutingService.h"
 #include "components/Exceptions.h"
+#include "components/CancelableThreadPool.h"
 #include "projections/Projection.h"
 #include "routing/OSRMRoutingProxy.h"
 #include "utils/Const.h"
@@ -17,7 +18,8 @@ namespace carto {
 
     OSRMOfflineRoutingService::OSRMOfflineRoutingService(const std::string& path) :
         RoutingService(),
-        _routeFinder()
+        _routeFinder(),
+        _matrixThreadPool(OSRMRoutingProxy::CreateMatrixThreadPool())
     {
         osrm::Graph::Settings graphSettings;
         auto graph = std::make_shared<osrm::Graph>(graphSettings);
@@ -33,6 +35,7 @@ namespace carto {
     }
 
     OSRMOfflineRoutingService::~OSRMOfflineRoutingService() {
+        _matrixThreadPool->deinit();
     }
 
     std::string OSRMOfflineRoutingService::getProfile() const {
@@ -57,6 +60,14 @@ namespace carto {
         return OSRMRoutingProxy::CalculateRoute(_routeFinder, request);
     }
 
+    std::shared_ptr<RoutingMatrixResult> OSRMOfflineRoutingService::calculateMatrix(const std::shared_ptr<RoutingMatrixRequest>& request) const {
+        if (!request) {
+            throw NullArgumentException("Null request");
+        }
+
+        return OSRMRoutingProxy::CalculateMatrix(_routeFinder, _matrixThreadPool, request);
+    }
+
 }
 
 #endif
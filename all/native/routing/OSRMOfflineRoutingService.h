@@ -19,6 +19,8 @@ namespace carto {
         class RouteFinder;
     }
 
+    class CancelableThreadPool;
+
     /**
      * An offline routing service that uses Carto-specific routing 
      * database file created from OSRM prepared routing files.
@@ -41,8 +43,11 @@ namespace carto {
 
         virtual std::shared_ptr<RoutingResult> calculateRoute(const std::shared_ptr<RoutingRequest>& request) const;
 
+        virtual std::shared_ptr<RoutingMatrixResult> calculateMatrix(const std::shared_ptr<RoutingMatrixRequest>& request) const;
+
     protected:
         std::shared_ptr<osrm::RouteFinder> _routeFinder;
+        std::shared_ptr<CancelableThreadPool> _matrixThreadPool;
     };
     
 }
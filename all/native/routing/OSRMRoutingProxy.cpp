@@ -3,10 +3,13 @@
 #include "OSRMRoutingProxy.h"
 #include "core/BinaryData.h"
 #include "components/Exceptions.h"
+#include "components/CancelableThreadPool.h"
 #include "projections/Projection.h"
 #include "projections/EPSG3857.h"
 #include "routing/RoutingRequest.h"
 #include "routing/RoutingResult.h"
+#include "routing/RoutingMatrixRequest.h"
+#include "routing/RoutingMatrixResult.h"
 #include "routing/RouteMatchingRequest.h"
 #include "routing/RouteMatchingResult.h"
 #include "network/HTTPClient.h"
@@ -14,6 +17,11 @@
 #include "utils/Const.h"
 #include "utils/Log.h"
 
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 #include <boost/lexical_cast.hpp>
 
 #include <rapidjson/rapidjson.h>
@@ -94,6 +102,75 @@ namespace carto {
         return std::make_shared<RoutingResult>(proj, points, instructions);
     }
 
+    struct OSRMRoutingProxy::MatrixState {
+        std::shared_ptr<osrm::RouteFinder> routeFinder;
+        std::shared_ptr<RoutingMatrixRequest> request;
+        std::vector<osrm::WGSPos> sourcePoints;
+        std::vector<osrm::WGSPos> targetPoints;
+        std::vector<double> distances;
+        std::vector<double> times;
+        std::atomic<std::size_t> nextRow;
+        std::size_t completedRows; // guarded by mutex
+        std::condition_variable condition;
+        std::mutex mutex;
+
+        MatrixState(const std::shared_ptr<osrm::RouteFinder>& routeFinder, const std::shared_ptr<RoutingMatrixRequest>& request) :
+            routeFinder(routeFinder),
+            request(request),
+            sourcePoints(),
+            targetPoints(),
+            distances(),
+            times(),
+            nextRow(0),
+            completedRows(0),
+            condition(),
+            mutex()
+        {
+        }
+    };
+
+    std::shared_ptr<RoutingMatrixResult> OSRMRoutingProxy::CalculateMatrix(const std::shared_ptr<osrm::RouteFinder>& routeFinder, const std::shared_ptr<CancelableThreadPool>& threadPool, const std::shared_ptr<RoutingMatrixRequest>& request) {
+        std::shared_ptr<Projection> proj = request->getProjection();
+
+        // Convert all points only once, rows are then processed in parallel
+        auto state = std::make_shared<MatrixState>(routeFinder, request);
+        state->sourcePoints.reserve(request->getSourcePoints().size());
+        for (const MapPos& pos : request->getSourcePoints()) {
+            MapPos wgsPos = proj->toWgs84(pos);
+            state->sourcePoints.emplace_back(wgsPos.getY(), wgsPos.getX());
+        }
+        state->targetPoints.reserve(request->getTargetPoints().size());
+        for (const MapPos& pos : request->getTargetPoints()) {
+            MapPos wgsPos = proj->toWgs84(pos);
+            state->targetPoints.emplace_back(wgsPos.getY(), wgsPos.getX());
+        }
+        state->distances.assign(state->sourcePoints.size() * state->targetPoints.size(), -1);
+        state->times.assign(state->sourcePoints.size() * state->targetPoints.size(), -1);
+
+        // The calling thread also processes rows, so the matrix is completed even if the pool is busy or stopped.
+        // Tasks that start after all rows are claimed simply exit.
+        if (threadPool) {
+            std::size_t taskCount = std::min(state->sourcePoints.size(), static_cast<std::size_t>(threadPool->getPoolSize()) + 1);
+            for (std::size_t i = 1; i < taskCount; i++) {
+                threadPool->execute(std::make_shared<MatrixTask>(state));
+            }
+        }
+        ProcessMatrixRows(*state);
+
+        {
+            std::unique_lock<std::mutex> lock(state->mutex);
+            state->condition.wait(lock, [&state]() { return state->completedRows >= state->sourcePoints.size(); });
+        }
+
+        return std::make_shared<RoutingMatrixResult>(static_cast<int>(state->sourcePoints.size()), static_cast<int>(state->targetPoints.size()), state->distances, state->times);
+    }
+
+    std::shared_ptr<CancelableThreadPool> OSRMRoutingProxy::CreateMatrixThreadPool() {
+        auto threadPool = std::make_shared<CancelableThreadPool>();
+        threadPool->setPoolSize(static_cast<int>(std::max(1u, std::min(std::thread::hardware_concurrency(), MAX_MATRIX_THREADS))) - 1);
+        return threadPool;
+    }
+
     std::shared_ptr<RoutingResult> OSRMRoutingProxy::CalculateRoute(HTTPClient& httpClient, const std::string& url, const std::shared_ptr<RoutingRequest>& request) {
         std::shared_ptr<Projection> proj = request->getProjection();
         EPSG3857 epsg3857;
@@ -289,10 +366,60 @@ namespace carto {
         return points;
     }
     
+    OSRMRoutingProxy::MatrixTask::MatrixTask(const std::shared_ptr<MatrixState>& state) :
+        _state(state)
+    {
+    }
+
+    void OSRMRoutingProxy::MatrixTask::run() {
+        if (!isCanceled()) {
+            ProcessMatrixRows(*_state);
+        }
+    }
+
     OSRMRoutingProxy::OSRMRoutingProxy() {
     }
+
+    void OSRMRoutingProxy::ProcessMatrixRows(MatrixState& state) {
+        const std::vector<MapPos>& sourceMapPoints = state.request->getSourcePoints();
+        const std::vector<MapPos>& targetMapPoints = state.request->getTargetPoints();
+        for (std::size_t i = state.nextRow++; i < state.sourcePoints.size(); i = state.nextRow++) {
+            for (std::size_t j = 0; j < state.targetPoints.size(); j++) {
+                std::size_t index = i * state.targetPoints.size() + j;
+                if (sourceMapPoints[i] == targetMapPoints[j]) {
+                    state.distances[index] = state.times[index] = 0;
+                    continue;
+                }
+
+                // Only totals are needed, so skip geometry and instruction translation
+                try {
+                    osrm::Result result = state.routeFinder->find(osrm::Query(state.sourcePoints[i], state.targetPoints[j]));
+                    if (result.getStatus() == osrm::Result::Status::FAILED) {
+                        continue;
+                    }
+                    double distance = 0, time = 0;
+                    for (const osrm::Instruction& instr : result.getInstructions()) {
+                        distance += instr.getDistance();
+                        time += instr.getTime();
+                    }
+                    state.distances[index] = distance;
+                    state.times[index] = time;
+                }
+                catch (const std::exception& ex) {
+                    Log::Errorf("OSRMRoutingProxy::CalculateMatrix: Exception while calculating route: %s", ex.what());
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(state.mutex);
+            if (++state.completedRows >= state.sourcePoints.size()) {
+                state.condition.notify_all();
+            }
+        }
+    }
     
     const double OSRMRoutingProxy::COORDINATE_SCALE = 1.0e-6;
+
+    const unsigned int OSRMRoutingProxy::MAX_MATRIX_THREADS = 8;
     
 }
 
@@ -10,6 +10,7 @@
 #ifdef _CARTO_ROUTING_SUPPORT
 
 #include "core/MapPos.h"
+#include "components/CancelableTask.h"
 #include "routing/RoutingInstruction.h"
 
 #include <memory>
@@ -21,20 +22,44 @@ namespace carto {
         class RouteFinder;
     }
     
+    class CancelableThreadPool;
     class HTTPClient;
     class RoutingRequest;
     class RoutingResult;
+    class RoutingMatrixRequest;
+    class RoutingMatrixResult;
     class RouteMatchingRequest;
     class RouteMatchingResult;
 
+    // Route finders are shared between threads: the routing services do not serialize calculateRoute calls
+    // and CalculateMatrix processes rows concurrently with the same route finder. Both rely on RouteFinder::find
+    // being reentrant for a shared graph.
     class OSRMRoutingProxy {
     public:
         static std::shared_ptr<RoutingResult> CalculateRoute(const std::shared_ptr<osrm::RouteFinder>& routeFinder, const std::shared_ptr<RoutingRequest>& request);
         
         static std::shared_ptr<RoutingResult> CalculateRoute(HTTPClient& httpClient, const std::string& url, const std::shared_ptr<RoutingRequest>& request);
 
+        static std::shared_ptr<RoutingMatrixResult> CalculateMatrix(const std::shared_ptr<osrm::RouteFinder>& routeFinder, const std::shared_ptr<CancelableThreadPool>& threadPool, const std::shared_ptr<RoutingMatrixRequest>& request);
+
+        static std::shared_ptr<CancelableThreadPool> CreateMatrixThreadPool();
+
     private:
+        struct MatrixState;
+
+        class MatrixTask : public CancelableTask {
+        public:
+            explicit MatrixTask(const std::shared_ptr<MatrixState>& state);
+
+            virtual void run();
+
+        private:
+            std::shared_ptr<MatrixState> _state;
+        };
+
         OSRMRoutingProxy();
+
+        static void ProcessMatrixRows(MatrixState& state);
         
         static float CalculateTurnAngle(const std::vector<MapPos>& epsg3857Points, int pointIndex);
         
@@ -45,6 +70,7 @@ namespace carto {
         static std::vector<MapPos> DecodeGeometry(const std::string& encodedGeometry);
         
         static const double COORDINATE_SCALE;
+        static const unsigned int MAX_MATRIX_THREADS;
     };
     
 }
@@ -2,6 +2,7 @@
 
 #include "PackageManagerRoutingService.h"
 #include "components/Exceptions.h"
+#include "components/CancelableThreadPool.h"
 #include "packagemanager/PackageInfo.h"
 #include "packagemanager/handlers/RoutingPackageHandler.h"
 #include "projections/Projection.h"
@@ -22,6 +23,7 @@ namespace carto {
         _packageManager(packageManager),
         _cachedPackageFileMap(),
         _cachedRouteFinder(),
+        _matrixThreadPool(OSRMRoutingProxy::CreateMatrixThreadPool()),
         _mutex()
     {
         if (!packageManager) {
@@ -35,6 +37,7 @@ namespace carto {
     PackageManagerRoutingService::~PackageManagerRoutingService() {
         _packageManager->unregisterOnChangeListener(_packageManagerListener);
         _packageManagerListener.reset();
+        _matrixThreadPool->deinit();
     }
 
     std::string PackageManagerRoutingService::getProfile() const {
@@ -59,43 +62,55 @@ namespace carto {
         // Do routing via package manager, so that all packages are locked during routing
         std::shared_ptr<RoutingResult> result;
         _packageManager->accessLocalPackages([this, &result, &request](const std::map<std::shared_ptr<PackageInfo>, std::shared_ptr<PackageHandler> >& packageHandlerMap) {
-            // Build map of routing packages and graph files
-            std::map<std::shared_ptr<PackageInfo>, std::shared_ptr<std::ifstream> > packageFileMap;
-            for (auto it = packageHandlerMap.begin(); it != packageHandlerMap.end(); it++) {
-                if (auto routingHandler = std::dynamic_pointer_cast<RoutingPackageHandler>(it->second)) {
-                    if (std::shared_ptr<std::ifstream> graphFile = routingHandler->getGraphFile()) {
-                        packageFileMap[it->first] = graphFile;
-                    }
+            result = OSRMRoutingProxy::CalculateRoute(getRouteFinder(packageHandlerMap), request);
+        });
+
+        return result;
+    }
+
+    std::shared_ptr<RoutingMatrixResult> PackageManagerRoutingService::calculateMatrix(const std::shared_ptr<RoutingMatrixRequest>& request) const {
+        if (!request) {
+            throw NullArgumentException("Null request");
+        }
+
+        std::shared_ptr<RoutingMatrixResult> result;
+        _packageManager->accessLocalPackages([this, &result, &request](const std::map<std::shared_ptr<PackageInfo>, std::shared_ptr<PackageHandler> >& packageHandlerMap) {
+            result = OSRMRoutingProxy::CalculateMatrix(getRouteFinder(packageHandlerMap), _matrixThreadPool, request);
+        });
+
+        return result;
+    }
+
+    std::shared_ptr<osrm::RouteFinder> PackageManagerRoutingService::getRouteFinder(const std::map<std::shared_ptr<PackageInfo>, std::shared_ptr<PackageHandler> >& packageHandlerMap) const {
+        // Build map of routing packages and graph files
+        std::map<std::shared_ptr<PackageInfo>, std::shared_ptr<std::ifstream> > packageFileMap;
+        for (auto it = packageHandlerMap.begin(); it != packageHandlerMap.end(); it++) {
+            if (auto routingHandler = std::dynamic_pointer_cast<RoutingPackageHandler>(it->second)) {
+                if (std::shared_ptr<std::ifstream> graphFile = routingHandler->getGraphFile()) {
+                    packageFileMap[it->first] = graphFile;
                 }
             }
+        }
 
-            // Now check if we have already a cached route finder for the files. If not, create new instance.
-            std::shared_ptr<osrm::RouteFinder> routeFinder;
-            {
-                std::lock_guard<std::mutex> lock(_mutex);
-                if (!_cachedRouteFinder || packageFileMap != _cachedPackageFileMap) {
-                    osrm::Graph::Settings graphSettings;
-                    auto graph = std::make_shared<osrm::Graph>(graphSettings);
-                    for (auto it = packageFileMap.begin(); it != packageFileMap.end(); it++) {
-                        try {
-                            if (!graph->import(it->second)) {
-                                throw FileException("Failed to import graph " + it->first->getPackageId(), "");
-                            }
-                        }
-                        catch (const std::exception& ex) {
-                            throw GenericException("Exception while importing graph " + it->first->getPackageId(), ex.what());
-                        }
+        // Now check if we have already a cached route finder for the files. If not, create new instance.
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!_cachedRouteFinder || packageFileMap != _cachedPackageFileMap) {
+            osrm::Graph::Settings graphSettings;
+            auto graph = std::make_shared<osrm::Graph>(graphSettings);
+            for (auto it = packageFileMap.begin(); it != packageFileMap.end(); it++) {
+                try {
+                    if (!graph->import(it->second)) {
+                        throw FileException("Failed to import graph " + it->first->getPackageId(), "");
                     }
-                    _cachedPackageFileMap = packageFileMap;
-                    _cachedRouteFinder = std::make_shared<osrm::RouteFinder>(graph);
                 }
-                routeFinder = _cachedRouteFinder;
+                catch (const std::exception& ex) {
+                    throw GenericException("Exception while importing graph " + it->first->getPackageId(), ex.what());
+                }
             }
-
-            result = OSRMRoutingProxy::CalculateRoute(routeFinder, request);
-        });
-
-        return result;
+            _cachedPackageFileMap = packageFileMap;
+            _cachedRouteFinder = std::make_shared<osrm::RouteFinder>(graph);
+        }
+        return _cachedRouteFinder;
     }
             
     PackageManagerRoutingService::PackageManagerListener::PackageManagerListener(PackageManagerRoutingService& service) :
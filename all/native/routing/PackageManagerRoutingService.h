@@ -22,6 +22,8 @@ namespace carto {
         class RouteFinder;
     }
 
+    class CancelableThreadPool;
+
     /**
      * A routing service that uses routing packages from package manager.
      */
@@ -41,6 +43,8 @@ namespace carto {
 
         virtual std::shared_ptr<RoutingResult> calculateRoute(const std::shared_ptr<RoutingRequest>& request) const;
 
+        virtual std::shared_ptr<RoutingMatrixResult> calculateMatrix(const std::shared_ptr<RoutingMatrixRequest>& request) const;
+
     protected:
         class PackageManagerListener : public PackageManager::OnChangeListener {
         public:
@@ -53,11 +57,15 @@ namespace carto {
             PackageManagerRoutingService& _service;
         };
 
+        std::shared_ptr<osrm::RouteFinder> getRouteFinder(const std::map<std::shared_ptr<PackageInfo>, std::shared_ptr<PackageHandler> >& packageHandlerMap) const;
+
         const std::shared_ptr<PackageManager> _packageManager;
 
         mutable std::map<std::shared_ptr<PackageInfo>, std::shared_ptr<std::ifstream> > _cachedPackageFileMap;
         mutable std::shared_ptr<osrm::RouteFinder> _cachedRouteFinder;
 
+        std::shared_ptr<CancelableThreadPool> _matrixThreadPool;
+
         mutable std::mutex _mutex;
 
     private:
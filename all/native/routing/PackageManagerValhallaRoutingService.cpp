@@ -18,7 +18,7 @@ namespace carto {
         _packageManager(packageManager),
         _profile("pedestrian"),
         _configuration(ValhallaRoutingProxy::GetDefaultConfiguration()),
-        _cachedPackageDatabases(),
+        _cachedGraphReaderPool(),
         _mutex()
     {
         if (!packageManager) {
@@ -79,29 +79,16 @@ namespace carto {
             throw NullArgumentException("Null request");
         }
 
-        // Do routing via package manager, so that all packages are locked during routing
-        std::shared_ptr<RouteMatchingResult> result;
-        _packageManager->accessLocalPackages([this, &result, &request](const std::map<std::shared_ptr<PackageInfo>, std::shared_ptr<PackageHandler> >& packageHandlerMap) {
-            // Build map of routing packages and graph files
-            std::vector<std::shared_ptr<sqlite3pp::database> > packageDatabases;
-            for (auto it = packageHandlerMap.begin(); it != packageHandlerMap.end(); it++) {
-                if (auto valhallaRoutingHandler = std::dynamic_pointer_cast<ValhallaRoutingPackageHandler>(it->second)) {
-                    if (std::shared_ptr<sqlite3pp::database> database = valhallaRoutingHandler->getDatabase()) {
-                        packageDatabases.push_back(database);
-                    }
-                }
-            }
-
-            // Now check if we have already a cached route finder for the files. If not, create new instance.
+        std::string profile;
+        Variant configuration;
+        {
             std::lock_guard<std::mutex> lock(_mutex);
-            if (packageDatabases != _cachedPackageDatabases) {
-                _cachedPackageDatabases = packageDatabases;
-            }
-
-            result = ValhallaRoutingProxy::MatchRoute(_cachedPackageDatabases, _profile, _configuration, request);
-        });
-
-        return result;
+            profile = _profile;
+            configuration = _configuration;
+        }
+        std::shared_ptr<void> packagePin;
+        std::shared_ptr<ValhallaRoutingProxy::GraphReaderPool> graphReaderPool = getGraphReaderPool(configuration, packagePin);
+        return ValhallaRoutingProxy::MatchRoute(*graphReaderPool, profile, configuration, request);
     }
 
     std::shared_ptr<RoutingResult> PackageManagerValhallaRoutingService::calculateRoute(const std::shared_ptr<RoutingRequest>& request) const {
@@ -109,29 +96,42 @@ namespace carto {
             throw NullArgumentException("Null request");
         }
 
-        // Do routing via package manager, so that all packages are locked during routing
-        std::shared_ptr<RoutingResult> result;
-        _packageManager->accessLocalPackages([this, &result, &request](const std::map<std::shared_ptr<PackageInfo>, std::shared_ptr<PackageHandler> >& packageHandlerMap) {
-            // Build map of routing packages and graph files
-            std::vector<std::shared_ptr<sqlite3pp::database> > packageDatabases;
+        std::string profile;
+        Variant configuration;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            profile = _profile;
+            configuration = _configuration;
+        }
+        std::shared_ptr<void> packagePin;
+        std::shared_ptr<ValhallaRoutingProxy::GraphReaderPool> graphReaderPool = getGraphReaderPool(configuration, packagePin);
+        return ValhallaRoutingProxy::CalculateRoute(*graphReaderPool, profile, configuration, request);
+    }
+
+    std::shared_ptr<ValhallaRoutingProxy::GraphReaderPool> PackageManagerValhallaRoutingService::getGraphReaderPool(const Variant& configuration, std::shared_ptr<void>& packagePin) const {
+        // Collect package databases via package manager. Requests do not lock the package manager,
+        // instead the packages are pinned so that their files are not deleted while the requests are processed.
+        std::shared_ptr<ValhallaRoutingProxy::GraphReaderPool> graphReaderPool;
+        _packageManager->accessLocalPackages([this, &configuration, &graphReaderPool, &packagePin](const std::map<std::shared_ptr<PackageInfo>, std::shared_ptr<PackageHandler> >& packageHandlerMap) {
+            // Build list of routing package files
+            std::vector<std::shared_ptr<PackageInfo> > packageInfos;
+            std::vector<std::string> packageFileNames;
             for (auto it = packageHandlerMap.begin(); it != packageHandlerMap.end(); it++) {
                 if (auto valhallaRoutingHandler = std::dynamic_pointer_cast<ValhallaRoutingPackageHandler>(it->second)) {
-                    if (std::shared_ptr<sqlite3pp::database> database = valhallaRoutingHandler->getDatabase()) {
-                        packageDatabases.push_back(database);
+                    if (valhallaRoutingHandler->getDatabase()) {
+                        packageInfos.push_back(it->first);
+                        packageFileNames.push_back(valhallaRoutingHandler->getFileName());
                     }
                 }
             }
+            packagePin = _packageManager->pinLocalPackages(packageInfos);
 
-            // Now check if we have already a cached route finder for the files. If not, create new instance.
+            // Reuse the cached graph reader pool if it matches the packages and the configuration. Otherwise create new instance.
             std::lock_guard<std::mutex> lock(_mutex);
-            if (packageDatabases != _cachedPackageDatabases) {
-                _cachedPackageDatabases = packageDatabases;
-            }
-
-            result = ValhallaRoutingProxy::CalculateRoute(_cachedPackageDatabases, _profile, _configuration, request);
+            _cachedGraphReaderPool = ValhallaRoutingProxy::UpdateGraphReaderPool(_cachedGraphReaderPool, packageFileNames, configuration);
+            graphReaderPool = _cachedGraphReaderPool;
         });
-
-        return result;
+        return graphReaderPool;
     }
             
     PackageManagerValhallaRoutingService::PackageManagerListener::PackageManagerListener(PackageManagerValhallaRoutingService& service) :
@@ -141,7 +141,7 @@ namespace carto {
         
     void PackageManagerValhallaRoutingService::PackageManagerListener::onPackagesChanged() {
         std::lock_guard<std::mutex> lock(_service._mutex);
-        _service._cachedPackageDatabases.clear();
+        _service._cachedGraphReaderPool.reset();
     }
 
     void PackageManagerValhallaRoutingService::PackageManagerListener::onStylesChanged() {
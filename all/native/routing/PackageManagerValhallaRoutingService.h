@@ -12,6 +12,7 @@
 #include "core/Variant.h"
 #include "packagemanager/PackageManager.h"
 #include "routing/RoutingService.h"
+#include "routing/ValhallaRoutingProxy.h"
 
 #include <memory>
 #include <string>
@@ -57,6 +58,8 @@ namespace carto {
         virtual std::shared_ptr<RoutingResult> calculateRoute(const std::shared_ptr<RoutingRequest>& request) const;
 
     protected:
+        std::shared_ptr<ValhallaRoutingProxy::GraphReaderPool> getGraphReaderPool(const Variant& configuration, std::shared_ptr<void>& packagePin) const;
+
         class PackageManagerListener : public PackageManager::OnChangeListener {
         public:
             explicit PackageManagerListener(PackageManagerValhallaRoutingService& service);
@@ -72,7 +75,7 @@ namespace carto {
         std::string _profile;
         Variant _configuration;
 
-        mutable std::vector<std::shared_ptr<sqlite3pp::database> > _cachedPackageDatabases;
+        mutable std::shared_ptr<ValhallaRoutingProxy::GraphReaderPool> _cachedGraphReaderPool;
 
         mutable std::mutex _mutex;
 
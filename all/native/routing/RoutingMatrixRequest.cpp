@@ -0,0 +1,53 @@
+#ifdef _CARTO_ROUTING_SUPPORT
+
+#include "RoutingMatrixRequest.h"
+#include "components/Exceptions.h"
+
+#include <iomanip>
+#include <sstream>
+
+namespace carto {
+
+    RoutingMatrixRequest::RoutingMatrixRequest(const std::shared_ptr<Projection>& projection, const std::vector<MapPos>& sourcePoints, const std::vector<MapPos>& targetPoints) :
+        _projection(projection),
+        _sourcePoints(sourcePoints),
+        _targetPoints(targetPoints)
+    {
+        if (!projection) {
+            throw NullArgumentException("Null projection");
+        }
+    }
+
+    RoutingMatrixRequest::~RoutingMatrixRequest() {
+    }
+
+    const std::shared_ptr<Projection>& RoutingMatrixRequest::getProjection() const {
+        return _projection;
+    }
+
+    const std::vector<MapPos>& RoutingMatrixRequest::getSourcePoints() const {
+        return _sourcePoints;
+    }
+
+    const std::vector<MapPos>& RoutingMatrixRequest::getTargetPoints() const {
+        return _targetPoints;
+    }
+
+    std::string RoutingMatrixRequest::toString() const {
+        std::stringstream ss;
+        ss << std::setiosflags(std::ios::fixed);
+        ss << "RoutingMatrixRequest [sourcePoints=[";
+        for (auto it = _sourcePoints.begin(); it != _sourcePoints.end(); ++it) {
+            ss << (it == _sourcePoints.begin() ? "" : ", ") << it->toString();
+        }
+        ss << "], targetPoints=[";
+        for (auto it = _targetPoints.begin(); it != _targetPoints.end(); ++it) {
+            ss << (it == _targetPoints.begin() ? "" : ", ") << it->toString();
+        }
+        ss << "]]";
+        return ss.str();
+    }
+
+}
+
+#endif
@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2016 CartoDB. All rights reserved.
+ * Copying and using this code is allowed only according
+ * to license terms, as given in https://cartodb.com/terms/
+ */
+
+#ifndef _CARTO_ROUTINGMATRIXREQUEST_H_
+#define _CARTO_ROUTINGMATRIXREQUEST_H_
+
+#ifdef _CARTO_ROUTING_SUPPORT
+
+#include "core/MapPos.h"
+
+#include <memory>
+#include <vector>
+
+namespace carto {
+    class Projection;
+
+    /**
+     * A class that defines required attributes for calculating routing matrix (source and target points).
+     */
+    class RoutingMatrixRequest {
+    public:
+        /**
+         * Constructs a new RoutingMatrixRequest instance from projection, source and target points.
+         * @param projection The projection of the points.
+         * @param sourcePoints The list of source points (matrix rows).
+         * @param targetPoints The list of target points (matrix columns).
+         */
+        RoutingMatrixRequest(const std::shared_ptr<Projection>& projection, const std::vector<MapPos>& sourcePoints, const std::vector<MapPos>& targetPoints);
+        virtual ~RoutingMatrixRequest();
+
+        /**
+         * Returns the projection of the points in the request.
+         * @return The projection of the request.
+         */
+        const std::shared_ptr<Projection>& getProjection() const;
+        /**
+         * Returns the source point list of the request.
+         * @return The source point list of the request.
+         */
+        const std::vector<MapPos>& getSourcePoints() const;
+        /**
+         * Returns the target point list of the request.
+         * @return The target point list of the request.
+         */
+        const std::vector<MapPos>& getTargetPoints() const;
+
+        /**
+         * Creates a string representation of this request object, useful for logging.
+         * @return The string representation of this request object.
+         */
+        std::string toString() const;
+        
+    private:
+        const std::shared_ptr<Projection> _projection;
+        const std::vector<MapPos> _sourcePoints;
+        const std::vector<MapPos> _targetPoints;
+    };
+    
+}
+
+#endif
+
+#endif
@@ -0,0 +1,73 @@
+#ifdef _CARTO_ROUTING_SUPPORT
+
+#include "RoutingMatrixResult.h"
+#include "components/Exceptions.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+namespace carto {
+
+    RoutingMatrixResult::RoutingMatrixResult(int sourceCount, int targetCount, const std::vector<double>& distances, const std::vector<double>& times) :
+        _sourceCount(sourceCount),
+        _targetCount(targetCount),
+        _distances(distances),
+        _times(times)
+    {
+        if (sourceCount < 0 || targetCount < 0) {
+            throw InvalidArgumentException("Negative matrix dimensions");
+        }
+        if (distances.size() != static_cast<std::size_t>(sourceCount) * targetCount || times.size() != distances.size()) {
+            throw InvalidArgumentException("Matrix dimensions do not match distance/time lists");
+        }
+    }
+
+    RoutingMatrixResult::~RoutingMatrixResult() {
+    }
+
+    int RoutingMatrixResult::getSourceCount() const {
+        return _sourceCount;
+    }
+
+    int RoutingMatrixResult::getTargetCount() const {
+        return _targetCount;
+    }
+
+    bool RoutingMatrixResult::isReachable(int sourceIndex, int targetIndex) const {
+        return _times[getIndex(sourceIndex, targetIndex)] >= 0;
+    }
+
+    double RoutingMatrixResult::getDistance(int sourceIndex, int targetIndex) const {
+        return _distances[getIndex(sourceIndex, targetIndex)];
+    }
+
+    double RoutingMatrixResult::getTime(int sourceIndex, int targetIndex) const {
+        return _times[getIndex(sourceIndex, targetIndex)];
+    }
+
+    std::string RoutingMatrixResult::toString() const {
+        std::size_t unreachableCount = std::count_if(_times.begin(), _times.end(), [](double time) { return time < 0; });
+        std::stringstream ss;
+        ss << std::setiosflags(std::ios::fixed);
+        ss << "RoutingMatrixResult [";
+        ss << "sourceCount=" << _sourceCount << ", ";
+        ss << "targetCount=" << _targetCount << ", ";
+        ss << "unreachable=" << unreachableCount;
+        ss << "]";
+        return ss.str();
+    }
+
+    std::size_t RoutingMatrixResult::getIndex(int sourceIndex, int targetIndex) const {
+        if (sourceIndex < 0 || sourceIndex >= _sourceCount) {
+            throw OutOfRangeException("Source index out of range");
+        }
+        if (targetIndex < 0 || targetIndex >= _targetCount) {
+            throw OutOfRangeException("Target index out of range");
+        }
+        return static_cast<std::size_t>(sourceIndex) * _targetCount + targetIndex;
+    }
+
+}
+
+#endif
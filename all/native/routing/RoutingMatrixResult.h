@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2016 CartoDB. All rights reserved.
+ * Copying and using this code is allowed only according
+ * to license terms, as given in https://cartodb.com/terms/
+ */
+
+#ifndef _CARTO_ROUTINGMATRIXRESULT_H_
+#define _CARTO_ROUTINGMATRIXRESULT_H_
+
+#ifdef _CARTO_ROUTING_SUPPORT
+
+#include <string>
+#include <vector>
+
+namespace carto {
+
+    /**
+     * A class that contains travel distances and durations between all source and target points of a routing matrix request.
+     */
+    class RoutingMatrixResult {
+    public:
+        /**
+         * Constructs a new RoutingMatrixResult instance from source/target counts and row-major distance and time lists.
+         * @param sourceCount The number of source points (matrix rows).
+         * @param targetCount The number of target points (matrix columns).
+         * @param distances The distances between source and target points in row-major order. Negative values denote unreachable targets.
+         * @param times The durations between source and target points in row-major order. Negative values denote unreachable targets.
+         */
+        RoutingMatrixResult(int sourceCount, int targetCount, const std::vector<double>& distances, const std::vector<double>& times);
+        virtual ~RoutingMatrixResult();
+
+        /**
+         * Returns the number of source points (matrix rows).
+         * @return The number of source points.
+         */
+        int getSourceCount() const;
+        /**
+         * Returns the number of target points (matrix columns).
+         * @return The number of target points.
+         */
+        int getTargetCount() const;
+
+        /**
+         * Returns true if the given target is reachable from the given source.
+         * @param sourceIndex The index of the source point.
+         * @param targetIndex The index of the target point.
+         * @return True if the target is reachable.
+         */
+        bool isReachable(int sourceIndex, int targetIndex) const;
+        /**
+         * Returns the distance between the given source and target points.
+         * @param sourceIndex The index of the source point.
+         * @param targetIndex The index of the target point.
+         * @return The distance in meters. Negative value if the target is not reachable.
+         */
+        double getDistance(int sourceIndex, int targetIndex) const;
+        /**
+         * Returns the approximate duration between the given source and target points.
+         * @param sourceIndex The index of the source point.
+         * @param targetIndex The index of the target point.
+         * @return The duration in seconds. Negative value if the target is not reachable.
+         */
+        double getTime(int sourceIndex, int targetIndex) const;
+
+        /**
+         * Creates a string representation of this result object, useful for logging.
+         * @return The string representation of this result object.
+         */
+        std::string toString() const;
+        
+    private:
+        std::size_t getIndex(int sourceIndex, int targetIndex) const;
+
+        int _sourceCount;
+        int _targetCount;
+        std::vector<double> _distances;
+        std::vector<double> _times;
+    };
+    
+}
+
+#endif
+
+#endif
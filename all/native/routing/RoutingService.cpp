@@ -1,6 +1,8 @@
 #ifdef _CARTO_ROUTING_SUPPORT
 
 #include "RoutingService.h"
+#include "components/Exceptions.h"
+#include "utils/Log.h"
 
 namespace carto {
 
@@ -10,6 +12,37 @@ namespace carto {
     RoutingService::~RoutingService() {
     }
 
+    std::shared_ptr<RoutingMatrixResult> RoutingService::calculateMatrix(const std::shared_ptr<RoutingMatrixRequest>& request) const {
+        if (!request) {
+            throw NullArgumentException("Null request");
+        }
+
+        const std::vector<MapPos>& sourcePoints = request->getSourcePoints();
+        const std::vector<MapPos>& targetPoints = request->getTargetPoints();
+        std::vector<double> distances(sourcePoints.size() * targetPoints.size(), -1);
+        std::vector<double> times(sourcePoints.size() * targetPoints.size(), -1);
+        for (std::size_t i = 0; i < sourcePoints.size(); i++) {
+            for (std::size_t j = 0; j < targetPoints.size(); j++) {
+                std::size_t index = i * targetPoints.size() + j;
+                if (sourcePoints[i] == targetPoints[j]) {
+                    distances[index] = times[index] = 0;
+                    continue;
+                }
+                try {
+                    auto routingRequest = std::make_shared<RoutingRequest>(request->getProjection(), std::vector<MapPos> { sourcePoints[i], targetPoints[j] });
+                    if (std::shared_ptr<RoutingResult> result = calculateRoute(routingRequest)) {
+                        distances[index] = result->getTotalDistance();
+                        times[index] = result->getTotalTime();
+                    }
+                }
+                catch (const std::exception& ex) {
+                    Log::Infof("RoutingService::calculateMatrix: Failed to calculate route %d -> %d: %s", static_cast<int>(i), static_cast<int>(j), ex.what());
+                }
+            }
+        }
+        return std::make_shared<RoutingMatrixResult>(static_cast<int>(sourcePoints.size()), static_cast<int>(targetPoints.size()), distances, times);
+    }
+
 }
 
 #endif
@@ -13,6 +13,8 @@
 #include "routing/RoutingResult.h"
 #include "routing/RouteMatchingRequest.h"
 #include "routing/RouteMatchingResult.h"
+#include "routing/RoutingMatrixRequest.h"
+#include "routing/RoutingMatrixResult.h"
 
 #include <memory>
 
@@ -52,6 +54,16 @@ namespace carto {
          */
         virtual std::shared_ptr<RoutingResult> calculateRoute(const std::shared_ptr<RoutingRequest>& request) const = 0;
 
+        /**
+         * Calculates travel distances and durations between all source and target points of the request.
+         * The default implementation calculates a separate route for each source/target pair,
+         * offline routing services override this with a faster implementation.
+         * @param request The routing matrix request defining source and target points.
+         * @return The matrix result. Unreachable targets are denoted by negative distances and durations.
+         * @throws std::runtime_error If IO error occured during the matrix calculation.
+         */
+        virtual std::shared_ptr<RoutingMatrixResult> calculateMatrix(const std::shared_ptr<RoutingMatrixRequest>& request) const;
+
     protected:
         /**
          * The default constructor.
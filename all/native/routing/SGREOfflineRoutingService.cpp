@@ -2,6 +2,7 @@
 
 #include "SGREOfflineRoutingService.h"
 #include "components/Exceptions.h"
+#include "components/CancelableThreadPool.h"
 #include "geometry/FeatureCollection.h"
 #include "geometry/GeoJSONGeometryWriter.h"
 #include "projections/Projection.h"
@@ -9,7 +10,12 @@
 #include "utils/Const.h"
 #include "utils/Log.h"
 
+#include <atomic>
+#include <condition_variable>
 #include <limits>
+#include <thread>
+
+#include <boost/lexical_cast.hpp>
 
 #include <sgre/Graph.h>
 #include <sgre/GraphBuilder.h>
@@ -23,24 +29,35 @@ namespace carto {
 
     SGREOfflineRoutingService::SGREOfflineRoutingService(const Variant& geoJSON, const Variant& config) :
         RoutingService(),
-        _featureData(geoJSON.toPicoJSON()),
+        _features(),
+        _featureIndices(),
+        _featureRevision(0),
         _config(config.toPicoJSON()),
         _profile(),
         _routingParameters(),
-        _cachedRouteFinder(),
-        _mutex()
+        _cachedGraphs(),
+        _buildMutex(),
+        _mutex(),
+        _matrixThreadPool(std::make_shared<CancelableThreadPool>())
     {
+        _matrixThreadPool->setPoolSize(static_cast<int>(std::max(1u, std::min(std::thread::hardware_concurrency(), MAX_MATRIX_THREADS))) - 1);
+        importFeatures(geoJSON.toPicoJSON());
     }
 
     SGREOfflineRoutingService::SGREOfflineRoutingService(const std::shared_ptr<Projection>& projection, const std::shared_ptr<FeatureCollection>& featureCollection, const Variant& config) :
         RoutingService(),
-        _featureData(),
+        _features(),
+        _featureIndices(),
+        _featureRevision(0),
         _config(config.toPicoJSON()),
         _profile(),
         _routingParameters(),
-        _cachedRouteFinder(),
-        _mutex()
+        _cachedGraphs(),
+        _buildMutex(),
+        _mutex(),
+        _matrixThreadPool(std::make_shared<CancelableThreadPool>())
     {
+        _matrixThreadPool->setPoolSize(static_cast<int>(std::max(1u, std::min(std::thread::hardware_concurrency(), MAX_MATRIX_THREADS))) - 1);
         if (!featureCollection) {
             throw NullArgumentException("Null featureCollection");
         }
@@ -48,13 +65,16 @@ namespace carto {
         GeoJSONGeometryWriter geometryWriter;
         geometryWriter.setSourceProjection(projection);
         geometryWriter.setZ(true);
-        std::string err = picojson::parse(_featureData, geometryWriter.writeFeatureCollection(featureCollection));
+        picojson::value featureData;
+        std::string err = picojson::parse(featureData, geometryWriter.writeFeatureCollection(featureCollection));
         if (!err.empty()) {
             throw GenericException("Error while serializing feature data", err);
         }
+        importFeatures(featureData);
     }
 
     SGREOfflineRoutingService::~SGREOfflineRoutingService() {
+        _matrixThreadPool->deinit();
     }
 
     float SGREOfflineRoutingService::getRoutingParameter(const std::string& param) const {
@@ -71,6 +91,73 @@ namespace carto {
         _routingParameters[param] = value;
     }
 
+    std::vector<std::string> SGREOfflineRoutingService::getFeatureIds() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        std::vector<std::string> ids;
+        ids.reserve(_features.size());
+        for (const std::pair<std::string, picojson::value>& feature : _features) {
+            ids.push_back(feature.first);
+        }
+        return ids;
+    }
+
+    Variant SGREOfflineRoutingService::getFeature(const std::string& id) const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it = _featureIndices.find(id);
+        if (it == _featureIndices.end()) {
+            return Variant();
+        }
+        return Variant::FromPicoJSON(_features[it->second].second);
+    }
+
+    void SGREOfflineRoutingService::setFeature(const std::string& id, const Variant& geoJSON) {
+        picojson::value featureDef = geoJSON.toPicoJSON();
+        if (!featureDef.is<picojson::object>() || featureDef.get("type").to_str() != "Feature") {
+            throw GenericException("Expected GeoJSON feature");
+        }
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        storeFeature(id, featureDef);
+        invalidateGraphs();
+    }
+
+    void SGREOfflineRoutingService::setFeature(const std::string& id, const std::shared_ptr<Projection>& projection, const std::shared_ptr<Feature>& feature) {
+        if (!feature) {
+            throw NullArgumentException("Null feature");
+        }
+
+        GeoJSONGeometryWriter geometryWriter;
+        geometryWriter.setSourceProjection(projection);
+        geometryWriter.setZ(true);
+        picojson::value featureDef;
+        std::string err = picojson::parse(featureDef, geometryWriter.writeFeature(feature));
+        if (!err.empty()) {
+            throw GenericException("Error while serializing feature data", err);
+        }
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        storeFeature(id, featureDef);
+        invalidateGraphs();
+    }
+
+    bool SGREOfflineRoutingService::removeFeature(const std::string& id) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it = _featureIndices.find(id);
+        if (it == _featureIndices.end()) {
+            return false;
+        }
+        // Move the last feature to the freed slot, so that removal does not need to reindex the following features
+        std::size_t index = it->second;
+        _featureIndices.erase(it);
+        if (index + 1 < _features.size()) {
+            _features[index] = std::move(_features.back());
+            _featureIndices[_features[index].first] = index;
+        }
+        _features.pop_back();
+        invalidateGraphs();
+        return true;
+    }
+
     std::string SGREOfflineRoutingService::getProfile() const {
         std::lock_guard<std::mutex> lock(_mutex);
         return _profile;
@@ -78,10 +165,7 @@ namespace carto {
 
     void SGREOfflineRoutingService::setProfile(const std::string& profile) {
         std::lock_guard<std::mutex> lock(_mutex);
-        if (profile != _profile) {
-            _profile = profile;
-            _cachedRouteFinder.reset();
-        }
+        _profile = profile;
     }
 
     std::shared_ptr<RouteMatchingResult> SGREOfflineRoutingService::matchRoute(const std::shared_ptr<RouteMatchingRequest>& request) const {
@@ -93,25 +177,7 @@ namespace carto {
             throw NullArgumentException("Null request");
         }
 
-        std::lock_guard<std::mutex> lock(_mutex);
-        if (!_cachedRouteFinder) {
-            try {
-                sgre::RuleList ruleList;
-                if (_config.contains("rules")) {
-                    ruleList = sgre::RuleList::parse(_config.get("rules"));
-                }
-                ruleList.filter(_profile);
-                sgre::GraphBuilder graphBuilder(std::move(ruleList));
-                graphBuilder.importGeoJSON(_featureData);
-                _cachedRouteFinder = sgre::RouteFinder::create(graphBuilder.build(), _config);
-            }
-            catch (const std::exception& ex) {
-                throw GenericException("Failed to create routing graph", ex.what());
-            }
-        }
-
-        std::shared_ptr<sgre::RouteFinder> routeFinder = _cachedRouteFinder;
-        routeFinder->setParameters(_routingParameters);
+        std::shared_ptr<sgre::RouteFinder> routeFinder = createRouteFinder();
 
         std::shared_ptr<Projection> proj = request->getProjection();
         EPSG3857 epsg3857;
@@ -194,6 +260,300 @@ namespace carto {
         return std::make_shared<RoutingResult>(proj, points, instructions);
     }
 
+    struct SGREOfflineRoutingService::MatrixState {
+        std::shared_ptr<RoutingMatrixRequest> request;
+        std::vector<sgre::Point> sourcePoints;
+        std::vector<sgre::Point> targetPoints;
+        std::vector<double> distances;
+        std::vector<double> times;
+        std::vector<std::shared_ptr<sgre::RouteFinder> > routeFinders; // idle route finders, guarded by mutex
+        std::size_t routeFinderCount;
+        std::atomic<std::size_t> nextRow;
+        std::size_t completedRows; // guarded by mutex
+        std::condition_variable condition;
+        std::mutex mutex;
+
+        MatrixState(const std::shared_ptr<RoutingMatrixRequest>& request, const std::vector<std::shared_ptr<sgre::RouteFinder> >& routeFinders) :
+            request(request),
+            sourcePoints(),
+            targetPoints(),
+            distances(),
+            times(),
+            routeFinders(routeFinders),
+            routeFinderCount(routeFinders.size()),
+            nextRow(0),
+            completedRows(0),
+            condition(),
+            mutex()
+        {
+        }
+    };
+
+    std::shared_ptr<RoutingMatrixResult> SGREOfflineRoutingService::calculateMatrix(const std::shared_ptr<RoutingMatrixRequest>& request) const {
+        if (!request) {
+            throw NullArgumentException("Null request");
+        }
+
+        // Route finders hold per-query state, so each worker uses its own route finder of the same graph
+        std::size_t workerCount = std::min(request->getSourcePoints().size(), static_cast<std::size_t>(_matrixThreadPool->getPoolSize()) + 1);
+        auto state = std::make_shared<MatrixState>(request, createRouteFinders(std::max(workerCount, static_cast<std::size_t>(1))));
+
+        std::shared_ptr<Projection> proj = request->getProjection();
+
+        // Convert all points only once, rows are then processed in parallel
+        state->sourcePoints.reserve(request->getSourcePoints().size());
+        for (const MapPos& pos : request->getSourcePoints()) {
+            MapPos wgsPos = proj->toWgs84(pos);
+            state->sourcePoints.emplace_back(wgsPos.getX(), wgsPos.getY(), pos.getZ());
+        }
+        state->targetPoints.reserve(request->getTargetPoints().size());
+        for (const MapPos& pos : request->getTargetPoints()) {
+            MapPos wgsPos = proj->toWgs84(pos);
+            state->targetPoints.emplace_back(wgsPos.getX(), wgsPos.getY(), pos.getZ());
+        }
+        state->distances.assign(state->sourcePoints.size() * state->targetPoints.size(), -1);
+        state->times.assign(state->sourcePoints.size() * state->targetPoints.size(), -1);
+
+        // The calling thread also processes rows. Tasks that start after all rows are claimed simply exit.
+        for (std::size_t i = 1; i < workerCount; i++) {
+            _matrixThreadPool->execute(std::make_shared<MatrixTask>(state));
+        }
+        ProcessMatrixRows(*state);
+
+        // Wait until all rows are calculated and all route finders are back, then release the route finders
+        // here, so that they are returned to the idle list while the service is known to be alive.
+        std::vector<std::shared_ptr<sgre::RouteFinder> > routeFinders;
+        {
+            std::unique_lock<std::mutex> lock(state->mutex);
+            state->condition.wait(lock, [&state]() { return state->completedRows >= state->sourcePoints.size() && state->routeFinders.size() >= state->routeFinderCount; });
+            std::swap(routeFinders, state->routeFinders);
+        }
+
+        return std::make_shared<RoutingMatrixResult>(static_cast<int>(state->sourcePoints.size()), static_cast<int>(state->targetPoints.size()), state->distances, state->times);
+    }
+
+    void SGREOfflineRoutingService::importFeatures(const picojson::value& featureData) {
+        if (!featureData.is<picojson::object>()) {
+            return;
+        }
+
+        if (featureData.get("type").to_str() == "FeatureCollection") {
+            const picojson::value& featuresDef = featureData.get("features");
+            if (featuresDef.is<picojson::array>()) {
+                const picojson::array& features = featuresDef.get<picojson::array>();
+                for (std::size_t i = 0; i < features.size(); i++) {
+                    storeFeature(getImportedFeatureId(features[i], i), features[i]);
+                }
+            }
+        } else if (featureData.get("type").to_str() == "Feature") {
+            storeFeature(getImportedFeatureId(featureData, 0), featureData);
+        } else {
+            picojson::object featureDef;
+            featureDef["type"] = picojson::value("Feature");
+            featureDef["geometry"] = featureData;
+            featureDef["properties"] = picojson::value(picojson::object());
+            storeFeature(getImportedFeatureId(picojson::value(), 0), picojson::value(featureDef));
+        }
+    }
+
+    std::string SGREOfflineRoutingService::getImportedFeatureId(const picojson::value& featureDef, std::size_t index) const {
+        if (featureDef.is<picojson::object>() && featureDef.contains("id")) {
+            std::string id = featureDef.get("id").to_str();
+            if (_featureIndices.find(id) == _featureIndices.end()) {
+                return id;
+            }
+        }
+
+        // Features without a unique id get an id from a separate namespace, so they never replace other features
+        std::string baseId = "#" + boost::lexical_cast<std::string>(index);
+        std::string id = baseId;
+        for (int n = 1; _featureIndices.find(id) != _featureIndices.end(); n++) {
+            id = baseId + "." + boost::lexical_cast<std::string>(n);
+        }
+        return id;
+    }
+
+    void SGREOfflineRoutingService::storeFeature(const std::string& id, const picojson::value& featureDef) {
+        auto it = _featureIndices.find(id);
+        if (it != _featureIndices.end()) {
+            _features[it->second].second = featureDef;
+            return;
+        }
+        _featureIndices[id] = _features.size();
+        _features.emplace_back(id, featureDef);
+    }
+
+    void SGREOfflineRoutingService::invalidateGraphs() {
+        // Graphs of all profiles are built from the same features, so all of them are stale now.
+        // Drop them immediately instead of keeping them until the next query for each profile.
+        _featureRevision++;
+        _cachedGraphs.clear();
+    }
+
+    std::shared_ptr<const sgre::Graph> SGREOfflineRoutingService::getGraph(const std::string& profile) const {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            auto it = _cachedGraphs.find(profile);
+            if (it != _cachedGraphs.end() && it->second.revision == _featureRevision) {
+                return it->second.graph;
+            }
+        }
+
+        // Build graphs outside of the main lock, so that feature updates and queries for already built graphs are not blocked
+        std::lock_guard<std::mutex> buildLock(_buildMutex);
+        picojson::array features;
+        std::uint64_t revision = 0;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            auto it = _cachedGraphs.find(profile);
+            if (it != _cachedGraphs.end() && it->second.revision == _featureRevision) {
+                return it->second.graph;
+            }
+            features.reserve(_features.size());
+            for (const std::pair<std::string, picojson::value>& feature : _features) {
+                features.push_back(feature.second);
+            }
+            revision = _featureRevision;
+        }
+
+        picojson::object featureCollectionDef;
+        featureCollectionDef["type"] = picojson::value("FeatureCollection");
+        featureCollectionDef["features"] = picojson::value(std::move(features));
+
+        std::shared_ptr<const sgre::Graph> graph;
+        try {
+            sgre::RuleList ruleList;
+            if (_config.contains("rules")) {
+                ruleList = sgre::RuleList::parse(_config.get("rules"));
+            }
+            ruleList.filter(profile);
+            sgre::GraphBuilder graphBuilder(std::move(ruleList));
+            graphBuilder.importGeoJSON(picojson::value(std::move(featureCollectionDef)));
+            graph = graphBuilder.build();
+        }
+        catch (const std::exception& ex) {
+            throw GenericException("Failed to create routing graph", ex.what());
+        }
+
+        // A graph built from features that were changed meanwhile is used for this query only
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (revision == _featureRevision) {
+            _cachedGraphs[profile] = CachedGraph { revision, graph, std::vector<std::shared_ptr<sgre::RouteFinder> >() };
+        }
+        return graph;
+    }
+
+    std::shared_ptr<sgre::RouteFinder> SGREOfflineRoutingService::createRouteFinder() const {
+        return createRouteFinders(1).front();
+    }
+
+    std::vector<std::shared_ptr<sgre::RouteFinder> > SGREOfflineRoutingService::createRouteFinders(std::size_t count) const {
+        std::string profile;
+        std::map<std::string, float> routingParameters;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            profile = _profile;
+            routingParameters = _routingParameters;
+        }
+
+        // Graphs are immutable and shared between queries. Route finders hold per-query state,
+        // so each query takes idle route finders of the graph or creates new ones.
+        std::shared_ptr<const sgre::Graph> graph = getGraph(profile);
+        std::vector<std::shared_ptr<sgre::RouteFinder> > routeFinders;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            auto it = _cachedGraphs.find(profile);
+            if (it != _cachedGraphs.end() && it->second.graph == graph) {
+                while (routeFinders.size() < count && !it->second.routeFinders.empty()) {
+                    routeFinders.push_back(it->second.routeFinders.back());
+                    it->second.routeFinders.pop_back();
+                }
+            }
+        }
+        while (routeFinders.size() < count) {
+            try {
+                routeFinders.push_back(sgre::RouteFinder::create(graph, _config));
+            }
+            catch (const std::exception& ex) {
+                throw GenericException("Failed to create route finder", ex.what());
+            }
+        }
+
+        // Return the route finders to the idle list once the query is done, unless the graph was rebuilt meanwhile
+        for (std::shared_ptr<sgre::RouteFinder>& routeFinder : routeFinders) {
+            routeFinder->setParameters(routingParameters);
+            std::shared_ptr<sgre::RouteFinder> pooledRouteFinder = routeFinder;
+            routeFinder = std::shared_ptr<sgre::RouteFinder>(pooledRouteFinder.get(), [this, profile, graph, pooledRouteFinder](sgre::RouteFinder*) {
+                std::lock_guard<std::mutex> lock(_mutex);
+                auto it = _cachedGraphs.find(profile);
+                if (it != _cachedGraphs.end() && it->second.graph == graph && it->second.routeFinders.size() < MAX_IDLE_ROUTE_FINDERS) {
+                    it->second.routeFinders.push_back(pooledRouteFinder);
+                }
+            });
+        }
+        return routeFinders;
+    }
+
+    SGREOfflineRoutingService::MatrixTask::MatrixTask(const std::shared_ptr<MatrixState>& state) :
+        _state(state)
+    {
+    }
+
+    void SGREOfflineRoutingService::MatrixTask::run() {
+        if (!isCanceled()) {
+            ProcessMatrixRows(*_state);
+        }
+    }
+
+    void SGREOfflineRoutingService::ProcessMatrixRows(MatrixState& state) {
+        std::shared_ptr<sgre::RouteFinder> routeFinder;
+        {
+            std::lock_guard<std::mutex> lock(state.mutex);
+            if (state.routeFinders.empty()) {
+                return;
+            }
+            routeFinder = state.routeFinders.back();
+            state.routeFinders.pop_back();
+        }
+
+        const std::vector<MapPos>& sourceMapPoints = state.request->getSourcePoints();
+        const std::vector<MapPos>& targetMapPoints = state.request->getTargetPoints();
+        std::size_t completedRows = 0;
+        for (std::size_t i = state.nextRow++; i < state.sourcePoints.size(); i = state.nextRow++) {
+            for (std::size_t j = 0; j < state.targetPoints.size(); j++) {
+                std::size_t index = i * state.targetPoints.size() + j;
+                if (sourceMapPoints[i] == targetMapPoints[j]) {
+                    state.distances[index] = state.times[index] = 0;
+                    continue;
+                }
+
+                // A failing pair is reported as unreachable instead of discarding the whole matrix
+                try {
+                    sgre::Result result = routeFinder->find(sgre::Query(state.sourcePoints[i], state.targetPoints[j]));
+                    if (result.getStatus() == sgre::Result::Status::FAILED) {
+                        continue;
+                    }
+                    double distance = 0, time = 0;
+                    for (const sgre::Instruction& instr : result.getInstructions()) {
+                        distance += instr.getDistance();
+                        time += instr.getTime();
+                    }
+                    state.distances[index] = distance;
+                    state.times[index] = time;
+                }
+                catch (const std::exception& ex) {
+                    Log::Errorf("SGREOfflineRoutingService::calculateMatrix: Exception while calculating route %d -> %d: %s", static_cast<int>(i), static_cast<int>(j), ex.what());
+                }
+            }
+            completedRows++;
+        }
+
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.completedRows += completedRows;
+        state.routeFinders.push_back(routeFinder);
+        state.condition.notify_all();
+    }
+
     float SGREOfflineRoutingService::CalculateTurnAngle(const std::vector<MapPos>& epsg3857Points, int pointIndex) {
         int pointIndex0 = pointIndex;
         while (--pointIndex0 >= 0) {
@@ -273,6 +633,9 @@ namespace carto {
         return true;
     }
 
+    const std::size_t SGREOfflineRoutingService::MAX_IDLE_ROUTE_FINDERS = 4;
+    const unsigned int SGREOfflineRoutingService::MAX_MATRIX_THREADS = 8;
+
 }
 
 #endif
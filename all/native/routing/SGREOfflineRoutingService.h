@@ -10,21 +10,27 @@
 #if defined(_CARTO_ROUTING_SUPPORT) && defined(_CARTO_OFFLINE_SUPPORT)
 
 #include "core/Variant.h"
+#include "components/CancelableTask.h"
 #include "routing/RoutingService.h"
 
 #include <memory>
 #include <mutex>
 #include <string>
+#include <vector>
 #include <map>
+#include <cstdint>
 
 #include <picojson/picojson.h>
 
 namespace carto {
     namespace sgre {
         class RuleList;
+        class Graph;
         class RouteFinder;
     }
 
+    class CancelableThreadPool;
+    class Feature;
     class FeatureCollection;
     class Projection;
 
@@ -64,6 +70,44 @@ namespace carto {
          */
         void setRoutingParameter(const std::string& param, float value);
 
+        /**
+         * Returns the ids of all features used for the routing graph.
+         * Features are identified by their GeoJSON 'id' member. Features without an id or with an already used id
+         * get a generated id of the form '#index', where index is the position in the original collection.
+         * @return The list of feature ids. Features are kept in insertion order, except that removing a feature moves the last feature to its place.
+         */
+        std::vector<std::string> getFeatureIds() const;
+        /**
+         * Returns the feature with the specified id as GeoJSON variant.
+         * @param id The id of the feature.
+         * @return The GeoJSON feature. If the feature does not exist, empty variant is returned.
+         */
+        Variant getFeature(const std::string& id) const;
+        /**
+         * Adds a new feature or replaces an existing feature with the specified id.
+         * This can be used for adding, removing or updating individual edges of the routing graph.
+         * Routing graphs are rebuilt on the next routing request, requests already in progress use the previous graph.
+         * @param id The id of the feature.
+         * @param geoJSON The GeoJSON variant specifying the feature.
+         * @throws std::runtime_error If the variant does not specify a valid GeoJSON feature.
+         */
+        void setFeature(const std::string& id, const Variant& geoJSON);
+        /**
+         * Adds a new feature or replaces an existing feature with the specified id.
+         * This can be used for adding, removing or updating individual edges of the routing graph.
+         * Routing graphs are rebuilt on the next routing request, requests already in progress use the previous graph.
+         * @param id The id of the feature.
+         * @param projection Projection for the feature. Can be null if the coordinates are based on WGS84.
+         * @param feature The feature to add.
+         */
+        void setFeature(const std::string& id, const std::shared_ptr<Projection>& projection, const std::shared_ptr<Feature>& feature);
+        /**
+         * Removes the feature with the specified id.
+         * @param id The id of the feature to remove.
+         * @return True if the feature was removed, false if it did not exist.
+         */
+        bool removeFeature(const std::string& id);
+
         virtual std::string getProfile() const;
         virtual void setProfile(const std::string& profile);
 
@@ -71,21 +115,61 @@ namespace carto {
 
         virtual std::shared_ptr<RoutingResult> calculateRoute(const std::shared_ptr<RoutingRequest>& request) const;
 
+        virtual std::shared_ptr<RoutingMatrixResult> calculateMatrix(const std::shared_ptr<RoutingMatrixRequest>& request) const;
+
     protected:
+        struct CachedGraph {
+            std::uint64_t revision;
+            std::shared_ptr<const sgre::Graph> graph;
+            std::vector<std::shared_ptr<sgre::RouteFinder> > routeFinders; // idle route finders for the graph
+        };
+
+        struct MatrixState;
+
+        class MatrixTask : public CancelableTask {
+        public:
+            explicit MatrixTask(const std::shared_ptr<MatrixState>& state);
+
+            virtual void run();
+
+        private:
+            std::shared_ptr<MatrixState> _state;
+        };
+
+        void importFeatures(const picojson::value& featureData);
+        std::string getImportedFeatureId(const picojson::value& featureDef, std::size_t index) const;
+        void storeFeature(const std::string& id, const picojson::value& featureDef);
+        void invalidateGraphs(); // requires _mutex to be locked
+
+        std::shared_ptr<const sgre::Graph> getGraph(const std::string& profile) const;
+
+        std::shared_ptr<sgre::RouteFinder> createRouteFinder() const;
+        std::vector<std::shared_ptr<sgre::RouteFinder> > createRouteFinders(std::size_t count) const;
+
+        static void ProcessMatrixRows(MatrixState& state);
+
         static float CalculateTurnAngle(const std::vector<MapPos>& epsg3857Points, int pointIndex);
         
         static float CalculateAzimuth(const std::vector<MapPos>& epsg3857Points, int pointIndex);
         
         static bool TranslateInstructionCode(int instructionCode, RoutingAction::RoutingAction& action);
 
-        picojson::value _featureData;
+        static const std::size_t MAX_IDLE_ROUTE_FINDERS;
+        static const unsigned int MAX_MATRIX_THREADS;
+
+        std::vector<std::pair<std::string, picojson::value> > _features;
+        std::map<std::string, std::size_t> _featureIndices;
+        std::uint64_t _featureRevision;
         picojson::value _config;
         std::string _profile;
         std::map<std::string, float> _routingParameters;
 
-        mutable std::shared_ptr<sgre::RouteFinder> _cachedRouteFinder;
+        mutable std::map<std::string, CachedGraph> _cachedGraphs;
 
+        mutable std::mutex _buildMutex;
         mutable std::mutex _mutex;
+
+        std::shared_ptr<CancelableThreadPool> _matrixThreadPool;
     };
     
 }
@@ -13,13 +13,15 @@
 namespace carto {
 
     ValhallaOfflineRoutingService::ValhallaOfflineRoutingService(const std::string& path) :
-        _database(),
+        _path(path),
+        _graphReaderPool(),
         _profile("pedestrian"),
         _configuration(ValhallaRoutingProxy::GetDefaultConfiguration()),
         _mutex()
     {
-        _database.reset(new sqlite3pp::database());
-        if (_database->connect_v2(path.c_str(), SQLITE_OPEN_READONLY) != SQLITE_OK) {
+        // Check that the database can be opened. Graph readers open their own connections.
+        sqlite3pp::database database;
+        if (database.connect_v2(path.c_str(), SQLITE_OPEN_READONLY) != SQLITE_OK) {
             throw FileException("Failed to open routing database", path);
         }
     }
@@ -72,8 +74,15 @@ namespace carto {
             throw NullArgumentException("Null request");
         }
 
-        std::lock_guard<std::mutex> lock(_mutex);
-        return ValhallaRoutingProxy::MatchRoute(std::vector<std::shared_ptr<sqlite3pp::database> > { _database }, _profile, _configuration, request);
+        std::string profile;
+        Variant configuration;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            profile = _profile;
+            configuration = _configuration;
+        }
+        std::shared_ptr<ValhallaRoutingProxy::GraphReaderPool> graphReaderPool = getGraphReaderPool(configuration);
+        return ValhallaRoutingProxy::MatchRoute(*graphReaderPool, profile, configuration, request);
     }
 
     std::shared_ptr<RoutingResult> ValhallaOfflineRoutingService::calculateRoute(const std::shared_ptr<RoutingRequest>& request) const {
@@ -81,8 +90,21 @@ namespace carto {
             throw NullArgumentException("Null request");
         }
 
+        std::string profile;
+        Variant configuration;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            profile = _profile;
+            configuration = _configuration;
+        }
+        std::shared_ptr<ValhallaRoutingProxy::GraphReaderPool> graphReaderPool = getGraphReaderPool(configuration);
+        return ValhallaRoutingProxy::CalculateRoute(*graphReaderPool, profile, configuration, request);
+    }
+
+    std::shared_ptr<ValhallaRoutingProxy::GraphReaderPool> ValhallaOfflineRoutingService::getGraphReaderPool(const Variant& configuration) const {
         std::lock_guard<std::mutex> lock(_mutex);
-        return ValhallaRoutingProxy::CalculateRoute(std::vector<std::shared_ptr<sqlite3pp::database> > { _database }, _profile, _configuration, request);
+        _graphReaderPool = ValhallaRoutingProxy::UpdateGraphReaderPool(_graphReaderPool, std::vector<std::string> { _path }, configuration);
+        return _graphReaderPool;
     }
 
 }
@@ -11,15 +11,12 @@
 
 #include "core/Variant.h"
 #include "routing/RoutingService.h"
+#include "routing/ValhallaRoutingProxy.h"
 
 #include <memory>
 #include <mutex>
 #include <string>
 
-namespace sqlite3pp {
-    class database;
-}
-
 namespace carto {
 
     /**
@@ -56,7 +53,10 @@ namespace carto {
         virtual std::shared_ptr<RoutingResult> calculateRoute(const std::shared_ptr<RoutingRequest>& request) const;
 
     private:
-        std::shared_ptr<sqlite3pp::database> _database;
+        std::shared_ptr<ValhallaRoutingProxy::GraphReaderPool> getGraphReaderPool(const Variant& configuration) const;
+
+        const std::string _path;
+        mutable std::shared_ptr<ValhallaRoutingProxy::GraphReaderPool> _graphReaderPool;
         std::string _profile;
         Variant _configuration;
         mutable std::mutex _mutex;
@@ -35,6 +35,8 @@
 
 #include <picojson/picojson.h>
 
+#include <sqlite3pp.h>
+
 #ifdef _CARTO_VALHALLA_ROUTING_SUPPORT
 #include <valhalla/config.h>
 #include <valhalla/meili/map_matcher.h>
@@ -192,14 +194,78 @@ namespace carto {
     }
 
 #ifdef _CARTO_VALHALLA_ROUTING_SUPPORT
-    std::shared_ptr<RouteMatchingResult> ValhallaRoutingProxy::MatchRoute(const std::vector<std::shared_ptr<sqlite3pp::database> >& databases, const std::string& profile, const Variant& config, const std::shared_ptr<RouteMatchingRequest>& request) {
+    ValhallaRoutingProxy::GraphReaderPool::GraphReaderPool(const std::vector<std::string>& fileNames, std::size_t maxIdleReaders, std::size_t maxTileCacheSize) :
+        _fileNames(fileNames),
+        _maxIdleReaders(maxIdleReaders),
+        _maxTileCacheSize(maxTileCacheSize),
+        _idleReaders(),
+        _mutex()
+    {
+    }
+
+    ValhallaRoutingProxy::GraphReaderPool::~GraphReaderPool() {
+    }
+
+    const std::vector<std::string>& ValhallaRoutingProxy::GraphReaderPool::getFileNames() const {
+        return _fileNames;
+    }
+
+    std::size_t ValhallaRoutingProxy::GraphReaderPool::getMaxIdleReaders() const {
+        return _maxIdleReaders;
+    }
+
+    std::size_t ValhallaRoutingProxy::GraphReaderPool::getMaxTileCacheSize() const {
+        return _maxTileCacheSize;
+    }
+
+    std::shared_ptr<valhalla::baldr::GraphReader> ValhallaRoutingProxy::GraphReaderPool::acquireReader() {
+        // GraphReader instances are not thread safe, so each concurrent request gets its own reader. Idle readers keep their tile caches.
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (!_idleReaders.empty()) {
+                std::shared_ptr<valhalla::baldr::GraphReader> reader = _idleReaders.back();
+                _idleReaders.pop_back();
+                return reader;
+            }
+        }
+        return createReader();
+    }
+
+    void ValhallaRoutingProxy::GraphReaderPool::releaseReader(const std::shared_ptr<valhalla::baldr::GraphReader>& reader) {
+        if (reader->OverCommitted()) {
+            reader->Trim();
+        }
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_idleReaders.size() < _maxIdleReaders) {
+            _idleReaders.push_back(reader);
+        }
+    }
+
+    std::shared_ptr<valhalla::baldr::GraphReader> ValhallaRoutingProxy::GraphReaderPool::createReader() const {
+        // Each reader uses its own database connections, so that readers of concurrent requests do not contend on the same connection
+        std::vector<std::shared_ptr<sqlite3pp::database> > databases;
+        for (const std::string& fileName : _fileNames) {
+            auto database = std::make_shared<sqlite3pp::database>();
+            if (database->connect_v2(fileName.c_str(), SQLITE_OPEN_READONLY) != SQLITE_OK) {
+                throw FileException("Failed to open routing database", fileName);
+            }
+            databases.push_back(database);
+        }
+
+        boost::property_tree::ptree readerConfig;
+        readerConfig.put("max_cache_size", _maxTileCacheSize);
+        return std::make_shared<valhalla::baldr::GraphReader>(databases, readerConfig);
+    }
+
+    std::shared_ptr<RouteMatchingResult> ValhallaRoutingProxy::MatchRoute(GraphReaderPool& readerPool, const std::string& profile, const Variant& config, const std::shared_ptr<RouteMatchingRequest>& request) {
         std::string resultString;
         try {
             std::stringstream ss;
             ss << config.toPicoJSON().serialize();
             boost::property_tree::ptree configTree;
             rapidjson::read_json(ss, configTree);
-            auto reader = std::make_shared<valhalla::baldr::GraphReader>(databases);
+            std::shared_ptr<valhalla::baldr::GraphReader> reader = readerPool.acquireReader();
 
             valhalla::Api api;
             valhalla::ParseApi(SerializeRouteMatchingRequest(profile, request), valhalla::Options::trace_attributes, api);
@@ -208,6 +274,8 @@ namespace carto {
             lokiworker.trace(api);
             valhalla::thor::thor_worker_t thorworker(configTree, reader);
             resultString = thorworker.trace_attributes(api);
+
+            readerPool.releaseReader(reader);
         }
         catch (const std::exception& ex) {
             throw GenericException("Exception while matching route", ex.what());
@@ -215,16 +283,15 @@ namespace carto {
         return ParseRouteMatchingResult(request->getProjection(), resultString);
     }
 
-    std::shared_ptr<RoutingResult> ValhallaRoutingProxy::CalculateRoute(const std::vector<std::shared_ptr<sqlite3pp::database> >& databases, const std::string& profile, const Variant& config, const std::shared_ptr<RoutingRequest>& request) {
-        std::string resultString;
+    std::shared_ptr<RoutingResult> ValhallaRoutingProxy::CalculateRoute(GraphReaderPool& readerPool, const std::string& profile, const Variant& config, const std::shared_ptr<RoutingRequest>& request) {
+        valhalla::Api api;
         try {
             std::stringstream ss;
             ss << config.toPicoJSON().serialize();
             boost::property_tree::ptree configTree;
             rapidjson::read_json(ss, configTree);
-            auto reader = std::make_shared<valhalla::baldr::GraphReader>(databases);
+            std::shared_ptr<valhalla::baldr::GraphReader> reader = readerPool.acquireReader();
 
-            valhalla::Api api;
             valhalla::ParseApi(SerializeRoutingRequest(profile, request), valhalla::Options::route, api);
 
             valhalla::loki::loki_worker_t lokiworker(configTree, reader);
@@ -233,12 +300,13 @@ namespace carto {
             thorworker.route(api);
             valhalla::odin::odin_worker_t odinworker(configTree);
             odinworker.narrate(api);
-            resultString = valhalla::tyr::serializeDirections(api);
+
+            readerPool.releaseReader(reader);
         }
         catch (const std::exception& ex) {
             throw GenericException("Exception while calculating route", ex.what());
         }
-        return ParseRoutingResult(request->getProjection(), resultString);
+        return TranslateRoutingResult(request->getProjection(), api);
     }
 #endif
 
@@ -246,6 +314,26 @@ namespace carto {
         return Variant::FromString(valhalla_default_config);
     }
 
+#ifdef _CARTO_VALHALLA_ROUTING_SUPPORT
+    std::shared_ptr<ValhallaRoutingProxy::GraphReaderPool> ValhallaRoutingProxy::UpdateGraphReaderPool(const std::shared_ptr<GraphReaderPool>& readerPool, const std::vector<std::string>& fileNames, const Variant& config) {
+        Variant mjolnirConfig = config.getObjectElement("mjolnir");
+        long long maxIdleReaders = mjolnirConfig.containsObjectKey("max_idle_readers") ? mjolnirConfig.getObjectElement("max_idle_readers").getLong() : DEFAULT_MAX_IDLE_READERS;
+        long long maxTileCacheSize = mjolnirConfig.containsObjectKey("max_cache_size") ? mjolnirConfig.getObjectElement("max_cache_size").getLong() : DEFAULT_MAX_TILE_CACHE_SIZE;
+        if (maxIdleReaders < 0) {
+            maxIdleReaders = 0;
+        }
+        if (maxTileCacheSize <= 0) {
+            maxTileCacheSize = DEFAULT_MAX_TILE_CACHE_SIZE;
+        }
+
+        // Keep the existing pool and its warm readers, unless the databases or the reader settings have changed
+        if (readerPool && readerPool->getFileNames() == fileNames && readerPool->getMaxIdleReaders() == static_cast<std::size_t>(maxIdleReaders) && readerPool->getMaxTileCacheSize() == static_cast<std::size_t>(maxTileCacheSize)) {
+            return readerPool;
+        }
+        return std::make_shared<GraphReaderPool>(fileNames, static_cast<std::size_t>(maxIdleReaders), static_cast<std::size_t>(maxTileCacheSize));
+    }
+#endif
+
     float ValhallaRoutingProxy::CalculateTurnAngle(const std::vector<MapPos>& epsg3857Points, int pointIndex) {
         int pointIndex0 = pointIndex;
         while (--pointIndex0 >= 0) {
@@ -502,13 +590,12 @@ namespace carto {
             throw GenericException("No trip info in the result");
         }
 
-        EPSG3857 epsg3857;
         std::vector<MapPos> points;
         std::vector<MapPos> epsg3857Points;
         std::vector<RoutingInstruction> instructions;
         try {
             for (const picojson::value& legInfo : result.get("trip").get("legs").get<picojson::array>()) {
-                std::vector<valhalla::midgard::PointLL> shape = valhalla::midgard::decode<std::vector<valhalla::midgard::PointLL> >(legInfo.get("shape").get<std::string>());
+                std::vector<MapPos> shape = DecodeShape(legInfo.get("shape").get<std::string>());
                 points.reserve(points.size() + shape.size());
                 epsg3857Points.reserve(epsg3857Points.size() + shape.size());
 
@@ -516,36 +603,72 @@ namespace carto {
                 for (std::size_t i = 0; i < maneuvers.size(); i++) {
                     const picojson::value& maneuver = maneuvers[i];
 
-                    RoutingAction::RoutingAction action = RoutingAction::ROUTING_ACTION_NO_TURN;
-                    TranslateManeuverType(static_cast<int>(maneuver.get("type").get<std::int64_t>()), action);
-                    if (action == RoutingAction::ROUTING_ACTION_FINISH && i + 1 < maneuvers.size()) {
-                        action = RoutingAction::ROUTING_ACTION_REACH_VIA_LOCATION;
-                    }
-
-                    std::size_t pointIndex = points.size();
-                    for (std::size_t j = static_cast<std::size_t>(maneuver.get("begin_shape_index").get<std::int64_t>()); j <= static_cast<std::size_t>(maneuver.get("end_shape_index").get<std::int64_t>()); j++) {
-                        const valhalla::midgard::PointLL& point = shape.at(j);
-                        epsg3857Points.push_back(epsg3857.fromLatLong(point.second, point.first));
-                        points.push_back(proj->fromLatLong(point.second, point.first));
-                    }
-
-                    float turnAngle = CalculateTurnAngle(epsg3857Points, pointIndex);
-                    float azimuth = CalculateAzimuth(epsg3857Points, pointIndex);
-
                     std::string streetName;
                     if (maneuver.get("street_names").is<picojson::array>()) {
                         const picojson::array& streetNames = maneuver.get("street_names").get<picojson::array>();
                         streetName = !streetNames.empty() ? streetNames[0].get<std::string>() : std::string("");
                     }
 
-                    instructions.emplace_back(
-                        action,
-                        pointIndex,
+                    AddManeuverInstruction(
+                        proj,
+                        shape,
+                        static_cast<int>(maneuver.get("type").get<std::int64_t>()),
+                        i + 1 == maneuvers.size(),
+                        static_cast<std::size_t>(maneuver.get("begin_shape_index").get<std::int64_t>()),
+                        static_cast<std::size_t>(maneuver.get("end_shape_index").get<std::int64_t>()),
                         streetName,
-                        turnAngle,
-                        azimuth,
                         maneuver.get("length").get<double>() * 1000.0,
-                        maneuver.get("time").get<double>()
+                        maneuver.get("time").get<double>(),
+                        points,
+                        epsg3857Points,
+                        instructions
+                    );
+                }
+            }
+        }
+        catch (const std::exception& ex) {
+            throw GenericException("Exception while translating route", ex.what());
+        }
+        return std::make_shared<RoutingResult>(proj, points, instructions);
+    }
+
+#ifdef _CARTO_VALHALLA_ROUTING_SUPPORT
+    std::shared_ptr<RoutingResult> ValhallaRoutingProxy::TranslateRoutingResult(const std::shared_ptr<Projection>& proj, const valhalla::Api& api) {
+        // Build the result directly from the directions, instead of serializing the directions to JSON and parsing them back
+        if (api.directions().routes_size() == 0) {
+            throw GenericException("No trip info in the result");
+        }
+
+        std::vector<MapPos> points;
+        std::vector<MapPos> epsg3857Points;
+        std::vector<RoutingInstruction> instructions;
+        try {
+            for (const valhalla::DirectionsLeg& leg : api.directions().routes(0).legs()) {
+                std::vector<MapPos> shape = DecodeShape(leg.shape());
+                points.reserve(points.size() + shape.size());
+                epsg3857Points.reserve(epsg3857Points.size() + shape.size());
+
+                for (int i = 0; i < leg.maneuver_size(); i++) {
+                    const valhalla::DirectionsLeg::Maneuver& maneuver = leg.maneuver(i);
+
+                    std::string streetName;
+                    if (maneuver.street_name_size() > 0) {
+                        streetName = maneuver.street_name(0).value();
+                    }
+
+                    AddManeuverInstruction(
+                        proj,
+                        shape,
+                        static_cast<int>(maneuver.type()),
+                        i + 1 == leg.maneuver_size(),
+                        static_cast<std::size_t>(maneuver.begin_shape_index()),
+                        static_cast<std::size_t>(maneuver.end_shape_index()),
+                        streetName,
+                        maneuver.length() * 1000.0,
+                        maneuver.time(),
+                        points,
+                        epsg3857Points,
+                        instructions
                     );
                 }
             }
@@ -555,6 +678,46 @@ namespace carto {
         }
         return std::make_shared<RoutingResult>(proj, points, instructions);
     }
+#endif
+
+    std::vector<MapPos> ValhallaRoutingProxy::DecodeShape(const std::string& encodedShape) {
+        std::vector<valhalla::midgard::PointLL> shape = valhalla::midgard::decode<std::vector<valhalla::midgard::PointLL> >(encodedShape);
+        std::vector<MapPos> points;
+        points.reserve(shape.size());
+        for (const valhalla::midgard::PointLL& point : shape) {
+            points.emplace_back(point.first, point.second);
+        }
+        return points;
+    }
+
+    void ValhallaRoutingProxy::AddManeuverInstruction(const std::shared_ptr<Projection>& proj, const std::vector<MapPos>& shape, int maneuverType, bool lastManeuver, std::size_t beginShapeIndex, std::size_t endShapeIndex, const std::string& streetName, double distance, double time, std::vector<MapPos>& points, std::vector<MapPos>& epsg3857Points, std::vector<RoutingInstruction>& instructions) {
+        RoutingAction::RoutingAction action = RoutingAction::ROUTING_ACTION_NO_TURN;
+        TranslateManeuverType(maneuverType, action);
+        if (action == RoutingAction::ROUTING_ACTION_FINISH && !lastManeuver) {
+            action = RoutingAction::ROUTING_ACTION_REACH_VIA_LOCATION;
+        }
+
+        EPSG3857 epsg3857;
+        std::size_t pointIndex = points.size();
+        for (std::size_t j = beginShapeIndex; j <= endShapeIndex; j++) {
+            const MapPos& point = shape.at(j);
+            epsg3857Points.push_back(epsg3857.fromLatLong(point.getY(), point.getX()));
+            points.push_back(proj->fromLatLong(point.getY(), point.getX()));
+        }
+
+        float turnAngle = CalculateTurnAngle(epsg3857Points, pointIndex);
+        float azimuth = CalculateAzimuth(epsg3857Points, pointIndex);
+
+        instructions.emplace_back(
+            action,
+            pointIndex,
+            streetName,
+            turnAngle,
+            azimuth,
+            distance,
+            time
+        );
+    }
 
     std::string ValhallaRoutingProxy::MakeHTTPRequest(HTTPClient& httpClient, const std::string& url) {
         std::map<std::string, std::string> requestHeaders;
@@ -591,6 +754,11 @@ namespace carto {
     ValhallaRoutingProxy::ValhallaRoutingProxy() {
     }
 
+#ifdef _CARTO_VALHALLA_ROUTING_SUPPORT
+    const std::size_t ValhallaRoutingProxy::DEFAULT_MAX_IDLE_READERS = 2;
+    const std::size_t ValhallaRoutingProxy::DEFAULT_MAX_TILE_CACHE_SIZE = 10 * 1024 * 1024;
+#endif
+
 }
 
 #endif
@@ -13,6 +13,8 @@
 #include "routing/RoutingInstruction.h"
 
 #include <memory>
+#include <mutex>
+#include <string>
 #include <vector>
 #include <unordered_map>
 
@@ -20,6 +22,15 @@ namespace sqlite3pp {
     class database;
 }
 
+#ifdef _CARTO_VALHALLA_ROUTING_SUPPORT
+namespace valhalla {
+    class Api;
+    namespace baldr {
+        class GraphReader;
+    }
+}
+#endif
+
 namespace carto {
     class HTTPClient;
     class Projection;
@@ -30,25 +41,62 @@ namespace carto {
     
     class ValhallaRoutingProxy {
     public:
+#ifdef _CARTO_VALHALLA_ROUTING_SUPPORT
+        class GraphReaderPool {
+        public:
+            GraphReaderPool(const std::vector<std::string>& fileNames, std::size_t maxIdleReaders, std::size_t maxTileCacheSize);
+            virtual ~GraphReaderPool();
+
+            const std::vector<std::string>& getFileNames() const;
+            std::size_t getMaxIdleReaders() const;
+            std::size_t getMaxTileCacheSize() const;
+
+            std::shared_ptr<valhalla::baldr::GraphReader> acquireReader();
+            void releaseReader(const std::shared_ptr<valhalla::baldr::GraphReader>& reader);
+
+        private:
+            std::shared_ptr<valhalla::baldr::GraphReader> createReader() const;
+
+            const std::vector<std::string> _fileNames;
+            const std::size_t _maxIdleReaders;
+            const std::size_t _maxTileCacheSize; // per reader, in bytes
+            std::vector<std::shared_ptr<valhalla::baldr::GraphReader> > _idleReaders; // readers with warm tile caches
+            std::mutex _mutex;
+        };
+#endif
+
         static std::shared_ptr<RouteMatchingResult> MatchRoute(HTTPClient& httpClient, const std::string& baseURL, const std::string& profile, const std::shared_ptr<RouteMatchingRequest>& request);
         static std::shared_ptr<RoutingResult> CalculateRoute(HTTPClient& httpClient, const std::string& baseURL, const std::string& profile, const std::shared_ptr<RoutingRequest>& request);
 
 #ifdef _CARTO_VALHALLA_ROUTING_SUPPORT
-        static std::shared_ptr<RouteMatchingResult> MatchRoute(const std::vector<std::shared_ptr<sqlite3pp::database> >& databases, const std::string& profile, const Variant& config, const std::shared_ptr<RouteMatchingRequest>& request);
-        static std::shared_ptr<RoutingResult> CalculateRoute(const std::vector<std::shared_ptr<sqlite3pp::database> >& databases, const std::string& profile, const Variant& config, const std::shared_ptr<RoutingRequest>& request);
+        static std::shared_ptr<RouteMatchingResult> MatchRoute(GraphReaderPool& readerPool, const std::string& profile, const Variant& config, const std::shared_ptr<RouteMatchingRequest>& request);
+        static std::shared_ptr<RoutingResult> CalculateRoute(GraphReaderPool& readerPool, const std::string& profile, const Variant& config, const std::shared_ptr<RoutingRequest>& request);
 #endif
 
         static Variant GetDefaultConfiguration();
 
+#ifdef _CARTO_VALHALLA_ROUTING_SUPPORT
+        static std::shared_ptr<GraphReaderPool> UpdateGraphReaderPool(const std::shared_ptr<GraphReaderPool>& readerPool, const std::vector<std::string>& fileNames, const Variant& config);
+#endif
+
     private:
         ValhallaRoutingProxy();
 
+#ifdef _CARTO_VALHALLA_ROUTING_SUPPORT
+        static const std::size_t DEFAULT_MAX_IDLE_READERS;
+        static const std::size_t DEFAULT_MAX_TILE_CACHE_SIZE;
+#endif
+
         static float CalculateTurnAngle(const std::vector<MapPos>& epsg3857Points, int pointIndex);
 
         static float CalculateAzimuth(const std::vector<MapPos>& epsg3857Points, int pointIndex);
 
         static bool TranslateManeuverType(int maneuverType, RoutingAction::RoutingAction& action);
 
+        static std::vector<MapPos> DecodeShape(const std::string& encodedShape);
+
+        static void AddManeuverInstruction(const std::shared_ptr<Projection>& proj, const std::vector<MapPos>& shape, int maneuverType, bool lastManeuver, std::size_t beginShapeIndex, std::size_t endShapeIndex, const std::string& streetName, double distance, double time, std::vector<MapPos>& points, std::vector<MapPos>& epsg3857Points, std::vector<RoutingInstruction>& instructions);
+
         static std::string SerializeRouteMatchingRequest(const std::string& profile, const std::shared_ptr<RouteMatchingRequest>& request);
 
         static std::string SerializeRoutingRequest(const std::string& profile, const std::shared_ptr<RoutingRequest>& request);
@@ -57,6 +105,10 @@ namespace carto {
 
         static std::shared_ptr<RoutingResult> ParseRoutingResult(const std::shared_ptr<Projection>& proj, const std::string& resultString);
 
+#ifdef _CARTO_VALHALLA_ROUTING_SUPPORT
+        static std::shared_ptr<RoutingResult> TranslateRoutingResult(const std::shared_ptr<Projection>& proj, const valhalla::Api& api);
+#endif
+
         static std::string MakeHTTPRequest(HTTPClient& httpClient, const std::string& url);
     };
 
@@ -2,6 +2,7 @@
 #include "components/CancelableThreadPool.h"
 #include "components/LicenseManager.h"
 #include "components/Layers.h"
+#include "components/MemoryBudgetManager.h"
 #include "core/MapPos.h"
 #include "core/MapBounds.h"
 #include "core/ScreenPos.h"
@@ -39,6 +40,22 @@ namespace carto {
         ss << ", device OS: " << PlatformUtils::GetDeviceOS();
         return ss.str();
     }
+
+    std::size_t BaseMapView::GetMemoryBudget() {
+        return MemoryBudgetManager::GetInstance().getMemoryBudget();
+    }
+
+    void BaseMapView::SetMemoryBudget(std::size_t budgetInBytes) {
+        MemoryBudgetManager::GetInstance().setMemoryBudget(budgetInBytes);
+    }
+
+    std::size_t BaseMapView::GetMemoryUsage() {
+        return MemoryBudgetManager::GetInstance().getMemoryUsage();
+    }
+
+    void BaseMapView::OnLowMemory() {
+        MemoryBudgetManager::GetInstance().onLowMemory();
+    }
     
     BaseMapView::BaseMapView() :
         _envelopeThreadPool(std::make_shared<CancelableThreadPool>()),
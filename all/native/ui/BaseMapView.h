@@ -46,6 +46,33 @@ namespace carto {
          * @return The SDK version and build info.
          */
         static std::string GetSDKVersion();
+
+        /**
+         * Returns the global memory budget shared by the caches of all layers and data sources.
+         * @return The global memory budget in bytes. 0 means that the budget is not limited.
+         */
+        static std::size_t GetMemoryBudget();
+        /**
+         * Sets the global memory budget shared by the caches of all layers and data sources.
+         * The budget is distributed dynamically between the caches based on their measured memory usage and recent miss ratios.
+         * The budget also covers the tiles that are currently visible, but these are never released.
+         * The capacities set for the individual caches remain as upper limits for each cache. The new budget is applied asynchronously.
+         * The default is 0, meaning that the budget is not limited and each cache uses its own capacity.
+         * @param budgetInBytes The new global memory budget in bytes.
+         */
+        static void SetMemoryBudget(std::size_t budgetInBytes);
+        /**
+         * Returns the total memory usage of the caches of all layers and data sources, as measured during the last update of the quotas.
+         * @return The total memory usage of the caches in bytes.
+         */
+        static std::size_t GetMemoryUsage();
+        /**
+         * Notifies the SDK that the system is running low on memory. The caches are shrunk asynchronously
+         * to half of their current total usage, starting with the caches with the lowest miss ratios.
+         * The caches are allowed to grow back gradually afterwards.
+         * MapView calls this method automatically when it receives the memory warning from the OS.
+         */
+        static void OnLowMemory();
         
         BaseMapView();
         virtual ~BaseMapView();
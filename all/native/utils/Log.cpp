@@ -15,6 +15,10 @@
 #include <windows.h>
 #endif
 
+#if !defined(__ANDROID__) && !defined(__APPLE__) && !defined(_WIN32)
+#include <cstdio>
+#endif
+
 namespace carto {
 
 #ifdef __ANDROID__
@@ -39,6 +43,13 @@ namespace carto {
         OutputDebugStringA("\n");
     }
 #endif
+#if !defined(__ANDROID__) && !defined(__APPLE__) && !defined(_WIN32)
+    enum LogType { LOG_TYPE_FATAL, LOG_TYPE_ERROR, LOG_TYPE_WARNING, LOG_TYPE_INFO, LOG_TYPE_DEBUG };
+
+    static void OutputLog(LogType logType, const std::string& tag, const char* text) {
+        std::fprintf(stderr, "%s: %s\n", tag.c_str(), text);
+    }
+#endif
 
     bool Log::IsShowError() {
         std::lock_guard<std::mutex> lock(_Mutex);
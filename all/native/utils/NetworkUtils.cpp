@@ -100,6 +100,15 @@ namespace carto {
         }
         return -1;
     }
+
+    std::string NetworkUtils::GetHTTPHeader(const std::map<std::string, std::string>& headers, const std::string& name) {
+        for (auto it = headers.begin(); it != headers.end(); it++) {
+            if (boost::iequals(it->first, name)) {
+                return boost::trim_copy(it->second);
+            }
+        }
+        return std::string();
+    }
     
     std::string NetworkUtils::URLEncode(const std::string& value) {
         std::ostringstream escaped;
@@ -5,6 +5,8 @@
 #include "utils/Const.h"
 #include "utils/Log.h"
 
+#include <vector>
+
 #include <stdext/utf8_filesystem.h>
 
 namespace carto {
@@ -107,10 +109,10 @@ namespace carto {
                     utf8_filesystem::fseek64(fp.get(), 0, SEEK_END);
                     std::uint64_t length = utf8_filesystem::ftell64(fp.get());
                     utf8_filesystem::fseek64(fp.get(), 0, SEEK_SET);
+                    std::vector<unsigned char> buf(65536);
                     while (!feof(fp.get())) {
-                        unsigned char buf[4096];
-                        std::size_t n = fread(buf, sizeof(unsigned char), sizeof(buf) / sizeof(unsigned char), fp.get());
-                        if (!handlerFn(length, buf, n)) {
+                        std::size_t n = fread(buf.data(), sizeof(unsigned char), buf.size(), fp.get());
+                        if (!handlerFn(length, buf.data(), n)) {
                             return false;
                         }
                     }
@@ -11,62 +11,130 @@
 #include <miniz.c>
 #include <string.h>
 
+#include <algorithm>
+#include <unordered_set>
+
+#ifdef _WIN32
+#include <stdext/utf8_filesystem.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 namespace carto {
 
     ZippedAssetPackage::ZippedAssetPackage(const std::shared_ptr<BinaryData>& zipData) :
         _zipData(zipData),
         _baseAssetPackage(),
-        _handle(),
-        _assetIndexMap()
+        _mappedData(),
+        _archiveData(nullptr),
+        _archiveSize(0),
+        _assetIndexMap(),
+        _assetCache(DEFAULT_CACHE_CAPACITY),
+        _mutex()
     {
+        if (!zipData) {
+            throw NullArgumentException("Null zipData");
+        }
+
         initialize();
     }
-    
+
     ZippedAssetPackage::ZippedAssetPackage(const std::shared_ptr<BinaryData>& zipData, const std::shared_ptr<AssetPackage>& baseAssetPackage) :
         _zipData(zipData),
         _baseAssetPackage(baseAssetPackage),
-        _handle(),
-        _assetIndexMap()
+        _mappedData(),
+        _archiveData(nullptr),
+        _archiveSize(0),
+        _assetIndexMap(),
+        _assetCache(DEFAULT_CACHE_CAPACITY),
+        _mutex()
     {
+        if (!zipData) {
+            throw NullArgumentException("Null zipData");
+        }
+
         initialize();
     }
-    
+
+    ZippedAssetPackage::ZippedAssetPackage(const std::string& fileName, const std::shared_ptr<AssetPackage>& baseAssetPackage) :
+        _zipData(),
+        _baseAssetPackage(baseAssetPackage),
+        _mappedData(),
+        _archiveData(nullptr),
+        _archiveSize(0),
+        _assetIndexMap(),
+        _assetCache(DEFAULT_CACHE_CAPACITY),
+        _mutex()
+    {
+#ifdef _WIN32
+        FILE* fpRaw = utf8_filesystem::fopen(fileName.c_str(), "rb");
+        if (!fpRaw) {
+            throw FileException("Could not open ZIP archive", fileName);
+        }
+        std::shared_ptr<FILE> fp(fpRaw, fclose);
+        utf8_filesystem::fseek64(fp.get(), 0, SEEK_END);
+        long long fileSize = utf8_filesystem::ftell64(fp.get());
+        utf8_filesystem::fseek64(fp.get(), 0, SEEK_SET);
+        std::vector<unsigned char> data(static_cast<std::size_t>(std::max(0LL, fileSize)));
+        if (data.empty() || fread(data.data(), 1, data.size(), fp.get()) != data.size()) {
+            throw FileException("Could not read ZIP archive", fileName);
+        }
+        _zipData = std::make_shared<BinaryData>(std::move(data));
+#else
+        int fd = ::open(fileName.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw FileException("Could not open ZIP archive", fileName);
+        }
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || st.st_size <= 0) {
+            ::close(fd);
+            throw FileException("Could not read ZIP archive", fileName);
+        }
+        std::size_t size = static_cast<std::size_t>(st.st_size);
+        void* ptr = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (ptr == MAP_FAILED) {
+            throw FileException("Could not map ZIP archive", fileName);
+        }
+        _mappedData = std::shared_ptr<void>(ptr, [size](void* ptr) { ::munmap(ptr, size); });
+        _archiveData = static_cast<const unsigned char*>(ptr);
+        _archiveSize = size;
+#endif
+
+        initialize();
+    }
+
     ZippedAssetPackage::~ZippedAssetPackage() {
-        deinitialize();
     }
-    
-    std::vector<std::string> ZippedAssetPackage::getLocalAssetNames() const {
-        std::lock_guard<std::mutex> lock(_mutex);
 
+    std::vector<std::string> ZippedAssetPackage::getLocalAssetNames() const {
         std::vector<std::string> names;
         names.reserve(_assetIndexMap.size());
         for (auto it = _assetIndexMap.begin(); it != _assetIndexMap.end(); it++) {
-            if (std::find(names.begin(), names.end(), it->first) == names.end()) {
-                names.push_back(it->first);
-            }
+            names.push_back(it->first);
         }
         return names;
     }
-    
-    std::vector<std::string> ZippedAssetPackage::getAssetNames() const {
-        std::lock_guard<std::mutex> lock(_mutex);
 
+    std::vector<std::string> ZippedAssetPackage::getAssetNames() const {
         std::vector<std::string> names;
         if (_baseAssetPackage) {
             names = _baseAssetPackage->getAssetNames();
         }
+        std::unordered_set<std::string> nameSet(names.begin(), names.end());
         names.reserve(names.size() + _assetIndexMap.size());
         for (auto it = _assetIndexMap.begin(); it != _assetIndexMap.end(); it++) {
-            if (std::find(names.begin(), names.end(), it->first) == names.end()) {
+            if (nameSet.insert(it->first).second) {
                 names.push_back(it->first);
             }
         }
         return names;
     }
-    
-    std::shared_ptr<BinaryData> ZippedAssetPackage::loadAsset(const std::string& name) const {
-        std::lock_guard<std::mutex> lock(_mutex);
 
+    std::shared_ptr<BinaryData> ZippedAssetPackage::loadAsset(const std::string& name) const {
         auto it = _assetIndexMap.find(name);
         if (it == _assetIndexMap.end()) {
             if (_baseAssetPackage) {
@@ -75,49 +143,117 @@ namespace carto {
             return std::shared_ptr<BinaryData>();
         }
 
-        mz_zip_archive* zip = static_cast<mz_zip_archive*>(_handle.get());
-        if (!zip) {
-            return std::shared_ptr<BinaryData>();
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            std::shared_ptr<BinaryData> data;
+            if (_assetCache.read(name, data)) {
+                return data;
+            }
         }
-    
-        std::size_t elementSize = 0;
-        std::shared_ptr<unsigned char> elementData(static_cast<unsigned char*>(mz_zip_reader_extract_to_heap(zip, it->second, &elementSize, 0)), mz_free);
-        if (!elementData) {
-            Log::Error("ZippedAssetPackage::loadAsset: Could not load archive asset");
-            return std::shared_ptr<BinaryData>();
+
+        // Extract the asset without holding the lock, so that multiple assets can be decompressed in parallel
+        std::shared_ptr<BinaryData> data = extractAsset(name, it->second);
+        if (data) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (data->size() <= _assetCache.capacity()) {
+                _assetCache.put(name, data, data->size());
+            }
         }
-        return std::make_shared<BinaryData>(elementData.get(), elementSize);
+        return data;
+    }
+
+    std::size_t ZippedAssetPackage::getCacheCapacity() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _assetCache.capacity();
+    }
+
+    void ZippedAssetPackage::setCacheCapacity(std::size_t capacityInBytes) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _assetCache.resize(capacityInBytes);
     }
 
     void ZippedAssetPackage::initialize() {
-        if (!_zipData) {
-            throw NullArgumentException("Null zipData");
+        if (_zipData) {
+            std::shared_ptr<std::vector<unsigned char> > data = _zipData->getDataPtr();
+            _archiveData = data->data();
+            _archiveSize = data->size();
         }
-    
-        _handle = std::make_shared<mz_zip_archive>();
-        mz_zip_archive* zip = static_cast<mz_zip_archive*>(_handle.get());
-        memset(zip, 0, sizeof(mz_zip_archive));
-        std::shared_ptr<std::vector<unsigned char> > data = _zipData->getDataPtr();
-        if (!mz_zip_reader_init_mem(zip, data->data(), data->size(), 0)) {
+
+        // Read the central directory only, assets are extracted directly from the archive data
+        mz_zip_archive zip;
+        memset(&zip, 0, sizeof(mz_zip_archive));
+        if (!mz_zip_reader_init_mem(&zip, _archiveData, _archiveSize, 0)) {
             throw GenericException("Could not open ZIP archive");
         }
-    
-        for (unsigned int i = 0; i < mz_zip_reader_get_num_files(zip); i++) {
+        std::shared_ptr<mz_zip_archive> zipGuard(&zip, mz_zip_reader_end);
+
+        for (unsigned int i = 0; i < mz_zip_reader_get_num_files(&zip); i++) {
             mz_zip_archive_file_stat stat;
-            if (!mz_zip_reader_file_stat(zip, i, &stat)) {
+            if (!mz_zip_reader_file_stat(&zip, i, &stat)) {
                 throw GenericException("Could not read ZIP archive file stats");
             }
-    
-            _assetIndexMap[stat.m_filename] = i;
+            if (mz_zip_reader_is_file_a_directory(&zip, i)) {
+                continue;
+            }
+
+            AssetEntry entry;
+            entry.localHeaderOffset = stat.m_local_header_ofs;
+            entry.compressedSize = stat.m_comp_size;
+            entry.uncompressedSize = stat.m_uncomp_size;
+            entry.crc32 = static_cast<std::uint32_t>(stat.m_crc32);
+            entry.method = stat.m_method;
+            entry.flags = stat.m_bit_flag;
+            _assetIndexMap[stat.m_filename] = entry;
         }
     }
 
-    void ZippedAssetPackage::deinitialize() {
-        mz_zip_archive* zip = static_cast<mz_zip_archive*>(_handle.get());
-        if (zip) {
-            mz_zip_reader_end(zip);
+    std::shared_ptr<BinaryData> ZippedAssetPackage::extractAsset(const std::string& name, const AssetEntry& entry) const {
+        if (entry.flags & 1) {
+            Log::Errorf("ZippedAssetPackage::extractAsset: Encrypted asset %s not supported", name.c_str());
+            return std::shared_ptr<BinaryData>();
+        }
+
+        // Locate the data using the local header, its name/extra field lengths may differ from the central directory
+        const std::uint64_t localHeaderSize = 30;
+        if (entry.localHeaderOffset + localHeaderSize > _archiveSize) {
+            Log::Errorf("ZippedAssetPackage::extractAsset: Invalid local header for asset %s", name.c_str());
+            return std::shared_ptr<BinaryData>();
+        }
+        const unsigned char* header = _archiveData + entry.localHeaderOffset;
+        if (MZ_READ_LE32(header) != 0x04034b50) {
+            Log::Errorf("ZippedAssetPackage::extractAsset: Invalid local header signature for asset %s", name.c_str());
+            return std::shared_ptr<BinaryData>();
+        }
+        std::uint64_t dataOffset = entry.localHeaderOffset + localHeaderSize + MZ_READ_LE16(header + 26) + MZ_READ_LE16(header + 28);
+        if (dataOffset + entry.compressedSize > _archiveSize) {
+            Log::Errorf("ZippedAssetPackage::extractAsset: Truncated data for asset %s", name.c_str());
+            return std::shared_ptr<BinaryData>();
+        }
+        const unsigned char* compressedData = _archiveData + dataOffset;
+
+        std::vector<unsigned char> data;
+        if (entry.method == 0) {
+            // Stored entries are copied directly from the (possibly memory-mapped) archive
+            data.assign(compressedData, compressedData + entry.compressedSize);
+        } else if (entry.method == MZ_DEFLATED) {
+            data.resize(static_cast<std::size_t>(entry.uncompressedSize));
+            std::size_t size = tinfl_decompress_mem_to_mem(data.data(), data.size(), compressedData, static_cast<std::size_t>(entry.compressedSize), 0);
+            if (size == TINFL_DECOMPRESS_MEM_TO_MEM_FAILED || size != data.size()) {
+                Log::Errorf("ZippedAssetPackage::extractAsset: Failed to decompress asset %s", name.c_str());
+                return std::shared_ptr<BinaryData>();
+            }
+        } else {
+            Log::Errorf("ZippedAssetPackage::extractAsset: Unsupported compression method %d for asset %s", entry.method, name.c_str());
+            return std::shared_ptr<BinaryData>();
+        }
+
+        if (mz_crc32(MZ_CRC32_INIT, data.data(), data.size()) != entry.crc32) {
+            Log::Errorf("ZippedAssetPackage::extractAsset: CRC mismatch for asset %s", name.c_str());
+            return std::shared_ptr<BinaryData>();
         }
-        _handle.reset();
+        return std::make_shared<BinaryData>(std::move(data));
     }
-    
+
+    const std::size_t ZippedAssetPackage::DEFAULT_CACHE_CAPACITY = 2 * 1024 * 1024;
+
 }
@@ -9,13 +9,18 @@
 
 #include "utils/AssetPackage.h"
 
+#include <cstdint>
+#include <map>
 #include <mutex>
 
+#include <stdext/timed_lru_cache.h>
+
 namespace carto {
 
     /**
      * An asset package based on ZIP archived.
      * Only deflate-based ZIP archives are supported.
+     * Assets can be loaded concurrently from multiple threads, recently loaded assets are cached.
      */
     class ZippedAssetPackage : public AssetPackage {
     public:
@@ -30,26 +35,61 @@ namespace carto {
          * @param baseAssetPackage The base asset package. If an asset is not found in the ZIP archive, base asset package is used.
          */
         ZippedAssetPackage(const std::shared_ptr<BinaryData>& zipData, const std::shared_ptr<AssetPackage>& baseAssetPackage);
+        /**
+         * Constructs a ZIP asset package from the ZIP archive file.
+         * The file is memory-mapped on platforms supporting it, so only the accessed assets are read from the file.
+         * @param fileName The full path of the ZIP archive file.
+         * @param baseAssetPackage The base asset package. If an asset is not found in the ZIP archive, base asset package is used. Can be null.
+         * @throws std::runtime_error If the file could not be opened or is not a valid ZIP archive.
+         */
+        ZippedAssetPackage(const std::string& fileName, const std::shared_ptr<AssetPackage>& baseAssetPackage);
         virtual ~ZippedAssetPackage();
 
         std::vector<std::string> getLocalAssetNames() const;
-    
+
         virtual std::vector<std::string> getAssetNames() const;
-    
+
         virtual std::shared_ptr<BinaryData> loadAsset(const std::string& name) const;
-    
+
+        /**
+         * Returns the capacity of the decompressed asset cache.
+         * @return The cache capacity in bytes.
+         */
+        std::size_t getCacheCapacity() const;
+        /**
+         * Sets the capacity of the decompressed asset cache.
+         * The default is 2MB. Zero can be used to disable caching.
+         * @param capacityInBytes The new cache capacity in bytes.
+         */
+        void setCacheCapacity(std::size_t capacityInBytes);
+
     private:
+        struct AssetEntry {
+            std::uint64_t localHeaderOffset;
+            std::uint64_t compressedSize;
+            std::uint64_t uncompressedSize;
+            std::uint32_t crc32;
+            unsigned int method;
+            unsigned int flags;
+        };
+
         void initialize();
-        void deinitialize();
 
-        const std::shared_ptr<BinaryData> _zipData;
+        std::shared_ptr<BinaryData> extractAsset(const std::string& name, const AssetEntry& entry) const;
+
+        static const std::size_t DEFAULT_CACHE_CAPACITY;
+
+        std::shared_ptr<BinaryData> _zipData;
         const std::shared_ptr<AssetPackage> _baseAssetPackage;
-        std::shared_ptr<void> _handle;
-        std::map<std::string, unsigned int> _assetIndexMap;
+        std::shared_ptr<void> _mappedData;
+        const unsigned char* _archiveData;
+        std::size_t _archiveSize;
+        std::map<std::string, AssetEntry> _assetIndexMap; // immutable after initialization
 
+        mutable cache::timed_lru_cache<std::string, std::shared_ptr<BinaryData> > _assetCache;
         mutable std::mutex _mutex;
     };
-    
+
 }
 
 #endif
@@ -0,0 +1,268 @@
+#include "datasources/HTTPTileDataSource.h"
+#include "datasources/components/TileData.h"
+#include "core/BinaryData.h"
+#include "core/MapTile.h"
+
+#include "support/StubHTTPServer.h"
+#include "support/TestUtils.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace carto;
+using namespace carto::test;
+
+namespace {
+
+    // Simulates a tile server with a single versioned resource for every tile
+    struct TileServerState {
+        std::string etag;
+        std::string lastModified;
+        std::string content;
+        int maxAge = 0;
+        int delayMs = 0;
+        std::vector<StubHTTPServer::Request> requests;
+        std::mutex mutex;
+
+        StubHTTPServer::Response handle(const StubHTTPServer::Request& request) {
+            int delay = 0;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                delay = delayMs;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+
+            std::lock_guard<std::mutex> lock(mutex);
+            requests.push_back(request);
+
+            StubHTTPServer::Response response(200, content);
+            bool notModified = false;
+            if (!request.getHeader("If-None-Match").empty()) {
+                notModified = !etag.empty() && request.getHeader("If-None-Match") == etag;
+            } else if (!request.getHeader("If-Modified-Since").empty()) {
+                notModified = !lastModified.empty() && request.getHeader("If-Modified-Since") == lastModified;
+            }
+            if (notModified) {
+                response = StubHTTPServer::Response(304, std::string());
+            }
+            if (!etag.empty()) {
+                response.headers["ETag"] = etag;
+            }
+            if (!lastModified.empty()) {
+                response.headers["Last-Modified"] = lastModified;
+            }
+            response.headers["Cache-Control"] = "max-age=" + std::to_string(maxAge);
+            return response;
+        }
+
+        StubHTTPServer::Request lastRequest() {
+            std::lock_guard<std::mutex> lock(mutex);
+            return requests.back();
+        }
+
+        void update(const std::string& newETag, const std::string& newLastModified, const std::string& newContent, int newMaxAge) {
+            std::lock_guard<std::mutex> lock(mutex);
+            etag = newETag;
+            lastModified = newLastModified;
+            content = newContent;
+            maxAge = newMaxAge;
+        }
+    };
+
+    struct CountingListener : public TileDataSource::OnChangeListener {
+        std::atomic<int> count;
+
+        CountingListener() : count(0) { }
+
+        virtual void onTilesChanged(bool removeTiles) {
+            count++;
+        }
+    };
+
+    std::string ToString(const std::shared_ptr<TileData>& tileData) {
+        if (!tileData || !tileData->getData()) {
+            return std::string();
+        }
+        return std::string(reinterpret_cast<const char*>(tileData->getData()->data()), tileData->getData()->size());
+    }
+
+    std::shared_ptr<HTTPTileDataSource> CreateDataSource(const StubHTTPServer& server) {
+        auto dataSource = std::make_shared<HTTPTileDataSource>(0, 18, server.getBaseURL() + "/{zoom}/{x}/{y}.png");
+        dataSource->setMaxAgeHeaderCheck(true);
+        return dataSource;
+    }
+
+}
+
+CARTO_TEST(ETagRevalidationReusesStaleTile) {
+    TileServerState state;
+    state.update("\"v1\"", std::string(), "tile-v1", 0);
+    StubHTTPServer server([&state](const StubHTTPServer::Request& request) { return state.handle(request); });
+    auto dataSource = CreateDataSource(server);
+    MapTile mapTile(1, 2, 3, 0);
+
+    std::shared_ptr<TileData> tileData1 = dataSource->loadTile(mapTile);
+    CARTO_CHECK_EQUAL(std::string("tile-v1"), ToString(tileData1));
+    CARTO_CHECK_EQUAL(std::string("\"v1\""), tileData1->getETag());
+    CARTO_CHECK_EQUAL(0LL, tileData1->getMaxAge());
+    CARTO_CHECK(state.lastRequest().getHeader("If-None-Match").empty());
+
+    state.update("\"v1\"", std::string(), "unexpected-body", 60);
+    std::shared_ptr<TileData> tileData2 = dataSource->loadTile(mapTile);
+    CARTO_CHECK_EQUAL(std::string("\"v1\""), state.lastRequest().getHeader("If-None-Match"));
+    CARTO_CHECK_EQUAL(std::string("/3/1/2.png"), state.lastRequest().path);
+    CARTO_CHECK_EQUAL(std::string("tile-v1"), ToString(tileData2));
+    CARTO_CHECK(tileData2->getData() == tileData1->getData());
+    CARTO_CHECK(tileData2->getMaxAge() > 0);
+    CARTO_CHECK_EQUAL(2, server.getRequestCount());
+
+    // Revalidated tile is fresh now, served from the cache without requests
+    std::shared_ptr<TileData> tileData3 = dataSource->loadTile(mapTile);
+    CARTO_CHECK_EQUAL(std::string("tile-v1"), ToString(tileData3));
+    CARTO_CHECK_EQUAL(2, server.getRequestCount());
+}
+
+CARTO_TEST(ETagMismatchReturnsNewContent) {
+    TileServerState state;
+    state.update("\"v1\"", std::string(), "tile-v1", 0);
+    StubHTTPServer server([&state](const StubHTTPServer::Request& request) { return state.handle(request); });
+    auto dataSource = CreateDataSource(server);
+    MapTile mapTile(0, 0, 1, 0);
+
+    CARTO_CHECK_EQUAL(std::string("tile-v1"), ToString(dataSource->loadTile(mapTile)));
+
+    state.update("\"v2\"", std::string(), "tile-v2", 0);
+    std::shared_ptr<TileData> tileData = dataSource->loadTile(mapTile);
+    CARTO_CHECK_EQUAL(std::string("\"v1\""), state.lastRequest().getHeader("If-None-Match"));
+    CARTO_CHECK_EQUAL(std::string("tile-v2"), ToString(tileData));
+    CARTO_CHECK_EQUAL(std::string("\"v2\""), tileData->getETag());
+
+    // Next conditional request uses the updated validator
+    dataSource->loadTile(mapTile);
+    CARTO_CHECK_EQUAL(std::string("\"v2\""), state.lastRequest().getHeader("If-None-Match"));
+}
+
+CARTO_TEST(LastModifiedRevalidation) {
+    const std::string lastModified = "Wed, 21 Oct 2015 07:28:00 GMT";
+    TileServerState state;
+    state.update(std::string(), lastModified, "tile-lm", 0);
+    StubHTTPServer server([&state](const StubHTTPServer::Request& request) { return state.handle(request); });
+    auto dataSource = CreateDataSource(server);
+    MapTile mapTile(5, 6, 7, 0);
+
+    std::shared_ptr<TileData> tileData1 = dataSource->loadTile(mapTile);
+    CARTO_CHECK_EQUAL(lastModified, tileData1->getLastModified());
+    CARTO_CHECK(tileData1->getETag().empty());
+
+    std::shared_ptr<TileData> tileData2 = dataSource->loadTile(mapTile);
+    StubHTTPServer::Request request = state.lastRequest();
+    CARTO_CHECK_EQUAL(lastModified, request.getHeader("If-Modified-Since"));
+    CARTO_CHECK(request.getHeader("If-None-Match").empty());
+    CARTO_CHECK_EQUAL(std::string("tile-lm"), ToString(tileData2));
+    CARTO_CHECK_EQUAL(lastModified, tileData2->getLastModified());
+}
+
+CARTO_TEST(TilesWithoutValidatorsAreNotRevalidated) {
+    TileServerState state;
+    state.update(std::string(), std::string(), "tile-plain", 0);
+    StubHTTPServer server([&state](const StubHTTPServer::Request& request) { return state.handle(request); });
+    auto dataSource = CreateDataSource(server);
+    MapTile mapTile(1, 1, 1, 0);
+
+    dataSource->loadTile(mapTile);
+    dataSource->loadTile(mapTile);
+    CARTO_CHECK_EQUAL(2, server.getRequestCount());
+    CARTO_CHECK(state.lastRequest().getHeader("If-None-Match").empty());
+    CARTO_CHECK(state.lastRequest().getHeader("If-Modified-Since").empty());
+}
+
+CARTO_TEST(StaleWhileRevalidateNotifiesOnNewContent) {
+    TileServerState state;
+    state.update("\"v1\"", std::string(), "tile-v1", 0);
+    StubHTTPServer server([&state](const StubHTTPServer::Request& request) { return state.handle(request); });
+    auto dataSource = CreateDataSource(server);
+    dataSource->setStaleWhileRevalidate(true);
+    auto listener = std::make_shared<CountingListener>();
+    dataSource->registerOnChangeListener(listener);
+    MapTile mapTile(2, 1, 1, 0);
+
+    CARTO_CHECK_EQUAL(std::string("tile-v1"), ToString(dataSource->loadTile(mapTile)));
+
+    state.update("\"v2\"", std::string(), "tile-v2", 60);
+    std::shared_ptr<TileData> staleTileData = dataSource->loadTile(mapTile);
+    CARTO_CHECK_EQUAL(std::string("tile-v1"), ToString(staleTileData));
+    CARTO_CHECK(staleTileData->getMaxAge() > 0);
+
+    CARTO_CHECK(WaitFor([&]() { return listener->count.load() > 0; }, 5000));
+    CARTO_CHECK_EQUAL(2, server.getRequestCount());
+    CARTO_CHECK_EQUAL(std::string("\"v1\""), state.lastRequest().getHeader("If-None-Match"));
+
+    // The stale entry was replaced before the layers were notified
+    std::shared_ptr<TileData> tileData = dataSource->loadTile(mapTile);
+    CARTO_CHECK_EQUAL(std::string("tile-v2"), ToString(tileData));
+    CARTO_CHECK_EQUAL(2, server.getRequestCount());
+    CARTO_CHECK_EQUAL(1, listener->count.load());
+
+    dataSource->unregisterOnChangeListener(listener);
+}
+
+CARTO_TEST(StaleWhileRevalidateDoesNotNotifyOnNotModified) {
+    TileServerState state;
+    state.update("\"v1\"", std::string(), "tile-v1", 0);
+    StubHTTPServer server([&state](const StubHTTPServer::Request& request) { return state.handle(request); });
+    auto dataSource = CreateDataSource(server);
+    dataSource->setStaleWhileRevalidate(true);
+    auto listener = std::make_shared<CountingListener>();
+    dataSource->registerOnChangeListener(listener);
+    MapTile mapTile(3, 2, 1, 0);
+
+    dataSource->loadTile(mapTile);
+    state.update("\"v1\"", std::string(), "tile-v1", 60);
+    CARTO_CHECK_EQUAL(std::string("tile-v1"), ToString(dataSource->loadTile(mapTile)));
+
+    CARTO_CHECK(WaitFor([&]() { return server.getRequestCount() == 2; }, 5000));
+    CARTO_CHECK(WaitFor([&]() { return dataSource->loadTile(mapTile)->getMaxAge() > 1000; }, 5000));
+    CARTO_CHECK_EQUAL(2, server.getRequestCount());
+    CARTO_CHECK_EQUAL(0, listener->count.load());
+
+    dataSource->unregisterOnChangeListener(listener);
+}
+
+CARTO_TEST(StaleWhileRevalidateCoalescesNotifications) {
+    TileServerState state;
+    state.update("\"v1\"", std::string(), "tile-v1", 0);
+    StubHTTPServer server([&state](const StubHTTPServer::Request& request) { return state.handle(request); });
+    auto dataSource = CreateDataSource(server);
+    dataSource->setStaleWhileRevalidate(true);
+    auto listener = std::make_shared<CountingListener>();
+    dataSource->registerOnChangeListener(listener);
+
+    std::vector<MapTile> mapTiles;
+    for (int x = 0; x < 4; x++) {
+        mapTiles.push_back(MapTile(x, 0, 2, 0));
+        dataSource->loadTile(mapTiles.back());
+    }
+
+    // Slow responses keep the revalidations queued until all tiles have been requested
+    state.update("\"v2\"", std::string(), "tile-v2", 60);
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.delayMs = 100;
+    }
+    for (const MapTile& mapTile : mapTiles) {
+        CARTO_CHECK_EQUAL(std::string("tile-v1"), ToString(dataSource->loadTile(mapTile)));
+    }
+
+    CARTO_CHECK(WaitFor([&]() { return server.getRequestCount() == 8 && listener->count.load() > 0; }, 5000));
+    for (const MapTile& mapTile : mapTiles) {
+        CARTO_CHECK_EQUAL(std::string("tile-v2"), ToString(dataSource->loadTile(mapTile)));
+    }
+    CARTO_CHECK_EQUAL(1, listener->count.load());
+
+    dataSource->unregisterOnChangeListener(listener);
+}
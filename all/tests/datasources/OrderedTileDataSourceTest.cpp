@@ -0,0 +1,261 @@
+#include "datasources/OrderedTileDataSource.h"
+#include "datasources/CombinedTileDataSource.h"
+#include "datasources/components/TileData.h"
+#include "datasources/components/TileLatencyHistogram.h"
+#include "core/BinaryData.h"
+#include "core/MapTile.h"
+
+#include "support/TestUtils.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace carto;
+using namespace carto::test;
+
+namespace {
+
+    enum FakeResult { FAKE_TILE, FAKE_MISSING, FAKE_EXCEPTION };
+
+    // Tile data source with a fixed latency. Tiles with x = 0 additionally block until the gate is opened.
+    class FakeTileDataSource : public TileDataSource {
+    public:
+        FakeTileDataSource(const std::string& name, int delayMs, FakeResult result) :
+            TileDataSource(0, 24), _name(name), _delayMs(delayMs), _result(result), _gateOpen(true), _loadCounts(), _mutex(), _condition() { }
+
+        void closeGate() {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _gateOpen = false;
+        }
+
+        void openGate() {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _gateOpen = true;
+            _condition.notify_all();
+        }
+
+        int getLoadCount(int x) const {
+            std::lock_guard<std::mutex> lock(_mutex);
+            auto it = _loadCounts.find(x);
+            return it != _loadCounts.end() ? it->second : 0;
+        }
+
+        virtual std::shared_ptr<TileData> loadTile(const MapTile& mapTile) {
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _loadCounts[mapTile.getX()]++;
+                if (mapTile.getX() == 0) {
+                    _condition.wait(lock, [this]() { return _gateOpen; });
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(_delayMs));
+
+            switch (_result) {
+            case FAKE_TILE:
+                return std::make_shared<TileData>(std::make_shared<BinaryData>(reinterpret_cast<const unsigned char*>(_name.data()), _name.size()));
+            case FAKE_MISSING:
+                return std::shared_ptr<TileData>();
+            default:
+                throw std::runtime_error(_name + " failed");
+            }
+        }
+
+    private:
+        std::string _name;
+        int _delayMs;
+        FakeResult _result;
+        bool _gateOpen;
+        std::map<int, int> _loadCounts;
+        mutable std::mutex _mutex;
+        std::condition_variable _condition;
+    };
+
+    std::string ToString(const std::shared_ptr<TileData>& tileData) {
+        if (!tileData || !tileData->getData()) {
+            return std::string();
+        }
+        return std::string(reinterpret_cast<const char*>(tileData->getData()->data()), tileData->getData()->size());
+    }
+
+    int ElapsedMs(std::chrono::steady_clock::time_point startTime) {
+        return static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count());
+    }
+
+    int SampleCount(const std::vector<int>& counts) {
+        return std::accumulate(counts.begin(), counts.end(), 0);
+    }
+
+    const MapTile TEST_TILE(1, 1, 2, 0);
+
+}
+
+CARTO_TEST(HistogramBucketLimits) {
+    TileLatencyHistogram histogram;
+    for (int ms : { 0, 9, 10, 24, 25, 99, 100, 4999, 5000, 60000 }) {
+        histogram.addSample(ms);
+    }
+    std::vector<int> expected = { 2, 2, 1, 1, 1, 0, 0, 0, 1, 2 };
+    CARTO_CHECK(histogram.getCounts() == expected);
+
+    histogram.clear();
+    CARTO_CHECK_EQUAL(0, SampleCount(histogram.getCounts()));
+}
+
+CARTO_TEST(DisabledHedgingWaitsForFirstSource) {
+    auto dataSource1 = std::make_shared<FakeTileDataSource>("first", 150, FAKE_TILE);
+    auto dataSource2 = std::make_shared<FakeTileDataSource>("second", 0, FAKE_TILE);
+    OrderedTileDataSource dataSource(dataSource1, dataSource2);
+
+    CARTO_CHECK_EQUAL(std::string("first"), ToString(dataSource.loadTile(TEST_TILE)));
+    CARTO_CHECK_EQUAL(0, dataSource2->getLoadCount(TEST_TILE.getX()));
+
+    // The 150ms load lands in the 100-250ms bucket
+    std::vector<int> counts1 = dataSource.getLatencyHistogram(0);
+    CARTO_CHECK_EQUAL(1, SampleCount(counts1));
+    CARTO_CHECK_EQUAL(1, counts1[4]);
+    CARTO_CHECK_EQUAL(0, SampleCount(dataSource.getLatencyHistogram(1)));
+
+    bool thrown = false;
+    try {
+        dataSource.getLatencyHistogram(2);
+    }
+    catch (const std::out_of_range&) {
+        thrown = true;
+    }
+    CARTO_CHECK(thrown);
+}
+
+CARTO_TEST(FastFirstSourceDoesNotStartSecond) {
+    auto dataSource1 = std::make_shared<FakeTileDataSource>("first", 10, FAKE_TILE);
+    auto dataSource2 = std::make_shared<FakeTileDataSource>("second", 0, FAKE_TILE);
+    OrderedTileDataSource dataSource(dataSource1, dataSource2);
+    dataSource.setHedgingDelay(500);
+
+    CARTO_CHECK_EQUAL(std::string("first"), ToString(dataSource.loadTile(TEST_TILE)));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    CARTO_CHECK_EQUAL(0, dataSource2->getLoadCount(TEST_TILE.getX()));
+}
+
+CARTO_TEST(SlowFirstSourceIsHedged) {
+    auto dataSource1 = std::make_shared<FakeTileDataSource>("first", 600, FAKE_TILE);
+    auto dataSource2 = std::make_shared<FakeTileDataSource>("second", 10, FAKE_TILE);
+    OrderedTileDataSource dataSource(dataSource1, dataSource2);
+    dataSource.setHedgingDelay(50);
+
+    auto startTime = std::chrono::steady_clock::now();
+    CARTO_CHECK_EQUAL(std::string("second"), ToString(dataSource.loadTile(TEST_TILE)));
+    CARTO_CHECK(ElapsedMs(startTime) < 400);
+    CARTO_CHECK_EQUAL(1, dataSource1->getLoadCount(TEST_TILE.getX()));
+
+    // The abandoned load still completes in the background and is recorded in its own histogram
+    CARTO_CHECK(WaitFor([&dataSource]() { return SampleCount(dataSource.getLatencyHistogram(0)) == 1; }, 5000));
+    CARTO_CHECK_EQUAL(1, dataSource.getLatencyHistogram(0)[6]);
+    CARTO_CHECK_EQUAL(1, SampleCount(dataSource.getLatencyHistogram(1)));
+}
+
+CARTO_TEST(FirstSourceWinsWhenItAnswersFirst) {
+    auto dataSource1 = std::make_shared<FakeTileDataSource>("first", 50, FAKE_TILE);
+    auto dataSource2 = std::make_shared<FakeTileDataSource>("second", 300, FAKE_TILE);
+    OrderedTileDataSource dataSource(dataSource1, dataSource2);
+    dataSource.setHedgingDelay(0);
+
+    auto startTime = std::chrono::steady_clock::now();
+    CARTO_CHECK_EQUAL(std::string("first"), ToString(dataSource.loadTile(TEST_TILE)));
+    CARTO_CHECK(ElapsedMs(startTime) < 250);
+    CARTO_CHECK(WaitFor([&dataSource2]() { return dataSource2->getLoadCount(TEST_TILE.getX()) == 1; }, 1000));
+}
+
+CARTO_TEST(MissingFirstTileStartsSecondImmediately) {
+    auto dataSource1 = std::make_shared<FakeTileDataSource>("first", 10, FAKE_MISSING);
+    auto dataSource2 = std::make_shared<FakeTileDataSource>("second", 10, FAKE_TILE);
+    OrderedTileDataSource dataSource(dataSource1, dataSource2);
+    dataSource.setHedgingDelay(2000);
+
+    auto startTime = std::chrono::steady_clock::now();
+    CARTO_CHECK_EQUAL(std::string("second"), ToString(dataSource.loadTile(TEST_TILE)));
+    CARTO_CHECK(ElapsedMs(startTime) < 1000);
+}
+
+CARTO_TEST(FirstSourceExceptionIsPropagated) {
+    auto dataSource1 = std::make_shared<FakeTileDataSource>("first", 10, FAKE_EXCEPTION);
+    auto dataSource2 = std::make_shared<FakeTileDataSource>("second", 300, FAKE_TILE);
+    OrderedTileDataSource dataSource(dataSource1, dataSource2);
+    dataSource.setHedgingDelay(0);
+
+    bool thrown = false;
+    try {
+        dataSource.loadTile(TEST_TILE);
+    }
+    catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    CARTO_CHECK(thrown);
+
+    // An exception after the second source has provided the tile is ignored
+    auto slowFailingSource = std::make_shared<FakeTileDataSource>("first", 300, FAKE_EXCEPTION);
+    auto fastSource = std::make_shared<FakeTileDataSource>("second", 10, FAKE_TILE);
+    OrderedTileDataSource hedgedDataSource(slowFailingSource, fastSource);
+    hedgedDataSource.setHedgingDelay(0);
+    CARTO_CHECK_EQUAL(std::string("second"), ToString(hedgedDataSource.loadTile(TEST_TILE)));
+}
+
+CARTO_TEST(UnstartedLoadsAreCanceled) {
+    auto dataSource1 = std::make_shared<FakeTileDataSource>("first", 0, FAKE_TILE);
+    auto dataSource2 = std::make_shared<FakeTileDataSource>("second", 100, FAKE_TILE);
+    OrderedTileDataSource dataSource(dataSource1, dataSource2);
+    dataSource.setHedgingDelay(200);
+
+    // Occupy all hedging pool threads with first source loads that block until the gate is opened
+    dataSource1->closeGate();
+    std::vector<std::string> blockedResults(4);
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < blockedResults.size(); i++) {
+        threads.emplace_back([&dataSource, &blockedResults, i]() {
+            blockedResults[i] = ToString(dataSource.loadTile(MapTile(0, static_cast<int>(i), 4, 0)));
+        });
+    }
+    CARTO_CHECK(WaitFor([&dataSource1]() { return dataSource1->getLoadCount(0) == 4; }, 5000));
+
+    // The queued load of the next tile is not started in time, so the caller loads the tile itself
+    CARTO_CHECK_EQUAL(std::string("first"), ToString(dataSource.loadTile(MapTile(1, 0, 4, 0))));
+    CARTO_CHECK_EQUAL(1, dataSource1->getLoadCount(1));
+
+    dataSource1->openGate();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    for (const std::string& result : blockedResults) {
+        CARTO_CHECK_EQUAL(std::string("first"), result);
+    }
+
+    // The canceled pool task never loads the tile a second time
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    CARTO_CHECK_EQUAL(1, dataSource1->getLoadCount(1));
+    CARTO_CHECK_EQUAL(0, dataSource2->getLoadCount(1));
+}
+
+CARTO_TEST(CombinedSourceRecordsLatencyPerSource) {
+    auto dataSource1 = std::make_shared<FakeTileDataSource>("first", 0, FAKE_TILE);
+    auto dataSource2 = std::make_shared<FakeTileDataSource>("second", 150, FAKE_TILE);
+    CombinedTileDataSource dataSource(dataSource1, dataSource2, 5);
+
+    CARTO_CHECK_EQUAL(std::string("first"), ToString(dataSource.loadTile(MapTile(0, 0, 4, 0))));
+    CARTO_CHECK_EQUAL(std::string("second"), ToString(dataSource.loadTile(MapTile(1, 1, 5, 0))));
+    CARTO_CHECK_EQUAL(std::string("second"), ToString(dataSource.loadTile(MapTile(2, 1, 6, 0))));
+
+    std::vector<int> counts1 = dataSource.getLatencyHistogram(0);
+    std::vector<int> counts2 = dataSource.getLatencyHistogram(1);
+    CARTO_CHECK_EQUAL(1, counts1[0]);
+    CARTO_CHECK_EQUAL(1, SampleCount(counts1));
+    CARTO_CHECK_EQUAL(2, counts2[4]);
+    CARTO_CHECK_EQUAL(2, SampleCount(counts2));
+}
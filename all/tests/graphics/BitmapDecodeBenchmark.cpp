@@ -0,0 +1,164 @@
+#include "graphics/Bitmap.h"
+#include "core/BinaryData.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <jpeglib.h>
+
+using namespace carto;
+
+// Raster tile decode throughput, comparing the bitmap path (decode, convert to RGBA, copy into the tile bitmap)
+// against Bitmap::DecodePixels with a new buffer per tile and with buffers recycled through the decode buffer pool.
+// PNG and JPEG tiles are generated, other tiles (for example WebP tiles from a tile server) can be given as files.
+// Usage: BitmapDecodeBenchmark [iterations] [tile files...]
+
+namespace {
+
+    const int TILE_SIZE = 256;
+
+    struct TileInput {
+        std::string name;
+        std::shared_ptr<BinaryData> data;
+    };
+
+    // Smooth terrain-like colors with per-pixel noise, similar to aerial imagery
+    std::vector<unsigned char> CreateTilePixels(int bytesPerPixel) {
+        std::mt19937 rng(42);
+        std::uniform_int_distribution<int> noise(-12, 12);
+        std::vector<unsigned char> pixels(TILE_SIZE * TILE_SIZE * bytesPerPixel);
+        for (int y = 0; y < TILE_SIZE; y++) {
+            for (int x = 0; x < TILE_SIZE; x++) {
+                double v = std::sin(x * 0.05) * std::cos(y * 0.07) + std::sin((x + y) * 0.013);
+                unsigned char* pixel = &pixels[(y * TILE_SIZE + x) * bytesPerPixel];
+                for (int c = 0; c < 3; c++) {
+                    pixel[c] = static_cast<unsigned char>(std::max(0, std::min(255, static_cast<int>(110 + 40 * v + c * 20) + noise(rng))));
+                }
+                if (bytesPerPixel == 4) {
+                    pixel[3] = (x < TILE_SIZE / 2 ? 255 : static_cast<unsigned char>(255 - y)); // partially transparent
+                }
+            }
+        }
+        return pixels;
+    }
+
+    std::shared_ptr<BinaryData> CreateJPEGTile() {
+        std::vector<unsigned char> pixels = CreateTilePixels(3);
+
+        FILE* fp = std::tmpfile();
+        if (!fp) {
+            return std::shared_ptr<BinaryData>();
+        }
+        jpeg_compress_struct cinfo;
+        jpeg_error_mgr jerr;
+        cinfo.err = jpeg_std_error(&jerr);
+        jpeg_create_compress(&cinfo);
+        jpeg_stdio_dest(&cinfo, fp);
+        cinfo.image_width = TILE_SIZE;
+        cinfo.image_height = TILE_SIZE;
+        cinfo.input_components = 3;
+        cinfo.in_color_space = JCS_RGB;
+        jpeg_set_defaults(&cinfo);
+        jpeg_set_quality(&cinfo, 85, TRUE);
+        jpeg_start_compress(&cinfo, TRUE);
+        while (cinfo.next_scanline < cinfo.image_height) {
+            JSAMPROW row = &pixels[cinfo.next_scanline * TILE_SIZE * 3];
+            jpeg_write_scanlines(&cinfo, &row, 1);
+        }
+        jpeg_finish_compress(&cinfo);
+        jpeg_destroy_compress(&cinfo);
+
+        std::vector<unsigned char> data(static_cast<std::size_t>(std::ftell(fp)));
+        std::rewind(fp);
+        std::size_t size = std::fread(data.data(), 1, data.size(), fp);
+        std::fclose(fp);
+        data.resize(size);
+        return std::make_shared<BinaryData>(std::move(data));
+    }
+
+    std::shared_ptr<BinaryData> ReadFile(const std::string& fileName) {
+        std::ifstream stream(fileName, std::ios::binary);
+        std::vector<unsigned char> data((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+        return data.empty() ? std::shared_ptr<BinaryData>() : std::make_shared<BinaryData>(std::move(data));
+    }
+
+    void Run(const char* mode, const TileInput& input, int iterations, const std::function<std::size_t(const BinaryData&)>& decode) {
+        std::size_t pixelBytes = decode(*input.data); // warm up
+        if (pixelBytes == 0) {
+            std::printf("%-24s %-14s decode failed\n", input.name.c_str(), mode);
+            return;
+        }
+
+        auto startTime = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++) {
+            decode(*input.data);
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        std::printf("%-24s %-14s %10.0f tiles/s %8.1f MB/s decoded\n", input.name.c_str(), mode, iterations / seconds, iterations * pixelBytes / seconds / (1024.0 * 1024.0));
+    }
+
+}
+
+int main(int argc, char* argv[]) {
+    int iterations = argc > 1 ? std::atoi(argv[1]) : 1000;
+
+    std::vector<TileInput> inputs;
+    std::vector<unsigned char> rgbPixels = CreateTilePixels(3);
+    std::vector<unsigned char> rgbaPixels = CreateTilePixels(4);
+    inputs.push_back(TileInput { "generated RGB PNG", Bitmap(rgbPixels.data(), TILE_SIZE, TILE_SIZE, ColorFormat::COLOR_FORMAT_RGB, TILE_SIZE * 3).compressToPNG() });
+    inputs.push_back(TileInput { "generated RGBA PNG", Bitmap(rgbaPixels.data(), TILE_SIZE, TILE_SIZE, ColorFormat::COLOR_FORMAT_RGBA, TILE_SIZE * 4).compressToPNG() });
+    inputs.push_back(TileInput { "generated JPEG", CreateJPEGTile() });
+    for (int i = 2; i < argc; i++) {
+        inputs.push_back(TileInput { argv[i], ReadFile(argv[i]) });
+    }
+
+    for (const TileInput& input : inputs) {
+        if (!input.data) {
+            std::printf("%-24s could not be read\n", input.name.c_str());
+            continue;
+        }
+        std::printf("%s: %d bytes\n", input.name.c_str(), static_cast<int>(input.data->size()));
+
+        Run("bitmap", input, iterations, [](const BinaryData& data) -> std::size_t {
+            std::shared_ptr<Bitmap> bitmap = Bitmap::CreateFromCompressed(data.data(), data.size());
+            if (!bitmap) {
+                return 0;
+            }
+            std::shared_ptr<Bitmap> rgbaBitmap = bitmap->getRGBABitmap();
+            std::vector<unsigned char> tilePixels(rgbaBitmap->getPixelData());
+            return tilePixels.size();
+        });
+
+        Run("decode", input, iterations, [](const BinaryData& data) -> std::size_t {
+            std::vector<unsigned char> pixelData;
+            pixelData.reserve(1); // a buffer with capacity bypasses the decode buffer pool
+            unsigned int width = 0, height = 0;
+            ColorFormat::ColorFormat colorFormat = ColorFormat::COLOR_FORMAT_RGBA;
+            if (!Bitmap::DecodePixels(data.data(), data.size(), pixelData, width, height, colorFormat)) {
+                return 0;
+            }
+            return pixelData.size();
+        });
+
+        Run("decode+pool", input, iterations, [](const BinaryData& data) -> std::size_t {
+            std::vector<unsigned char> pixelData;
+            unsigned int width = 0, height = 0;
+            ColorFormat::ColorFormat colorFormat = ColorFormat::COLOR_FORMAT_RGBA;
+            bool decoded = Bitmap::DecodePixels(data.data(), data.size(), pixelData, width, height, colorFormat);
+            std::size_t size = decoded ? pixelData.size() : 0;
+            Bitmap::RecycleDecodeBuffer(pixelData);
+            return size;
+        });
+    }
+    return 0;
+}
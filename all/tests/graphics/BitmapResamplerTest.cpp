@@ -0,0 +1,268 @@
+#include "graphics/utils/BitmapResampler.h"
+
+#include "support/TestUtils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace carto;
+using namespace carto::test;
+
+namespace {
+
+    // The pixel loop of Bitmap::getResizedBitmap before it was delegated to BitmapResampler, kept as the reference for the BOX filter
+    std::vector<unsigned char> LegacyResize(const std::vector<unsigned char>& srcData, unsigned int srcWidth, unsigned int srcHeight, unsigned int bytesPerPixel, unsigned int width, unsigned int height) {
+        const unsigned char* dsrc = srcData.data();
+        std::vector<unsigned char> pixelData(width * height * bytesPerPixel);
+        unsigned char* ddest = pixelData.data();
+
+        bool bUpsampleX = (srcWidth < width);
+        bool bUpsampleY = (srcHeight < height);
+
+        int weight_shift = 0;
+        float source_texels_per_out_pixel = ((srcWidth / static_cast<float>(width + 1)) * (srcHeight / static_cast<float>(height + 1)));
+        float weight_per_pixel = source_texels_per_out_pixel * 256 * 256;
+        float accum_per_pixel = weight_per_pixel * 256;
+        float weight_div = accum_per_pixel / 4294967000.0f;
+        if (weight_div > 1) {
+            weight_shift = static_cast<int>(ceilf(logf(weight_div) / logf(2)));
+        }
+        weight_shift = std::min(15, weight_shift);
+
+        float fh = 256 * srcHeight / static_cast<float>(height);
+        float fw = 256 * srcWidth / static_cast<float>(width);
+
+        std::vector<int> g_px1ab(width * 2 * 2);
+        for (std::size_t x2 = 0; x2 < width; x2++) {
+            int x1a = static_cast<int>((x2) * fw);
+            int x1b = static_cast<int>((x2 + 1) * fw);
+            if (bUpsampleX) {
+                x1b = x1a + 256;
+            }
+            x1b = std::min(x1b, static_cast<int>(256 * srcWidth - 1));
+            g_px1ab[x2 * 2 + 0] = x1a;
+            g_px1ab[x2 * 2 + 1] = x1b;
+        }
+
+        for (std::size_t y2 = 0; y2 < height; y2++) {
+            int y1a = static_cast<int>((y2) * fh);
+            int y1b = static_cast<int>((y2 + 1) * fh);
+            if (bUpsampleY) {
+                y1b = y1a + 256;
+            }
+            y1b = std::min(y1b, static_cast<int>(256 * srcHeight - 1));
+            int y1c = y1a >> 8;
+            int y1d = y1b >> 8;
+
+            for (std::size_t x2 = 0; x2 < width; x2++) {
+                int x1a = g_px1ab[x2 * 2 + 0];
+                int x1b = g_px1ab[x2 * 2 + 1];
+                int x1c = x1a >> 8;
+                int x1d = x1b >> 8;
+
+                unsigned int r = 0, g = 0, b = 0, a = 0, wa = 0;
+                for (int y = y1c; y <= y1d; y++) {
+                    unsigned int weight_y = 256;
+                    if (y1c != y1d) {
+                        if (y == y1c) {
+                            weight_y = 256 - (y1a & 0xFF);
+                        } else if (y == y1d) {
+                            weight_y = (y1b & 0xFF);
+                        }
+                    }
+
+                    const unsigned char* dsrc2 = &dsrc[y * srcWidth * bytesPerPixel + x1c * bytesPerPixel];
+                    for (int x = x1c; x <= x1d; x++) {
+                        unsigned int weight_x = 256;
+                        if (x1c != x1d) {
+                            if (x == x1c) {
+                                weight_x = 256 - (x1a & 0xFF);
+                            } else if (x == x1d) {
+                                weight_x = (x1b & 0xFF);
+                            }
+                        }
+
+                        unsigned int w = (weight_x * weight_y) >> weight_shift;
+
+                        r += *dsrc2++ * w;
+                        if (bytesPerPixel > 1) {
+                            g += *dsrc2++ * w;
+                        }
+                        if (bytesPerPixel > 2) {
+                            b += *dsrc2++ * w;
+                        }
+                        if (bytesPerPixel > 3) {
+                            a += *dsrc2++ * w;
+                        }
+                        wa += w;
+                    }
+                }
+                if (wa <= 0) {
+                    wa = std::numeric_limits<int>::max();
+                }
+
+                *ddest++ = r / wa;
+                if (bytesPerPixel > 1) {
+                    *ddest++ = g / wa;
+                }
+                if (bytesPerPixel > 2) {
+                    *ddest++ = b / wa;
+                }
+                if (bytesPerPixel > 3) {
+                    *ddest++ = a / wa;
+                }
+            }
+        }
+        return pixelData;
+    }
+
+    std::vector<unsigned char> CreateRandomPixels(unsigned int width, unsigned int height, unsigned int bytesPerPixel, unsigned int seed) {
+        std::mt19937 rng(seed);
+        std::vector<unsigned char> pixels(width * height * bytesPerPixel);
+        for (unsigned char& value : pixels) {
+            value = static_cast<unsigned char>(rng());
+        }
+        return pixels;
+    }
+
+    std::vector<unsigned char> Resample(const std::vector<unsigned char>& srcData, int srcWidth, int srcHeight, int bytesPerPixel, int width, int height, BitmapResampler::Filter filter) {
+        std::vector<unsigned char> pixelData(width * height * bytesPerPixel);
+        BitmapResampler::Resample(srcData.data(), srcWidth, srcHeight, srcWidth * bytesPerPixel, bytesPerPixel, pixelData.data(), width, height, filter);
+        return pixelData;
+    }
+
+    // Resampled RGBA data is premultiplied, color channels never exceed alpha
+    std::vector<unsigned char> CreateRandomPremultipliedPixels(unsigned int width, unsigned int height, unsigned int seed) {
+        std::vector<unsigned char> pixels = CreateRandomPixels(width, height, 4, seed);
+        for (std::size_t i = 0; i < pixels.size(); i += 4) {
+            for (int c = 0; c < 3; c++) {
+                pixels[i + c] = static_cast<unsigned char>(pixels[i + c] * pixels[i + 3] / 255);
+            }
+        }
+        return pixels;
+    }
+
+    int FirstDifference(const std::vector<unsigned char>& expected, const std::vector<unsigned char>& actual) {
+        for (std::size_t i = 0; i < std::min(expected.size(), actual.size()); i++) {
+            if (expected[i] != actual[i]) {
+                return static_cast<int>(i);
+            }
+        }
+        return expected.size() == actual.size() ? -1 : static_cast<int>(std::min(expected.size(), actual.size()));
+    }
+
+    struct ResizeCase {
+        unsigned int srcWidth;
+        unsigned int srcHeight;
+        unsigned int width;
+        unsigned int height;
+    };
+
+    const std::vector<ResizeCase> RESIZE_CASES = {
+        { 256, 256, 512, 512 },   // one level overzoom, exact 2x path
+        { 128, 64, 256, 128 },
+        { 256, 256, 257, 300 },   // generic upsampling
+        { 37, 53, 100, 71 },
+        { 1, 1, 5, 3 },
+        { 3, 2, 1000, 4 },
+        { 256, 256, 128, 128 },   // downsampling
+        { 100, 37, 37, 100 },     // mixed directions
+        { 5, 7, 1, 1 },
+        { 1000, 1000, 3, 3 },     // large downscale with shifted weights
+        { 4000, 300, 2, 1 },
+        { 256, 256, 256, 256 }    // identical size
+    };
+
+}
+
+CARTO_TEST(BoxFilterMatchesLegacyResize) {
+    unsigned int seed = 1;
+    for (const ResizeCase& resizeCase : RESIZE_CASES) {
+        for (unsigned int bytesPerPixel = 1; bytesPerPixel <= 4; bytesPerPixel++) {
+            std::vector<unsigned char> srcData = CreateRandomPixels(resizeCase.srcWidth, resizeCase.srcHeight, bytesPerPixel, seed++);
+            std::vector<unsigned char> expected = LegacyResize(srcData, resizeCase.srcWidth, resizeCase.srcHeight, bytesPerPixel, resizeCase.width, resizeCase.height);
+            std::vector<unsigned char> actual = Resample(srcData, resizeCase.srcWidth, resizeCase.srcHeight, bytesPerPixel, resizeCase.width, resizeCase.height, BitmapResampler::Filter::BOX);
+            int index = FirstDifference(expected, actual);
+            if (index >= 0) {
+                Fail(__FILE__, __LINE__, "BOX output differs for " + ToString(resizeCase.srcWidth) + "x" + ToString(resizeCase.srcHeight) + " -> " + ToString(resizeCase.width) + "x" + ToString(resizeCase.height) + ", " + ToString(bytesPerPixel) + " bytes per pixel, at byte " + ToString(index));
+            }
+        }
+    }
+}
+
+CARTO_TEST(BoxFilterMatchesLegacyResizeOfSubRectangle) {
+    // Overzoomed tiles are resampled directly from a sub-rectangle of the parent tile
+    const unsigned int parentSize = 256;
+    for (unsigned int bytesPerPixel = 1; bytesPerPixel <= 4; bytesPerPixel++) {
+        std::vector<unsigned char> parentData = CreateRandomPixels(parentSize, parentSize, bytesPerPixel, 100 + bytesPerPixel);
+        for (int deltaZoom = 1; deltaZoom <= 4; deltaZoom++) {
+            unsigned int size = parentSize >> deltaZoom;
+            unsigned int x = size * 1, y = parentSize - size * 2;
+
+            std::vector<unsigned char> subData;
+            for (unsigned int row = 0; row < size; row++) {
+                const unsigned char* rowData = &parentData[((y + row) * parentSize + x) * bytesPerPixel];
+                subData.insert(subData.end(), rowData, rowData + size * bytesPerPixel);
+            }
+            std::vector<unsigned char> expected = LegacyResize(subData, size, size, bytesPerPixel, parentSize, parentSize);
+
+            std::vector<unsigned char> actual(parentSize * parentSize * bytesPerPixel);
+            BitmapResampler::Resample(&parentData[(y * parentSize + x) * bytesPerPixel], size, size, parentSize * bytesPerPixel, bytesPerPixel, actual.data(), parentSize, parentSize, BitmapResampler::Filter::BOX);
+            CARTO_CHECK_EQUAL(-1, FirstDifference(expected, actual));
+        }
+    }
+}
+
+CARTO_TEST(LanczosFilterIsReproducible) {
+    std::vector<unsigned char> srcData = CreateRandomPremultipliedPixels(64, 48, 7);
+    std::vector<unsigned char> result1 = Resample(srcData, 64, 48, 4, 256, 192, BitmapResampler::Filter::LANCZOS3);
+    std::vector<unsigned char> result2 = Resample(srcData, 64, 48, 4, 256, 192, BitmapResampler::Filter::LANCZOS3);
+    CARTO_CHECK_EQUAL(-1, FirstDifference(result1, result2));
+
+    // Same size resampling samples the kernel at integer offsets only, so the image is kept as is
+    std::vector<unsigned char> identity = Resample(srcData, 64, 48, 4, 64, 48, BitmapResampler::Filter::LANCZOS3);
+    CARTO_CHECK_EQUAL(-1, FirstDifference(srcData, identity));
+}
+
+CARTO_TEST(LanczosFilterKeepsConstantColor) {
+    for (const ResizeCase& resizeCase : RESIZE_CASES) {
+        if (resizeCase.srcWidth * resizeCase.srcHeight > 100000) {
+            continue;
+        }
+        std::vector<unsigned char> srcData(resizeCase.srcWidth * resizeCase.srcHeight * 3);
+        for (std::size_t i = 0; i < srcData.size(); i += 3) {
+            srcData[i + 0] = 200;
+            srcData[i + 1] = 17;
+            srcData[i + 2] = 255;
+        }
+        std::vector<unsigned char> result = Resample(srcData, resizeCase.srcWidth, resizeCase.srcHeight, 3, resizeCase.width, resizeCase.height, BitmapResampler::Filter::LANCZOS3);
+        for (std::size_t i = 0; i < result.size(); i += 3) {
+            CARTO_CHECK_EQUAL(200, static_cast<int>(result[i + 0]));
+            CARTO_CHECK_EQUAL(17, static_cast<int>(result[i + 1]));
+            CARTO_CHECK_EQUAL(255, static_cast<int>(result[i + 2]));
+        }
+    }
+}
+
+CARTO_TEST(LanczosFilterKeepsColorBelowAlpha) {
+    // Opaque white next to fully transparent pixels, the negative lobes overshoot at the alpha edge
+    const int srcSize = 16;
+    std::vector<unsigned char> srcData(srcSize * srcSize * 4, 0);
+    for (int y = 0; y < srcSize; y++) {
+        for (int x = 0; x < srcSize; x++) {
+            if ((x / 4 + y / 4) % 2 == 0) {
+                std::fill(&srcData[(y * srcSize + x) * 4], &srcData[(y * srcSize + x) * 4 + 4], 255);
+            }
+        }
+    }
+    for (int size : { 64, 37, 8 }) {
+        std::vector<unsigned char> result = Resample(srcData, srcSize, srcSize, 4, size, size, BitmapResampler::Filter::LANCZOS3);
+        for (std::size_t i = 0; i < result.size(); i += 4) {
+            CARTO_CHECK(result[i + 0] <= result[i + 3] && result[i + 1] <= result[i + 3] && result[i + 2] <= result[i + 3]);
+        }
+    }
+}
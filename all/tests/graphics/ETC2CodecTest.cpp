@@ -0,0 +1,227 @@
+#include "graphics/utils/ETC2Codec.h"
+
+#include "support/TestUtils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace carto;
+using namespace carto::test;
+
+namespace {
+
+    struct RoundTripError {
+        int maxColorError;
+        double colorMSE;
+        int maxAlphaError;
+        double alphaMSE;
+    };
+
+    std::vector<unsigned char> RoundTrip(const std::vector<unsigned char>& rgbaData, int width, int height, ETC2Codec::Format format) {
+        std::vector<unsigned char> compressedData;
+        ETC2Codec::Compress(rgbaData.data(), width, height, format, compressedData);
+        CARTO_CHECK_EQUAL(ETC2Codec::GetCompressedSize(width, height, format), compressedData.size());
+
+        std::vector<unsigned char> decodedData;
+        CARTO_CHECK(ETC2Codec::Decompress(compressedData.data(), compressedData.size(), width, height, format, decodedData));
+        CARTO_CHECK_EQUAL(rgbaData.size(), decodedData.size());
+        return decodedData;
+    }
+
+    RoundTripError CalculateError(const std::vector<unsigned char>& rgbaData, const std::vector<unsigned char>& decodedData) {
+        RoundTripError error = { 0, 0, 0, 0 };
+        for (std::size_t i = 0; i < rgbaData.size(); i += 4) {
+            for (int c = 0; c < 4; c++) {
+                int delta = std::abs(rgbaData[i + c] - decodedData[i + c]);
+                if (c < 3) {
+                    error.maxColorError = std::max(error.maxColorError, delta);
+                    error.colorMSE += delta * delta;
+                } else {
+                    error.maxAlphaError = std::max(error.maxAlphaError, delta);
+                    error.alphaMSE += delta * delta;
+                }
+            }
+        }
+        std::size_t pixelCount = rgbaData.size() / 4;
+        error.colorMSE /= pixelCount * 3;
+        error.alphaMSE /= pixelCount;
+        return error;
+    }
+
+    // Error of replacing each 4x4 block with its average color, the baseline any block codec has to beat
+    RoundTripError CalculateBlockAverageError(const std::vector<unsigned char>& rgbaData, int width, int height) {
+        std::vector<unsigned char> averageData(rgbaData.size());
+        for (int by = 0; by < height; by += 4) {
+            for (int bx = 0; bx < width; bx += 4) {
+                for (int c = 0; c < 4; c++) {
+                    int sum = 0, count = 0;
+                    for (int y = by; y < std::min(by + 4, height); y++) {
+                        for (int x = bx; x < std::min(bx + 4, width); x++) {
+                            sum += rgbaData[(y * width + x) * 4 + c];
+                            count++;
+                        }
+                    }
+                    for (int y = by; y < std::min(by + 4, height); y++) {
+                        for (int x = bx; x < std::min(bx + 4, width); x++) {
+                            averageData[(y * width + x) * 4 + c] = static_cast<unsigned char>((sum + count / 2) / count);
+                        }
+                    }
+                }
+            }
+        }
+        return CalculateError(rgbaData, averageData);
+    }
+
+    // A column of solid 4x4 blocks, one block per color
+    std::vector<unsigned char> CreateSolidBlocks(const std::vector<std::vector<unsigned char> >& colors) {
+        std::vector<unsigned char> rgbaData;
+        for (const std::vector<unsigned char>& color : colors) {
+            for (int i = 0; i < 16; i++) {
+                rgbaData.insert(rgbaData.end(), color.begin(), color.end());
+            }
+        }
+        return rgbaData;
+    }
+
+}
+
+CARTO_TEST(SolidBlocksRoundTrip) {
+    std::vector<std::vector<unsigned char> > grays;
+    for (int value = 0; value < 256; value++) {
+        grays.push_back({ static_cast<unsigned char>(value), static_cast<unsigned char>(value), static_cast<unsigned char>(value), 255 });
+    }
+    std::vector<unsigned char> grayData = CreateSolidBlocks(grays);
+    RoundTripError grayError = CalculateError(grayData, RoundTrip(grayData, 4, 256 * 4, ETC2Codec::Format::RGB8));
+    CARTO_CHECK(grayError.maxColorError <= 1);
+    CARTO_CHECK_EQUAL(0, grayError.maxAlphaError);
+
+    // The channels share one modifier, so a solid color is within half of a 5-bit step plus the smallest modifier (2)
+    std::mt19937 rng(1);
+    std::vector<std::vector<unsigned char> > colors;
+    for (int i = 0; i < 1024; i++) {
+        colors.push_back({ static_cast<unsigned char>(rng()), static_cast<unsigned char>(rng()), static_cast<unsigned char>(rng()), static_cast<unsigned char>(rng()) });
+    }
+    std::vector<unsigned char> colorData = CreateSolidBlocks(colors);
+    std::vector<unsigned char> decodedData = RoundTrip(colorData, 4, 1024 * 4, ETC2Codec::Format::RGBA8);
+    RoundTripError colorError = CalculateError(colorData, decodedData);
+    CARTO_CHECK(colorError.maxColorError <= 6);
+    CARTO_CHECK_EQUAL(0, colorError.maxAlphaError);
+
+    // Solid blocks stay solid
+    for (std::size_t i = 0; i < decodedData.size(); i += 64) {
+        for (int j = 4; j < 64; j++) {
+            CARTO_CHECK_EQUAL(static_cast<int>(decodedData[i + j % 4]), static_cast<int>(decodedData[i + j]));
+        }
+    }
+}
+
+CARTO_TEST(ConstantAlphaIsExact) {
+    std::vector<std::vector<unsigned char> > colors;
+    for (int alpha = 0; alpha < 256; alpha++) {
+        colors.push_back({ 10, 200, 90, static_cast<unsigned char>(alpha) });
+    }
+    std::vector<unsigned char> rgbaData = CreateSolidBlocks(colors);
+    CARTO_CHECK_EQUAL(0, CalculateError(rgbaData, RoundTrip(rgbaData, 4, 256 * 4, ETC2Codec::Format::RGBA8)).maxAlphaError);
+
+    // The RGB format decodes as opaque
+    std::vector<unsigned char> decodedData = RoundTrip(rgbaData, 4, 256 * 4, ETC2Codec::Format::RGB8);
+    for (std::size_t i = 0; i < decodedData.size(); i += 4) {
+        CARTO_CHECK_EQUAL(255, static_cast<int>(decodedData[i + 3]));
+    }
+}
+
+CARTO_TEST(GradientsRoundTrip) {
+    const int size = 64;
+    std::vector<unsigned char> rgbaData(size * size * 4);
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            unsigned char* pixel = &rgbaData[(y * size + x) * 4];
+            pixel[0] = static_cast<unsigned char>(x * 4);
+            pixel[1] = static_cast<unsigned char>(y * 4);
+            pixel[2] = static_cast<unsigned char>((x + y) * 2);
+            pixel[3] = static_cast<unsigned char>(255 - x * 2);
+        }
+    }
+    RoundTripError error = CalculateError(rgbaData, RoundTrip(rgbaData, size, size, ETC2Codec::Format::RGBA8));
+    CARTO_CHECK(error.maxColorError <= 8);
+    CARTO_CHECK(std::sqrt(error.colorMSE) <= 3.5);
+    CARTO_CHECK(error.maxAlphaError <= 1);
+}
+
+CARTO_TEST(AlphaEdgesAreExact) {
+    // Premultiplied tiles with fully transparent areas, typical for overlays
+    const int size = 64;
+    std::vector<unsigned char> rgbaData(size * size * 4);
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            unsigned char value = (x * 7 + y * 3) % 11 < 5 ? 255 : 0;
+            std::fill(&rgbaData[(y * size + x) * 4], &rgbaData[(y * size + x) * 4 + 4], value);
+        }
+    }
+    RoundTripError error = CalculateError(rgbaData, RoundTrip(rgbaData, size, size, ETC2Codec::Format::RGBA8));
+    CARTO_CHECK_EQUAL(0, error.maxColorError);
+    CARTO_CHECK_EQUAL(0, error.maxAlphaError);
+}
+
+CARTO_TEST(RandomImagesBeatBlockAverage) {
+    const int size = 64;
+    for (unsigned int seed = 1; seed <= 8; seed++) {
+        std::mt19937 rng(seed);
+
+        // Uniform noise and smooth images with noise
+        std::vector<unsigned char> noiseData(size * size * 4);
+        std::vector<unsigned char> smoothData(size * size * 4);
+        double phase = rng() % 100 * 0.01;
+        for (int y = 0; y < size; y++) {
+            for (int x = 0; x < size; x++) {
+                for (int c = 0; c < 4; c++) {
+                    noiseData[(y * size + x) * 4 + c] = static_cast<unsigned char>(rng());
+                    int value = 128 + static_cast<int>(100 * std::sin(0.1 * x * (c + 1) + 0.07 * y + phase));
+                    smoothData[(y * size + x) * 4 + c] = static_cast<unsigned char>(std::max(0, std::min(255, value + static_cast<int>(rng() % 17) - 8)));
+                }
+            }
+        }
+
+        for (const std::vector<unsigned char>& rgbaData : { noiseData, smoothData }) {
+            RoundTripError error = CalculateError(rgbaData, RoundTrip(rgbaData, size, size, ETC2Codec::Format::RGBA8));
+            RoundTripError averageError = CalculateBlockAverageError(rgbaData, size, size);
+            CARTO_CHECK(error.colorMSE < averageError.colorMSE);
+            CARTO_CHECK(error.alphaMSE < averageError.alphaMSE);
+        }
+
+        RoundTripError noiseError = CalculateError(noiseData, RoundTrip(noiseData, size, size, ETC2Codec::Format::RGBA8));
+        CARTO_CHECK(std::sqrt(noiseError.colorMSE) <= 60);
+        CARTO_CHECK(std::sqrt(noiseError.alphaMSE) <= 10);
+        RoundTripError smoothError = CalculateError(smoothData, RoundTrip(smoothData, size, size, ETC2Codec::Format::RGBA8));
+        CARTO_CHECK(std::sqrt(smoothError.colorMSE) <= 12);
+        CARTO_CHECK(std::sqrt(smoothError.alphaMSE) <= 5);
+    }
+}
+
+CARTO_TEST(PartialBlocksAndTruncatedData) {
+    // Sizes that are not multiples of 4 replicate the edge pixels when encoding and crop when decoding
+    for (int size : { 1, 3, 5, 7 }) {
+        std::vector<unsigned char> rgbaData(size * (size + 2) * 4);
+        for (std::size_t i = 0; i < rgbaData.size(); i += 4) {
+            rgbaData[i + 0] = 40;
+            rgbaData[i + 1] = 120;
+            rgbaData[i + 2] = 200;
+            rgbaData[i + 3] = 128;
+        }
+        RoundTripError error = CalculateError(rgbaData, RoundTrip(rgbaData, size, size + 2, ETC2Codec::Format::RGBA8));
+        CARTO_CHECK(error.maxColorError <= 6);
+        CARTO_CHECK_EQUAL(0, error.maxAlphaError);
+    }
+
+    std::vector<unsigned char> rgbaData(8 * 8 * 4, 255);
+    std::vector<unsigned char> compressedData;
+    ETC2Codec::Compress(rgbaData.data(), 8, 8, ETC2Codec::Format::RGB8, compressedData);
+    std::vector<unsigned char> decodedData;
+    CARTO_CHECK(!ETC2Codec::Decompress(compressedData.data(), compressedData.size() - 1, 8, 8, ETC2Codec::Format::RGB8, decodedData));
+    CARTO_CHECK(!ETC2Codec::Decompress(compressedData.data(), compressedData.size(), 8, 8, ETC2Codec::Format::RGBA8, decodedData));
+    CARTO_CHECK(!ETC2Codec::Decompress(compressedData.data(), compressedData.size(), 0, 8, ETC2Codec::Format::RGB8, decodedData));
+}
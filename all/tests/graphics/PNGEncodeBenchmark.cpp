@@ -0,0 +1,128 @@
+#include "graphics/Bitmap.h"
+#include "core/BinaryData.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <png.h>
+
+using namespace carto;
+
+// PNG encoding throughput of Bitmap::compressToPNG for each compression preset, with plain libpng using its
+// default settings as the baseline. Tiles go through the single stripe path, the large image through the parallel stripes.
+// Usage: PNGEncodeBenchmark [iterations] [large image size]
+
+namespace {
+
+    const int TILE_SIZE = 256;
+
+    struct ImageInput {
+        std::string name;
+        int size;
+        ColorFormat::ColorFormat colorFormat;
+        int bytesPerPixel;
+        std::vector<unsigned char> pixels;
+    };
+
+    // Smooth terrain-like colors with per-pixel noise and a partially transparent half, similar to overlay tiles
+    std::vector<unsigned char> CreatePixels(int size, int bytesPerPixel) {
+        std::mt19937 rng(42);
+        std::uniform_int_distribution<int> noise(-12, 12);
+        std::vector<unsigned char> pixels(static_cast<std::size_t>(size) * size * bytesPerPixel);
+        for (int y = 0; y < size; y++) {
+            for (int x = 0; x < size; x++) {
+                double v = std::sin(x * 0.05) * std::cos(y * 0.07) + std::sin((x + y) * 0.013);
+                unsigned char* pixel = &pixels[(static_cast<std::size_t>(y) * size + x) * bytesPerPixel];
+                unsigned char alpha = bytesPerPixel == 4 && x >= size / 2 ? static_cast<unsigned char>(255 - y % 256) : 255;
+                for (int c = 0; c < 3; c++) {
+                    int value = std::max(0, std::min(255, static_cast<int>(110 + 40 * v + c * 20) + noise(rng)));
+                    pixel[c] = static_cast<unsigned char>(value * alpha / 255); // premultiplied, as stored in bitmaps
+                }
+                if (bytesPerPixel == 4) {
+                    pixel[3] = alpha;
+                }
+            }
+        }
+        return pixels;
+    }
+
+    std::size_t EncodeLibPNG(const ImageInput& input) {
+        png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+        png_infop info = png_create_info_struct(png);
+        std::vector<unsigned char> data;
+        if (setjmp(png_jmpbuf(png))) {
+            png_destroy_write_struct(&png, &info);
+            return 0;
+        }
+        png_set_write_fn(png, &data, [](png_structp png, png_bytep bytes, png_size_t size) {
+            std::vector<unsigned char>* data = static_cast<std::vector<unsigned char>*>(png_get_io_ptr(png));
+            data->insert(data->end(), bytes, bytes + size);
+        }, nullptr);
+        png_set_IHDR(png, info, input.size, input.size, 8, input.bytesPerPixel == 4 ? PNG_COLOR_TYPE_RGBA : PNG_COLOR_TYPE_RGB, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+        png_write_info(png, info);
+        for (int y = 0; y < input.size; y++) {
+            png_write_row(png, const_cast<png_bytep>(&input.pixels[static_cast<std::size_t>(y) * input.size * input.bytesPerPixel]));
+        }
+        png_write_end(png, info);
+        png_destroy_write_struct(&png, &info);
+        return data.size();
+    }
+
+    void Run(const char* mode, const ImageInput& input, int iterations, const std::function<std::size_t()>& encode) {
+        std::size_t compressedSize = encode(); // warm up
+        if (compressedSize == 0) {
+            std::printf("%-20s %-8s encode failed\n", input.name.c_str(), mode);
+            return;
+        }
+
+        auto startTime = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++) {
+            encode();
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        double pixelBytes = static_cast<double>(input.pixels.size());
+        std::printf("%-20s %-8s %8.1f MB/s %9.2f ms/image %10d bytes %6.1f%%\n", input.name.c_str(), mode, iterations * pixelBytes / seconds / (1024.0 * 1024.0), seconds * 1000.0 / iterations, static_cast<int>(compressedSize), 100.0 * compressedSize / pixelBytes);
+    }
+
+}
+
+int main(int argc, char* argv[]) {
+    int iterations = argc > 1 ? std::atoi(argv[1]) : 200;
+    int largeSize = argc > 2 ? std::atoi(argv[2]) : 2048;
+
+    std::vector<ImageInput> inputs;
+    inputs.push_back(ImageInput { "RGB tile", TILE_SIZE, ColorFormat::COLOR_FORMAT_RGB, 3, CreatePixels(TILE_SIZE, 3) });
+    inputs.push_back(ImageInput { "RGBA tile", TILE_SIZE, ColorFormat::COLOR_FORMAT_RGBA, 4, CreatePixels(TILE_SIZE, 4) });
+    inputs.push_back(ImageInput { "RGBA " + std::to_string(largeSize) + "x" + std::to_string(largeSize), largeSize, ColorFormat::COLOR_FORMAT_RGBA, 4, CreatePixels(largeSize, 4) });
+
+    const std::pair<const char*, PNGCompressionPreset::PNGCompressionPreset> presets[] = {
+        { "fast", PNGCompressionPreset::PNG_COMPRESSION_PRESET_FAST },
+        { "default", PNGCompressionPreset::PNG_COMPRESSION_PRESET_DEFAULT },
+        { "small", PNGCompressionPreset::PNG_COMPRESSION_PRESET_SMALL }
+    };
+
+    for (const ImageInput& input : inputs) {
+        // Keep the total amount of encoded data similar for tiles and the large image
+        int imageIterations = std::max(1, static_cast<int>(static_cast<long long>(iterations) * TILE_SIZE * TILE_SIZE / (static_cast<long long>(input.size) * input.size)));
+        Bitmap bitmap(input.pixels.data(), input.size, input.size, input.colorFormat, input.size * input.bytesPerPixel);
+
+        Run("libpng", input, imageIterations, [&input]() {
+            return EncodeLibPNG(input);
+        });
+        for (const std::pair<const char*, PNGCompressionPreset::PNGCompressionPreset>& preset : presets) {
+            Run(preset.first, input, imageIterations, [&bitmap, &preset]() -> std::size_t {
+                std::shared_ptr<BinaryData> data = bitmap.compressToPNG(preset.second);
+                return data ? data->size() : 0;
+            });
+        }
+    }
+    return 0;
+}
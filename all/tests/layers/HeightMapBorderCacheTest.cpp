@@ -0,0 +1,136 @@
+#include "layers/components/HeightMapBorderCache.h"
+#include "core/MapTile.h"
+
+#include "support/TestUtils.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace carto;
+using namespace carto::test;
+
+namespace {
+
+    const unsigned int TILE_SIZE = 8;
+
+    const std::size_t CACHE_SIZE = 1024 * 1024;
+
+    // Height of a global pixel, rows counted from the top of the world. Hashed so that any misplaced pixel is detected.
+    std::uint32_t GlobalHeight(int zoom, int x, int y) {
+        int worldSize = static_cast<int>(TILE_SIZE) << zoom;
+        std::uint32_t hash = static_cast<std::uint32_t>(((x % worldSize) + worldSize) % worldSize) * 2654435761u;
+        hash ^= static_cast<std::uint32_t>(y) * 40503u + 0x9e3779b9u + (hash << 6) + (hash >> 2);
+        return hash;
+    }
+
+    // Height map of a tile cut from the global heights, rows are stored bottom-up
+    std::vector<std::uint32_t> CreateHeightMap(const MapTile& tile) {
+        std::vector<std::uint32_t> heightMap(TILE_SIZE * TILE_SIZE);
+        for (unsigned int row = 0; row < TILE_SIZE; row++) {
+            for (unsigned int col = 0; col < TILE_SIZE; col++) {
+                heightMap[row * TILE_SIZE + col] = GlobalHeight(tile.getZoom(), tile.getX() * TILE_SIZE + col, tile.getY() * TILE_SIZE + (TILE_SIZE - 1 - row));
+            }
+        }
+        return heightMap;
+    }
+
+    std::vector<std::uint32_t> BuildPaddedHeightMap(HeightMapBorderCache& cache, const MapTile& tile) {
+        std::vector<std::uint32_t> heightMap = CreateHeightMap(tile);
+        return cache.buildPaddedHeightMap(tile, TILE_SIZE, TILE_SIZE, heightMap.data());
+    }
+
+    // Checks the padded height map against the global heights. Padding towards the listed neighbours must continue
+    // the global height map, padding towards any other direction must replicate the edge of the tile itself.
+    void CheckPaddedHeightMap(const MapTile& tile, const std::vector<std::uint32_t>& paddedHeightMap, const std::vector<std::pair<int, int> >& neighbours) {
+        const int paddedSize = TILE_SIZE + 2;
+        CARTO_CHECK_EQUAL(static_cast<std::size_t>(paddedSize * paddedSize), paddedHeightMap.size());
+        for (int row = 0; row < paddedSize; row++) {
+            for (int col = 0; col < paddedSize; col++) {
+                int dx = col == 0 ? -1 : (col == paddedSize - 1 ? 1 : 0);
+                int dy = row == 0 ? 1 : (row == paddedSize - 1 ? -1 : 0);
+                int x = tile.getX() * TILE_SIZE + col - 1;
+                int y = tile.getY() * TILE_SIZE + TILE_SIZE - row;
+                if ((dx != 0 || dy != 0) && std::find(neighbours.begin(), neighbours.end(), std::make_pair(dx, dy)) == neighbours.end()) {
+                    x = std::min(std::max(x, tile.getX() * static_cast<int>(TILE_SIZE)), (tile.getX() + 1) * static_cast<int>(TILE_SIZE) - 1);
+                    y = std::min(std::max(y, tile.getY() * static_cast<int>(TILE_SIZE)), (tile.getY() + 1) * static_cast<int>(TILE_SIZE) - 1);
+                }
+                if (paddedHeightMap[row * paddedSize + col] != GlobalHeight(tile.getZoom(), x, y)) {
+                    Fail(__FILE__, __LINE__, "Padded height differs at row " + ToString(row) + ", column " + ToString(col) + " of tile " + tile.toString());
+                }
+            }
+        }
+    }
+
+    const std::vector<std::pair<int, int> > ALL_NEIGHBOURS = { { -1, -1 }, { 0, -1 }, { 1, -1 }, { -1, 0 }, { 1, 0 }, { -1, 1 }, { 0, 1 }, { 1, 1 } };
+
+}
+
+CARTO_TEST(MissingNeighboursReplicateEdges) {
+    HeightMapBorderCache cache(CACHE_SIZE);
+    MapTile tile(5, 7, 4, 0);
+    CheckPaddedHeightMap(tile, BuildPaddedHeightMap(cache, tile), {});
+}
+
+CARTO_TEST(CachedNeighboursRemoveSeams) {
+    // Normals at the tile edges use the padding, so it has to continue the heights of the neighbours exactly
+    HeightMapBorderCache cache(CACHE_SIZE);
+    MapTile tile(5, 7, 4, 0);
+    for (const std::pair<int, int>& neighbour : ALL_NEIGHBOURS) {
+        BuildPaddedHeightMap(cache, MapTile(tile.getX() + neighbour.first, tile.getY() + neighbour.second, tile.getZoom(), 0));
+    }
+    CheckPaddedHeightMap(tile, BuildPaddedHeightMap(cache, tile), ALL_NEIGHBOURS);
+}
+
+CARTO_TEST(PartialNeighboursKeepReplicatedCorners) {
+    HeightMapBorderCache cache(CACHE_SIZE);
+    MapTile tile(5, 7, 4, 0);
+    BuildPaddedHeightMap(cache, MapTile(6, 7, 4, 0));
+    BuildPaddedHeightMap(cache, MapTile(5, 8, 4, 0));
+    CheckPaddedHeightMap(tile, BuildPaddedHeightMap(cache, tile), { { 1, 0 }, { 0, 1 } });
+}
+
+CARTO_TEST(NeighboursWrapAroundAntimeridian) {
+    HeightMapBorderCache cache(CACHE_SIZE);
+    int zoom = 3;
+    int lastX = (1 << zoom) - 1;
+    for (int y = 2; y <= 4; y++) {
+        for (int x : { 0, 1, lastX - 1, lastX }) {
+            BuildPaddedHeightMap(cache, MapTile(x, y, zoom, 0));
+        }
+    }
+
+    // The westmost tile is padded from the eastmost column of tiles and vice versa
+    CheckPaddedHeightMap(MapTile(0, 3, zoom, 0), BuildPaddedHeightMap(cache, MapTile(0, 3, zoom, 0)), ALL_NEIGHBOURS);
+    CheckPaddedHeightMap(MapTile(lastX, 3, zoom, 0), BuildPaddedHeightMap(cache, MapTile(lastX, 3, zoom, 0)), ALL_NEIGHBOURS);
+
+    // A single tile at zoom 0 is its own neighbour across the antimeridian
+    HeightMapBorderCache worldCache(CACHE_SIZE);
+    CheckPaddedHeightMap(MapTile(0, 0, 0, 0), BuildPaddedHeightMap(worldCache, MapTile(0, 0, 0, 0)), { { -1, 0 }, { 1, 0 } });
+}
+
+CARTO_TEST(PolesDoNotWrap) {
+    HeightMapBorderCache cache(CACHE_SIZE);
+    int zoom = 2;
+    int lastY = (1 << zoom) - 1;
+    for (int x = 0; x < (1 << zoom); x++) {
+        BuildPaddedHeightMap(cache, MapTile(x, 0, zoom, 0));
+        BuildPaddedHeightMap(cache, MapTile(x, 1, zoom, 0));
+        BuildPaddedHeightMap(cache, MapTile(x, lastY, zoom, 0));
+    }
+    CheckPaddedHeightMap(MapTile(1, 0, zoom, 0), BuildPaddedHeightMap(cache, MapTile(1, 0, zoom, 0)), { { -1, 0 }, { 1, 0 }, { -1, 1 }, { 0, 1 }, { 1, 1 } });
+    CheckPaddedHeightMap(MapTile(1, lastY, zoom, 0), BuildPaddedHeightMap(cache, MapTile(1, lastY, zoom, 0)), { { -1, 0 }, { 1, 0 } });
+}
+
+CARTO_TEST(NeighboursOfOtherSizeOrAfterClearAreIgnored) {
+    HeightMapBorderCache cache(CACHE_SIZE);
+    MapTile tile(5, 7, 4, 0);
+    std::vector<std::uint32_t> largeHeightMap(TILE_SIZE * 2 * TILE_SIZE * 2, 1);
+    cache.buildPaddedHeightMap(MapTile(6, 7, 4, 0), TILE_SIZE * 2, TILE_SIZE * 2, largeHeightMap.data());
+    CheckPaddedHeightMap(tile, BuildPaddedHeightMap(cache, tile), {});
+
+    BuildPaddedHeightMap(cache, MapTile(4, 7, 4, 0));
+    cache.clear();
+    CheckPaddedHeightMap(tile, BuildPaddedHeightMap(cache, tile), {});
+}
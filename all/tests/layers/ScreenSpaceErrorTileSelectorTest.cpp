@@ -0,0 +1,182 @@
+#include "layers/components/ScreenSpaceErrorTileSelector.h"
+#include "core/MapTile.h"
+
+#include "support/TestUtils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+using namespace carto;
+using namespace carto::test;
+
+namespace {
+
+    typedef ScreenSpaceErrorTileSelector::Candidate Candidate;
+
+    // Synthetic view over the unit square: the error of a tile grows with its size and shrinks with its distance
+    // from the focus point, like the projected error of a tilted view. Tiles right of the visible area are culled.
+    struct SyntheticView {
+        double focusX;
+        double focusY;
+        double errorScale;
+        double visibleMaxX;
+        int minZoom;
+        int maxZoom;
+        std::vector<MapTile> calculatedTiles;
+
+        SyntheticView(double focusX, double focusY, double errorScale, double visibleMaxX, int minZoom, int maxZoom) : focusX(focusX), focusY(focusY), errorScale(errorScale), visibleMaxX(visibleMaxX), minZoom(minZoom), maxZoom(maxZoom), calculatedTiles() { }
+
+        double calculateError(const MapTile& tile) const {
+            double size = 1.0 / (1 << tile.getZoom());
+            double dx = std::max(0.0, std::abs((tile.getX() + 0.5) * size - focusX) - size * 0.5);
+            double dy = std::max(0.0, std::abs((tile.getY() + 0.5) * size - focusY) - size * 0.5);
+            return errorScale * size / (std::sqrt(dx * dx + dy * dy) + 0.01);
+        }
+
+        bool calculateCandidate(const MapTile& tile, Candidate& candidate) {
+            calculatedTiles.push_back(tile);
+            double size = 1.0 / (1 << tile.getZoom());
+            if (tile.getX() * size >= visibleMaxX) {
+                return false;
+            }
+            candidate.tile = tile;
+            candidate.priority = calculateError(tile);
+            candidate.inVisibleFrustum = true;
+            candidate.subDivide = (candidate.priority > 1 && tile.getZoom() < maxZoom) || minZoom > tile.getZoom(); // like TileLayer::calculateTileCandidate
+            return true;
+        }
+
+        std::vector<Candidate> selectTiles(int maxTileCount) {
+            calculatedTiles.clear();
+            return ScreenSpaceErrorTileSelector::SelectTiles({ MapTile(0, 0, 0, 0) }, minZoom, maxTileCount, [this](const MapTile& tile, Candidate& candidate) {
+                return calculateCandidate(tile, candidate);
+            });
+        }
+
+        // Plain recursive subdivision of all tiles that need it, the expected result without a budget
+        void selectTilesRecursive(const MapTile& tile, std::unordered_set<MapTile>& tiles) {
+            Candidate candidate;
+            if (!calculateCandidate(tile, candidate)) {
+                return;
+            }
+            if (candidate.subDivide) {
+                for (int n = 0; n < 4; n++) {
+                    selectTilesRecursive(tile.getChild(n), tiles);
+                }
+            } else {
+                tiles.insert(tile);
+            }
+        }
+    };
+
+    std::unordered_set<MapTile> GetTiles(const std::vector<Candidate>& candidates) {
+        std::unordered_set<MapTile> tiles;
+        for (const Candidate& candidate : candidates) {
+            tiles.insert(candidate.tile);
+        }
+        return tiles;
+    }
+
+    // Selected tiles must not overlap and must cover the visible part of the unit square
+    void CheckCoverage(const SyntheticView& view, const std::vector<Candidate>& candidates) {
+        double area = 0;
+        std::unordered_set<MapTile> tiles = GetTiles(candidates);
+        CARTO_CHECK_EQUAL(candidates.size(), tiles.size());
+        for (const MapTile& tile : tiles) {
+            double size = 1.0 / (1 << tile.getZoom());
+            area += size * std::min(size, view.visibleMaxX - tile.getX() * size);
+            for (MapTile parent = tile; parent.getZoom() > 0; ) {
+                parent = parent.getParent();
+                CARTO_CHECK(tiles.find(parent) == tiles.end());
+            }
+        }
+        CARTO_CHECK_NEAR(view.visibleMaxX, area, 1.0e-9);
+    }
+
+}
+
+CARTO_TEST(RefinesLargestErrorFirst) {
+    SyntheticView view(0.3, 0.6, 2.0, 0.8, 0, 12);
+    std::vector<Candidate> candidates = view.selectTiles(0);
+
+    // Children are calculated in groups of four right after their parent is taken from the heap.
+    // The refined tile must have the largest error of all tiles still waiting for refinement.
+    std::unordered_map<MapTile, double> openTiles;
+    openTiles[MapTile(0, 0, 0, 0)] = view.calculateError(MapTile(0, 0, 0, 0));
+    int refinedCount = 0;
+    for (std::size_t i = 1; i < view.calculatedTiles.size(); i += 4) {
+        MapTile refinedTile = view.calculatedTiles[i].getParent();
+        auto it = openTiles.find(refinedTile);
+        CARTO_CHECK(it != openTiles.end());
+        for (const std::pair<const MapTile, double>& openTile : openTiles) {
+            CARTO_CHECK(it->second >= openTile.second);
+        }
+        openTiles.erase(it);
+        refinedCount++;
+
+        for (int n = 0; n < 4; n++) {
+            Candidate candidate;
+            if (view.calculateCandidate(refinedTile.getChild(n), candidate) && candidate.subDivide) {
+                openTiles[candidate.tile] = candidate.priority;
+            }
+        }
+        view.calculatedTiles.resize(view.calculatedTiles.size() - 4);
+    }
+    CARTO_CHECK(openTiles.empty());
+    CARTO_CHECK(refinedCount > 20);
+}
+
+CARTO_TEST(StopsWhenAllTilesAreBelowErrorThreshold) {
+    SyntheticView view(0.7, 0.2, 2.0, 0.8, 0, 12);
+    std::vector<Candidate> candidates = view.selectTiles(0);
+    for (const Candidate& candidate : candidates) {
+        CARTO_CHECK(!candidate.subDivide);
+        CARTO_CHECK(candidate.priority <= 1 || candidate.tile.getZoom() == view.maxZoom);
+        CARTO_CHECK(view.calculateError(candidate.tile.getParent()) > 1);
+    }
+    CheckCoverage(view, candidates);
+
+    // Without a budget the greedy refinement selects the same tiles as plain recursive subdivision
+    std::unordered_set<MapTile> expectedTiles;
+    view.selectTilesRecursive(MapTile(0, 0, 0, 0), expectedTiles);
+    CARTO_CHECK(GetTiles(candidates) == expectedTiles);
+}
+
+CARTO_TEST(ReturnsAtMostMaxTileCountTiles) {
+    SyntheticView view(0.3, 0.6, 2.0, 0.8, 0, 12);
+    std::size_t unlimitedCount = view.selectTiles(0).size();
+    CARTO_CHECK(unlimitedCount > 100);
+
+    std::size_t lastCount = 0;
+    for (int maxTileCount : { 1, 3, 4, 7, 10, 25, 64, 100 }) {
+        std::vector<Candidate> candidates = view.selectTiles(maxTileCount);
+        CARTO_CHECK(candidates.size() <= static_cast<std::size_t>(maxTileCount));
+        CARTO_CHECK(candidates.size() >= lastCount);
+        CheckCoverage(view, candidates);
+        lastCount = candidates.size();
+    }
+
+    // The budget is spent close to the focus point, where the error is largest
+    std::vector<Candidate> candidates = view.selectTiles(25);
+    const Candidate& finest = *std::max_element(candidates.begin(), candidates.end(), [](const Candidate& candidate1, const Candidate& candidate2) {
+        return candidate1.tile.getZoom() < candidate2.tile.getZoom();
+    });
+    CARTO_CHECK(view.calculateError(finest.tile) >= view.calculateError(MapTile(3, 0, 2, 0)));
+
+    CARTO_CHECK_EQUAL(unlimitedCount, view.selectTiles(static_cast<int>(unlimitedCount)).size());
+}
+
+CARTO_TEST(MinZoomOverridesTileBudget) {
+    // Tiles below the minimum zoom are always subdivided, even if the budget is exceeded
+    SyntheticView view(0.5, 0.5, 0.0001, 1.0, 2, 12);
+    std::vector<Candidate> candidates = view.selectTiles(4);
+    CARTO_CHECK_EQUAL(static_cast<std::size_t>(16), candidates.size());
+    for (const Candidate& candidate : candidates) {
+        CARTO_CHECK_EQUAL(2, candidate.tile.getZoom());
+    }
+    CheckCoverage(view, candidates);
+}
@@ -0,0 +1,180 @@
+#include "layers/components/TileCacheSnapshot.h"
+#include "core/MapTile.h"
+
+#include "support/TestUtils.h"
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <stdext/timed_lru_cache.h>
+
+using namespace carto;
+using namespace carto::test;
+
+namespace {
+
+    typedef cache::timed_lru_cache<long long, int> TileCache;
+
+    // Mirrors the cache lookups of RasterTileLayer and VectorTileLayer: the visible cache, the preloading cache
+    // and the compressed cache that is checked together with the preloading cache. In tile map mode the frame
+    // numbers are ignored, like in VectorTileLayer::getTileId.
+    struct LayerCaches {
+        TileCache visibleCache;
+        TileCache preloadingCache;
+        TileCache compressedCache;
+        bool tileMapMode;
+        TileCacheSnapshot cachedTiles;
+
+        LayerCaches(std::size_t capacity, bool tileMapMode) : visibleCache(capacity), preloadingCache(capacity), compressedCache(capacity), tileMapMode(tileMapMode), cachedTiles() { }
+
+        long long getTileId(const MapTile& tile) const {
+            return tileMapMode ? MapTile(tile.getX(), tile.getY(), tile.getZoom(), 0).getTileId() : tile.getTileId();
+        }
+
+        void collectCachedTiles() {
+            cachedTiles.clear();
+            cachedTiles.addCache(visibleCache);
+            cachedTiles.addCache(preloadingCache);
+            cachedTiles.addCache(compressedCache);
+        }
+
+        bool tileExists(const MapTile& tile, bool preloadingCache) const {
+            long long tileId = getTileId(tile);
+            if (preloadingCache) {
+                return this->preloadingCache.exists(tileId) || compressedCache.exists(tileId);
+            }
+            return visibleCache.exists(tileId);
+        }
+
+        bool tileCached(const MapTile& tile, bool preloadingCache) const {
+            if (!cachedTiles.contains(getTileId(tile))) {
+                return false;
+            }
+            return tileExists(tile, preloadingCache);
+        }
+    };
+
+    MapTile RandomTile(std::mt19937& rng, int maxZoom, int frameCount) {
+        int zoom = static_cast<int>(rng() % (maxZoom + 1));
+        return MapTile(static_cast<int>(rng() % (1u << zoom)), static_cast<int>(rng() % (1u << zoom)), zoom, static_cast<int>(rng() % frameCount));
+    }
+
+    // Applies the cache operations done by the layers when fetching, moving, invalidating and evicting tiles
+    void ApplyRandomOperation(LayerCaches& caches, std::mt19937& rng, const MapTile& tile) {
+        long long tileId = caches.getTileId(tile);
+        std::size_t size = 1 + rng() % 8;
+        int value = 0;
+        switch (rng() % 10) {
+        case 0:
+        case 1:
+            caches.visibleCache.put(tileId, 1, size);
+            break;
+        case 2:
+        case 3:
+            caches.preloadingCache.put(tileId, 1, size);
+            break;
+        case 4:
+            caches.compressedCache.put(tileId, 1, size);
+            break;
+        case 5:
+            caches.preloadingCache.move(tileId, caches.visibleCache);
+            break;
+        case 6:
+            caches.visibleCache.move(tileId, caches.preloadingCache);
+            break;
+        case 7:
+            caches.visibleCache.invalidate(tileId, std::chrono::steady_clock::now());
+            caches.preloadingCache.invalidate_all(std::chrono::steady_clock::now());
+            break;
+        case 8:
+            caches.visibleCache.remove(tileId);
+            caches.compressedCache.read(tileId, value);
+            break;
+        default:
+            caches.preloadingCache.resize(caches.preloadingCache.capacity() % 64 + 16);
+            break;
+        }
+    }
+
+    void CheckTileCachedMatchesTileExists(LayerCaches& caches, std::mt19937& rng, const std::vector<MapTile>& usedTiles) {
+        caches.collectCachedTiles();
+
+        // Probe the tiles and their parents and children like sortTiles and findTiles do, plus other frames and random tiles
+        std::vector<MapTile> probeTiles;
+        for (const MapTile& tile : usedTiles) {
+            probeTiles.push_back(tile);
+            probeTiles.push_back(MapTile(tile.getX(), tile.getY(), tile.getZoom(), tile.getFrameNr() + 1));
+            if (tile.getZoom() > 0) {
+                probeTiles.push_back(tile.getParent());
+            }
+            for (int n = 0; n < 4; n++) {
+                probeTiles.push_back(tile.getChild(n));
+            }
+            probeTiles.push_back(RandomTile(rng, 8, 3));
+        }
+
+        for (const MapTile& tile : probeTiles) {
+            for (bool preloadingCache : { false, true }) {
+                if (caches.tileCached(tile, preloadingCache) != caches.tileExists(tile, preloadingCache)) {
+                    Fail(__FILE__, __LINE__, "tileCached differs from tileExists for " + tile.toString() + (preloadingCache ? " in preloading cache" : " in visible cache"));
+                }
+            }
+        }
+    }
+
+    void CheckRandomOperations(bool tileMapMode, unsigned int seed) {
+        std::mt19937 rng(seed);
+        LayerCaches caches(64, tileMapMode);
+        for (int pass = 0; pass < 200; pass++) {
+            std::vector<MapTile> usedTiles;
+            for (int i = 0; i < 20; i++) {
+                usedTiles.push_back(RandomTile(rng, 6, 3));
+                ApplyRandomOperation(caches, rng, usedTiles.back());
+            }
+            if (pass % 50 == 49) {
+                caches.visibleCache.clear();
+            }
+            CheckTileCachedMatchesTileExists(caches, rng, usedTiles);
+        }
+    }
+
+}
+
+CARTO_TEST(TileCachedMatchesTileExists) {
+    CheckRandomOperations(false, 1);
+    CheckRandomOperations(false, 2);
+}
+
+CARTO_TEST(TileCachedMatchesTileExistsInTileMapMode) {
+    CheckRandomOperations(true, 3);
+    CheckRandomOperations(true, 4);
+}
+
+CARTO_TEST(InvalidatedTilesStayInSnapshot) {
+    // Invalid tiles are still drawn and re-fetched, so they must not be dropped from the snapshot
+    LayerCaches caches(64, false);
+    MapTile tile(3, 5, 4, 0);
+    caches.visibleCache.put(tile.getTileId(), 1, 1);
+    caches.visibleCache.invalidate_all(std::chrono::steady_clock::now() - std::chrono::seconds(1));
+    caches.collectCachedTiles();
+    CARTO_CHECK(!caches.visibleCache.valid(tile.getTileId()));
+    CARTO_CHECK(caches.tileCached(tile, false));
+    CARTO_CHECK(!caches.tileCached(tile, true));
+}
+
+CARTO_TEST(SnapshotMissesTilesAddedLater) {
+    // The snapshot is only exact while the caches are not modified, TileLayer::loadData relies on holding the layer lock
+    LayerCaches caches(64, false);
+    caches.collectCachedTiles();
+    MapTile tile(1, 1, 1, 0);
+    caches.preloadingCache.put(tile.getTileId(), 1, 1);
+    CARTO_CHECK(caches.tileExists(tile, true));
+    CARTO_CHECK(!caches.tileCached(tile, true));
+
+    caches.collectCachedTiles();
+    CARTO_CHECK(caches.tileCached(tile, true));
+    caches.cachedTiles.clear();
+    CARTO_CHECK(!caches.tileCached(tile, true));
+}
@@ -0,0 +1,70 @@
+#include "network/HTTPClient.h"
+#include "core/BinaryData.h"
+
+#include "support/StubHTTPServer.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace carto;
+using namespace carto::test;
+
+// Compares pooled keep-alive connections against one connection per request (idle timeout 0),
+// using a loopback server returning tile sized responses.
+// Usage: HTTPClientBenchmark [requests] [threads] [response bytes]
+
+namespace {
+
+    double Run(int idleTimeout, int requestCount, int threadCount, int responseSize) {
+        std::string body(responseSize, 'x');
+        StubHTTPServer server([&body](const StubHTTPServer::Request& request) {
+            return StubHTTPServer::Response(200, body);
+        });
+
+        HTTPClient client(false);
+        client.setConnectionIdleTimeout(idleTimeout);
+
+        auto startTime = std::chrono::steady_clock::now();
+        std::vector<std::thread> threads;
+        for (int i = 0; i < threadCount; i++) {
+            threads.emplace_back([&, i]() {
+                for (int j = i; j < requestCount; j += threadCount) {
+                    std::map<std::string, std::string> responseHeaders;
+                    std::shared_ptr<BinaryData> responseData;
+                    client.get(server.getBaseURL() + "/" + std::to_string(j) + ".png", std::map<std::string, std::string>(), responseHeaders, responseData);
+                }
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+        HTTPClient::ConnectionStats stats = client.getConnectionStats();
+        std::printf("%-24s %8.1f ms %10.0f req/s  new=%llu reused=%llu server connections=%d\n",
+            idleTimeout == 0 ? "connection per request" : "pooled keep-alive",
+            seconds * 1000.0, requestCount / seconds,
+            static_cast<unsigned long long>(stats.newConnections), static_cast<unsigned long long>(stats.reusedConnections),
+            server.getConnectionCount());
+        return seconds;
+    }
+
+}
+
+int main(int argc, char* argv[]) {
+    int requestCount = argc > 1 ? std::atoi(argv[1]) : 2000;
+    int threadCount = argc > 2 ? std::atoi(argv[2]) : 4;
+    int responseSize = argc > 3 ? std::atoi(argv[3]) : 16384;
+
+    std::printf("%d requests, %d threads, %d byte responses\n", requestCount, threadCount, responseSize);
+    double oldTime = Run(0, requestCount, threadCount, responseSize);
+    double newTime = Run(30000, requestCount, threadCount, responseSize);
+    std::printf("speedup: %.2fx\n", oldTime / newTime);
+    return 0;
+}
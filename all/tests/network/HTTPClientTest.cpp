@@ -0,0 +1,100 @@
+#include "network/HTTPClient.h"
+#include "core/BinaryData.h"
+
+#include "support/StubHTTPServer.h"
+#include "support/TestUtils.h"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace carto;
+using namespace carto::test;
+
+namespace {
+
+    StubHTTPServer::Response Echo(const StubHTTPServer::Request& request) {
+        return StubHTTPServer::Response(200, request.path);
+    }
+
+    void Get(const HTTPClient& client, const std::string& url) {
+        std::map<std::string, std::string> responseHeaders;
+        std::shared_ptr<BinaryData> responseData;
+        int statusCode = -1;
+        CARTO_CHECK_EQUAL(0, client.get(url, std::map<std::string, std::string>(), responseHeaders, responseData, &statusCode));
+        CARTO_CHECK_EQUAL(200, statusCode);
+    }
+
+}
+
+CARTO_TEST(SequentialRequestsReuseConnection) {
+    StubHTTPServer server(Echo);
+    HTTPClient client(false);
+
+    for (int i = 0; i < 10; i++) {
+        Get(client, server.getBaseURL() + "/tile/" + std::to_string(i));
+    }
+
+    HTTPClient::ConnectionStats stats = client.getConnectionStats();
+    CARTO_CHECK_EQUAL(1ULL, static_cast<unsigned long long>(stats.newConnections));
+    CARTO_CHECK_EQUAL(9ULL, static_cast<unsigned long long>(stats.reusedConnections));
+    CARTO_CHECK_EQUAL(1, server.getConnectionCount());
+    CARTO_CHECK_EQUAL(10, server.getRequestCount());
+}
+
+CARTO_TEST(ZeroIdleTimeoutDisablesReuse) {
+    StubHTTPServer server(Echo);
+    HTTPClient client(false);
+    client.setConnectionIdleTimeout(0);
+
+    for (int i = 0; i < 5; i++) {
+        Get(client, server.getBaseURL() + "/tile/" + std::to_string(i));
+    }
+
+    HTTPClient::ConnectionStats stats = client.getConnectionStats();
+    CARTO_CHECK_EQUAL(5ULL, static_cast<unsigned long long>(stats.newConnections));
+    CARTO_CHECK_EQUAL(0ULL, static_cast<unsigned long long>(stats.reusedConnections));
+    CARTO_CHECK(WaitFor([&]() { return server.getConnectionCount() == 5; }, 1000));
+}
+
+CARTO_TEST(ExpiredIdleConnectionsAreReplaced) {
+    StubHTTPServer server(Echo);
+    HTTPClient client(false);
+    client.setConnectionIdleTimeout(50);
+
+    Get(client, server.getBaseURL() + "/a");
+    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+    Get(client, server.getBaseURL() + "/b");
+
+    HTTPClient::ConnectionStats stats = client.getConnectionStats();
+    CARTO_CHECK_EQUAL(2ULL, static_cast<unsigned long long>(stats.newConnections));
+    CARTO_CHECK_EQUAL(0ULL, static_cast<unsigned long long>(stats.reusedConnections));
+}
+
+CARTO_TEST(PoolSizeLimitsConcurrentConnections) {
+    StubHTTPServer server([](const StubHTTPServer::Request& request) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        return StubHTTPServer::Response(200, request.path);
+    });
+    HTTPClient client(false);
+    client.setMaxConnectionsPerHost(2);
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 6; i++) {
+        threads.emplace_back([&client, &server, i]() {
+            for (int j = 0; j < 5; j++) {
+                Get(client, server.getBaseURL() + "/tile/" + std::to_string(i) + "/" + std::to_string(j));
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    HTTPClient::ConnectionStats stats = client.getConnectionStats();
+    CARTO_CHECK_EQUAL(30, server.getRequestCount());
+    CARTO_CHECK(server.getConnectionCount() <= 2);
+    CARTO_CHECK_EQUAL(30ULL, static_cast<unsigned long long>(stats.newConnections + stats.reusedConnections));
+}
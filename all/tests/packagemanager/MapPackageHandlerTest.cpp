@@ -0,0 +1,179 @@
+#include "packagemanager/handlers/MapPackageHandler.h"
+#include "packagemanager/PackageTileMask.h"
+#include "core/MapTile.h"
+
+#include "support/TestUtils.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <set>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <unistd.h>
+
+#include <sqlite3pp.h>
+
+using namespace carto;
+using namespace carto::test;
+
+namespace {
+
+    struct PackageLayout {
+        int pageSize;
+        std::string tilesSchema;
+        std::string tilesTable;
+        int tileCount;
+        int maxZoom;
+        bool deleteTiles;
+    };
+
+    std::string CreateTempFileName() {
+        char pathTemplate[] = "/tmp/carto_mappkg_XXXXXX";
+        int fd = mkstemp(pathTemplate);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return pathTemplate;
+    }
+
+    std::vector<unsigned char> ReadFile(const std::string& fileName) {
+        std::ifstream stream(fileName, std::ios::binary);
+        return std::vector<unsigned char>(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+    }
+
+    void CreatePackage(const std::string& fileName, const PackageLayout& layout) {
+        std::remove(fileName.c_str());
+        sqlite3pp::database db(fileName.c_str());
+        db.execute(("PRAGMA page_size=" + std::to_string(layout.pageSize)).c_str());
+        db.execute("CREATE TABLE metadata (name TEXT, value TEXT)");
+        db.execute("INSERT INTO metadata (name, value) VALUES ('format', 'pbf')");
+        db.execute(layout.tilesSchema.c_str());
+
+        // Tile sizes vary so that some tiles overflow to separate pages
+        std::mt19937 rng(42);
+        std::set<std::tuple<int, int, int> > tiles;
+        sqlite3pp::transaction xct(db);
+        while (static_cast<int>(tiles.size()) < layout.tileCount) {
+            int zoom = static_cast<int>(rng() % (layout.maxZoom + 1));
+            int x = static_cast<int>(rng() % (1u << zoom));
+            int y = static_cast<int>(rng() % (1u << zoom));
+            if (!tiles.insert(std::make_tuple(zoom, x, y)).second) {
+                continue;
+            }
+            std::string data(rng() % 2 == 0 ? 100 : 5000, static_cast<char>(rng()));
+            sqlite3pp::command command(db, ("INSERT INTO " + layout.tilesTable + " (zoom_level, tile_column, tile_row, tile_data) VALUES (:zoom, :x, :y, :data)").c_str());
+            command.bind(":zoom", zoom);
+            command.bind(":x", x);
+            command.bind(":y", y);
+            command.bind(":data", data.data(), static_cast<unsigned int>(data.size()));
+            command.execute();
+        }
+        xct.commit();
+        if (layout.deleteTiles) {
+            db.execute(("DELETE FROM " + layout.tilesTable + " WHERE tile_column % 3 = 0").c_str());
+        }
+    }
+
+    // Compares the tile mask calculated from streamed data with the mask calculated by querying the package.
+    // If the package can be scanned while streaming, the package file is removed before the streamed mask is calculated.
+    void CheckStreamedTileMask(const PackageLayout& layout, bool scanned) {
+        std::string fileName = CreateTempFileName();
+        CreatePackage(fileName, layout);
+        std::vector<unsigned char> data = ReadFile(fileName);
+
+        MapPackageHandler queriedHandler(fileName, "", "");
+        std::shared_ptr<PackageTileMask> queriedTileMask = queriedHandler.calculateTileMask();
+
+        MapPackageHandler streamedHandler(fileName, "", "");
+        std::mt19937 rng(1);
+        for (std::size_t offset = 0; offset < data.size(); ) {
+            std::size_t size = std::min(data.size() - offset, static_cast<std::size_t>(1 + rng() % 100000));
+            streamedHandler.onImportPackageData(offset, &data[offset], size);
+            offset += size;
+        }
+        if (scanned) {
+            std::remove(fileName.c_str());
+        }
+        std::shared_ptr<PackageTileMask> streamedTileMask = streamedHandler.calculateTileMask();
+        std::remove(fileName.c_str());
+
+        CARTO_CHECK(streamedTileMask && queriedTileMask);
+        CARTO_CHECK_EQUAL(queriedTileMask->getStringValue(), streamedTileMask->getStringValue());
+        CARTO_CHECK_EQUAL(queriedTileMask->getMaxZoomLevel(), streamedTileMask->getMaxZoomLevel());
+    }
+
+    const std::string DEFAULT_TILES_SCHEMA = "CREATE TABLE tiles (zoom_level INTEGER, tile_column INTEGER, tile_row INTEGER, tile_data BLOB)";
+
+}
+
+CARTO_TEST(StreamedTileMaskMatchesQueriedTileMask) {
+    CheckStreamedTileMask(PackageLayout { 4096, DEFAULT_TILES_SCHEMA, "tiles", 5000, 14, false }, true);
+}
+
+CARTO_TEST(StreamedTileMaskWithSmallPagesAndQuotedColumns) {
+    CheckStreamedTileMask(PackageLayout { 512, "CREATE TABLE \"Tiles\" ([zoom_level] integer, `tile_column` INTEGER, \"tile_row\" INTEGER, tile_data BLOB, UNIQUE (zoom_level, tile_column, tile_row))", "tiles", 3000, 18, false }, true);
+}
+
+CARTO_TEST(StreamedTileMaskWithLargePagesAndHighZooms) {
+    CheckStreamedTileMask(PackageLayout { 65536, DEFAULT_TILES_SCHEMA, "tiles", 5000, 22, false }, true);
+}
+
+CARTO_TEST(StreamedTileMaskIgnoresFreePages) {
+    CheckStreamedTileMask(PackageLayout { 1024, DEFAULT_TILES_SCHEMA, "tiles", 5000, 14, true }, true);
+}
+
+CARTO_TEST(StreamedTileMaskFallsBackForReorderedColumns) {
+    // Tile coordinates stored after the tile data overflow the page, so the handler has to query the package
+    CheckStreamedTileMask(PackageLayout { 1024, "CREATE TABLE tiles (tile_data BLOB, zoom_level INTEGER, tile_column INTEGER, tile_row INTEGER)", "tiles", 2000, 14, false }, false);
+}
+
+CARTO_TEST(StreamedTileMaskFallsBackForViews) {
+    CheckStreamedTileMask(PackageLayout { 4096, "CREATE TABLE map (zoom_level INTEGER, tile_column INTEGER, tile_row INTEGER, tile_data BLOB); CREATE VIEW tiles AS SELECT * FROM map", "map", 500, 10, false }, false);
+}
+
+CARTO_TEST(StreamedTileMaskFallsBackForPartialData) {
+    std::string fileName = CreateTempFileName();
+    CreatePackage(fileName, PackageLayout { 4096, DEFAULT_TILES_SCHEMA, "tiles", 2000, 12, false });
+    std::vector<unsigned char> data = ReadFile(fileName);
+
+    // Data that does not start from the beginning of the file is ignored, the tiles are then read from the package
+    MapPackageHandler streamedHandler(fileName, "", "");
+    streamedHandler.onImportPackageData(4096, &data[4096], data.size() - 4096);
+    std::shared_ptr<PackageTileMask> streamedTileMask = streamedHandler.calculateTileMask();
+
+    MapPackageHandler queriedHandler(fileName, "", "");
+    std::shared_ptr<PackageTileMask> queriedTileMask = queriedHandler.calculateTileMask();
+    std::remove(fileName.c_str());
+
+    CARTO_CHECK(streamedTileMask && queriedTileMask);
+    CARTO_CHECK_EQUAL(queriedTileMask->getStringValue(), streamedTileMask->getStringValue());
+}
+
+CARTO_TEST(TileLoadStatsCountLoadsAndCacheHits) {
+    std::string fileName = CreateTempFileName();
+    CreatePackage(fileName, PackageLayout { 4096, DEFAULT_TILES_SCHEMA, "tiles", 1, 0, false });
+
+    MapPackageHandler handler(fileName, "", "");
+    handler.openDatabase();
+    CARTO_CHECK(handler.loadTile(MapTile(0, 0, 0, 0)));
+    CARTO_CHECK(handler.loadTile(MapTile(0, 0, 0, 0)));
+    CARTO_CHECK(!handler.loadTile(MapTile(0, 0, 1, 0)));
+
+    MapPackageHandler::TileLoadStats stats = handler.getTileLoadStats();
+    CARTO_CHECK_EQUAL(1, static_cast<int>(stats.tilesLoaded));
+    CARTO_CHECK_EQUAL(1, static_cast<int>(stats.cacheHits));
+
+    // The decoded tile cache is dropped with the database, the statistics are kept
+    handler.closeDatabase();
+    CARTO_CHECK(handler.loadTile(MapTile(0, 0, 0, 0)));
+    std::remove(fileName.c_str());
+
+    stats = handler.getTileLoadStats();
+    CARTO_CHECK_EQUAL(2, static_cast<int>(stats.tilesLoaded));
+    CARTO_CHECK_EQUAL(1, static_cast<int>(stats.cacheHits));
+}
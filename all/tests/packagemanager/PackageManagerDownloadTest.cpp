@@ -0,0 +1,249 @@
+#include "packagemanager/PackageManager.h"
+#include "packagemanager/PackageManagerListener.h"
+#include "packagemanager/PackageTileMask.h"
+#include "core/MapTile.h"
+
+#include "support/StubHTTPServer.h"
+#include "support/TestUtils.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+
+#include <ftw.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <sqlite3pp.h>
+
+using namespace carto;
+using namespace carto::test;
+
+namespace {
+
+    // Large enough to be downloaded in chunks (MIN_CHUNKED_DOWNLOAD_SIZE is 32MB, chunks are 8MB)
+    const int PACKAGE_PADDING_SIZE = 40 * 1024 * 1024;
+
+    const int DOWNLOAD_TIMEOUT = 60000;
+
+    struct TempDirectory {
+        std::string path;
+
+        TempDirectory() : path() {
+            char pathTemplate[] = "/tmp/carto_pkgmgr_XXXXXX";
+            if (char* result = mkdtemp(pathTemplate)) {
+                path = result;
+            }
+        }
+
+        ~TempDirectory() {
+            nftw(path.c_str(), [](const char* fileName, const struct stat*, int, struct FTW*) { return std::remove(fileName); }, 16, FTW_DEPTH | FTW_PHYS);
+        }
+    };
+
+    std::string ReadFile(const std::string& fileName) {
+        std::ifstream stream(fileName, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+    }
+
+    // Creates a minimal map package: metadata, a single tile and incompressible padding to reach the chunked download size
+    std::string CreateMapPackage(const std::string& fileName) {
+        {
+            sqlite3pp::database db(fileName.c_str());
+            db.execute("CREATE TABLE metadata (name TEXT, value TEXT)");
+            db.execute("CREATE TABLE tiles (zoom_level INTEGER, tile_column INTEGER, tile_row INTEGER, tile_data BLOB)");
+            db.execute("CREATE TABLE padding (data BLOB)");
+            db.execute("INSERT INTO metadata (name, value) VALUES ('format', 'png')");
+            db.execute("INSERT INTO tiles (zoom_level, tile_column, tile_row, tile_data) VALUES (0, 0, 0, x'89504e47')");
+
+            std::mt19937 rng(1234);
+            std::string blob(1024 * 1024, '\0');
+            sqlite3pp::transaction xct(db);
+            for (int size = 0; size < PACKAGE_PADDING_SIZE; size += static_cast<int>(blob.size())) {
+                for (char& c : blob) {
+                    c = static_cast<char>(rng());
+                }
+                sqlite3pp::command command(db, "INSERT INTO padding (data) VALUES (:data)");
+                command.bind(":data", blob.data(), static_cast<unsigned int>(blob.size()));
+                command.execute();
+            }
+            xct.commit();
+        }
+        return ReadFile(fileName);
+    }
+
+    // Serves the package list and the package, optionally with byte range support and a delay per package request
+    struct PackageServerState {
+        std::string package;
+        bool rangesSupported = true;
+        std::string baseURL;
+        std::atomic<int> delayMs;
+        std::atomic<int> packageRequests;
+        std::atomic<int> rangeRequests;
+
+        PackageServerState() : delayMs(0), packageRequests(0), rangeRequests(0) { }
+
+        StubHTTPServer::Response handle(const StubHTTPServer::Request& request) {
+            if (request.path == "/packages.json") {
+                return StubHTTPServer::Response(200, "{\"packages\":[{\"id\":\"test\",\"version\":1,\"size\":" + std::to_string(package.size()) + ",\"url\":\"" + baseURL + "/test.mbtiles\"}]}");
+            }
+            if (request.path != "/test.mbtiles") {
+                return StubHTTPServer::Response(404, std::string());
+            }
+
+            packageRequests++;
+            std::this_thread::sleep_for(std::chrono::milliseconds(delayMs));
+
+            std::string range = request.getHeader("Range");
+            if (rangesSupported && range.compare(0, 6, "bytes=") == 0) {
+                rangeRequests++;
+                std::size_t sep = range.find('-');
+                std::size_t begin = std::stoul(range.substr(6, sep - 6));
+                std::size_t end = sep + 1 < range.size() ? std::stoul(range.substr(sep + 1)) : package.size() - 1;
+                StubHTTPServer::Response response(206, package.substr(begin, end - begin + 1));
+                response.headers["Content-Range"] = "bytes " + std::to_string(begin) + "-" + std::to_string(end) + "/" + std::to_string(package.size());
+                return response;
+            }
+            return StubHTTPServer::Response(200, package);
+        }
+    };
+
+    struct RecordingListener : public PackageManagerListener {
+        std::atomic<int> listUpdated;
+        std::atomic<int> packageUpdated;
+        std::atomic<int> packageFailed;
+
+        RecordingListener() : listUpdated(0), packageUpdated(0), packageFailed(0) { }
+
+        virtual void onPackageListUpdated() { listUpdated++; }
+        virtual void onPackageUpdated(const std::string& id, int version) { packageUpdated++; }
+        virtual void onPackageFailed(const std::string& id, int version, PackageErrorType::PackageErrorType errorType) { packageFailed++; }
+    };
+
+    struct DownloadFixture {
+        TempDirectory sourceDir;
+        TempDirectory dataDir;
+        PackageServerState serverState;
+        std::unique_ptr<StubHTTPServer> server;
+        std::shared_ptr<RecordingListener> listener;
+        std::shared_ptr<PackageManager> packageManager;
+
+        explicit DownloadFixture(bool rangesSupported) : sourceDir(), dataDir(), serverState(), server(), listener(std::make_shared<RecordingListener>()), packageManager() {
+            serverState.package = CreateMapPackage(sourceDir.path + "/test.mbtiles");
+            serverState.rangesSupported = rangesSupported;
+            server.reset(new StubHTTPServer([this](const StubHTTPServer::Request& request) { return serverState.handle(request); }));
+            serverState.baseURL = server->getBaseURL();
+
+            packageManager = std::make_shared<PackageManager>(server->getBaseURL() + "/packages.json", dataDir.path, "", "");
+            packageManager->setPackageManagerListener(listener);
+            packageManager->start();
+            packageManager->startPackageListDownload();
+            CARTO_CHECK(WaitFor([this]() { return listener->listUpdated > 0; }, DOWNLOAD_TIMEOUT));
+        }
+
+        ~DownloadFixture() {
+            packageManager->stop(true);
+            server->stop();
+        }
+
+        std::string downloadedPackage() const {
+            return ReadFile(dataDir.path + "/__Nuti_pkgmgr_test.1.mbtiles");
+        }
+
+        bool chunkStateExists() const {
+            return access((dataDir.path + "/__Nuti_pkgmgr_test.1.mbtiles.chunks").c_str(), F_OK) == 0;
+        }
+    };
+
+}
+
+CARTO_TEST(LargePackageIsDownloadedInRangeChunks) {
+    DownloadFixture fixture(true);
+    CARTO_CHECK(fixture.packageManager->startPackageDownload("test"));
+    CARTO_CHECK(WaitFor([&fixture]() { return fixture.listener->packageUpdated > 0 || fixture.listener->packageFailed > 0; }, DOWNLOAD_TIMEOUT));
+
+    CARTO_CHECK_EQUAL(0, fixture.listener->packageFailed.load());
+    CARTO_CHECK(fixture.serverState.rangeRequests >= 5);
+    CARTO_CHECK(fixture.downloadedPackage() == fixture.serverState.package);
+    CARTO_CHECK(!fixture.chunkStateExists());
+
+    // The tile mask is collected from the chunks while they are downloaded
+    std::shared_ptr<PackageInfo> package = fixture.packageManager->getLocalPackage("test");
+    CARTO_CHECK(package && package->getTileMask());
+    CARTO_CHECK(package->getTileMask()->getTileStatus(MapTile(0, 0, 0, 0)) != PackageTileStatus::PACKAGE_TILE_STATUS_MISSING);
+}
+
+CARTO_TEST(PausedChunksAreRequeuedAndResumed) {
+    DownloadFixture fixture(true);
+    fixture.serverState.delayMs = 200;
+    fixture.packageManager->setMaxDownloadConnections(2);
+    CARTO_CHECK(fixture.packageManager->startPackageDownload("test"));
+
+    // Pause while the first chunks are in flight and resume before the workers have drained
+    CARTO_CHECK(WaitFor([&fixture]() { return fixture.serverState.rangeRequests > 0; }, DOWNLOAD_TIMEOUT));
+    fixture.packageManager->setPackagePriority("test", -1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    fixture.packageManager->setPackagePriority("test", 0);
+    CARTO_CHECK(WaitFor([&fixture]() { return fixture.listener->packageUpdated > 0 || fixture.listener->packageFailed > 0; }, DOWNLOAD_TIMEOUT));
+
+    CARTO_CHECK_EQUAL(0, fixture.listener->packageFailed.load());
+    CARTO_CHECK(fixture.downloadedPackage() == fixture.serverState.package);
+    CARTO_CHECK(!fixture.chunkStateExists());
+}
+
+CARTO_TEST(PausedDownloadKeepsChunkState) {
+    DownloadFixture fixture(true);
+    fixture.serverState.delayMs = 200;
+    fixture.packageManager->setMaxDownloadConnections(2);
+    CARTO_CHECK(fixture.packageManager->startPackageDownload("test"));
+
+    CARTO_CHECK(WaitFor([&fixture]() { return fixture.serverState.rangeRequests > 0; }, DOWNLOAD_TIMEOUT));
+    fixture.packageManager->setPackagePriority("test", -1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+
+    CARTO_CHECK_EQUAL(0, fixture.listener->packageFailed.load());
+    CARTO_CHECK_EQUAL(0, fixture.listener->packageUpdated.load());
+    CARTO_CHECK(fixture.chunkStateExists());
+
+    int requestsWhenPaused = fixture.serverState.rangeRequests;
+    fixture.packageManager->setPackagePriority("test", 0);
+    CARTO_CHECK(WaitFor([&fixture]() { return fixture.listener->packageUpdated > 0 || fixture.listener->packageFailed > 0; }, DOWNLOAD_TIMEOUT));
+
+    CARTO_CHECK_EQUAL(0, fixture.listener->packageFailed.load());
+    CARTO_CHECK(fixture.serverState.rangeRequests > requestsWhenPaused);
+    CARTO_CHECK(fixture.downloadedPackage() == fixture.serverState.package);
+}
+
+CARTO_TEST(ServerWithoutRangesFallsBackToSequentialDownload) {
+    DownloadFixture fixture(false);
+    CARTO_CHECK(fixture.packageManager->startPackageDownload("test"));
+    CARTO_CHECK(WaitFor([&fixture]() { return fixture.listener->packageUpdated > 0 || fixture.listener->packageFailed > 0; }, DOWNLOAD_TIMEOUT));
+
+    CARTO_CHECK_EQUAL(0, fixture.listener->packageFailed.load());
+    CARTO_CHECK_EQUAL(0, fixture.serverState.rangeRequests.load());
+    CARTO_CHECK(fixture.downloadedPackage() == fixture.serverState.package);
+    CARTO_CHECK(!fixture.chunkStateExists());
+}
+
+CARTO_TEST(LocalPackageImportSharesSourceFile) {
+    DownloadFixture fixture(true);
+    std::string sourceFileName = fixture.sourceDir.path + "/test.mbtiles";
+    CARTO_CHECK(fixture.packageManager->startPackageImport("local", 1, sourceFileName));
+    CARTO_CHECK(WaitFor([&fixture]() { return fixture.listener->packageUpdated > 0 || fixture.listener->packageFailed > 0; }, DOWNLOAD_TIMEOUT));
+
+    CARTO_CHECK_EQUAL(0, fixture.listener->packageFailed.load());
+    struct stat st;
+    CARTO_CHECK(stat(sourceFileName.c_str(), &st) == 0);
+    CARTO_CHECK_EQUAL(2, static_cast<int>(st.st_nlink));
+    std::shared_ptr<PackageInfo> package = fixture.packageManager->getLocalPackage("local");
+    CARTO_CHECK(package && package->getTileMask());
+    CARTO_CHECK(package->getTileMask()->getTileStatus(MapTile(0, 0, 0, 0)) != PackageTileStatus::PACKAGE_TILE_STATUS_MISSING);
+}
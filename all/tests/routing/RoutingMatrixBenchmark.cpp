@@ -0,0 +1,104 @@
+#include "routing/SGREOfflineRoutingService.h"
+#include "routing/RoutingRequest.h"
+#include "routing/RoutingMatrixRequest.h"
+#include "routing/RoutingMatrixResult.h"
+#include "projections/EPSG3857.h"
+#include "core/MapPos.h"
+#include "core/Variant.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace carto;
+
+// Routing matrix over a generated street grid, comparing one calculateRoute call per pair
+// against a single calculateMatrix call that distributes the rows over the matrix thread pool.
+// Usage: RoutingMatrixBenchmark [sources] [targets] [grid size]
+
+namespace {
+
+    const double GRID_STEP = 0.001; // degrees, roughly 100m
+
+    std::string CreateGridGeoJSON(int gridSize) {
+        std::ostringstream ss;
+        ss.precision(9);
+        ss << "{\"type\":\"FeatureCollection\",\"features\":[";
+        bool first = true;
+        for (int i = 0; i < gridSize; i++) {
+            for (int j = 0; j + 1 < gridSize; j++) {
+                for (int dir = 0; dir < 2; dir++) {
+                    double x0 = (dir == 0 ? j : i) * GRID_STEP, y0 = (dir == 0 ? i : j) * GRID_STEP;
+                    double x1 = (dir == 0 ? j + 1 : i) * GRID_STEP, y1 = (dir == 0 ? i : j + 1) * GRID_STEP;
+                    ss << (first ? "" : ",") << "{\"type\":\"Feature\",\"properties\":{},\"geometry\":{\"type\":\"LineString\",\"coordinates\":[[" << x0 << "," << y0 << ",0],[" << x1 << "," << y1 << ",0]]}}";
+                    first = false;
+                }
+            }
+        }
+        ss << "]}";
+        return ss.str();
+    }
+
+    std::vector<MapPos> CreatePoints(const std::shared_ptr<Projection>& proj, std::mt19937& rng, int gridSize, int count) {
+        std::uniform_real_distribution<double> coord(0, (gridSize - 1) * GRID_STEP);
+        std::vector<MapPos> points;
+        for (int i = 0; i < count; i++) {
+            double x = coord(rng);
+            points.push_back(proj->fromWgs84(MapPos(x, coord(rng))));
+        }
+        return points;
+    }
+
+}
+
+int main(int argc, char* argv[]) {
+    int sourceCount = argc > 1 ? std::atoi(argv[1]) : 100;
+    int targetCount = argc > 2 ? std::atoi(argv[2]) : 100;
+    int gridSize = argc > 3 ? std::atoi(argv[3]) : 60;
+
+    SGREOfflineRoutingService service(Variant::FromString(CreateGridGeoJSON(gridSize)), Variant::FromString("{\"rules\":[{\"speed\":1.4}]}"));
+    auto proj = std::make_shared<EPSG3857>();
+    std::mt19937 rng(1234);
+    std::vector<MapPos> sourcePoints = CreatePoints(proj, rng, gridSize, sourceCount);
+    std::vector<MapPos> targetPoints = CreatePoints(proj, rng, gridSize, targetCount);
+    std::printf("%dx%d matrix on a %dx%d grid\n", sourceCount, targetCount, gridSize, gridSize);
+
+    // Build the graph before timing
+    service.calculateRoute(std::make_shared<RoutingRequest>(proj, std::vector<MapPos> { sourcePoints.front(), targetPoints.front() }));
+
+    int failedCount = 0;
+    auto startTime = std::chrono::steady_clock::now();
+    for (const MapPos& source : sourcePoints) {
+        for (const MapPos& target : targetPoints) {
+            try {
+                service.calculateRoute(std::make_shared<RoutingRequest>(proj, std::vector<MapPos> { source, target }));
+            }
+            catch (const std::exception&) {
+                failedCount++;
+            }
+        }
+    }
+    double routeTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    std::printf("%-24s %8.1f ms  failed=%d\n", "route per pair", routeTime * 1000.0, failedCount);
+
+    startTime = std::chrono::steady_clock::now();
+    std::shared_ptr<RoutingMatrixResult> result = service.calculateMatrix(std::make_shared<RoutingMatrixRequest>(proj, sourcePoints, targetPoints));
+    double matrixTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    int unreachableCount = 0;
+    for (int i = 0; i < sourceCount; i++) {
+        for (int j = 0; j < targetCount; j++) {
+            if (result->getDistance(i, j) < 0) {
+                unreachableCount++;
+            }
+        }
+    }
+    std::printf("%-24s %8.1f ms  unreachable=%d\n", "matrix", matrixTime * 1000.0, unreachableCount);
+    std::printf("speedup: %.2fx\n", routeTime / matrixTime);
+    return 0;
+}
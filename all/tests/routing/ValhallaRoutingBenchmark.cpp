@@ -0,0 +1,102 @@
+#include "routing/ValhallaOfflineRoutingService.h"
+#include "routing/RoutingRequest.h"
+#include "routing/RoutingResult.h"
+#include "projections/EPSG3857.h"
+#include "core/MapPos.h"
+#include "core/Variant.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace carto;
+
+// Repeated short routes in one region, comparing a new graph reader per request (no idle readers)
+// against pooled readers that keep their graph tile caches between requests.
+// Usage: ValhallaRoutingBenchmark <routing package> <lat> <lng> [routes] [threads] [radius in meters] [tile cache bytes]
+
+namespace {
+
+    std::vector<std::vector<MapPos> > CreateRoutes(double lat, double lng, double radius, int routeCount) {
+        std::mt19937 rng(1234);
+        std::uniform_real_distribution<double> offset(-1.0, 1.0);
+        double latRadius = radius / 111320.0;
+        double lngRadius = latRadius / std::cos(lat * 3.14159265358979 / 180.0);
+        std::vector<std::vector<MapPos> > routes;
+        for (int i = 0; i < routeCount; i++) {
+            std::vector<MapPos> points;
+            for (int j = 0; j < 2; j++) {
+                points.push_back(MapPos(lng + offset(rng) * lngRadius, lat + offset(rng) * latRadius));
+            }
+            routes.push_back(points);
+        }
+        return routes;
+    }
+
+    double Run(const std::string& packageFileName, const std::vector<std::vector<MapPos> >& routes, int threadCount, long long maxIdleReaders, long long maxTileCacheSize) {
+        ValhallaOfflineRoutingService service(packageFileName);
+        service.setProfile("auto");
+        service.setConfigurationParameter("mjolnir.max_idle_readers", Variant(maxIdleReaders));
+        service.setConfigurationParameter("mjolnir.max_cache_size", Variant(maxTileCacheSize));
+
+        auto proj = std::make_shared<EPSG3857>();
+        std::atomic<int> failedCount(0);
+        auto startTime = std::chrono::steady_clock::now();
+        std::vector<std::thread> threads;
+        for (int i = 0; i < threadCount; i++) {
+            threads.emplace_back([&, i]() {
+                for (std::size_t j = i; j < routes.size(); j += threadCount) {
+                    std::vector<MapPos> points;
+                    for (const MapPos& pos : routes[j]) {
+                        points.push_back(proj->fromWgs84(pos));
+                    }
+                    try {
+                        service.calculateRoute(std::make_shared<RoutingRequest>(proj, points));
+                    }
+                    catch (const std::exception&) {
+                        failedCount++; // points outside of the road network
+                    }
+                }
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+        std::printf("%-24s %8.1f ms %8.1f routes/s  failed=%d\n",
+            maxIdleReaders == 0 ? "reader per request" : "pooled readers",
+            seconds * 1000.0, routes.size() / seconds, failedCount.load());
+        return seconds;
+    }
+
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 4) {
+        std::fprintf(stderr, "Usage: %s <routing package> <lat> <lng> [routes] [threads] [radius in meters] [tile cache bytes]\n", argv[0]);
+        return 1;
+    }
+    std::string packageFileName = argv[1];
+    double lat = std::atof(argv[2]);
+    double lng = std::atof(argv[3]);
+    int routeCount = argc > 4 ? std::atoi(argv[4]) : 500;
+    int threadCount = argc > 5 ? std::atoi(argv[5]) : 4;
+    double radius = argc > 6 ? std::atof(argv[6]) : 3000.0;
+    long long maxTileCacheSize = argc > 7 ? std::atoll(argv[7]) : 10000000;
+
+    std::vector<std::vector<MapPos> > routes = CreateRoutes(lat, lng, radius, routeCount);
+    std::printf("%d routes within %.0f m, %d threads, %lld byte tile cache per reader\n", routeCount, radius, threadCount, maxTileCacheSize);
+    double oldTime = Run(packageFileName, routes, threadCount, 0, maxTileCacheSize);
+    double newTime = Run(packageFileName, routes, threadCount, threadCount, maxTileCacheSize);
+    std::printf("speedup: %.2fx\n", oldTime / newTime);
+    return 0;
+}
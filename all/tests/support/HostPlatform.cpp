@@ -0,0 +1,61 @@
+#include "components/Task.h"
+#include "utils/AssetUtils.h"
+#include "utils/PlatformUtils.h"
+#include "utils/ThreadUtils.h"
+
+// Minimal host implementations of the platform specific SDK classes used by the tests.
+// The mobile platforms provide these in android/native, ios/native and winphone/native.
+
+namespace carto {
+
+    void Task::operator()() {
+        run();
+    }
+
+    PlatformType::PlatformType PlatformUtils::GetPlatformType() {
+        // Desktop Linux hosts share the POSIX code paths with Android
+#ifdef __APPLE__
+        return PlatformType::PLATFORM_TYPE_MAC_OS;
+#else
+        return PlatformType::PLATFORM_TYPE_ANDROID;
+#endif
+    }
+
+    std::string PlatformUtils::GetDeviceId() {
+        return "test-device";
+    }
+
+    std::string PlatformUtils::GetDeviceType() {
+        return "host";
+    }
+
+    std::string PlatformUtils::GetDeviceOS() {
+        return "host";
+    }
+
+    std::string PlatformUtils::GetAppIdentifier() {
+        return "com.carto.tests";
+    }
+
+    std::string PlatformUtils::GetAppDeviceId() {
+        return GetAppIdentifier() + ":" + GetDeviceId();
+    }
+
+    bool PlatformUtils::ExcludeFolderFromBackup(const std::string& folder) {
+        return true;
+    }
+
+    PlatformUtils::PlatformUtils() {
+    }
+
+    std::shared_ptr<BinaryData> AssetUtils::LoadAsset(const std::string& path) {
+        return std::shared_ptr<BinaryData>();
+    }
+
+    void ThreadUtils::SetThreadPriority(ThreadPriority::ThreadPriority priority) {
+    }
+
+    ThreadUtils::ThreadUtils() {
+    }
+
+}
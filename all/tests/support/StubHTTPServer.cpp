@@ -0,0 +1,229 @@
+#include "StubHTTPServer.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+namespace carto { namespace test {
+
+    std::string StubHTTPServer::Request::getHeader(const std::string& name) const {
+        std::string lowerName = name;
+        std::transform(lowerName.begin(), lowerName.end(), lowerName.begin(), ::tolower);
+        auto it = headers.find(lowerName);
+        return it != headers.end() ? it->second : std::string();
+    }
+
+    StubHTTPServer::StubHTTPServer(const Handler& handler) :
+        _handler(handler),
+        _listenSocket(-1),
+        _port(0),
+        _requestCount(0),
+        _connectionCount(0),
+        _stopped(false),
+        _acceptThread(),
+        _connectionThreads(),
+        _connectionSockets(),
+        _mutex()
+    {
+        _listenSocket = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (_listenSocket < 0) {
+            throw std::runtime_error("StubHTTPServer: Failed to create socket");
+        }
+        int reuse = 1;
+        ::setsockopt(_listenSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+        sockaddr_in addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        socklen_t addrLen = sizeof(addr);
+        if (::bind(_listenSocket, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(_listenSocket, 64) != 0 || ::getsockname(_listenSocket, reinterpret_cast<sockaddr*>(&addr), &addrLen) != 0) {
+            ::close(_listenSocket);
+            throw std::runtime_error("StubHTTPServer: Failed to bind socket");
+        }
+        _port = ntohs(addr.sin_port);
+
+        _acceptThread = std::thread(&StubHTTPServer::acceptConnections, this);
+    }
+
+    StubHTTPServer::~StubHTTPServer() {
+        stop();
+    }
+
+    int StubHTTPServer::getPort() const {
+        return _port;
+    }
+
+    std::string StubHTTPServer::getBaseURL() const {
+        return "http://127.0.0.1:" + std::to_string(_port);
+    }
+
+    int StubHTTPServer::getRequestCount() const {
+        return _requestCount.load();
+    }
+
+    int StubHTTPServer::getConnectionCount() const {
+        return _connectionCount.load();
+    }
+
+    void StubHTTPServer::stop() {
+        if (_stopped.exchange(true)) {
+            return;
+        }
+
+        ::shutdown(_listenSocket, SHUT_RDWR);
+        _acceptThread.join();
+        ::close(_listenSocket);
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            for (int socket : _connectionSockets) {
+                ::shutdown(socket, SHUT_RDWR);
+            }
+        }
+        for (std::thread& thread : _connectionThreads) {
+            thread.join();
+        }
+    }
+
+    void StubHTTPServer::acceptConnections() {
+        while (!_stopped) {
+            int socket = ::accept(_listenSocket, nullptr, nullptr);
+            if (socket < 0) {
+                break;
+            }
+
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_stopped) {
+                ::close(socket);
+                break;
+            }
+            int noDelay = 1;
+            ::setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+            _connectionCount++;
+            _connectionSockets.push_back(socket);
+            _connectionThreads.emplace_back(&StubHTTPServer::serveConnection, this, socket);
+        }
+    }
+
+    void StubHTTPServer::serveConnection(int socket) {
+        std::string buffer;
+        while (!_stopped) {
+            Request request;
+            if (!ReadRequest(socket, buffer, request)) {
+                break;
+            }
+            _requestCount++;
+
+            Response response;
+            try {
+                response = _handler(request);
+            }
+            catch (const std::exception& ex) {
+                response = Response(500, ex.what());
+            }
+
+            if (!WriteResponse(socket, request, response)) {
+                break;
+            }
+            std::string connection = request.getHeader("Connection");
+            std::transform(connection.begin(), connection.end(), connection.begin(), ::tolower);
+            if (connection == "close" || response.headers.count("Connection") > 0) {
+                break;
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _connectionSockets.erase(std::remove(_connectionSockets.begin(), _connectionSockets.end(), socket), _connectionSockets.end());
+        }
+        ::close(socket);
+    }
+
+    bool StubHTTPServer::ReadRequest(int socket, std::string& buffer, Request& request) {
+        char data[16384];
+        std::size_t headerEnd;
+        while ((headerEnd = buffer.find("\r\n\r\n")) == std::string::npos) {
+            ssize_t size = ::recv(socket, data, sizeof(data), 0);
+            if (size <= 0) {
+                return false;
+            }
+            buffer.append(data, size);
+        }
+
+        std::istringstream headerStream(buffer.substr(0, headerEnd));
+        std::string line;
+        if (!std::getline(headerStream, line)) {
+            return false;
+        }
+        std::istringstream requestLine(line);
+        requestLine >> request.method >> request.path;
+        while (std::getline(headerStream, line)) {
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            std::size_t colon = line.find(':');
+            if (colon == std::string::npos) {
+                continue;
+            }
+            std::string name = line.substr(0, colon);
+            std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+            std::string value = line.substr(colon + 1);
+            value.erase(0, value.find_first_not_of(' '));
+            request.headers[name] = value;
+        }
+        buffer.erase(0, headerEnd + 4);
+
+        std::size_t contentLength = std::strtoul(request.getHeader("Content-Length").c_str(), nullptr, 10);
+        while (buffer.size() < contentLength) {
+            ssize_t size = ::recv(socket, data, sizeof(data), 0);
+            if (size <= 0) {
+                return false;
+            }
+            buffer.append(data, size);
+        }
+        request.body = buffer.substr(0, contentLength);
+        buffer.erase(0, contentLength);
+        return true;
+    }
+
+    bool StubHTTPServer::WriteResponse(int socket, const Request& request, const Response& response) {
+        bool sendBody = request.method != "HEAD" && response.statusCode != 204 && response.statusCode != 304;
+
+        std::ostringstream ss;
+        ss << "HTTP/1.1 " << response.statusCode << " " << (response.statusCode < 400 ? "OK" : "Error") << "\r\n";
+        for (auto it = response.headers.begin(); it != response.headers.end(); it++) {
+            ss << it->first << ": " << it->second << "\r\n";
+        }
+        if (response.headers.count("Content-Length") == 0) {
+            ss << "Content-Length: " << (sendBody ? response.body.size() : 0) << "\r\n";
+        }
+        ss << "\r\n";
+        std::string data = ss.str();
+        if (sendBody) {
+            data += response.body;
+        }
+
+        std::size_t offset = 0;
+        while (offset < data.size()) {
+            ssize_t size = ::send(socket, data.data() + offset, data.size() - offset, MSG_NOSIGNAL);
+            if (size <= 0) {
+                return false;
+            }
+            offset += size;
+        }
+        return true;
+    }
+
+} }
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2016 CartoDB. All rights reserved.
+ * Copying and using this code is allowed only according
+ * to license terms, as given in https://cartodb.com/terms/
+ */
+
+#ifndef _CARTO_STUBHTTPSERVER_H_
+#define _CARTO_STUBHTTPSERVER_H_
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace carto { namespace test {
+
+    /**
+     * A minimal HTTP/1.1 server listening on a loopback port, used to test the network code without external services.
+     * Connections are kept alive unless the client asks otherwise. Request header names are lowercased.
+     */
+    class StubHTTPServer {
+    public:
+        struct Request {
+            std::string method;
+            std::string path;
+            std::map<std::string, std::string> headers;
+            std::string body;
+
+            std::string getHeader(const std::string& name) const;
+        };
+
+        struct Response {
+            int statusCode;
+            std::map<std::string, std::string> headers;
+            std::string body;
+
+            Response() : statusCode(200), headers(), body() { }
+            Response(int statusCode, const std::string& body) : statusCode(statusCode), headers(), body(body) { }
+        };
+
+        typedef std::function<Response(const Request&)> Handler;
+
+        explicit StubHTTPServer(const Handler& handler);
+        virtual ~StubHTTPServer();
+
+        int getPort() const;
+        std::string getBaseURL() const;
+
+        int getRequestCount() const;
+        int getConnectionCount() const;
+
+        void stop();
+
+    private:
+        void acceptConnections();
+        void serveConnection(int socket);
+
+        static bool ReadRequest(int socket, std::string& buffer, Request& request);
+        static bool WriteResponse(int socket, const Request& request, const Response& response);
+
+        Handler _handler;
+        int _listenSocket;
+        int _port;
+        std::atomic<int> _requestCount;
+        std::atomic<int> _connectionCount;
+        std::atomic<bool> _stopped;
+        std::thread _acceptThread;
+        std::vector<std::thread> _connectionThreads;
+        std::vector<int> _connectionSockets;
+        mutable std::mutex _mutex;
+    };
+
+} }
+
+#endif
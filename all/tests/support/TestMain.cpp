@@ -0,0 +1,27 @@
+#include "TestUtils.h"
+
+#include <cstdio>
+#include <cstring>
+
+int main(int argc, char* argv[]) {
+    using namespace carto::test;
+
+    int failed = 0;
+    int executed = 0;
+    for (const TestCase& testCase : GetTestCases()) {
+        if (argc > 1 && std::strstr(testCase.name.c_str(), argv[1]) == nullptr) {
+            continue;
+        }
+        executed++;
+        try {
+            testCase.function();
+            std::printf("[ OK ] %s\n", testCase.name.c_str());
+        }
+        catch (const std::exception& ex) {
+            std::printf("[FAIL] %s: %s\n", testCase.name.c_str(), ex.what());
+            failed++;
+        }
+    }
+    std::printf("%d/%d tests passed\n", executed - failed, executed);
+    return failed == 0 && executed > 0 ? 0 : 1;
+}
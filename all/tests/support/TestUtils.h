@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2016 CartoDB. All rights reserved.
+ * Copying and using this code is allowed only according
+ * to license terms, as given in https://cartodb.com/terms/
+ */
+
+#ifndef _CARTO_TESTUTILS_H_
+#define _CARTO_TESTUTILS_H_
+
+#include <cmath>
+#include <chrono>
+#include <functional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace carto { namespace test {
+
+    class TestFailure : public std::runtime_error {
+    public:
+        explicit TestFailure(const std::string& msg) : std::runtime_error(msg) { }
+    };
+
+    struct TestCase {
+        std::string name;
+        std::function<void()> function;
+    };
+
+    inline std::vector<TestCase>& GetTestCases() {
+        static std::vector<TestCase> testCases;
+        return testCases;
+    }
+
+    struct TestRegistrar {
+        TestRegistrar(const char* name, void (*function)()) {
+            GetTestCases().push_back(TestCase { name, function });
+        }
+    };
+
+    inline void Fail(const char* file, int line, const std::string& msg) {
+        std::stringstream ss;
+        ss << file << ":" << line << ": " << msg;
+        throw TestFailure(ss.str());
+    }
+
+    template <typename T>
+    std::string ToString(const T& value) {
+        std::stringstream ss;
+        ss << value;
+        return ss.str();
+    }
+
+    inline bool WaitFor(const std::function<bool()>& condition, int timeoutMs) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+        while (!condition()) {
+            if (std::chrono::steady_clock::now() >= deadline) {
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        return true;
+    }
+
+} }
+
+#define CARTO_TEST(name) \
+    static void name(); \
+    static carto::test::TestRegistrar name##_registrar(#name, &name); \
+    static void name()
+
+#define CARTO_CHECK(expr) \
+    do { if (!(expr)) { carto::test::Fail(__FILE__, __LINE__, "CARTO_CHECK(" #expr ") failed"); } } while (false)
+
+#define CARTO_CHECK_EQUAL(expected, actual) \
+    do { \
+        auto expectedValue_ = (expected); \
+        auto actualValue_ = (actual); \
+        if (!(expectedValue_ == actualValue_)) { \
+            carto::test::Fail(__FILE__, __LINE__, "CARTO_CHECK_EQUAL(" #expected ", " #actual ") failed: " + carto::test::ToString(expectedValue_) + " != " + carto::test::ToString(actualValue_)); \
+        } \
+    } while (false)
+
+#define CARTO_CHECK_NEAR(expected, actual, tolerance) \
+    do { \
+        double expectedValue_ = (expected); \
+        double actualValue_ = (actual); \
+        if (!(std::abs(expectedValue_ - actualValue_) <= (tolerance))) { \
+            carto::test::Fail(__FILE__, __LINE__, "CARTO_CHECK_NEAR(" #expected ", " #actual ") failed: " + carto::test::ToString(expectedValue_) + " vs " + carto::test::ToString(actualValue_)); \
+        } \
+    } while (false)
+
+#endif
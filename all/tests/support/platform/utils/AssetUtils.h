@@ -0,0 +1,34 @@
+/*
+ * Copyright (c) 2016 CartoDB. All rights reserved.
+ * Copying and using this code is allowed only according
+ * to license terms, as given in https://cartodb.com/terms/
+ */
+
+#ifndef _CARTO_ASSETUTILS_H_
+#define _CARTO_ASSETUTILS_H_
+
+#include <memory>
+#include <string>
+
+namespace carto {
+    class BinaryData;
+
+    /**
+     * Host version of the bundled asset helper. Tests do not bundle assets, so loading always fails.
+     */
+    class AssetUtils {
+    public:
+        /**
+         * Loads the specified bundled asset.
+         * @param path The path of the asset to load.
+         * @return Always null on the host.
+         */
+        static std::shared_ptr<BinaryData> LoadAsset(const std::string& path);
+
+    private:
+        AssetUtils();
+    };
+
+}
+
+#endif
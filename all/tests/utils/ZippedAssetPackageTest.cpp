@@ -0,0 +1,289 @@
+#include "utils/ZippedAssetPackage.h"
+#include "core/BinaryData.h"
+#include "components/Exceptions.h"
+
+#include "support/TestUtils.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#define MINIZ_HEADER_FILE_ONLY
+#define MINIZ_NO_STDIO
+#define MINIZ_NO_ARCHIVE_APIS
+#define MINIZ_NO_ZLIB_COMPATIBLE_NAMES
+
+#include <miniz.c>
+
+using namespace carto;
+using namespace carto::test;
+
+namespace {
+
+    struct ZipEntry {
+        std::string name;
+        std::string data;
+        bool deflated;
+    };
+
+    // Byte offsets of an entry in the generated archive, used for corrupting it
+    struct ZipEntryLayout {
+        std::size_t dataOffset;
+        std::size_t centralCRCOffset;
+    };
+
+    void WriteLE16(std::vector<unsigned char>& out, unsigned int value) {
+        out.push_back(static_cast<unsigned char>(value & 0xff));
+        out.push_back(static_cast<unsigned char>((value >> 8) & 0xff));
+    }
+
+    void WriteLE32(std::vector<unsigned char>& out, std::uint32_t value) {
+        WriteLE16(out, value & 0xffff);
+        WriteLE16(out, value >> 16);
+    }
+
+    // Writes a minimal ZIP archive by hand, so that the test does not depend on the miniz writer APIs
+    std::vector<unsigned char> CreateZipArchive(const std::vector<ZipEntry>& entries, std::vector<ZipEntryLayout>* layouts = nullptr) {
+        std::vector<unsigned char> archive;
+        std::vector<unsigned char> centralDir;
+        for (const ZipEntry& entry : entries) {
+            std::uint32_t crc = static_cast<std::uint32_t>(mz_crc32(MZ_CRC32_INIT, reinterpret_cast<const unsigned char*>(entry.data.data()), entry.data.size()));
+            std::string compressed = entry.data;
+            if (entry.deflated) {
+                std::size_t compressedSize = 0;
+                void* compressedData = tdefl_compress_mem_to_heap(entry.data.data(), entry.data.size(), &compressedSize, TDEFL_DEFAULT_MAX_PROBES);
+                compressed.assign(static_cast<const char*>(compressedData), compressedSize);
+                mz_free(compressedData);
+            }
+            unsigned int method = entry.deflated ? MZ_DEFLATED : 0;
+            std::size_t localHeaderOffset = archive.size();
+
+            WriteLE32(archive, 0x04034b50);
+            WriteLE16(archive, 20);
+            WriteLE16(archive, 0);
+            WriteLE16(archive, method);
+            WriteLE32(archive, 0);
+            WriteLE32(archive, crc);
+            WriteLE32(archive, static_cast<std::uint32_t>(compressed.size()));
+            WriteLE32(archive, static_cast<std::uint32_t>(entry.data.size()));
+            WriteLE16(archive, static_cast<unsigned int>(entry.name.size()));
+            WriteLE16(archive, 0);
+            archive.insert(archive.end(), entry.name.begin(), entry.name.end());
+            std::size_t dataOffset = archive.size();
+            archive.insert(archive.end(), compressed.begin(), compressed.end());
+
+            WriteLE32(centralDir, 0x02014b50);
+            WriteLE16(centralDir, 20);
+            WriteLE16(centralDir, 20);
+            WriteLE16(centralDir, 0);
+            WriteLE16(centralDir, method);
+            WriteLE32(centralDir, 0);
+            std::size_t centralCRCOffset = centralDir.size();
+            WriteLE32(centralDir, crc);
+            WriteLE32(centralDir, static_cast<std::uint32_t>(compressed.size()));
+            WriteLE32(centralDir, static_cast<std::uint32_t>(entry.data.size()));
+            WriteLE16(centralDir, static_cast<unsigned int>(entry.name.size()));
+            WriteLE16(centralDir, 0);
+            WriteLE16(centralDir, 0);
+            WriteLE16(centralDir, 0);
+            WriteLE16(centralDir, 0);
+            WriteLE32(centralDir, 0);
+            WriteLE32(centralDir, static_cast<std::uint32_t>(localHeaderOffset));
+            centralDir.insert(centralDir.end(), entry.name.begin(), entry.name.end());
+
+            if (layouts) {
+                layouts->push_back(ZipEntryLayout { dataOffset, centralCRCOffset });
+            }
+        }
+
+        std::size_t centralDirOffset = archive.size();
+        archive.insert(archive.end(), centralDir.begin(), centralDir.end());
+        WriteLE32(archive, 0x06054b50);
+        WriteLE16(archive, 0);
+        WriteLE16(archive, 0);
+        WriteLE16(archive, static_cast<unsigned int>(entries.size()));
+        WriteLE16(archive, static_cast<unsigned int>(entries.size()));
+        WriteLE32(archive, static_cast<std::uint32_t>(centralDir.size()));
+        WriteLE32(archive, static_cast<std::uint32_t>(centralDirOffset));
+        WriteLE16(archive, 0);
+
+        if (layouts) {
+            for (ZipEntryLayout& layout : *layouts) {
+                layout.centralCRCOffset += centralDirOffset;
+            }
+        }
+        return archive;
+    }
+
+    std::string CreateRandomData(std::size_t size, unsigned int seed) {
+        std::mt19937 rng(seed);
+        std::string data(size, '\0');
+        for (char& c : data) {
+            c = static_cast<char>('a' + rng() % 4); // compressible, but not trivially
+        }
+        return data;
+    }
+
+    std::string AssetString(const std::shared_ptr<BinaryData>& data) {
+        return std::string(reinterpret_cast<const char*>(data->data()), data->size());
+    }
+
+    std::string CreateTempFileName() {
+        char pathTemplate[] = "/tmp/carto_zipasset_XXXXXX";
+        int fd = mkstemp(pathTemplate);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return pathTemplate;
+    }
+
+    void WriteFile(const std::string& fileName, const std::vector<unsigned char>& data) {
+        std::ofstream stream(fileName, std::ios::binary);
+        stream.write(reinterpret_cast<const char*>(data.data()), data.size());
+    }
+
+    class MemoryAssetPackage : public AssetPackage {
+    public:
+        explicit MemoryAssetPackage(const std::string& name, const std::string& data) : _name(name), _data(data) { }
+
+        virtual std::vector<std::string> getAssetNames() const {
+            return std::vector<std::string> { _name };
+        }
+
+        virtual std::shared_ptr<BinaryData> loadAsset(const std::string& name) const {
+            if (name != _name) {
+                return std::shared_ptr<BinaryData>();
+            }
+            return std::make_shared<BinaryData>(reinterpret_cast<const unsigned char*>(_data.data()), _data.size());
+        }
+
+    private:
+        std::string _name;
+        std::string _data;
+    };
+
+    const std::vector<ZipEntry> TEST_ENTRIES = {
+        ZipEntry { "style.json", "{\"layers\":[]}", false },
+        ZipEntry { "fonts/font.ttf", CreateRandomData(200000, 1), true },
+        ZipEntry { "images/icon.png", CreateRandomData(5000, 2), false }
+    };
+
+}
+
+CARTO_TEST(StoredAndDeflatedAssetsAreExtracted) {
+    ZippedAssetPackage package(std::make_shared<BinaryData>(CreateZipArchive(TEST_ENTRIES)));
+    CARTO_CHECK_EQUAL(TEST_ENTRIES.size(), package.getLocalAssetNames().size());
+    for (const ZipEntry& entry : TEST_ENTRIES) {
+        std::shared_ptr<BinaryData> data = package.loadAsset(entry.name);
+        CARTO_CHECK(data);
+        CARTO_CHECK(AssetString(data) == entry.data);
+    }
+    CARTO_CHECK(!package.loadAsset("missing.json"));
+}
+
+CARTO_TEST(CorruptedCRCFailsOnlyTheAffectedAsset) {
+    std::vector<ZipEntryLayout> layouts;
+    std::vector<unsigned char> archive = CreateZipArchive(TEST_ENTRIES, &layouts);
+    archive[layouts[0].dataOffset] ^= 0xff; // stored data no longer matches its CRC
+    archive[layouts[1].centralCRCOffset] ^= 0xff; // deflated data is intact, but the indexed CRC is wrong
+
+    ZippedAssetPackage package(std::make_shared<BinaryData>(std::move(archive)));
+    CARTO_CHECK(!package.loadAsset(TEST_ENTRIES[0].name));
+    CARTO_CHECK(!package.loadAsset(TEST_ENTRIES[1].name));
+
+    std::shared_ptr<BinaryData> data = package.loadAsset(TEST_ENTRIES[2].name);
+    CARTO_CHECK(data);
+    CARTO_CHECK(AssetString(data) == TEST_ENTRIES[2].data);
+
+    // Failed extractions are not cached, the error is reported again
+    CARTO_CHECK(!package.loadAsset(TEST_ENTRIES[0].name));
+}
+
+CARTO_TEST(FileConstructorMapsArchive) {
+    std::string fileName = CreateTempFileName();
+    WriteFile(fileName, CreateZipArchive(TEST_ENTRIES));
+
+    auto basePackage = std::make_shared<MemoryAssetPackage>("base.json", "{}");
+    ZippedAssetPackage package(fileName, basePackage);
+
+    // The mapping stays valid after the file is unlinked
+    std::remove(fileName.c_str());
+
+    CARTO_CHECK_EQUAL(TEST_ENTRIES.size() + 1, package.getAssetNames().size());
+    for (const ZipEntry& entry : TEST_ENTRIES) {
+        std::shared_ptr<BinaryData> data = package.loadAsset(entry.name);
+        CARTO_CHECK(data);
+        CARTO_CHECK(AssetString(data) == entry.data);
+    }
+    std::shared_ptr<BinaryData> baseData = package.loadAsset("base.json");
+    CARTO_CHECK(baseData);
+    CARTO_CHECK(AssetString(baseData) == "{}");
+}
+
+CARTO_TEST(FileConstructorRejectsMissingAndInvalidFiles) {
+    std::string fileName = CreateTempFileName();
+    bool thrown = false;
+    try {
+        ZippedAssetPackage package(fileName, std::shared_ptr<AssetPackage>()); // empty file
+    }
+    catch (const FileException&) {
+        thrown = true;
+    }
+    CARTO_CHECK(thrown);
+
+    WriteFile(fileName, std::vector<unsigned char>(1000, 0x55));
+    thrown = false;
+    try {
+        ZippedAssetPackage package(fileName, std::shared_ptr<AssetPackage>());
+    }
+    catch (const GenericException&) {
+        thrown = true;
+    }
+    CARTO_CHECK(thrown);
+    std::remove(fileName.c_str());
+
+    thrown = false;
+    try {
+        ZippedAssetPackage package(fileName, std::shared_ptr<AssetPackage>());
+    }
+    catch (const FileException&) {
+        thrown = true;
+    }
+    CARTO_CHECK(thrown);
+}
+
+CARTO_TEST(ConcurrentLoadsReturnIdenticalData) {
+    std::string fileName = CreateTempFileName();
+    WriteFile(fileName, CreateZipArchive(TEST_ENTRIES));
+    ZippedAssetPackage package(fileName, std::shared_ptr<AssetPackage>());
+    std::remove(fileName.c_str());
+    package.setCacheCapacity(0);
+
+    std::vector<int> failures(8, 0);
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < failures.size(); i++) {
+        threads.emplace_back([&package, &failures, i]() {
+            for (int j = 0; j < 20; j++) {
+                const ZipEntry& entry = TEST_ENTRIES[(i + j) % TEST_ENTRIES.size()];
+                std::shared_ptr<BinaryData> data = package.loadAsset(entry.name);
+                if (!data || AssetString(data) != entry.data) {
+                    failures[i]++;
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    for (int failureCount : failures) {
+        CARTO_CHECK_EQUAL(0, failureCount);
+    }
+}
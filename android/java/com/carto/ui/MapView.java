@@ -5,9 +5,11 @@ import java.lang.reflect.Method;
 import javax.microedition.khronos.egl.EGLConfig;
 import javax.microedition.khronos.opengles.GL10;
 
+import android.content.ComponentCallbacks2;
 import android.content.Context;
 import android.content.SharedPreferences;
 import android.content.res.AssetManager;
+import android.content.res.Configuration;
 import android.content.res.TypedArray;
 import android.opengl.GLSurfaceView;
 import android.opengl.GLSurfaceView.Renderer;
@@ -52,6 +54,7 @@ public class MapView extends GLSurfaceView implements Renderer {
     }
     
     private static AssetManager assetManager;
+    private static ComponentCallbacks2 memoryCallbacks;
     
     private BaseMapView baseMapView;
     
@@ -141,6 +144,9 @@ public class MapView extends GLSurfaceView implements Renderer {
             // Set asset manager pointer to allow native access to assets
             assetManager = context.getApplicationContext().getAssets();
             AssetUtils.setAssetManagerPointer(assetManager);
+
+            // Release cached map data when the system is running low on memory
+            registerMemoryCallbacks(context);
         
             baseMapView = new BaseMapView();
             baseMapView.getOptions().setDPI(getResources().getDisplayMetrics().densityDpi);
@@ -159,6 +165,31 @@ public class MapView extends GLSurfaceView implements Renderer {
         }
     }
 
+    private static synchronized void registerMemoryCallbacks(Context context) {
+        if (memoryCallbacks != null) {
+            return;
+        }
+        memoryCallbacks = new ComponentCallbacks2() {
+            @Override
+            public void onTrimMemory(int level) {
+                // Moving to background (TRIM_MEMORY_UI_HIDDEN, TRIM_MEMORY_BACKGROUND) is not a reason to release the caches
+                if (level == TRIM_MEMORY_RUNNING_LOW || level == TRIM_MEMORY_RUNNING_CRITICAL || level == TRIM_MEMORY_COMPLETE) {
+                    BaseMapView.onLowMemory();
+                }
+            }
+
+            @Override
+            public void onLowMemory() {
+                BaseMapView.onLowMemory();
+            }
+
+            @Override
+            public void onConfigurationChanged(Configuration newConfig) {
+            }
+        };
+        context.getApplicationContext().registerComponentCallbacks(memoryCallbacks);
+    }
+
     /**
      * Deletes the resources associated with the MapView.
      * The method can be used to dispose native objects immediately,
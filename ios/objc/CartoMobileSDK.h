@@ -170,6 +170,7 @@
 #import "NTPackageInfo.h"
 #import "NTPackageStatus.h"
 #import "NTPackageTileMask.h"
+#import "NTPackageTileLoadStatistics.h"
 #import "NTPackageManager.h"
 #import "NTCartoPackageManager.h"
 
@@ -181,6 +182,7 @@
 #import "NTGeocodingResult.h"
 #import "NTReverseGeocodingRequest.h"
 #import "NTGeocodingService.h"
+#import "NTGeocodingSession.h"
 #import "NTReverseGeocodingService.h"
 #import "NTPackageManagerGeocodingService.h"
 #import "NTPackageManagerReverseGeocodingService.h"
@@ -205,6 +207,8 @@
 #import "NTRoutingInstruction.h"
 #import "NTRoutingRequest.h"
 #import "NTRoutingResult.h"
+#import "NTRoutingMatrixRequest.h"
+#import "NTRoutingMatrixResult.h"
 #import "NTRoutingService.h"
 #import "NTRouteMatchingRequest.h"
 #import "NTRouteMatchingResult.h"
@@ -65,6 +65,7 @@ static const int NATIVE_NO_COORDINATE = -1;
 
     [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(appDidEnterBackground) name:UIApplicationDidEnterBackgroundNotification object:nil];
     [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(appWillEnterForeground) name:UIApplicationWillEnterForegroundNotification object:nil];
+    [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(appDidReceiveMemoryWarning) name:UIApplicationDidReceiveMemoryWarningNotification object:nil];
 
     _active = YES;
 
@@ -195,6 +196,7 @@ static const int NATIVE_NO_COORDINATE = -1;
 
     [[NSNotificationCenter defaultCenter] removeObserver:self name:UIApplicationDidEnterBackgroundNotification object:nil];
     [[NSNotificationCenter defaultCenter] removeObserver:self name:UIApplicationWillEnterForegroundNotification object:nil];
+    [[NSNotificationCenter defaultCenter] removeObserver:self name:UIApplicationDidReceiveMemoryWarningNotification object:nil];
 }
 
 -(void)appDidEnterBackground {
@@ -226,6 +228,12 @@ static const int NATIVE_NO_COORDINATE = -1;
     [self setNeedsDisplay];
 }
 
+-(void)appDidReceiveMemoryWarning {
+    carto::Log::Info("MapView::appDidReceiveMemoryWarning");
+
+    [NTBaseMapView onLowMemory];
+}
+
 -(void)transformScreenCoord:(CGPoint*)screenCoord {
     screenCoord->x *= _scale;
     screenCoord->y *= _scale;